@@ -0,0 +1,67 @@
+#ifndef WASABI_COMMAND_QUEUE_HPP
+#define WASABI_COMMAND_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// Single-producer/single-consumer lock-free queue of small messages (such as the commands sent to the render thread).
+//
+// The slots are preallocated and the messages are copied in and out of them, so neither side ever allocates, locks or
+// waits: a full queue makes push() fail and an empty one makes pop() fail, which the caller handles without blocking.
+// As in the ring buffer, the positions are monotonic, published with release semantics and observed with acquire
+// semantics, and each one lives on its own cache line. The capacity must be a power of two.
+template<typename T, size_t capacity>
+class CommandQueue {
+private:
+	static_assert(capacity > 0 && (capacity & (capacity - 1)) == 0, "The capacity must be a power of two");
+
+	// Write position, owned by the producer
+	alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> head{};
+
+	// Read position, owned by the consumer
+	alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> tail{};
+
+	alignas(CACHE_LINE_SIZE) T slots[capacity]{};
+
+public:
+	CommandQueue() = default;
+
+	CommandQueue(CommandQueue const &command_queue) = delete;
+
+	CommandQueue &operator=(CommandQueue const &command_queue) = delete;
+
+	// Producer side, returns false (dropping the message) if the queue is full
+	bool push(const T &message) {
+		uint64_t position = this->head.load(std::memory_order_relaxed);
+
+		if (position - this->tail.load(std::memory_order_acquire) == capacity) {
+			return false;
+		}
+
+		this->slots[position & (capacity - 1)] = message;
+		this->head.store(position + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	// Consumer side, returns false if there is no message waiting
+	bool pop(T &message) {
+		uint64_t position = this->tail.load(std::memory_order_relaxed);
+
+		if (position == this->head.load(std::memory_order_acquire)) {
+			return false;
+		}
+
+		message = this->slots[position & (capacity - 1)];
+		this->tail.store(position + 1, std::memory_order_release);
+
+		return true;
+	}
+};
+
+#endif //WASABI_COMMAND_QUEUE_HPP
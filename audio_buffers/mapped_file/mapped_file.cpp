@@ -0,0 +1,188 @@
+#include "mapped_file.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() = default;
+
+MappedFile::~MappedFile() {
+	this->close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string &file_path) {
+	this->close();
+
+	// Opens the file hinting the cache manager that it will be read sequentially
+	this->file_handle = CreateFileA(file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	if (this->file_handle == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	// Only regular disk files can be mapped
+	LARGE_INTEGER file_size;
+
+	if (GetFileType(this->file_handle) != FILE_TYPE_DISK || !GetFileSizeEx(this->file_handle, &file_size) ||
+		file_size.QuadPart == 0) {
+		this->close();
+
+		return false;
+	}
+
+	this->mapping_handle = CreateFileMappingA(this->file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (this->mapping_handle == nullptr) {
+		this->close();
+
+		return false;
+	}
+
+	this->data = (const uint8_t*)MapViewOfFile(this->mapping_handle, FILE_MAP_READ, 0, 0, 0);
+
+	if (this->data == nullptr) {
+		this->close();
+
+		return false;
+	}
+
+	this->size = (uint64_t)file_size.QuadPart;
+
+	return true;
+}
+
+void MappedFile::close() {
+	// Frees all allocated resources
+	if (this->data != nullptr) {
+		UnmapViewOfFile(this->data);
+	}
+
+	if (this->mapping_handle != nullptr) {
+		CloseHandle(this->mapping_handle);
+	}
+
+	if (this->file_handle != INVALID_HANDLE_VALUE) {
+		CloseHandle(this->file_handle);
+	}
+
+	this->data = nullptr;
+	this->size = 0;
+	this->mapping_handle = nullptr;
+	this->file_handle = INVALID_HANDLE_VALUE;
+}
+
+void MappedFile::advise_sequential(uint64_t offset, uint64_t length) {
+	// The sequential access hint was already given when opening the file
+}
+
+void MappedFile::prefetch(uint64_t offset, uint64_t length) {
+	// Asks the memory manager to start reading the range ahead of the consumer
+	if (offset >= this->size) {
+		return;
+	}
+
+	if (offset + length > this->size) {
+		length = this->size - offset;
+	}
+
+	WIN32_MEMORY_RANGE_ENTRY range;
+
+	range.VirtualAddress = (PVOID)(this->data + offset);
+	range.NumberOfBytes = (SIZE_T)length;
+
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+#else
+
+bool MappedFile::open(const std::string &file_path) {
+	this->close();
+
+	this->file_descriptor = ::open(file_path.c_str(), O_RDONLY);
+
+	if (this->file_descriptor == -1) {
+		return false;
+	}
+
+	// Only regular files can be mapped
+	struct stat file_status{};
+
+	if (fstat(this->file_descriptor, &file_status) != 0 || !S_ISREG(file_status.st_mode) ||
+		file_status.st_size == 0) {
+		this->close();
+
+		return false;
+	}
+
+	void *mapping = mmap(nullptr, (size_t)file_status.st_size, PROT_READ, MAP_SHARED, this->file_descriptor, 0);
+
+	if (mapping == MAP_FAILED) {
+		this->close();
+
+		return false;
+	}
+
+	this->data = (const uint8_t*)mapping;
+	this->size = (uint64_t)file_status.st_size;
+
+	return true;
+}
+
+void MappedFile::close() {
+	// Frees all allocated resources
+	if (this->data != nullptr) {
+		munmap((void*)this->data, (size_t)this->size);
+	}
+
+	if (this->file_descriptor != -1) {
+		::close(this->file_descriptor);
+	}
+
+	this->data = nullptr;
+	this->size = 0;
+	this->file_descriptor = -1;
+}
+
+void MappedFile::advise_sequential(uint64_t offset, uint64_t length) {
+	// madvise requires a page aligned start address
+	uint64_t page_size = (uint64_t)sysconf(_SC_PAGESIZE);
+	uint64_t aligned_offset = offset - (offset % page_size);
+
+	madvise((void*)(this->data + aligned_offset), (size_t)(length + offset - aligned_offset), MADV_SEQUENTIAL);
+}
+
+void MappedFile::prefetch(uint64_t offset, uint64_t length) {
+	// Asks the kernel to start reading the range ahead of the consumer
+	if (offset >= this->size) {
+		return;
+	}
+
+	if (offset + length > this->size) {
+		length = this->size - offset;
+	}
+
+	uint64_t page_size = (uint64_t)sysconf(_SC_PAGESIZE);
+	uint64_t aligned_offset = offset - (offset % page_size);
+
+	madvise((void*)(this->data + aligned_offset), (size_t)(length + offset - aligned_offset), MADV_WILLNEED);
+}
+
+#endif
+
+bool MappedFile::is_open() const {
+	return this->data != nullptr;
+}
+
+const uint8_t *MappedFile::get_data() const {
+	return this->data;
+}
+
+uint64_t MappedFile::get_size() const {
+	return this->size;
+}
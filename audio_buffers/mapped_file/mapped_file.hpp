@@ -0,0 +1,51 @@
+#ifndef WASABI_MAPPED_FILE_HPP
+#define WASABI_MAPPED_FILE_HPP
+
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Read-only memory mapping of a whole regular file.
+//
+// The pages are shared with the page cache, so several readers mapping the same file don't duplicate its data.
+// Opening fails on anything that can't be mapped (pipes, character devices, empty files...), in which case the
+// caller is expected to fall back to regular streaming reads.
+class MappedFile {
+private:
+	const uint8_t *data{};
+	uint64_t size{};
+#ifdef _WIN32
+	HANDLE file_handle{INVALID_HANDLE_VALUE};
+	HANDLE mapping_handle{};
+#else
+	int file_descriptor{-1};
+#endif
+
+public:
+	MappedFile();
+
+	MappedFile(MappedFile const &mapped_file) = delete;
+
+	MappedFile &operator=(MappedFile const &mapped_file) = delete;
+
+	~MappedFile();
+
+	bool open(const std::string &file_path);
+
+	void close();
+
+	bool is_open() const;
+
+	const uint8_t *get_data() const;
+
+	uint64_t get_size() const;
+
+	void advise_sequential(uint64_t offset, uint64_t length);
+
+	void prefetch(uint64_t offset, uint64_t length);
+};
+
+#endif //WASABI_MAPPED_FILE_HPP
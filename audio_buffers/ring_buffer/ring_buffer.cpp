@@ -0,0 +1,223 @@
+#include "ring_buffer.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+RingBuffer::RingBuffer() = default;
+
+RingBuffer::~RingBuffer() {
+	// Frees all allocated memory
+	free(this->data);
+}
+
+bool RingBuffer::allocate(size_t buffer_capacity) {
+	// Allocates the storage once, it is reused for the whole lifetime of the stream
+	free(this->data);
+
+	this->data = buffer_capacity != 0 ? (uint8_t*)malloc(buffer_capacity) : nullptr;
+	this->capacity = this->data != nullptr ? buffer_capacity : 0;
+	this->head.store(0, std::memory_order_relaxed);
+	this->tail.store(0, std::memory_order_relaxed);
+	this->cached_head = 0;
+	this->cached_tail = 0;
+	// A buffer without storage stays closed, so neither side ever waits on it or indexes it
+	this->closed.store(this->data == nullptr, std::memory_order_relaxed);
+
+	return this->data != nullptr;
+}
+
+size_t RingBuffer::get_capacity() const {
+	return this->capacity;
+}
+
+size_t RingBuffer::get_readable_size() {
+	return (size_t)(this->head.load(std::memory_order_acquire) - this->tail.load(std::memory_order_relaxed));
+}
+
+size_t RingBuffer::get_writable_size() {
+	return this->capacity - (size_t)(this->head.load(std::memory_order_relaxed) - this->tail.load(std::memory_order_acquire));
+}
+
+void RingBuffer::notify() {
+	// Orders the position update before the waiters check, so a waiter either sees the new position or gets notified
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	if (this->num_waiters.load(std::memory_order_relaxed) > 0) {
+		std::lock_guard<std::mutex> lck(this->mtx);
+		this->cv.notify_all();
+	}
+}
+
+size_t RingBuffer::acquire_write(uint8_t **buffer) {
+	uint64_t write_position = this->head.load(std::memory_order_relaxed);
+
+	// Only reloads the consumer position when the cached one says the buffer is full
+	if (write_position - this->cached_tail == this->capacity) {
+		this->cached_tail = this->tail.load(std::memory_order_acquire);
+	}
+
+	size_t writable = this->capacity - (size_t)(write_position - this->cached_tail);
+	size_t offset = (size_t)(write_position % this->capacity);
+
+	*buffer = this->data + offset;
+
+	// Returns the contiguous free space up to the end of the storage
+	return std::min(writable, this->capacity - offset);
+}
+
+void RingBuffer::commit_write(size_t size) {
+	if (size == 0) {
+		return;
+	}
+
+	this->head.store(this->head.load(std::memory_order_relaxed) + size, std::memory_order_release);
+	this->notify();
+}
+
+size_t RingBuffer::write(const uint8_t *buffer, size_t size) {
+	size_t written = 0;
+	uint8_t *span;
+	size_t span_size;
+
+	// Copies as much as fits, in at most two contiguous spans (before and after wrapping around)
+	while (written < size && (span_size = this->acquire_write(&span)) > 0) {
+		span_size = std::min(span_size, size - written);
+
+		memcpy(span, buffer + written, span_size);
+		this->head.store(this->head.load(std::memory_order_relaxed) + span_size, std::memory_order_release);
+
+		written += span_size;
+	}
+
+	if (written > 0) {
+		this->notify();
+	}
+
+	return written;
+}
+
+bool RingBuffer::wait_for_writable(size_t size) {
+	size = std::min(size, this->capacity);
+
+	if (this->get_writable_size() >= size || this->closed.load(std::memory_order_acquire)) {
+		return !this->closed.load(std::memory_order_acquire);
+	}
+
+	std::unique_lock<std::mutex> lck(this->mtx);
+
+	this->num_waiters.fetch_add(1, std::memory_order_seq_cst);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	this->cv.wait(lck, [&] {
+		return this->get_writable_size() >= size || this->closed.load(std::memory_order_acquire);
+	});
+	this->num_waiters.fetch_sub(1, std::memory_order_relaxed);
+
+	return !this->closed.load(std::memory_order_acquire);
+}
+
+void RingBuffer::close() {
+	this->closed.store(true, std::memory_order_release);
+
+	// Wakes up both sides unconditionally, closing is not on the hot path
+	std::lock_guard<std::mutex> lck(this->mtx);
+	this->cv.notify_all();
+}
+
+size_t RingBuffer::acquire_read(const uint8_t **buffer) {
+	uint64_t read_position = this->tail.load(std::memory_order_relaxed);
+
+	// Only reloads the producer position when the cached one says the buffer is empty
+	if (this->cached_head == read_position) {
+		this->cached_head = this->head.load(std::memory_order_acquire);
+	}
+
+	size_t readable = (size_t)(this->cached_head - read_position);
+	size_t offset = (size_t)(read_position % this->capacity);
+
+	*buffer = this->data + offset;
+
+	// Returns the contiguous readable data up to the end of the storage
+	return std::min(readable, this->capacity - offset);
+}
+
+void RingBuffer::commit_read(size_t size) {
+	if (size == 0) {
+		return;
+	}
+
+	this->tail.store(this->tail.load(std::memory_order_relaxed) + size, std::memory_order_release);
+	this->notify();
+}
+
+size_t RingBuffer::read(uint8_t *buffer, size_t size) {
+	uint64_t read_position = this->tail.load(std::memory_order_relaxed);
+
+	// Only reloads the producer position when the cached one doesn't hold enough data
+	if (this->cached_head - read_position < size) {
+		this->cached_head = this->head.load(std::memory_order_acquire);
+	}
+
+	size = std::min(size, (size_t)(this->cached_head - read_position));
+
+	if (size == 0) {
+		return 0;
+	}
+
+	size_t offset = (size_t)(read_position % this->capacity);
+	size_t first_span_size = std::min(size, this->capacity - offset);
+
+	memcpy(buffer, this->data + offset, first_span_size);
+	memcpy(buffer + first_span_size, this->data, size - first_span_size);
+
+	this->tail.store(read_position + size, std::memory_order_release);
+	this->notify();
+
+	return size;
+}
+
+bool RingBuffer::wait_for_readable(size_t size) {
+	return this->wait_for_readable(size, std::chrono::milliseconds::max());
+}
+
+bool RingBuffer::wait_for_readable(size_t size, std::chrono::milliseconds timeout) {
+	size = std::min(size, this->capacity);
+
+	if (this->get_readable_size() < size && !this->closed.load(std::memory_order_acquire)) {
+		std::unique_lock<std::mutex> lck(this->mtx);
+		auto is_ready = [&] {
+			return this->get_readable_size() >= size || this->closed.load(std::memory_order_acquire);
+		};
+
+		this->num_waiters.fetch_add(1, std::memory_order_seq_cst);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (timeout == std::chrono::milliseconds::max()) {
+			this->cv.wait(lck, is_ready);
+		} else {
+			this->cv.wait_for(lck, timeout, is_ready);
+		}
+
+		this->num_waiters.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	return this->get_readable_size() > 0;
+}
+
+bool RingBuffer::is_closed() {
+	return this->closed.load(std::memory_order_acquire);
+}
+
+bool RingBuffer::is_drained() {
+	return this->closed.load(std::memory_order_acquire) && this->get_readable_size() == 0;
+}
+
+void RingBuffer::reset() {
+	this->head.store(0, std::memory_order_relaxed);
+	this->tail.store(0, std::memory_order_relaxed);
+	this->cached_head = 0;
+	this->cached_tail = 0;
+
+	// Publishes the positions along with the reopening (the thread using the buffer next synchronizes with it), a
+	// buffer without storage stays closed
+	this->closed.store(this->data == nullptr, std::memory_order_release);
+}
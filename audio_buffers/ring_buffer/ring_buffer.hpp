@@ -0,0 +1,90 @@
+#ifndef WASABI_RING_BUFFER_HPP
+#define WASABI_RING_BUFFER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#define CACHE_LINE_SIZE 64
+
+// Single-producer/single-consumer lock-free byte ring buffer.
+//
+// The producer only advances the write position and the consumer only advances the read position, both are
+// published with release semantics and observed with acquire semantics, so the data path never takes a lock.
+// Each position lives on its own cache line to avoid false sharing between the two threads. When one side has to
+// wait for the other, it falls back to a condition variable that the other side only signals if someone is waiting.
+class RingBuffer {
+private:
+	// Write position (monotonic, in bytes), owned by the producer
+	alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> head{};
+	// Last read position observed by the producer
+	uint64_t cached_tail{};
+
+	// Read position (monotonic, in bytes), owned by the consumer
+	alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> tail{};
+	// Last write position observed by the consumer
+	uint64_t cached_head{};
+
+	alignas(CACHE_LINE_SIZE) std::atomic<bool> closed{};
+	std::atomic<uint32_t> num_waiters{};
+	std::mutex mtx;
+	std::condition_variable cv;
+
+	uint8_t *data{};
+	size_t capacity{};
+
+	void notify();
+
+public:
+	RingBuffer();
+
+	RingBuffer(RingBuffer const &ring_buffer) = delete;
+
+	RingBuffer &operator=(RingBuffer const &ring_buffer) = delete;
+
+	~RingBuffer();
+
+	// Allocates the storage and empties the buffer. Returns false when the storage can't be allocated, the buffer is
+	// then left closed with a capacity of 0
+	bool allocate(size_t buffer_capacity);
+
+	size_t get_capacity() const;
+
+	size_t get_readable_size();
+
+	size_t get_writable_size();
+
+	// Producer side
+	size_t acquire_write(uint8_t **buffer);
+
+	void commit_write(size_t size);
+
+	size_t write(const uint8_t *buffer, size_t size);
+
+	bool wait_for_writable(size_t size);
+
+	void close();
+
+	// Consumer side
+	size_t acquire_read(const uint8_t **buffer);
+
+	void commit_read(size_t size);
+
+	size_t read(uint8_t *buffer, size_t size);
+
+	bool wait_for_readable(size_t size);
+
+	bool wait_for_readable(size_t size, std::chrono::milliseconds timeout);
+
+	bool is_closed();
+
+	bool is_drained();
+
+	// Discards the buffered data and reopens the buffer, neither side must be using it when it is called
+	void reset();
+};
+
+#endif //WASABI_RING_BUFFER_HPP
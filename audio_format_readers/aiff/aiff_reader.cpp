@@ -0,0 +1,333 @@
+#include "aiff_reader.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+static uint16_t read_uint16_be(const uint8_t *data) {
+	return (uint16_t)((data[0] << 8) | data[1]);
+}
+
+static uint32_t read_uint32_be(const uint8_t *data) {
+	return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+}
+
+// Reads an 80 bits IEEE 754 extended precision number (sign, 15 bits exponent, then a 64 bits mantissa whose integer
+// bit is explicit), as the sample rate of the COMM chunk is stored
+static double read_extended(const uint8_t *data) {
+	int exponent = ((data[0] & 0x7F) << 8) | data[1];
+	uint64_t mantissa = ((uint64_t)read_uint32_be(data + 2) << 32) | read_uint32_be(data + 6);
+
+	if (exponent == 0x7FFF) {
+		return NAN;
+	}
+
+	double value = ldexp((double)mantissa, exponent - 16383 - 63);
+
+	return (data[0] & 0x80) != 0 ? -value : value;
+}
+
+bool AIFFReader::load_header(std::shared_ptr<std::ifstream> file) {
+	this->report() << "\nChecking the file header..." << std::endl;
+
+	this->chunks.clear();
+	this->header.clear();
+	this->header_offset = 0;
+	this->file_size = 0;
+
+	if (!this->read_header_region(file, 0) || this->header.size() < 12) {
+		std::cerr << "ERROR: The file is too short to be an AIFF file." << std::endl;
+
+		return false;
+	}
+
+	// Checks the FORM header (AIFC files share its layout)
+	this->is_aifc = memcmp(this->header.data() + 8, "AIFC", 4) == 0;
+
+	if (memcmp(this->header.data(), "FORM", 4) != 0 ||
+		(memcmp(this->header.data() + 8, "AIFF", 4) != 0 && !this->is_aifc)) {
+		std::cerr << "ERROR: Invalid FORM header, the file isn't an AIFF file." << std::endl;
+
+		return false;
+	}
+
+	memcpy(this->chunk_id, this->header.data(), 4);
+	memcpy(this->format_descriptor, this->header.data() + 8, 4);
+	this->chunk_size = read_uint32_be(this->header.data() + 4);
+
+	// Gets the size of the file (if it can be seeked) to bound the chunks with unset or truncated sizes (files shorter
+	// than the header region leave the stream failed after the read)
+	uint64_t header_end = this->header.size();
+
+	file->clear();
+
+	if (file->seekg(0, std::ios::end)) {
+		this->file_size = (uint64_t)file->tellg();
+
+		file->seekg((std::streamoff)header_end);
+	}
+
+	file->clear();
+
+	this->report() << "FORM header: Ok (" << (this->is_aifc ? "AIFC" : "AIFF") << ", " << this->chunk_size << " bytes)."
+		<< std::endl;
+
+	// Walks the chunks (each one is an ID, a big-endian size and its data padded to an even size) until the 'SSND'
+	// chunk, which is indexed but not read
+	uint64_t offset = 12;
+	std::vector<uint8_t> comm_data;
+	bool has_comm_chunk = false;
+
+	while (true) {
+		if (offset + 8 > this->header_offset + this->header.size()) {
+			// The chunk header lies after the region read so far (a large chunk was skipped)
+			if (this->header.size() < WAV_HEADER_READ_SIZE || !this->read_header_region(file, offset) ||
+				this->header.size() < 8) {
+				std::cerr << "ERROR: The file has no 'SSND' chunk." << std::endl;
+
+				return false;
+			}
+		}
+
+		const uint8_t *chunk_header = this->header.data() + (offset - this->header_offset);
+		RIFF_CHUNK chunk;
+
+		memcpy(chunk.id, chunk_header, 4);
+		chunk.id[4] = '\0';
+		chunk.offset = offset + 8;
+		chunk.size = read_uint32_be(chunk_header + 4);
+
+		this->chunks.push_back(chunk);
+
+		// Keeps the format fields, the region they are in may be replaced while looking for the 'SSND' chunk
+		if (memcmp(chunk.id, "COMM", 4) == 0) {
+			size_t comm_offset = std::min<size_t>(chunk.offset - this->header_offset, this->header.size());
+			size_t comm_size = std::min<size_t>(std::min<uint64_t>(chunk.size, AIFC_COMM_SIZE),
+				this->header.size() - comm_offset);
+
+			comm_data.assign(this->header.begin() + (std::ptrdiff_t)comm_offset,
+				this->header.begin() + (std::ptrdiff_t)(comm_offset + comm_size));
+			has_comm_chunk = true;
+		}
+
+		if (memcmp(chunk.id, "SSND", 4) == 0) {
+			break;
+		}
+
+		offset = chunk.offset + chunk.size + (chunk.size & 1);
+	}
+
+	this->report() << "Chunks:";
+
+	for (const RIFF_CHUNK &indexed_chunk : this->chunks) {
+		this->report() << " '" << indexed_chunk.id << "' (" << indexed_chunk.size << " bytes)";
+	}
+
+	this->report() << std::endl;
+
+	if (!has_comm_chunk) {
+		std::cerr << "ERROR: The file has no 'COMM' chunk before its 'SSND' chunk." << std::endl;
+
+		return false;
+	}
+
+	return this->load_comm_chunk(comm_data.data(), comm_data.size()) && this->load_ssnd_chunk(file, this->chunks.back());
+}
+
+bool AIFFReader::load_comm_chunk(const uint8_t *data, uint64_t size) {
+	this->report() << "\nReading the 'COMM' chunk..." << std::endl;
+
+	if (size < (this->is_aifc ? AIFC_COMM_SIZE : AIFF_COMM_SIZE)) {
+		std::cerr << "ERROR: Bad 'COMM' chunk size (" << size << " bytes)." << std::endl;
+
+		return false;
+	}
+
+	uint16_t file_num_channels = read_uint16_be(data);
+	uint32_t file_num_sample_frames = read_uint32_be(data + 2);
+	uint16_t file_sample_size = read_uint16_be(data + 6);
+	double file_sample_rate = read_extended(data + 8);
+	bool is_float = false;
+
+	this->num_sample_frames = file_num_sample_frames;
+
+	// Checks the compression type (AIFC files only, the uncompressed ones store their samples like AIFF files)
+	if (this->is_aifc) {
+		memcpy(this->compression_type, data + 18, 4);
+
+		if (memcmp(this->compression_type, "NONE", 4) == 0 || memcmp(this->compression_type, "twos", 4) == 0 ||
+			memcmp(this->compression_type, "in24", 4) == 0 || memcmp(this->compression_type, "in32", 4) == 0) {
+			this->is_big_endian = true;
+		}
+		else if (memcmp(this->compression_type, "sowt", 4) == 0) {
+			// Little-endian samples, which are still signed at 8 bits
+			this->is_big_endian = file_sample_size <= 8;
+		}
+		else if (memcmp(this->compression_type, "raw ", 4) == 0 && file_sample_size <= 8) {
+			// Unsigned 8 bits samples, as WAV files store them
+			this->is_big_endian = false;
+		}
+		else if ((memcmp(this->compression_type, "fl32", 4) == 0 || memcmp(this->compression_type, "FL32", 4) == 0) &&
+			file_sample_size == 32) {
+			this->is_big_endian = true;
+			is_float = true;
+		}
+		else {
+			std::cerr << "ERROR: Bad compression type ('" << this->compression_type << "'), only uncompressed (NONE, "
+				"twos, sowt, raw, in24, in32) and 32 bits float (fl32) AIFC files are currently supported." << std::endl;
+
+			return false;
+		}
+
+		this->report() << "Compression type: Ok ('" << this->compression_type << "')." << std::endl;
+	}
+
+	this->audio_format = is_float ? WAV_FORMAT_IEEE_FLOAT : WAV_FORMAT_PCM;
+
+	// Checks the number of channels
+	if (file_num_channels >= 1 && file_num_channels <= MAX_NUM_CHANNELS) {
+		if (file_num_channels == 1) {
+			this->report() << "Number of channels: 1 (mono)" << std::endl;
+		}
+		else if (file_num_channels == 2) {
+			this->report() << "Number of channels: 2 (stereo)" << std::endl;
+		}
+		else {
+			this->report() << "Number of channels: " << file_num_channels << std::endl;
+		}
+
+		this->num_channels = file_num_channels;
+	}
+	else {
+		std::cerr << "ERROR: Bad number of channels, only audio files with up to " << MAX_NUM_CHANNELS
+			<< " channels are currently supported." << std::endl;
+
+		return false;
+	}
+
+	// Checks the sample rate (stored as a real number, which is rounded)
+	if (file_sample_rate >= MIN_SAMPLE_RATE && file_sample_rate <= MAX_SAMPLE_RATE) {
+		this->sample_rate = (uint32_t)lround(file_sample_rate);
+
+		if (std::fabs(file_sample_rate - this->sample_rate) > 0.001) {
+			this->report() << "WARNING: Fractional sample rate (" << file_sample_rate << " Hz), " << this->sample_rate
+				<< " Hz will be used instead." << std::endl;
+		}
+		else {
+			this->report() << "Sample rate: Ok (" << this->sample_rate << " Hz)." << std::endl;
+		}
+	}
+	else {
+		std::cerr << "ERROR: Bad sample rate, only audio files sampled between " << MIN_SAMPLE_RATE << " and "
+			<< MAX_SAMPLE_RATE << " Hz are currently supported." << std::endl;
+
+		return false;
+	}
+
+	// Checks the bit depth (the samples are left-justified in whole bytes, which are decoded as a whole)
+	if (file_sample_size >= 1 && file_sample_size <= 32) {
+		this->bit_depth = (uint16_t)((file_sample_size + 7) / 8 * 8);
+
+		this->report() << "Bit Depth: Ok (" << file_sample_size << " bits";
+
+		if (this->bit_depth != file_sample_size) {
+			this->report() << " in " << this->bit_depth << " bits samples";
+		}
+
+		this->report() << ")." << std::endl;
+	}
+	else {
+		std::cerr << "ERROR: Invalid bit depth (" << file_sample_size << " bits)." << std::endl;
+
+		return false;
+	}
+
+	// Computes the block alignment and the byte rate, which AIFF files don't store
+	this->block_align = (uint16_t)(this->num_channels * (this->bit_depth / 8));
+	this->byte_rate = this->sample_rate * this->block_align;
+
+	// AIFF files have no channel mask, the channels are assumed to follow the default layout for their number
+	this->channel_mask = get_default_channel_mask(this->num_channels);
+
+	return true;
+}
+
+bool AIFFReader::load_ssnd_chunk(std::shared_ptr<std::ifstream> file, const RIFF_CHUNK &ssnd_chunk) {
+	this->report() << "\nReading the 'SSND' chunk..." << std::endl;
+
+	memcpy(this->data_subchunk_id, ssnd_chunk.id, 4);
+
+	// The samples start after the offset and block size fields, and after as many bytes as the offset says (used to
+	// align the samples to blocks, which is rare)
+	if (ssnd_chunk.offset + AIFF_SSND_HEADER_SIZE > this->header_offset + this->header.size() &&
+		(!this->read_header_region(file, ssnd_chunk.offset) || this->header.size() < AIFF_SSND_HEADER_SIZE)) {
+		std::cerr << "ERROR: The 'SSND' chunk is truncated." << std::endl;
+
+		return false;
+	}
+
+	const uint8_t *ssnd = this->header.data() + (ssnd_chunk.offset - this->header_offset);
+	uint32_t data_skip = read_uint32_be(ssnd);
+
+	this->data_offset = ssnd_chunk.offset + AIFF_SSND_HEADER_SIZE + data_skip;
+
+	// Streaming writers leave the size unset, the samples then go on until the end of the file (or until the number
+	// of frames of the COMM chunk, when it is set)
+	uint64_t available_size = this->file_size > this->data_offset ? this->file_size - this->data_offset : 0;
+	uint64_t declared_size = ssnd_chunk.size > AIFF_SSND_HEADER_SIZE + (uint64_t)data_skip ?
+		ssnd_chunk.size - AIFF_SSND_HEADER_SIZE - data_skip : 0;
+
+	this->is_data_size_known = true;
+
+	if (ssnd_chunk.size == 0 || ssnd_chunk.size == UINT32_MAX) {
+		this->report() << "WARNING: Unset 'SSND' chunk size, the samples will be read until the end of the file."
+			<< std::endl;
+
+		this->is_data_size_known = this->file_size != 0 || this->num_sample_frames != 0;
+		this->data_subchunk_size = this->file_size != 0 ? available_size : UINT64_MAX;
+	}
+	else if (this->file_size != 0 && declared_size > available_size) {
+		this->report() << "WARNING: Truncated 'SSND' chunk (" << declared_size << " bytes declared, " << available_size
+			<< " bytes available)." << std::endl;
+
+		this->data_subchunk_size = available_size;
+	}
+	else {
+		this->report() << "SSND chunk size: Ok (" << ssnd_chunk.size << " bytes)." << std::endl;
+
+		this->data_subchunk_size = declared_size;
+	}
+
+	if (this->num_sample_frames != 0) {
+		this->data_subchunk_size = std::min(this->data_subchunk_size, this->num_sample_frames * this->block_align);
+	}
+
+	// Only whole frames are read
+	this->data_subchunk_size -= this->data_subchunk_size % this->block_align;
+
+	double duration = this->get_duration();
+
+	this->audio_duration.minutes = (int)(duration / 60);
+	this->audio_duration.seconds = (int)(duration - this->audio_duration.minutes * 60.0);
+
+	// The samples read along with the header are handed to the data loader, so they aren't read twice (nor lost on
+	// pipes). When they start past the region read so far, the file is moved to them
+	if (this->data_offset > this->header_offset + this->header.size() &&
+		!this->read_header_region(file, this->data_offset)) {
+		this->header.clear();
+	}
+
+	this->prefetched_data.assign(this->header.begin() + (std::ptrdiff_t)std::min<uint64_t>(
+		this->data_offset - this->header_offset, this->header.size()), this->header.end());
+
+	return true;
+}
+
+AUDIO_FORMAT AIFFReader::get_format() {
+	AUDIO_FORMAT format = WAVReader::get_format();
+
+	format.is_big_endian = this->is_big_endian;
+
+	return format;
+}
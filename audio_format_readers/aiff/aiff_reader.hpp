@@ -0,0 +1,39 @@
+#ifndef WASABI_AIFF_READER_HPP
+#define WASABI_AIFF_READER_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include "wav_reader.hpp"
+
+// Sizes of the fixed fields of the COMM chunk (AIFC adds the compression type, its name is skipped)
+#define AIFF_COMM_SIZE 18
+#define AIFC_COMM_SIZE 22
+
+// Size of the fields preceding the samples in the SSND chunk (offset and block size)
+#define AIFF_SSND_HEADER_SIZE 8
+
+// Reader of AIFF and AIFC files. Their samples are laid out like the ones of WAV files (interleaved frames in a single
+// chunk), only most significant byte first, so the reader only parses the header and shares the streaming and memory
+// mapped data paths of the WAV reader. The samples are lent as they are stored, the format converter swaps their bytes
+// while converting them.
+class AIFFReader : public WAVReader {
+private:
+	bool is_aifc{};
+	bool is_big_endian{true};
+	uint64_t num_sample_frames{}; // From the COMM chunk (0 when unset)
+
+	bool load_comm_chunk(const uint8_t *data, uint64_t size);
+
+	bool load_ssnd_chunk(std::shared_ptr<std::ifstream> file, const RIFF_CHUNK &ssnd_chunk);
+
+protected:
+	bool load_header(std::shared_ptr<std::ifstream> file) override;
+
+public:
+	char compression_type[5]{'N', 'O', 'N', 'E'}; // Always "NONE" for AIFF files
+
+	AUDIO_FORMAT get_format() override;
+};
+
+#endif //WASABI_AIFF_READER_HPP
@@ -0,0 +1,101 @@
+#include "decoder_registry.hpp"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+#include "aiff_reader.hpp"
+#include "flac_reader.hpp"
+#include "wav_reader.hpp"
+
+// RIFF, RF64 and BW64 headers, followed by the WAVE form type
+static bool probe_wav(const uint8_t *data, size_t size) {
+	return size >= 12 && (memcmp(data, "RIFF", 4) == 0 || memcmp(data, "RF64", 4) == 0 ||
+		memcmp(data, "BW64", 4) == 0) && memcmp(data + 8, "WAVE", 4) == 0;
+}
+
+static AudioDecoder *create_wav_reader() {
+	return new WAVReader();
+}
+
+static bool probe_flac(const uint8_t *data, size_t size) {
+	return size >= 4 && memcmp(data, "fLaC", 4) == 0;
+}
+
+static AudioDecoder *create_flac_reader() {
+	return new FLACReader();
+}
+
+// FORM header, followed by the AIFF or AIFC form type
+static bool probe_aiff(const uint8_t *data, size_t size) {
+	return size >= 12 && memcmp(data, "FORM", 4) == 0 &&
+		(memcmp(data + 8, "AIFF", 4) == 0 || memcmp(data + 8, "AIFC", 4) == 0);
+}
+
+static AudioDecoder *create_aiff_reader() {
+	return new AIFFReader();
+}
+
+DecoderRegistry::DecoderRegistry() {
+	// The WAV reader comes first, so the streams that can't be probed are read as WAV files
+	this->register_decoder({"WAV", probe_wav, create_wav_reader});
+	this->register_decoder({"FLAC", probe_flac, create_flac_reader});
+	this->register_decoder({"AIFF", probe_aiff, create_aiff_reader});
+}
+
+void DecoderRegistry::register_decoder(const DECODER_TYPE &decoder_type) {
+	this->decoder_types.push_back(decoder_type);
+}
+
+const DECODER_TYPE *DecoderRegistry::find_decoder(const uint8_t *data, size_t size) {
+	for (const DECODER_TYPE &decoder_type : this->decoder_types) {
+		if (decoder_type.probe(data, size)) {
+			return &decoder_type;
+		}
+	}
+
+	return nullptr;
+}
+
+std::unique_ptr<AudioDecoder> DecoderRegistry::open_file(const std::string &file_path, bool use_memory_map,
+	bool is_verbose) {
+	if (this->decoder_types.empty()) {
+		return nullptr;
+	}
+
+	const DECODER_TYPE *decoder_type = &this->decoder_types.front();
+	struct stat file_status{};
+
+	// Reading the first bytes of a pipe would take them from the decoder, so only regular files are probed (the
+	// decoders report the files that don't exist)
+	if (stat(file_path.c_str(), &file_status) == 0 && (file_status.st_mode & S_IFMT) == S_IFREG) {
+		std::ifstream file(file_path, std::ios::in | std::ios::binary);
+		uint8_t data[DECODER_PROBE_SIZE];
+
+		file.read(reinterpret_cast<char *>(data), DECODER_PROBE_SIZE);
+		decoder_type = this->find_decoder(data, (size_t)file.gcount());
+
+		if (decoder_type == nullptr) {
+			std::cerr << "ERROR: Unknown audio file format, only";
+
+			for (size_t i = 0; i < this->decoder_types.size(); i++) {
+				std::cerr << (i == 0 ? " " : i + 1 == this->decoder_types.size() ? " and " : ", ")
+					<< this->decoder_types[i].name;
+			}
+
+			std::cerr << " files are currently supported." << std::endl;
+
+			return nullptr;
+		}
+	}
+
+	std::unique_ptr<AudioDecoder> decoder(decoder_type->create());
+	std::string path = file_path;
+
+	decoder->is_verbose = is_verbose;
+
+	if (!decoder->load_file(&path, use_memory_map)) {
+		return nullptr;
+	}
+
+	return decoder;
+}
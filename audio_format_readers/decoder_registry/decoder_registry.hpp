@@ -0,0 +1,42 @@
+#ifndef WASABI_DECODER_REGISTRY_HPP
+#define WASABI_DECODER_REGISTRY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "audio_decoder.hpp"
+
+// Number of bytes read from the start of a file to find its decoder (the magic bytes of every format fit in them)
+#define DECODER_PROBE_SIZE 16
+
+// Decoder of a file format: its name, how to recognise its files from their first bytes, and how to create it
+typedef struct DECODER_TYPE {
+	const char *name{};
+	// Returns whether the first bytes of a file (at most DECODER_PROBE_SIZE of them) belong to the format
+	bool (*probe)(const uint8_t *data, size_t size){};
+	AudioDecoder *(*create)(){};
+} DECODER_TYPE;
+
+// Registry of the decoders the files are opened with. Every file is probed against the decoders in the order they were
+// registered, from its first bytes rather than its extension. Streams that can't be probed without consuming their
+// data (pipes) are handed to the first decoder registered.
+class DecoderRegistry {
+private:
+	std::vector<DECODER_TYPE> decoder_types;
+
+public:
+	// Registers the built-in decoders
+	DecoderRegistry();
+
+	void register_decoder(const DECODER_TYPE &decoder_type);
+
+	// Gets the decoder of the format the given bytes belong to, returns nullptr if none recognises them
+	const DECODER_TYPE *find_decoder(const uint8_t *data, size_t size);
+
+	// Creates the decoder of the file and loads it, returns nullptr (after printing the reason) if it can't be played
+	std::unique_ptr<AudioDecoder> open_file(const std::string &file_path, bool use_memory_map, bool is_verbose);
+};
+
+#endif //WASABI_DECODER_REGISTRY_HPP
@@ -0,0 +1,223 @@
+#include "flac_kernels.hpp"
+
+// Number of samples restored at once by the vectorised kernels (the terms of the most recent samples are added one by
+// one, so blocks are kept short)
+#define LPC_BLOCK_SAMPLES 4
+
+static void restore_lpc_from(int32_t *samples, size_t first_sample, size_t num_samples, const int32_t *coefficients,
+	uint32_t order, int shift) {
+	for (size_t i = first_sample; i < num_samples; i++) {
+		int32_t prediction = 0;
+
+		for (uint32_t j = 0; j < order; j++) {
+			prediction += coefficients[j] * samples[i - 1 - j];
+		}
+
+		samples[i] += prediction >> shift;
+	}
+}
+
+static void restore_lpc(int32_t *samples, size_t num_samples, const int32_t *coefficients, uint32_t order, int shift) {
+	restore_lpc_from(samples, order, num_samples, coefficients, order, shift);
+}
+
+static void restore_wide_lpc_from(int32_t *samples, size_t first_sample, size_t num_samples,
+	const int32_t *coefficients, uint32_t order, int shift) {
+	for (size_t i = first_sample; i < num_samples; i++) {
+		int64_t prediction = 0;
+
+		for (uint32_t j = 0; j < order; j++) {
+			prediction += (int64_t)coefficients[j] * samples[i - 1 - j];
+		}
+
+		samples[i] += (int32_t)(prediction >> shift);
+	}
+}
+
+static void restore_wide_lpc(int32_t *samples, size_t num_samples, const int32_t *coefficients, uint32_t order,
+	int shift) {
+	restore_wide_lpc_from(samples, order, num_samples, coefficients, order, shift);
+}
+
+#ifdef WASABI_SIMD_X86
+
+// SSE2 only multiplies unsigned 32 bits integers into 64 bits, the low 32 bits of the products are the same for signed
+// ones
+static inline __m128i multiply_low_epi32_sse2(__m128i a, __m128i b) {
+	__m128i even_products = _mm_mul_epu32(a, b);
+	__m128i odd_products = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even_products, _MM_SHUFFLE(0, 0, 2, 0)),
+		_mm_shuffle_epi32(odd_products, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static void restore_lpc_sse2(int32_t *samples, size_t num_samples, const int32_t *coefficients, uint32_t order,
+	int shift) {
+	// The terms of the 3 most recent samples are always added one by one, lower orders have nothing to vectorise
+	if (order < LPC_BLOCK_SAMPLES) {
+		restore_lpc(samples, num_samples, coefficients, order, shift);
+
+		return;
+	}
+
+	__m128i broadcast_coefficients[FLAC_MAX_LPC_ORDER];
+	int32_t first_coefficient = coefficients[0];
+	int32_t second_coefficient = coefficients[1];
+	int32_t third_coefficient = coefficients[2];
+	size_t i = order;
+
+	for (uint32_t j = LPC_BLOCK_SAMPLES - 1; j < order; j++) {
+		broadcast_coefficients[j] = _mm_set1_epi32(coefficients[j]);
+	}
+
+	for (; i + LPC_BLOCK_SAMPLES <= num_samples; i += LPC_BLOCK_SAMPLES) {
+		__m128i partial_predictions = _mm_setzero_si128();
+
+		// Each lane sums the terms of one sample of the block over the samples preceding the block
+		for (uint32_t j = LPC_BLOCK_SAMPLES - 1; j < order; j++) {
+			partial_predictions = _mm_add_epi32(partial_predictions, multiply_low_epi32_sse2(broadcast_coefficients[j],
+				_mm_loadu_si128((const __m128i *)(samples + i - 1 - j))));
+		}
+
+		alignas(16) int32_t predictions[LPC_BLOCK_SAMPLES];
+
+		_mm_store_si128((__m128i *)predictions, partial_predictions);
+
+		int32_t first_sample = samples[i] + ((predictions[0] + first_coefficient * samples[i - 1] +
+			second_coefficient * samples[i - 2] + third_coefficient * samples[i - 3]) >> shift);
+		int32_t second_sample = samples[i + 1] + ((predictions[1] + first_coefficient * first_sample +
+			second_coefficient * samples[i - 1] + third_coefficient * samples[i - 2]) >> shift);
+		int32_t third_sample = samples[i + 2] + ((predictions[2] + first_coefficient * second_sample +
+			second_coefficient * first_sample + third_coefficient * samples[i - 1]) >> shift);
+		int32_t fourth_sample = samples[i + 3] + ((predictions[3] + first_coefficient * third_sample +
+			second_coefficient * second_sample + third_coefficient * first_sample) >> shift);
+
+		// Stored at once, so the next block loads them back from a single store
+		_mm_storeu_si128((__m128i *)(samples + i), _mm_setr_epi32(first_sample, second_sample, third_sample,
+			fourth_sample));
+	}
+
+	restore_lpc_from(samples, i, num_samples, coefficients, order, shift);
+}
+
+WASABI_TARGET_AVX2
+static void restore_lpc_avx2(int32_t *samples, size_t num_samples, const int32_t *coefficients, uint32_t order,
+	int shift) {
+	if (order < LPC_BLOCK_SAMPLES) {
+		restore_lpc(samples, num_samples, coefficients, order, shift);
+
+		return;
+	}
+
+	__m128i broadcast_coefficients[FLAC_MAX_LPC_ORDER];
+	int32_t first_coefficient = coefficients[0];
+	int32_t second_coefficient = coefficients[1];
+	int32_t third_coefficient = coefficients[2];
+	size_t i = order;
+
+	for (uint32_t j = LPC_BLOCK_SAMPLES - 1; j < order; j++) {
+		broadcast_coefficients[j] = _mm_set1_epi32(coefficients[j]);
+	}
+
+	// The blocks are as short as the SSE2 ones, AVX2 brings the signed multiplication
+	for (; i + LPC_BLOCK_SAMPLES <= num_samples; i += LPC_BLOCK_SAMPLES) {
+		__m128i partial_predictions = _mm_setzero_si128();
+
+		for (uint32_t j = LPC_BLOCK_SAMPLES - 1; j < order; j++) {
+			partial_predictions = _mm_add_epi32(partial_predictions, _mm_mullo_epi32(broadcast_coefficients[j],
+				_mm_loadu_si128((const __m128i *)(samples + i - 1 - j))));
+		}
+
+		alignas(16) int32_t predictions[LPC_BLOCK_SAMPLES];
+
+		_mm_store_si128((__m128i *)predictions, partial_predictions);
+
+		int32_t first_sample = samples[i] + ((predictions[0] + first_coefficient * samples[i - 1] +
+			second_coefficient * samples[i - 2] + third_coefficient * samples[i - 3]) >> shift);
+		int32_t second_sample = samples[i + 1] + ((predictions[1] + first_coefficient * first_sample +
+			second_coefficient * samples[i - 1] + third_coefficient * samples[i - 2]) >> shift);
+		int32_t third_sample = samples[i + 2] + ((predictions[2] + first_coefficient * second_sample +
+			second_coefficient * first_sample + third_coefficient * samples[i - 1]) >> shift);
+		int32_t fourth_sample = samples[i + 3] + ((predictions[3] + first_coefficient * third_sample +
+			second_coefficient * second_sample + third_coefficient * first_sample) >> shift);
+
+		_mm_storeu_si128((__m128i *)(samples + i), _mm_setr_epi32(first_sample, second_sample, third_sample,
+			fourth_sample));
+	}
+
+	restore_lpc_from(samples, i, num_samples, coefficients, order, shift);
+}
+
+WASABI_TARGET_AVX2
+static void restore_wide_lpc_avx2(int32_t *samples, size_t num_samples, const int32_t *coefficients, uint32_t order,
+	int shift) {
+	if (order < LPC_BLOCK_SAMPLES) {
+		restore_wide_lpc(samples, num_samples, coefficients, order, shift);
+
+		return;
+	}
+
+	__m256i broadcast_coefficients[FLAC_MAX_LPC_ORDER];
+	int64_t first_coefficient = coefficients[0];
+	int64_t second_coefficient = coefficients[1];
+	int64_t third_coefficient = coefficients[2];
+	size_t i = order;
+
+	for (uint32_t j = LPC_BLOCK_SAMPLES - 1; j < order; j++) {
+		broadcast_coefficients[j] = _mm256_set1_epi64x(coefficients[j]);
+	}
+
+	// The samples are sign extended to 64 bits lanes, whose low halves are multiplied into 64 bits products
+	for (; i + LPC_BLOCK_SAMPLES <= num_samples; i += LPC_BLOCK_SAMPLES) {
+		__m256i partial_predictions = _mm256_setzero_si256();
+
+		for (uint32_t j = LPC_BLOCK_SAMPLES - 1; j < order; j++) {
+			__m256i history = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i *)(samples + i - 1 - j)));
+
+			partial_predictions = _mm256_add_epi64(partial_predictions,
+				_mm256_mul_epi32(broadcast_coefficients[j], history));
+		}
+
+		alignas(32) int64_t predictions[LPC_BLOCK_SAMPLES];
+
+		_mm256_store_si256((__m256i *)predictions, partial_predictions);
+
+		int32_t first_sample = samples[i] + (int32_t)((predictions[0] + first_coefficient * samples[i - 1] +
+			second_coefficient * samples[i - 2] + third_coefficient * samples[i - 3]) >> shift);
+		int32_t second_sample = samples[i + 1] + (int32_t)((predictions[1] + first_coefficient * first_sample +
+			second_coefficient * samples[i - 1] + third_coefficient * samples[i - 2]) >> shift);
+		int32_t third_sample = samples[i + 2] + (int32_t)((predictions[2] + first_coefficient * second_sample +
+			second_coefficient * first_sample + third_coefficient * samples[i - 1]) >> shift);
+		int32_t fourth_sample = samples[i + 3] + (int32_t)((predictions[3] + first_coefficient * third_sample +
+			second_coefficient * second_sample + third_coefficient * first_sample) >> shift);
+
+		_mm_storeu_si128((__m128i *)(samples + i), _mm_setr_epi32(first_sample, second_sample, third_sample,
+			fourth_sample));
+	}
+
+	restore_wide_lpc_from(samples, i, num_samples, coefficients, order, shift);
+}
+
+#endif
+
+LPC_RESTORE_KERNEL get_lpc_restore_kernel(SIMD_LEVEL level) {
+#ifdef WASABI_SIMD_X86
+	if (level >= SIMD_LEVEL_AVX2) {
+		return restore_lpc_avx2;
+	}
+
+	if (level >= SIMD_LEVEL_SSE2) {
+		return restore_lpc_sse2;
+	}
+#endif
+	return restore_lpc;
+}
+
+LPC_RESTORE_KERNEL get_wide_lpc_restore_kernel(SIMD_LEVEL level) {
+#ifdef WASABI_SIMD_X86
+	if (level >= SIMD_LEVEL_AVX2) {
+		return restore_wide_lpc_avx2;
+	}
+#endif
+	return restore_wide_lpc;
+}
@@ -0,0 +1,28 @@
+#ifndef WASABI_FLAC_KERNELS_HPP
+#define WASABI_FLAC_KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "simd.hpp"
+
+// Highest order of the linear predictors of FLAC subframes
+#define FLAC_MAX_LPC_ORDER 32
+
+// Restores the samples of a subframe predicted by a linear predictor, in place: the first (order) samples are the
+// warm-up samples, and each of the following ones holds its residual, to which the prediction (the sum of the previous
+// samples weighted by the coefficients, shifted right) is added. The first coefficient weights the previous sample.
+// Each sample depends on the ones just restored, so the vectorised kernels compute blocks of 4 samples at once: the
+// terms of the samples preceding the block are summed across the block with vectors, and the 3 most recent ones are
+// added sample by sample.
+typedef void (*LPC_RESTORE_KERNEL)(int32_t *samples, size_t num_samples, const int32_t *coefficients, uint32_t order,
+	int shift);
+
+// Return the kernels for the given instruction set. The narrow kernels sum the prediction on 32 bits, which the caller
+// must only use when it can't overflow (the bits of the samples, of the coefficients and of the order add up to 32 at
+// most), the wide ones sum it on 64 bits (SSE2 has no signed 32 bits multiplication, so it falls back to the scalar
+// one)
+LPC_RESTORE_KERNEL get_lpc_restore_kernel(SIMD_LEVEL level);
+
+LPC_RESTORE_KERNEL get_wide_lpc_restore_kernel(SIMD_LEVEL level);
+
+#endif //WASABI_FLAC_KERNELS_HPP
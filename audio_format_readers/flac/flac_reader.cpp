@@ -0,0 +1,1232 @@
+#include "flac_reader.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include "instrumentation.hpp"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Longest frame header (sync code, fields, a 7 bytes frame number, 16 bits block size and sample rate, and CRC-8)
+#define FLAC_MAX_FRAME_HEADER_SIZE 16
+
+// Lengths of the fixed blocks of the metadata
+#define FLAC_STREAMINFO_SIZE 34
+#define FLAC_SEEK_POINT_SIZE 18
+
+// FLAC streams with 7 channels put the back center and side channels behind the front ones (the default WAV layout has
+// back channels instead of side ones), the other counts match the default layouts
+#define FLAC_CHANNEL_LAYOUT_6_1 (CHANNEL_FRONT_LEFT | CHANNEL_FRONT_RIGHT | CHANNEL_FRONT_CENTER | \
+	CHANNEL_LOW_FREQUENCY | CHANNEL_BACK_CENTER | CHANNEL_SIDE_LEFT | CHANNEL_SIDE_RIGHT)
+
+enum FLAC_CHANNEL_ASSIGNMENT {
+	FLAC_CHANNELS_LEFT_SIDE = 8,
+	FLAC_CHANNELS_RIGHT_SIDE = 9,
+	FLAC_CHANNELS_MID_SIDE = 10
+};
+
+enum FLAC_SUBFRAME_TYPE {
+	FLAC_SUBFRAME_CONSTANT = 0,
+	FLAC_SUBFRAME_VERBATIM = 1,
+	FLAC_SUBFRAME_FIXED = 8, // Up to order 4
+	FLAC_SUBFRAME_LPC = 32 // Up to order 32
+};
+
+static const char *const METADATA_BLOCK_NAMES[] = {"STREAMINFO", "PADDING", "APPLICATION", "SEEKTABLE",
+	"VORBIS_COMMENT", "CUESHEET", "PICTURE"};
+
+// Sample rates of the frame header codes (0 defers to STREAMINFO, 12 to 14 are followed by the rate)
+static const uint32_t FRAME_SAMPLE_RATES[12] = {0, 88200, 176400, 192000, 8000, 16000, 22050, 24000, 32000, 44100,
+	48000, 96000};
+
+// Bit depths of the frame header codes (0 defers to STREAMINFO, 3 is reserved)
+static const uint16_t FRAME_BIT_DEPTHS[8] = {0, 8, 12, 0, 16, 20, 24, 32};
+
+// The fixed predictors are linear predictors without shift
+static const int32_t FIXED_COEFFICIENTS[5][4] = {{}, {1}, {2, -1}, {3, -3, 1}, {4, -6, 4, -1}};
+
+// CRC-8 (polynomial 0x07) of the frame headers and CRC-16 (polynomial 0x8005) of the frames
+typedef struct FLAC_CRC_TABLES {
+	uint8_t crc8[256];
+	uint16_t crc16[256];
+
+	FLAC_CRC_TABLES() {
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t crc8 = i;
+			uint32_t crc16 = i << 8;
+
+			for (int bit = 0; bit < 8; bit++) {
+				crc8 = (crc8 & 0x80) ? (crc8 << 1) ^ 0x07 : crc8 << 1;
+				crc16 = (crc16 & 0x8000) ? (crc16 << 1) ^ 0x8005 : crc16 << 1;
+			}
+
+			this->crc8[i] = (uint8_t)crc8;
+			this->crc16[i] = (uint16_t)crc16;
+		}
+	}
+} FLAC_CRC_TABLES;
+
+static const FLAC_CRC_TABLES crc_tables;
+
+static uint8_t compute_crc8(const uint8_t *data, size_t size) {
+	uint8_t crc = 0;
+
+	for (size_t i = 0; i < size; i++) {
+		crc = crc_tables.crc8[crc ^ data[i]];
+	}
+
+	return crc;
+}
+
+static uint16_t compute_crc16(const uint8_t *data, size_t size) {
+	uint16_t crc = 0;
+
+	for (size_t i = 0; i < size; i++) {
+		crc = (uint16_t)((crc << 8) ^ crc_tables.crc16[(crc >> 8) ^ data[i]]);
+	}
+
+	return crc;
+}
+
+static uint32_t read_uint16_be(const uint8_t *data) {
+	return (uint32_t)data[0] << 8 | data[1];
+}
+
+static uint32_t read_uint24_be(const uint8_t *data) {
+	return (uint32_t)data[0] << 16 | (uint32_t)data[1] << 8 | data[2];
+}
+
+static uint64_t read_uint64_be(const uint8_t *data) {
+	uint64_t value = 0;
+
+	for (int i = 0; i < 8; i++) {
+		value = value << 8 | data[i];
+	}
+
+	return value;
+}
+
+static inline uint64_t load_uint64_be(const uint8_t *data) {
+	uint64_t value;
+
+	memcpy(&value, data, sizeof(value));
+
+#ifdef _MSC_VER
+	return _byteswap_uint64(value);
+#else
+	return __builtin_bswap64(value);
+#endif
+}
+
+static inline uint32_t count_leading_zeros(uint64_t value) {
+#ifdef _MSC_VER
+	unsigned long index;
+
+	_BitScanReverse64(&index, value);
+
+	return 63 - (uint32_t)index;
+#else
+	return (uint32_t)__builtin_clzll(value);
+#endif
+}
+
+// Gets the next bits of the reader in the most significant ones (at least 57 of them, the others are zeros)
+static inline uint64_t peek_bits(const FLAC_BIT_READER &reader) {
+	size_t byte = (size_t)(reader.position >> 3);
+
+	return byte <= reader.load_limit ? load_uint64_be(reader.data + byte) << (reader.position & 7) : 0;
+}
+
+// Reads up to 32 bits
+static inline uint32_t read_bits(FLAC_BIT_READER &reader, uint32_t num_bits) {
+	if (num_bits == 0) {
+		return 0;
+	}
+
+	uint32_t value = (uint32_t)(peek_bits(reader) >> (64 - num_bits));
+
+	reader.position += num_bits;
+
+	return value;
+}
+
+static inline int32_t read_signed_bits(FLAC_BIT_READER &reader, uint32_t num_bits) {
+	if (num_bits == 0) {
+		return 0;
+	}
+
+	int64_t value = (int64_t)peek_bits(reader) >> (64 - num_bits);
+
+	reader.position += num_bits;
+
+	return (int32_t)value;
+}
+
+// Reads the number of zeros preceding the next one (and skips it)
+static inline bool read_unary(FLAC_BIT_READER &reader, uint32_t &value) {
+	value = 0;
+
+	while (true) {
+		uint64_t bits = peek_bits(reader);
+
+		if (bits != 0) {
+			uint32_t num_zeros = count_leading_zeros(bits);
+
+			value += num_zeros;
+			reader.position += num_zeros + 1;
+
+			return true;
+		}
+
+		// Only the bits past the position within the byte were loaded
+		uint32_t num_loaded_bits = 64 - (uint32_t)(reader.position & 7);
+
+		value += num_loaded_bits;
+		reader.position += num_loaded_bits;
+
+		if (reader.position > reader.limit) {
+			return false;
+		}
+	}
+}
+
+static bool has_bits(const FLAC_BIT_READER &reader, uint64_t num_bits) {
+	return reader.position + num_bits <= reader.limit;
+}
+
+// Decodes the Rice coded residual of a subframe, partitioned in 2^order parts of the block (the first one is shorter by
+// the number of warm-up samples)
+static bool decode_residual(FLAC_BIT_READER &reader, int32_t *residuals, uint32_t block_size, uint32_t order) {
+	uint32_t coding_method = read_bits(reader, 2);
+
+	if (coding_method > 1) {
+		return false;
+	}
+
+	uint32_t parameter_size = coding_method == 0 ? 4 : 5;
+	uint32_t escape_parameter = (1u << parameter_size) - 1;
+	uint32_t partition_order = read_bits(reader, 4);
+	uint32_t partition_size = block_size >> partition_order;
+
+	if ((partition_size << partition_order) != block_size || partition_size < order) {
+		return false;
+	}
+
+	for (uint32_t partition = 0; partition < (1u << partition_order); partition++) {
+		uint32_t num_samples = partition == 0 ? partition_size - order : partition_size;
+		uint32_t parameter = read_bits(reader, parameter_size);
+
+		// Escaped partitions hold the residuals in plain signed integers
+		if (parameter == escape_parameter) {
+			uint32_t num_bits = read_bits(reader, 5);
+
+			if (!has_bits(reader, (uint64_t)num_samples * num_bits)) {
+				return false;
+			}
+
+			for (uint32_t i = 0; i < num_samples; i++) {
+				residuals[i] = read_signed_bits(reader, num_bits);
+			}
+		}
+		else {
+			for (uint32_t i = 0; i < num_samples; i++) {
+				uint32_t quotient;
+
+				if (!read_unary(reader, quotient)) {
+					return false;
+				}
+
+				// Zigzag folded: the sign is in the lowest bit
+				uint32_t folded_residual = (quotient << parameter) | read_bits(reader, parameter);
+
+				residuals[i] = (int32_t)(folded_residual >> 1) ^ -(int32_t)(folded_residual & 1);
+			}
+
+			if (reader.position > reader.limit) {
+				return false;
+			}
+		}
+
+		residuals += num_samples;
+	}
+
+	return true;
+}
+
+static uint32_t floor_log2(uint32_t value) {
+	uint32_t log = 0;
+
+	while (value >>= 1) {
+		log++;
+	}
+
+	return log;
+}
+
+// Interleaves the channels in containers of whole bytes (the samples are aligned on their most significant bits, 8 bits
+// samples are unsigned)
+static void interleave_samples(const int32_t *samples, size_t channel_stride, uint32_t num_frames,
+	uint16_t num_channels, uint16_t bit_depth, uint16_t container_bit_depth, uint8_t *output) {
+	uint32_t shift = container_bit_depth - bit_depth;
+
+	for (uint16_t channel = 0; channel < num_channels; channel++) {
+		const int32_t *channel_samples = samples + channel * channel_stride;
+
+		switch (container_bit_depth) {
+		case 8:
+			for (uint32_t i = 0; i < num_frames; i++) {
+				output[(size_t)i * num_channels + channel] = (uint8_t)(((uint32_t)channel_samples[i] << shift) + 128);
+			}
+
+			break;
+		case 16:
+			for (uint32_t i = 0; i < num_frames; i++) {
+				int16_t sample = (int16_t)((uint32_t)channel_samples[i] << shift);
+
+				memcpy(output + ((size_t)i * num_channels + channel) * 2, &sample, 2);
+			}
+
+			break;
+		default:
+			for (uint32_t i = 0; i < num_frames; i++) {
+				uint32_t sample = (uint32_t)channel_samples[i] << shift;
+				uint8_t *bytes = output + ((size_t)i * num_channels + channel) * 3;
+
+				bytes[0] = (uint8_t)sample;
+				bytes[1] = (uint8_t)(sample >> 8);
+				bytes[2] = (uint8_t)(sample >> 16);
+			}
+
+			break;
+		}
+	}
+}
+
+FLACReader::FLACReader() = default;
+
+FLACReader::~FLACReader() {
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		this->is_stopping = true;
+		this->is_closed = true;
+	}
+
+	this->slot_freed.notify_all();
+	this->frame_pending.notify_all();
+
+	if (this->scanner.joinable()) {
+		this->scanner.join();
+	}
+
+	for (std::thread &worker : this->workers) {
+		worker.join();
+	}
+}
+
+std::ostream &FLACReader::report() {
+	return this->is_verbose ? std::cout : this->null_stream;
+}
+
+bool FLACReader::load_file(std::string *file_path, bool use_memory_map) {
+	if (file_path->empty()) {
+		std::cerr << "ERROR: A file path must be provided" << std::endl;
+
+		return false;
+	}
+
+	this->audio_file_path = *file_path;
+	this->file.open(this->audio_file_path, std::ios::in | std::ios::binary);
+
+	if (!this->file.is_open()) {
+		std::cerr << "ERROR: The provided file path doesn't point to an existing file" << std::endl;
+
+		return false;
+	}
+
+	this->report() << "\n[Loaded \"" << *file_path << "\"]" << std::flush;
+
+	if (!this->load_metadata()) {
+		return false;
+	}
+
+	this->file.clear();
+
+	if (use_memory_map && this->mapped_file.open(this->audio_file_path)) {
+		this->report() << "\n[Memory mapped the frames]" << std::endl;
+
+		this->is_memory_mapped = true;
+		this->file_size = this->mapped_file.get_size();
+		this->mapped_file.advise_sequential(this->first_frame_offset, this->file_size - this->first_frame_offset);
+		this->file.close();
+	}
+
+	SIMD_LEVEL simd_level = get_simd_level();
+
+	this->restore_lpc = get_lpc_restore_kernel(simd_level);
+	this->restore_wide_lpc = get_wide_lpc_restore_kernel(simd_level);
+
+	// Holds the frames decoded ahead, each one may be as long as the longest block
+	this->num_slots = std::max<size_t>(FLAC_MIN_FRAME_SLOTS,
+		(size_t)this->sample_rate * FLAC_DECODE_AHEAD_DURATION / this->max_block_size + 1);
+	this->slots.reset(new FLAC_FRAME_SLOT[this->num_slots]);
+
+	for (size_t i = 0; i < this->num_slots; i++) {
+		this->slots[i].decoded_data.resize((size_t)this->max_block_size * this->format.block_align);
+	}
+
+	size_t num_workers = std::min<size_t>(this->num_decode_threads != 0 ? this->num_decode_threads :
+		std::max(std::thread::hardware_concurrency(), 1u), FLAC_MAX_DECODE_THREADS);
+
+	this->report() << "Decoding threads: " << num_workers << " (" << this->num_slots << " frames ahead)" << std::endl;
+
+	for (size_t i = 0; i < num_workers; i++) {
+		this->workers.emplace_back(&FLACReader::decode_frames, this);
+	}
+
+	this->start_decoding(this->first_frame_offset, 0);
+
+	return true;
+}
+
+bool FLACReader::load_metadata() {
+	uint8_t signature[4];
+
+	this->report() << "\nChecking the file header..." << std::endl;
+
+	this->file.read(reinterpret_cast<char *>(signature), 4);
+
+	if (this->file.gcount() < 4 || memcmp(signature, "fLaC", 4) != 0) {
+		std::cerr << "ERROR: Invalid signature, the file isn't a FLAC file." << std::endl;
+
+		return false;
+	}
+
+	// Walks the metadata blocks (each one is a header with its type and length, then its data) until the last one,
+	// only STREAMINFO and SEEKTABLE are read
+	std::vector<uint8_t> block;
+	std::vector<uint8_t> streaminfo;
+	uint64_t offset = 4;
+	bool is_last_block = false;
+
+	this->report() << "Metadata blocks:";
+
+	while (!is_last_block) {
+		uint8_t block_header[4];
+
+		this->file.read(reinterpret_cast<char *>(block_header), 4);
+
+		if (this->file.gcount() < 4) {
+			this->report() << std::endl;
+			std::cerr << "ERROR: The file ends within its metadata." << std::endl;
+
+			return false;
+		}
+
+		uint8_t block_type = block_header[0] & 0x7F;
+		uint32_t block_size = read_uint24_be(block_header + 1);
+
+		is_last_block = (block_header[0] & 0x80) != 0;
+
+		this->report() << " '" << (block_type < 7 ? METADATA_BLOCK_NAMES[block_type] : "UNKNOWN") << "' (" << block_size
+			<< " bytes)";
+
+		if (block_type == FLAC_METADATA_STREAMINFO || block_type == FLAC_METADATA_SEEKTABLE) {
+			block.resize(block_size);
+
+			this->file.read(reinterpret_cast<char *>(block.data()), block_size);
+
+			if ((uint32_t)this->file.gcount() < block_size) {
+				this->report() << std::endl;
+				std::cerr << "ERROR: The file ends within its metadata." << std::endl;
+
+				return false;
+			}
+
+			if (block_type == FLAC_METADATA_STREAMINFO) {
+				streaminfo = block;
+			}
+			else {
+				this->load_seektable(block.data(), block_size);
+			}
+		}
+		else {
+			this->file.ignore(block_size);
+		}
+
+		offset += 4 + block_size;
+	}
+
+	this->report() << std::endl;
+
+	if (streaminfo.size() < FLAC_STREAMINFO_SIZE) {
+		std::cerr << "ERROR: The file has no valid STREAMINFO block." << std::endl;
+
+		return false;
+	}
+
+	if (!this->load_streaminfo(streaminfo.data())) {
+		return false;
+	}
+
+	// The seek points are given from the first frame
+	this->first_frame_offset = offset;
+
+	for (FLAC_SEEK_POINT &seek_point : this->seek_points) {
+		seek_point.offset += this->first_frame_offset;
+	}
+
+	if (!this->seek_points.empty()) {
+		this->report() << "Seek table: " << this->seek_points.size() << " points" << std::endl;
+	}
+
+	return true;
+}
+
+bool FLACReader::load_streaminfo(const uint8_t *data) {
+	this->min_block_size = read_uint16_be(data);
+	this->max_block_size = read_uint16_be(data + 2);
+	this->sample_rate = read_uint24_be(data + 10) >> 4;
+	this->num_channels = (uint16_t)(((data[12] >> 1) & 0x07) + 1);
+	this->bit_depth = (uint16_t)((((data[12] & 0x01) << 4) | (data[13] >> 4)) + 1);
+	this->num_frames = (uint64_t)(data[13] & 0x0F) << 32 | (uint64_t)read_uint24_be(data + 14) << 8 | data[17];
+
+	// Checks the number of channels
+	if (this->num_channels == 1) {
+		this->report() << "Number of channels: 1 (mono)" << std::endl;
+	}
+	else if (this->num_channels == 2) {
+		this->report() << "Number of channels: 2 (stereo)" << std::endl;
+	}
+	else {
+		this->report() << "Number of channels: " << this->num_channels << std::endl;
+	}
+
+	// Checks the sample rate
+	if (this->sample_rate >= MIN_SAMPLE_RATE && this->sample_rate <= MAX_SAMPLE_RATE) {
+		this->report() << "Sample rate: Ok (" << this->sample_rate << " Hz)." << std::endl;
+	}
+	else {
+		std::cerr << "ERROR: Bad sample rate, only audio files sampled between " << MIN_SAMPLE_RATE << " and "
+			<< MAX_SAMPLE_RATE << " Hz are currently supported." << std::endl;
+
+		return false;
+	}
+
+	// Checks the bit depth (the samples are decoded to containers of whole bytes)
+	if (this->bit_depth >= FLAC_MIN_BIT_DEPTH && this->bit_depth <= FLAC_MAX_BIT_DEPTH) {
+		this->report() << "Bit Depth: Ok (" << this->bit_depth << " bits)." << std::endl;
+	}
+	else {
+		std::cerr << "ERROR: Invalid bit depth (" << this->bit_depth << " bits), only FLAC files with " << FLAC_MIN_BIT_DEPTH
+			<< " to " << FLAC_MAX_BIT_DEPTH << " bits samples are currently supported." << std::endl;
+
+		return false;
+	}
+
+	// Checks the block sizes (every frame buffer is allocated for the longest block)
+	if (this->max_block_size >= 16 && this->min_block_size <= this->max_block_size) {
+		this->report() << "Block size: Ok (" << this->min_block_size << " to " << this->max_block_size << " frames)."
+			<< std::endl;
+	}
+	else {
+		std::cerr << "ERROR: Bad block sizes (" << this->min_block_size << " to " << this->max_block_size << " frames)."
+			<< std::endl;
+
+		return false;
+	}
+
+	if (this->num_frames == 0) {
+		this->report() << "WARNING: Unknown number of samples, the duration of the file won't be shown." << std::endl;
+	}
+
+	uint32_t channel_mask = this->num_channels == 7 ? FLAC_CHANNEL_LAYOUT_6_1 :
+		get_default_channel_mask(this->num_channels);
+
+	this->format = make_audio_format(this->sample_rate, this->num_channels, (uint16_t)((this->bit_depth + 7) / 8 * 8),
+		false, channel_mask);
+
+	return true;
+}
+
+void FLACReader::load_seektable(const uint8_t *data, uint32_t size) {
+	for (uint32_t offset = 0; offset + FLAC_SEEK_POINT_SIZE <= size; offset += FLAC_SEEK_POINT_SIZE) {
+		FLAC_SEEK_POINT seek_point;
+
+		seek_point.sample = read_uint64_be(data + offset);
+		seek_point.offset = read_uint64_be(data + offset + 8);
+
+		// Placeholder points are kept for later editing, they point nowhere
+		if (seek_point.sample != UINT64_MAX) {
+			this->seek_points.push_back(seek_point);
+		}
+	}
+}
+
+bool FLACReader::parse_frame_header(const uint8_t *data, size_t size, FLAC_FRAME_HEADER &header) {
+	// Sync code (14 bits) and a zero bit, then the blocking strategy bit
+	if (size < 6 || data[0] != 0xFF || (data[1] & 0xFE) != 0xF8) {
+		return false;
+	}
+
+	bool is_variable_block_size = (data[1] & 0x01) != 0;
+	uint32_t block_size_code = data[2] >> 4;
+	uint32_t sample_rate_code = data[2] & 0x0F;
+	uint32_t channel_code = data[3] >> 4;
+	uint32_t bit_depth_code = (data[3] >> 1) & 0x07;
+
+	if (block_size_code == 0 || sample_rate_code == 15 || channel_code > FLAC_CHANNELS_MID_SIDE ||
+		bit_depth_code == 3 || (data[3] & 0x01) != 0) {
+		return false;
+	}
+
+	// The frame (or sample) number is coded like UTF-8, on up to 7 bytes
+	size_t position = 4;
+	uint64_t number = data[position++];
+	uint32_t num_continuation_bytes = 0;
+
+	if (number >= 0x80) {
+		while (num_continuation_bytes < 7 && (number & (0x40 >> num_continuation_bytes)) != 0) {
+			num_continuation_bytes++;
+		}
+
+		if (num_continuation_bytes == 0 || num_continuation_bytes > 6) {
+			return false;
+		}
+
+		number &= 0x3F >> num_continuation_bytes;
+	}
+
+	if (size < position + num_continuation_bytes + 5) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < num_continuation_bytes; i++) {
+		if ((data[position] & 0xC0) != 0x80) {
+			return false;
+		}
+
+		number = number << 6 | (data[position++] & 0x3F);
+	}
+
+	// Block size and sample rate stored after the number
+	if (block_size_code == 1) {
+		header.block_size = 192;
+	}
+	else if (block_size_code <= 5) {
+		header.block_size = 576u << (block_size_code - 2);
+	}
+	else if (block_size_code == 6) {
+		header.block_size = data[position++] + 1u;
+	}
+	else if (block_size_code == 7) {
+		header.block_size = read_uint16_be(data + position) + 1;
+		position += 2;
+	}
+	else {
+		header.block_size = 256u << (block_size_code - 8);
+	}
+
+	uint32_t frame_sample_rate = this->sample_rate;
+
+	if (sample_rate_code >= 1 && sample_rate_code <= 11) {
+		frame_sample_rate = FRAME_SAMPLE_RATES[sample_rate_code];
+	}
+	else if (sample_rate_code == 12) {
+		frame_sample_rate = data[position++] * 1000u;
+	}
+	else if (sample_rate_code >= 13) {
+		frame_sample_rate = read_uint16_be(data + position) * (sample_rate_code == 13 ? 1u : 10u);
+		position += 2;
+	}
+
+	if (compute_crc8(data, position) != data[position]) {
+		return false;
+	}
+
+	// Frames changing the format of the stream aren't supported (and rule out false sync codes)
+	uint16_t frame_num_channels = (uint16_t)(channel_code < 8 ? channel_code + 1 : 2);
+	uint16_t frame_bit_depth = bit_depth_code == 0 ? this->bit_depth : FRAME_BIT_DEPTHS[bit_depth_code];
+
+	if (frame_num_channels != this->num_channels || frame_bit_depth != this->bit_depth ||
+		frame_sample_rate != this->sample_rate || header.block_size > this->max_block_size) {
+		return false;
+	}
+
+	// Streams with a fixed block size number their frames, the other ones their samples
+	header.sample = is_variable_block_size ? number : number * this->min_block_size;
+	header.channel_assignment = (uint8_t)channel_code;
+	header.header_size = (uint32_t)position + 1;
+
+	return true;
+}
+
+size_t FLACReader::read_window(uint64_t offset, size_t size, const uint8_t **data) {
+	// The mapping holds the whole file
+	if (this->is_memory_mapped) {
+		offset = std::min(offset, this->file_size);
+
+		*data = this->mapped_file.get_data() + offset;
+		this->is_window_at_end = true;
+
+		return (size_t)(this->file_size - offset);
+	}
+
+	uint64_t window_end = this->window_offset + this->window.size();
+
+	// Moves the window when the offset is out of it (once the scanner is restarted elsewhere)
+	if (offset < this->window_offset || offset > window_end) {
+		this->window.clear();
+		this->window_offset = offset;
+		this->is_window_at_end = false;
+
+		this->file.clear();
+		this->file.seekg((std::streamoff)offset);
+	}
+	else if (offset - this->window_offset >= FLAC_READ_SIZE) {
+		// Drops the frames already handed to the workers
+		this->window.erase(this->window.begin(), this->window.begin() + (std::ptrdiff_t)(offset - this->window_offset));
+		this->window_offset = offset;
+	}
+
+	size_t position = (size_t)(offset - this->window_offset);
+
+	while (this->window.size() < position + size && !this->is_window_at_end) {
+		size_t previous_size = this->window.size();
+
+		this->window.resize(previous_size + FLAC_READ_SIZE);
+
+		uint64_t read_start_time = begin_trace_span();
+
+		this->file.read(reinterpret_cast<char *>(this->window.data() + previous_size), FLAC_READ_SIZE);
+
+		end_trace_span(TRACE_IO, read_start_time, (uint64_t)this->file.gcount());
+
+		this->window.resize(previous_size + (size_t)this->file.gcount());
+
+		this->is_window_at_end = this->file.gcount() < FLAC_READ_SIZE;
+	}
+
+	*data = this->window.data() + position;
+
+	return this->window.size() - position;
+}
+
+bool FLACReader::find_frame(uint64_t keep_offset, uint64_t offset, uint64_t expected_sample, uint64_t &frame_offset,
+	FLAC_FRAME_HEADER &header) {
+	while (true) {
+		// Reads ahead by whole regions, keeping the frame being delimited
+		const uint8_t *data;
+		size_t position = (size_t)(offset - keep_offset);
+		size_t size = this->read_window(keep_offset, position + FLAC_READ_SIZE, &data);
+
+		if (position + 1 >= size) {
+			return false;
+		}
+
+		const uint8_t *sync_byte = (const uint8_t *)memchr(data + position, 0xFF, size - position - 1);
+
+		if (sync_byte == nullptr) {
+			if (this->is_window_at_end) {
+				return false;
+			}
+
+			offset = keep_offset + size - 1;
+
+			continue;
+		}
+
+		position = (size_t)(sync_byte - data);
+
+		// Reads the rest of a header cut by the end of the window first
+		if (size - position < FLAC_MAX_FRAME_HEADER_SIZE && !this->is_window_at_end) {
+			offset = keep_offset + position;
+
+			continue;
+		}
+
+		// A frame starts where a header is valid and numbered as expected
+		if (this->parse_frame_header(data + position, size - position, header) &&
+			(expected_sample == UINT64_MAX || header.sample == expected_sample)) {
+			frame_offset = keep_offset + position;
+
+			return true;
+		}
+
+		offset = keep_offset + position + 1;
+	}
+}
+
+void FLACReader::scan_frames(uint64_t offset, uint64_t target_sample) {
+	register_trace_thread("FLAC scanner", TRACE_READER_EVENTS);
+
+	FLAC_FRAME_HEADER header;
+	uint64_t frame_offset;
+	uint64_t previous_sample = UINT64_MAX;
+
+	// Starts from the first frame found from the offset (the seek points and the indexed frames point right at one)
+	bool is_found = this->find_frame(offset, offset, UINT64_MAX, frame_offset, header);
+
+	while (is_found) {
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+
+			if (this->is_stopping) {
+				return;
+			}
+		}
+
+		// The frame ends where the following one starts (or at the end of the file)
+		FLAC_FRAME_HEADER next_header;
+		uint64_t next_frame_offset = 0;
+
+		is_found = this->find_frame(frame_offset, frame_offset + header.header_size,
+			header.sample + header.block_size, next_frame_offset, next_header);
+
+		// Resynchronises past a damaged frame on any valid header within the stream
+		if (!is_found) {
+			is_found = this->find_frame(frame_offset, frame_offset + header.header_size, UINT64_MAX,
+				next_frame_offset, next_header) && next_header.sample > header.sample &&
+				(this->num_frames == 0 || next_header.sample < this->num_frames);
+		}
+
+		const uint8_t *data;
+		size_t frame_size = this->read_window(frame_offset, is_found ? (size_t)(next_frame_offset - frame_offset) : 0,
+			&data);
+
+		if (is_found) {
+			frame_size = (size_t)(next_frame_offset - frame_offset);
+		}
+
+		// Indexes the frames following the last one indexed
+		if (this->frame_index.empty() ? header.sample == 0 : header.sample > this->frame_index.back().sample &&
+			previous_sample == this->frame_index.back().sample) {
+			this->frame_index.push_back({header.sample, frame_offset});
+		}
+
+		previous_sample = header.sample;
+
+		// The samples of the damaged frames (up to the next frame found, or to the end of the stream when its length is
+		// known) are played as silence, so the following ones keep their position
+		uint64_t end_sample = header.sample + header.block_size;
+		uint64_t next_sample = is_found ? next_header.sample : std::max(this->num_frames, end_sample);
+
+		// The frames preceding the target are only delimited
+		if (end_sample > target_sample &&
+			!this->dispatch_frame(data, frame_size, header, target_sample, !is_found && next_sample == end_sample)) {
+			return;
+		}
+
+		while (end_sample < next_sample) {
+			FLAC_FRAME_HEADER missing_header;
+
+			missing_header.sample = end_sample;
+			missing_header.block_size = (uint32_t)std::min<uint64_t>(next_sample - end_sample, this->max_block_size);
+			end_sample += missing_header.block_size;
+
+			if (end_sample > target_sample && !this->dispatch_frame(nullptr, 0, missing_header, target_sample,
+				!is_found && end_sample == next_sample)) {
+				return;
+			}
+		}
+
+		frame_offset = next_frame_offset;
+		header = next_header;
+	}
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	this->is_scan_finished = true;
+	this->frame_decoded.notify_all();
+}
+
+bool FLACReader::dispatch_frame(const uint8_t *data, size_t size, const FLAC_FRAME_HEADER &header,
+	uint64_t target_sample, bool is_last) {
+	std::unique_lock<std::mutex> lock(this->mutex);
+	FLAC_FRAME_SLOT &slot = this->slots[this->next_scan_sequence % this->num_slots];
+
+	// Waits for the consumer to be done with the frame the slot held
+	this->slot_freed.wait(lock, [&]() {
+		return this->is_stopping || slot.state.load() == FLAC_SLOT_FREE;
+	});
+
+	if (this->is_stopping) {
+		return false;
+	}
+
+	// Only the scanner touches the free slots
+	lock.unlock();
+
+	slot.frame_data.assign(data, data + size);
+	slot.frame_data.resize(size + FLAC_FRAME_PADDING, 0);
+	slot.frame_size = size;
+	slot.header = header;
+	slot.read_position = target_sample > header.sample ?
+		(uint32_t)(target_sample - header.sample) * this->format.block_align : 0;
+	slot.is_last = is_last;
+
+	lock.lock();
+
+	slot.state.store(FLAC_SLOT_PENDING);
+	this->next_scan_sequence += 1;
+	this->frame_pending.notify_one();
+
+	return true;
+}
+
+void FLACReader::decode_frames() {
+	// Channels of the frame being decoded, one after the other
+	std::vector<int32_t> samples((size_t)this->num_channels * this->max_block_size);
+	std::unique_lock<std::mutex> lock(this->mutex);
+
+	while (true) {
+		this->frame_pending.wait(lock, [this]() {
+			return this->is_closed || (!this->is_stopping && this->next_decode_sequence < this->next_scan_sequence);
+		});
+
+		if (this->is_closed) {
+			return;
+		}
+
+		// The frames are taken in order, but decoded at once by every worker
+		FLAC_FRAME_SLOT &slot = this->slots[this->next_decode_sequence % this->num_slots];
+
+		this->next_decode_sequence += 1;
+		this->num_active_decodes += 1;
+		slot.state.store(FLAC_SLOT_DECODING);
+
+		lock.unlock();
+
+		// Frames that can't be decoded are played as silence
+		if (!this->decode_frame(slot, samples.data())) {
+			slot.decoded_size = slot.header.block_size * this->format.block_align;
+			memset(slot.decoded_data.data(), this->format.bit_depth == 8 ? 128 : 0, slot.decoded_size);
+
+			this->num_decode_errors += 1;
+		}
+
+		lock.lock();
+
+		this->num_active_decodes -= 1;
+		slot.state.store(FLAC_SLOT_READY, std::memory_order_release);
+		this->frame_decoded.notify_all();
+	}
+}
+
+bool FLACReader::decode_subframe(FLAC_BIT_READER &reader, int32_t *samples, uint32_t block_size,
+	uint32_t subframe_bit_depth) {
+	// Zero bit, type and wasted bits flag (their number is unary coded)
+	if (read_bits(reader, 1) != 0) {
+		return false;
+	}
+
+	uint32_t type = read_bits(reader, 6);
+	uint32_t num_wasted_bits = 0;
+
+	if (read_bits(reader, 1) != 0) {
+		if (!read_unary(reader, num_wasted_bits) || num_wasted_bits + 1 >= subframe_bit_depth) {
+			return false;
+		}
+
+		num_wasted_bits += 1;
+	}
+
+	uint32_t bit_depth = subframe_bit_depth - num_wasted_bits;
+
+	if (type == FLAC_SUBFRAME_CONSTANT) {
+		std::fill(samples, samples + block_size, read_signed_bits(reader, bit_depth));
+	}
+	else if (type == FLAC_SUBFRAME_VERBATIM) {
+		if (!has_bits(reader, (uint64_t)block_size * bit_depth)) {
+			return false;
+		}
+
+		for (uint32_t i = 0; i < block_size; i++) {
+			samples[i] = read_signed_bits(reader, bit_depth);
+		}
+	}
+	else if ((type >= FLAC_SUBFRAME_FIXED && type <= FLAC_SUBFRAME_FIXED + 4) || type >= FLAC_SUBFRAME_LPC) {
+		bool is_fixed = type < FLAC_SUBFRAME_LPC;
+		uint32_t order = is_fixed ? type - FLAC_SUBFRAME_FIXED : type - FLAC_SUBFRAME_LPC + 1;
+
+		if (order > block_size || !has_bits(reader, (uint64_t)order * bit_depth)) {
+			return false;
+		}
+
+		for (uint32_t i = 0; i < order; i++) {
+			samples[i] = read_signed_bits(reader, bit_depth);
+		}
+
+		// Fixed predictors have no shift and coefficients of at most 3 bits (and an order of at most 4)
+		const int32_t *coefficients = FIXED_COEFFICIENTS[order < 5 ? order : 0];
+		int32_t lpc_coefficients[FLAC_MAX_LPC_ORDER];
+		uint32_t precision = 4;
+		int shift = 0;
+
+		if (!is_fixed) {
+			precision = read_bits(reader, 4) + 1;
+			shift = read_signed_bits(reader, 5);
+
+			if (precision > 15 || shift < 0 || !has_bits(reader, (uint64_t)order * precision)) {
+				return false;
+			}
+
+			for (uint32_t i = 0; i < order; i++) {
+				lpc_coefficients[i] = read_signed_bits(reader, precision);
+			}
+
+			coefficients = lpc_coefficients;
+		}
+
+		if (!decode_residual(reader, samples + order, block_size, order)) {
+			return false;
+		}
+
+		// The prediction fits in 32 bits as long as the sum of the bits of its terms does
+		if (order > 0) {
+			LPC_RESTORE_KERNEL restore = subframe_bit_depth + precision + floor_log2(order) <= 32 ?
+				this->restore_lpc : this->restore_wide_lpc;
+
+			restore(samples, block_size, coefficients, order, shift);
+		}
+	}
+	else {
+		return false;
+	}
+
+	if (num_wasted_bits > 0) {
+		for (uint32_t i = 0; i < block_size; i++) {
+			samples[i] = (int32_t)((uint32_t)samples[i] << num_wasted_bits);
+		}
+	}
+
+	return reader.position <= reader.limit;
+}
+
+bool FLACReader::decode_frame(FLAC_FRAME_SLOT &slot, int32_t *samples) {
+	const FLAC_FRAME_HEADER &header = slot.header;
+	const uint8_t *data = slot.frame_data.data();
+	FLAC_BIT_READER reader;
+	size_t channel_stride = this->max_block_size;
+
+	// Frames that were lost have no data
+	if (slot.frame_size <= header.header_size) {
+		return false;
+	}
+
+	reader.data = data;
+	reader.position = (uint64_t)header.header_size * 8;
+	reader.limit = (uint64_t)slot.frame_size * 8;
+	reader.load_limit = slot.frame_size + FLAC_FRAME_PADDING - 8;
+
+	// The side channel has an extra bit
+	for (uint16_t channel = 0; channel < this->num_channels; channel++) {
+		bool is_side_channel = (header.channel_assignment == FLAC_CHANNELS_LEFT_SIDE && channel == 1) ||
+			(header.channel_assignment == FLAC_CHANNELS_RIGHT_SIDE && channel == 0) ||
+			(header.channel_assignment == FLAC_CHANNELS_MID_SIDE && channel == 1);
+
+		if (!this->decode_subframe(reader, samples + channel * channel_stride, header.block_size,
+			this->bit_depth + (is_side_channel ? 1 : 0))) {
+			return false;
+		}
+	}
+
+	// The subframes are padded to a whole byte, followed by the CRC-16 of the frame
+	size_t frame_end = (size_t)((reader.position + 7) / 8);
+
+	if (frame_end + 2 > slot.frame_size || compute_crc16(data, frame_end) != read_uint16_be(data + frame_end)) {
+		return false;
+	}
+
+	int32_t *left = samples;
+	int32_t *right = samples + channel_stride;
+
+	switch (header.channel_assignment) {
+	case FLAC_CHANNELS_LEFT_SIDE:
+		for (uint32_t i = 0; i < header.block_size; i++) {
+			right[i] = left[i] - right[i];
+		}
+
+		break;
+	case FLAC_CHANNELS_RIGHT_SIDE:
+		for (uint32_t i = 0; i < header.block_size; i++) {
+			left[i] += right[i];
+		}
+
+		break;
+	case FLAC_CHANNELS_MID_SIDE:
+		// The lowest bit of the mid channel was dropped, it's the one of the side channel
+		for (uint32_t i = 0; i < header.block_size; i++) {
+			int32_t mid = (int32_t)((uint32_t)left[i] << 1) | (right[i] & 1);
+			int32_t side = right[i];
+
+			left[i] = (mid + side) >> 1;
+			right[i] = (mid - side) >> 1;
+		}
+
+		break;
+	default:
+		break;
+	}
+
+	interleave_samples(samples, channel_stride, header.block_size, this->num_channels, this->bit_depth,
+		this->format.bit_depth, slot.decoded_data.data());
+
+	slot.decoded_size = header.block_size * this->format.block_align;
+
+	return true;
+}
+
+void FLACReader::start_decoding(uint64_t offset, uint64_t target_sample) {
+	this->scanner = std::thread(&FLACReader::scan_frames, this, offset, target_sample);
+}
+
+void FLACReader::stop_decoding() {
+	std::unique_lock<std::mutex> lock(this->mutex);
+
+	this->is_stopping = true;
+	this->slot_freed.notify_all();
+
+	lock.unlock();
+
+	if (this->scanner.joinable()) {
+		this->scanner.join();
+	}
+
+	lock.lock();
+
+	// Waits for the frames being decoded, the pending ones are dropped along with the decoded ones
+	this->frame_decoded.wait(lock, [this]() {
+		return this->num_active_decodes == 0;
+	});
+
+	for (size_t i = 0; i < this->num_slots; i++) {
+		this->slots[i].state.store(FLAC_SLOT_FREE);
+	}
+
+	this->next_scan_sequence = 0;
+	this->next_decode_sequence = 0;
+	this->next_read_sequence = 0;
+	this->is_scan_finished = false;
+	this->is_stopping = false;
+	this->is_playback_started = false;
+}
+
+AUDIO_FORMAT FLACReader::get_format() {
+	return this->format;
+}
+
+bool FLACReader::get_chunk(AUDIO_CHUNK &chunk, uint32_t max_size) {
+	FLAC_FRAME_SLOT &slot = this->slots[this->next_read_sequence % this->num_slots];
+	uint64_t hand_off_start_time = begin_trace_span();
+
+	// Lends the next frame once decoded, which is usually already the case. Otherwise an empty chunk is lent without
+	// waiting (as chunks are requested from the render thread), the last one if the scanner is done with the file (it
+	// is checked only when the lock is free, the next request tells it otherwise)
+	if (slot.state.load(std::memory_order_acquire) != FLAC_SLOT_READY) {
+		std::unique_lock<std::mutex> lock(this->mutex, std::try_to_lock);
+		bool is_end = lock.owns_lock() && this->is_scan_finished &&
+			this->next_read_sequence == this->next_scan_sequence;
+
+		chunk.data = nullptr;
+		chunk.size = 0;
+		chunk.is_eof = is_end;
+
+		if (!is_end && this->is_playback_started) {
+			this->num_stalls += 1;
+
+			record_trace_event(TRACE_READER_STALL, max_size);
+		}
+
+		return is_end;
+	}
+
+	this->is_playback_started = true;
+
+	uint32_t remaining_size = slot.decoded_size - std::min(slot.read_position, slot.decoded_size);
+
+	chunk.data = slot.decoded_data.data() + slot.read_position;
+	chunk.size = std::min(remaining_size, max_size);
+	chunk.is_eof = slot.is_last && chunk.size == remaining_size;
+
+	end_trace_span(TRACE_HAND_OFF, hand_off_start_time, chunk.size);
+
+	return chunk.is_eof;
+}
+
+void FLACReader::wait_for_chunk(uint32_t timeout) {
+	FLAC_FRAME_SLOT &slot = this->slots[this->next_read_sequence % this->num_slots];
+	std::unique_lock<std::mutex> lock(this->mutex);
+
+	this->frame_decoded.wait_for(lock, std::chrono::milliseconds(timeout), [&]() {
+		return slot.state.load() == FLAC_SLOT_READY ||
+			(this->is_scan_finished && this->next_read_sequence == this->next_scan_sequence);
+	});
+}
+
+void FLACReader::release_chunk(AUDIO_CHUNK &chunk) {
+	if (chunk.data != nullptr) {
+		FLAC_FRAME_SLOT &slot = this->slots[this->next_read_sequence % this->num_slots];
+
+		slot.read_position += chunk.size;
+
+		// Hands the slot back to the scanner once the whole frame has been read
+		if (slot.read_position >= slot.decoded_size) {
+			std::lock_guard<std::mutex> lock(this->mutex);
+
+			slot.state.store(FLAC_SLOT_FREE);
+			this->next_read_sequence += 1;
+			this->slot_freed.notify_one();
+		}
+	}
+
+	chunk.data = nullptr;
+	chunk.size = 0;
+}
+
+bool FLACReader::seek(uint64_t frame) {
+	if (this->num_frames != 0) {
+		frame = std::min(frame, this->num_frames);
+	}
+
+	this->stop_decoding();
+
+	// Starts from the last indexed frame preceding the target, or from a closer seek point past the indexed frames
+	FLAC_SEEK_POINT start_point{0, this->first_frame_offset};
+	auto indexed_frame = std::upper_bound(this->frame_index.begin(), this->frame_index.end(), frame,
+		[](uint64_t sample, const FLAC_SEEK_POINT &point) {
+			return sample < point.sample;
+		});
+
+	if (indexed_frame != this->frame_index.begin()) {
+		start_point = *(indexed_frame - 1);
+	}
+
+	for (const FLAC_SEEK_POINT &seek_point : this->seek_points) {
+		if (seek_point.sample <= frame && seek_point.sample > start_point.sample) {
+			start_point = seek_point;
+		}
+	}
+
+	this->start_decoding(start_point.offset, frame);
+
+	return true;
+}
+
+uint64_t FLACReader::get_num_frames() {
+	return this->num_frames;
+}
+
+double FLACReader::get_duration() {
+	return this->sample_rate != 0 ? (double)this->num_frames / this->sample_rate : 0.0;
+}
+
+uint64_t FLACReader::get_num_stalls() {
+	return this->num_stalls;
+}
+
+uint64_t FLACReader::get_num_decode_errors() {
+	return this->num_decode_errors;
+}
@@ -0,0 +1,203 @@
+#ifndef WASABI_FLAC_READER_HPP
+#define WASABI_FLAC_READER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "audio_decoder.hpp"
+#include "flac_kernels.hpp"
+#include "mapped_file.hpp"
+
+// Size of the regions of the file read at once while looking for the frames
+#define FLAC_READ_SIZE (256 * 1024)
+
+// Duration (in seconds) of the audio decoded ahead of the frame being read
+#define FLAC_DECODE_AHEAD_DURATION 2
+
+// Minimum number of frames decoded ahead (so every worker has one even with the longest blocks)
+#define FLAC_MIN_FRAME_SLOTS 8
+
+// Maximum number of threads decoding the frames
+#define FLAC_MAX_DECODE_THREADS 4
+
+// Zeroed bytes following the data of each frame, so the bit reader can always load 8 bytes at once
+#define FLAC_FRAME_PADDING 8
+
+// Supported bit depths (the side channel of a 24 bits stream still fits in 32 bits)
+#define FLAC_MIN_BIT_DEPTH 4
+#define FLAC_MAX_BIT_DEPTH 24
+
+// Metadata block types
+#define FLAC_METADATA_STREAMINFO 0
+#define FLAC_METADATA_SEEKTABLE 3
+
+// Fields of a frame header, with the ones deferred to the STREAMINFO block resolved
+typedef struct FLAC_FRAME_HEADER {
+	uint64_t sample{}; // First sample of the frame
+	uint32_t block_size{};
+	uint8_t channel_assignment{}; // Independent channels (0 to 7), left/side (8), right/side (9) or mid/side (10)
+	uint32_t header_size{};
+} FLAC_FRAME_HEADER;
+
+// Big-endian bit reader over the data of a frame
+typedef struct FLAC_BIT_READER {
+	const uint8_t *data{};
+	uint64_t position{}; // In bits
+	uint64_t limit{}; // Size of the data, in bits (reading past it fails the frame)
+	size_t load_limit{}; // Last byte 8 bytes can be loaded from (past it, the bits read are zeros)
+} FLAC_BIT_READER;
+
+// Location of a frame (from the SEEKTABLE block or found while reading the file)
+typedef struct FLAC_SEEK_POINT {
+	uint64_t sample{};
+	uint64_t offset{}; // In bytes, from the start of the file
+} FLAC_SEEK_POINT;
+
+enum FLAC_SLOT_STATE {
+	FLAC_SLOT_FREE,
+	FLAC_SLOT_PENDING, // Holds the data of a frame waiting for a worker
+	FLAC_SLOT_DECODING,
+	FLAC_SLOT_READY // Holds the decoded samples of the frame
+};
+
+// Frame on its way from the file to the consumer
+typedef struct FLAC_FRAME_SLOT {
+	std::atomic<FLAC_SLOT_STATE> state{FLAC_SLOT_FREE};
+	FLAC_FRAME_HEADER header;
+	std::vector<uint8_t> frame_data; // Followed by FLAC_FRAME_PADDING zeroed bytes
+	size_t frame_size{};
+	std::vector<uint8_t> decoded_data;
+	uint32_t decoded_size{};
+	uint32_t read_position{}; // Starts past the samples preceding the target of a seek
+	bool is_last{};
+} FLAC_FRAME_SLOT;
+
+// Reader of FLAC files. A scanner thread walks the file, finds the frames (their headers are checked with their CRC and
+// their numbering, so the frames are found without decoding them) and hands them to a small pool of workers, which
+// decode them independently and in parallel ahead of the frame being read. The frames are lent in order straight from
+// their decoded buffers, which are allocated when the file is loaded. The frames found are indexed, so seeking
+// goes straight to the frame holding the target (or to the closest point of the SEEKTABLE block before it, from which
+// the frames are found again).
+class FLACReader : public AudioDecoder {
+private:
+	std::string audio_file_path;
+	std::ifstream file;
+	MappedFile mapped_file;
+	bool is_memory_mapped{};
+	uint64_t file_size{};
+	uint64_t first_frame_offset{};
+	std::ostream null_stream{nullptr};
+
+	// STREAMINFO fields
+	uint32_t min_block_size{};
+	uint32_t max_block_size{};
+	uint32_t sample_rate{};
+	uint16_t num_channels{};
+	uint16_t bit_depth{};
+	uint64_t num_frames{}; // 0 when unknown
+	AUDIO_FORMAT format;
+
+	std::vector<FLAC_SEEK_POINT> seek_points;
+	std::vector<FLAC_SEEK_POINT> frame_index; // Every frame found since the start of the file
+
+	// Region of the file read by the scanner
+	std::vector<uint8_t> window;
+	uint64_t window_offset{};
+	bool is_window_at_end{};
+
+	LPC_RESTORE_KERNEL restore_lpc{};
+	LPC_RESTORE_KERNEL restore_wide_lpc{};
+
+	std::thread scanner;
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable slot_freed;
+	std::condition_variable frame_pending;
+	std::condition_variable frame_decoded;
+	std::unique_ptr<FLAC_FRAME_SLOT[]> slots;
+	size_t num_slots{};
+	uint64_t next_scan_sequence{}; // Of the next frame handed to the workers
+	uint64_t next_decode_sequence{};
+	uint64_t next_read_sequence{};
+	uint32_t num_active_decodes{};
+	bool is_scan_finished{};
+	bool is_stopping{};
+	bool is_closed{};
+	bool is_playback_started{};
+	uint64_t num_stalls{};
+	std::atomic<uint64_t> num_decode_errors{};
+
+	// Gets the stream the header checks are reported to
+	std::ostream &report();
+
+	bool load_metadata();
+
+	bool load_streaminfo(const uint8_t *data);
+
+	void load_seektable(const uint8_t *data, uint32_t size);
+
+	bool parse_frame_header(const uint8_t *data, size_t size, FLAC_FRAME_HEADER &header);
+
+	size_t read_window(uint64_t offset, size_t size, const uint8_t **data);
+
+	bool find_frame(uint64_t keep_offset, uint64_t offset, uint64_t expected_sample, uint64_t &frame_offset,
+		FLAC_FRAME_HEADER &header);
+
+	void scan_frames(uint64_t offset, uint64_t target_sample);
+
+	bool dispatch_frame(const uint8_t *data, size_t size, const FLAC_FRAME_HEADER &header, uint64_t target_sample,
+		bool is_last);
+
+	void decode_frames();
+
+	bool decode_subframe(FLAC_BIT_READER &reader, int32_t *samples, uint32_t block_size, uint32_t subframe_bit_depth);
+
+	bool decode_frame(FLAC_FRAME_SLOT &slot, int32_t *samples);
+
+	void start_decoding(uint64_t offset, uint64_t target_sample);
+
+	void stop_decoding();
+
+public:
+	// Threads decoding the frames ahead, set before loading the file (one per core up to FLAC_MAX_DECODE_THREADS when 0)
+	unsigned num_decode_threads{};
+
+	FLACReader();
+
+	FLACReader(FLACReader const &reader) = delete;
+
+	FLACReader &operator=(FLACReader const &reader) = delete;
+
+	~FLACReader() override;
+
+	bool load_file(std::string *file_path, bool use_memory_map = false) override;
+
+	AUDIO_FORMAT get_format() override;
+
+	bool get_chunk(AUDIO_CHUNK &chunk, uint32_t max_size) override;
+
+	void release_chunk(AUDIO_CHUNK &chunk) override;
+
+	void wait_for_chunk(uint32_t timeout) override;
+
+	// Restarts the scanner from the indexed frame or the seek point closest to the target, the frames decoded ahead are
+	// discarded and the samples of the first frame preceding the target are skipped
+	bool seek(uint64_t frame) override;
+
+	uint64_t get_num_frames() override;
+
+	double get_duration() override;
+
+	uint64_t get_num_stalls() override;
+
+	uint64_t get_num_decode_errors() override;
+};
+
+#endif //WASABI_FLAC_READER_HPP
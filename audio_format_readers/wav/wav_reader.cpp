@@ -1,328 +1,753 @@
 #include "wav_reader.hpp"
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <thread>
-#include <windows.h>
+#include "instrumentation.hpp"
 
 WAVReader::WAVReader() = default;
 
 WAVReader::WAVReader(const WAVReader &reader) {}
 
-WAVReader::~WAVReader() = default;
+WAVReader::~WAVReader() {
+    // Stops the data loader (if it is still running) and waits for it to finish
+    this->audio_buffer.close();
 
-void WAVReader::load_file(std::string *file_path) {
-    if (!file_path->empty()) {
-        this->audio_file_path = *file_path;
-        std::shared_ptr<std::ifstream> file = std::make_shared<std::ifstream>(this->audio_file_path,
-                                                                              std::ios::in | std::ios::binary);
-
-        if (file != nullptr && file->is_open()) {
-            std::cout << "\n[Loaded \"" << *file_path << "\"]" << std::flush;
+    if (this->data_loader.joinable()) {
+        this->data_loader.join();
+    }
+}
 
-            check_riff_header(file);
-            load_fmt_subchunk(file);
-            load_data_subchunk(file);
+std::ostream &WAVReader::report() {
+    return this->is_verbose ? std::cout : this->null_stream;
+}
 
-            std::thread data_loader(&WAVReader::load_data, this, file);
-            data_loader.detach();
-        } else {
-            std::cerr << "ERROR: The provided file path doesn't point to an existing file" << std::endl;
-        }
-    } else {
+bool WAVReader::load_file(std::string *file_path, bool use_memory_map) {
+    if (file_path->empty()) {
         std::cerr << "ERROR: A file path must be provided" << std::endl;
+
+        return false;
     }
-};
 
-void WAVReader::check_riff_header(std::shared_ptr<std::ifstream> file) {
-    char file_chunk_id[5];
-    uint32_t file_chunk_size;
-    char file_format[5];
+    this->audio_file_path = *file_path;
+    std::shared_ptr<std::ifstream> file = std::make_shared<std::ifstream>(this->audio_file_path,
+                                                                          std::ios::in | std::ios::binary);
+
+    if (file == nullptr || !file->is_open()) {
+        std::cerr << "ERROR: The provided file path doesn't point to an existing file" << std::endl;
 
-    std::cout << "\nChecking the file header..." << std::endl;
+        return false;
+    }
 
-    // Checks the chunk ID
-    file->read(file_chunk_id, sizeof(file_chunk_id) - 1);
+    this->report() << "\n[Loaded \"" << *file_path << "\"]" << std::flush;
 
-    file_chunk_id[sizeof(file_chunk_id) - 1] = '\0';
+    if (!this->load_header(file)) {
+        return false;
+    }
 
-    if (strncmp(file_chunk_id, "RIFF", sizeof(file_chunk_id) - 1) == 0) {
-        std::cout << "Chunk ID: Ok." << std::endl;
+    // Only the chunk index is kept once the header has been parsed
+    this->header.clear();
+    this->header.shrink_to_fit();
+
+    // Initializes audio buffer chunk size to be equal to the file byte rate
+    this->audio_buffer_chunk_size = this->byte_rate;
 
-        strcpy(this->chunk_id, file_chunk_id);
+    // Maps the data subchunk if requested, falling back to streaming when the file can't be mapped (pipes...)
+    if (use_memory_map && this->map_data()) {
+        this->report() << "\n[Memory mapped the 'data' subchunk]" << std::endl;
+
+        this->prefetched_data.clear();
+        file->close();
     } else {
-        std::cerr << "ERROR: Invalid chunk ID." << std::endl;
+        if (!this->audio_buffer.allocate((size_t) this->audio_buffer_chunk_size * MAX_AUDIO_BUFFER_CHUNKS)) {
+            std::cerr << "ERROR: The audio buffer couldn't be allocated." << std::endl;
+
+            return false;
+        }
 
-        exit(EXIT_FAILURE);
+        // Keeps the file open while the reader exists, so seeking doesn't have to reopen it
+        this->data_file = file;
+        this->data_loader = std::thread(&WAVReader::load_data, this, 0);
     }
 
-    // Gets the chunk size (in bytes)
-    file->read((char *) &file_chunk_size, sizeof(file_chunk_size));
+    return true;
+}
 
-    if (file_chunk_size >= 36) {
-        std::cout << "Chunk size: Ok (" << file_chunk_size << " bytes)." << std::endl;
+bool WAVReader::load_header(std::shared_ptr<std::ifstream> file) {
+    return this->index_chunks(file) && this->load_fmt_chunk() && this->load_data_chunk();
+}
 
-        this->chunk_size = file_chunk_size;
-    } else {
-        std::cerr << "ERROR: Bad chunk size." << std::endl;
+static uint16_t read_uint16(const uint8_t *data) {
+    return (uint16_t) (data[0] | (data[1] << 8));
+}
+
+static uint32_t read_uint32(const uint8_t *data) {
+    return (uint32_t) data[0] | ((uint32_t) data[1] << 8) | ((uint32_t) data[2] << 16) | ((uint32_t) data[3] << 24);
+}
+
+static uint64_t read_uint64(const uint8_t *data) {
+    return (uint64_t) read_uint32(data) | ((uint64_t) read_uint32(data + 4) << 32);
+}
+
+bool WAVReader::read_header_region(std::shared_ptr<std::ifstream> file, uint64_t offset) {
+    uint64_t position = this->header_offset + this->header.size();
+
+    // Moves to the region, reading through the skipped bytes when the file can't seek (pipes)
+    if (offset != position) {
+        file->clear();
 
-        exit(EXIT_FAILURE);
+        if (!file->seekg((std::streamoff) offset)) {
+            file->clear();
+
+            if (offset < position) {
+                return false;
+            }
+
+            file->ignore((std::streamsize) (offset - position));
+        }
     }
 
-    // Checks the format descriptor
-    file->read(file_format, sizeof(file_format) - 1);
+    // A single read is enough for the whole header of most files
+    this->header.resize(WAV_HEADER_READ_SIZE);
 
-    file_chunk_id[sizeof(file_chunk_id) - 1] = '\0';
+    file->read(reinterpret_cast<char *> (this->header.data()), WAV_HEADER_READ_SIZE);
 
-    if (strncmp(file_format, "WAVE", sizeof(file_format) - 1) == 0) {
-        std::cout << "Format descriptor: Ok." << std::endl;
+    this->header.resize((size_t) file->gcount());
+    this->header_offset = offset;
 
-        strcpy(this->format_descriptor, file_format);
-    } else {
-        std::cerr << "ERROR: Invalid format descriptor." << std::endl;
+    return !this->header.empty();
+}
+
+bool WAVReader::index_chunks(std::shared_ptr<std::ifstream> file) {
+    this->report() << "\nChecking the file header..." << std::endl;
 
-        exit(EXIT_FAILURE);
+    this->chunks.clear();
+    this->fmt_data.clear();
+    this->header.clear();
+    this->header_offset = 0;
+    this->ds64_chunk_sizes.clear();
+    this->is_data_size_unset = false;
+    this->file_size = 0;
+
+    if (!this->read_header_region(file, 0) || this->header.size() < 12) {
+        std::cerr << "ERROR: The file is too short to be a WAV file." << std::endl;
+
+        return false;
     }
-};
 
-void WAVReader::load_fmt_subchunk(std::shared_ptr<std::ifstream> file) {
-    char file_fmt_id[5];
-    uint32_t file_fmt_size;
-    uint16_t file_fmt_audio_format;
-    uint16_t file_fmt_num_channels;
-    uint32_t file_fmt_sample_rate;
-    uint32_t file_fmt_byte_rate;
-    uint16_t file_fmt_block_align;
-    uint16_t file_fmt_bit_depth;
+    // Checks the RIFF header (RF64 and BW64 files share its layout, their sizes being in the 'ds64' chunk)
+    this->is_rf64 = memcmp(this->header.data(), "RF64", 4) == 0 || memcmp(this->header.data(), "BW64", 4) == 0;
 
-    std::cout << "\nReading the 'fmt' subchunk..." << std::endl;
+    if ((memcmp(this->header.data(), "RIFF", 4) != 0 && !this->is_rf64) ||
+        memcmp(this->header.data() + 8, "WAVE", 4) != 0) {
+        std::cerr << "ERROR: Invalid RIFF header, the file isn't a WAV file." << std::endl;
 
-    // Checks the fmt subchunk ID
-    file->read(file_fmt_id, sizeof(file_fmt_id) - 1);
+        return false;
+    }
 
-    file_fmt_id[sizeof(file_fmt_id) - 1] = '\0';
+    memcpy(this->chunk_id, this->header.data(), 4);
+    memcpy(this->format_descriptor, this->header.data() + 8, 4);
+    this->chunk_size = read_uint32(this->header.data() + 4);
 
-    if (strncmp(file_fmt_id, "fmt", sizeof(file_fmt_id) - 2) == 0) {
-        std::cout << "fmt subchunk ID: Ok." << std::endl;
+    // Gets the size of the file (if it can be seeked) to bound the chunks with unset or truncated sizes (files shorter
+    // than the header region leave the stream failed after the read)
+    uint64_t header_end = this->header.size();
 
-        strcpy(this->chunk_id, file_fmt_id);
-    } else {
-        std::cerr << "Error: Invalid fmt subchunk ID." << std::endl;
+    file->clear();
 
-        exit(EXIT_FAILURE);
+    if (file->seekg(0, std::ios::end)) {
+        this->file_size = (uint64_t) file->tellg();
+
+        file->seekg((std::streamoff) header_end);
     }
 
-    // Gets the fmt subchunk size and checks the audio encoding
-    file->read((char*) &file_fmt_size, sizeof(file_fmt_size));
+    file->clear();
 
-    if (file_fmt_size == 16) {
-        std::cout << "fmt subchunk size: Ok (" << file_fmt_size << " bytes)." << std::endl;
+    if (this->is_rf64 && !this->load_ds64_chunk()) {
+        return false;
+    }
 
-        this->fmt_subchunk_size = file_fmt_size;
-    } else {
-        std::cerr << "Error: Bad encoding, only PCM encoded wav audio files are currently supported." << std::endl;
+    this->report() << "RIFF header: Ok (" << this->chunk_id[0] << this->chunk_id[1] << this->chunk_id[2]
+              << this->chunk_id[3] << ", " << this->chunk_size << " bytes)." << std::endl;
+
+    // Walks the chunks (each one is an ID, a size and its data padded to an even size) until the 'data' chunk, which is
+    // indexed but not read
+    uint64_t offset = 12;
+
+    while (true) {
+        if (offset + 8 > this->header_offset + this->header.size()) {
+            // The chunk header lies after the region read so far (a large chunk was skipped)
+            if (this->header.size() < WAV_HEADER_READ_SIZE || !this->read_header_region(file, offset) ||
+                this->header.size() < 8) {
+                std::cerr << "ERROR: The file has no 'data' chunk." << std::endl;
+
+                return false;
+            }
+        }
+
+        const uint8_t *chunk_header = this->header.data() + (offset - this->header_offset);
+        RIFF_CHUNK chunk;
+
+        memcpy(chunk.id, chunk_header, 4);
+        chunk.id[4] = '\0';
+        chunk.offset = offset + 8;
+        chunk.size = read_uint32(chunk_header + 4);
+
+        // RF64 chunks larger than 4 GB have their actual size in the 'ds64' chunk (where a writer that hasn't finished
+        // leaves the size of the 'data' chunk to 0), the size of other files' chunks can only be unset
+        if (memcmp(chunk.id, "data", 4) == 0 && chunk.size == UINT32_MAX) {
+            this->is_data_size_unset = !this->is_rf64 || this->ds64_data_size == 0;
+        }
+
+        if (!this->resolve_rf64_chunk_size(chunk)) {
+            std::cerr << "ERROR: The size of the '" << chunk.id << "' chunk is missing from the 'ds64' chunk."
+                      << std::endl;
+
+            return false;
+        }
+
+        this->chunks.push_back(chunk);
 
-        exit(EXIT_FAILURE);
+        // Keeps the format fields, the region they are in may be replaced while looking for the 'data' chunk
+        if (memcmp(chunk.id, "fmt ", 4) == 0) {
+            size_t fmt_offset = std::min<size_t>(chunk.offset - this->header_offset, this->header.size());
+            size_t fmt_size = std::min<size_t>(std::min<uint64_t>(chunk.size, WAV_FMT_MAX_SIZE),
+                                               this->header.size() - fmt_offset);
+
+            this->fmt_data.assign(this->header.begin() + (std::ptrdiff_t) fmt_offset,
+                                  this->header.begin() + (std::ptrdiff_t) (fmt_offset + fmt_size));
+        }
+
+        if (memcmp(chunk.id, "data", 4) == 0) {
+            break;
+        }
+
+        offset = chunk.offset + chunk.size + (chunk.size & 1);
     }
 
-    // Checks the audio format
-    file->read(reinterpret_cast<char *> (&file_fmt_audio_format), sizeof(file_fmt_audio_format));
+    // The audio data read along with the header is handed to the data loader, so it isn't read twice (nor lost on pipes)
+    const RIFF_CHUNK &data_chunk = this->chunks.back();
+    uint64_t data_end = data_chunk.offset + data_chunk.size + (data_chunk.size & 1);
+
+    this->prefetched_data.assign(this->header.begin() + (std::ptrdiff_t) std::min<uint64_t>(
+            data_chunk.offset - this->header_offset, this->header.size()), this->header.end());
 
-    if (file_fmt_audio_format == 1) {
-        std::cout << "Audio format: Ok." << std::endl;
+    // The metadata often follows the audio data (written once it's known, like 'LIST', 'bext' or 'id3 ' chunks), its
+    // chunks are indexed when the file can seek past the audio data, then the file is moved back after the header
+    if (this->file_size != 0 && !this->is_data_size_unset) {
+        this->index_trailing_chunks(file, data_end);
+
+        file->clear();
+        file->seekg((std::streamoff) (this->header_offset + this->header.size()));
+    }
+
+    this->report() << "Chunks:";
+
+    for (const RIFF_CHUNK &indexed_chunk : this->chunks) {
+        this->report() << " '" << indexed_chunk.id << "' (" << indexed_chunk.size << " bytes)";
+    }
+
+    this->report() << std::endl;
+
+    return true;
+}
+
+// Replaces the size of an RF64 chunk larger than 4 GB (left to 0xFFFFFFFF) with its size from the 'ds64' chunk, returns
+// false when it isn't there
+bool WAVReader::resolve_rf64_chunk_size(RIFF_CHUNK &chunk) {
+    if (!this->is_rf64 || chunk.size != UINT32_MAX) {
+        return true;
+    }
+
+    if (memcmp(chunk.id, "data", 4) == 0) {
+        chunk.size = this->ds64_data_size;
+
+        return true;
+    }
+
+    for (const RIFF_CHUNK &table_entry : this->ds64_chunk_sizes) {
+        if (memcmp(table_entry.id, chunk.id, 4) == 0) {
+            chunk.size = table_entry.size;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Chunk IDs are made of printable ASCII characters
+static bool is_chunk_id(const char *id) {
+    return std::all_of(id, id + 4, [](char character) {
+        return character >= 0x20 && character <= 0x7E;
+    });
+}
+
+void WAVReader::index_trailing_chunks(std::shared_ptr<std::ifstream> file, uint64_t offset) {
+    std::vector<uint8_t> region;
+    uint64_t region_offset = 0;
+    size_t num_trailing_chunks = 0;
+
+    // Reads the chunk headers a region at a time (the data of the chunks is skipped by seeking past it), the walk stops
+    // at the first bytes that aren't a whole chunk (padding, a tag appended without a chunk header, a truncated chunk)
+    while (offset + 8 <= this->file_size && num_trailing_chunks < WAV_MAX_TRAILING_CHUNKS) {
+        if (offset < region_offset || offset + 8 > region_offset + region.size()) {
+            region.resize((size_t) std::min<uint64_t>(WAV_TRAILER_READ_SIZE, this->file_size - offset));
+            region_offset = offset;
+
+            file->clear();
+
+            if (!file->seekg((std::streamoff) offset) ||
+                !file->read(reinterpret_cast<char *> (region.data()), (std::streamsize) region.size())) {
+                break;
+            }
+        }
+
+        const uint8_t *chunk_header = region.data() + (offset - region_offset);
+        RIFF_CHUNK chunk;
+
+        memcpy(chunk.id, chunk_header, 4);
+        chunk.id[4] = '\0';
+        chunk.offset = offset + 8;
+        chunk.size = read_uint32(chunk_header + 4);
+
+        if (!is_chunk_id(chunk.id) || !this->resolve_rf64_chunk_size(chunk) ||
+            chunk.size > this->file_size - chunk.offset) {
+            break;
+        }
+
+        this->chunks.push_back(chunk);
+        num_trailing_chunks++;
+
+        offset = chunk.offset + chunk.size + (chunk.size & 1);
+    }
+}
+
+bool WAVReader::load_ds64_chunk() {
+    // The 'ds64' chunk must be the first one: RIFF size, data size and sample count (64 bits each), then a table of
+    // the other chunks whose size doesn't fit in 32 bits
+    if (this->header.size() < 12 + 8 + 28 || memcmp(this->header.data() + 12, "ds64", 4) != 0) {
+        std::cerr << "ERROR: The RF64 file has no 'ds64' chunk." << std::endl;
+
+        return false;
+    }
+
+    const uint8_t *ds64 = this->header.data() + 20;
+    uint64_t ds64_size = std::min<uint64_t>(read_uint32(this->header.data() + 16), this->header.size() - 20);
+    uint32_t table_length = read_uint32(ds64 + 24);
+
+    if (ds64_size < 28) {
+        std::cerr << "ERROR: Bad 'ds64' chunk size (" << ds64_size << " bytes)." << std::endl;
+
+        return false;
+    }
+
+    this->chunk_size = read_uint64(ds64);
+    this->ds64_data_size = read_uint64(ds64 + 8);
+
+    for (uint32_t entry = 0; entry < table_length && 28 + (entry + 1) * (uint64_t) 12 <= ds64_size; entry++) {
+        RIFF_CHUNK table_entry;
+
+        memcpy(table_entry.id, ds64 + 28 + entry * 12, 4);
+        table_entry.size = read_uint64(ds64 + 28 + entry * 12 + 4);
+
+        this->ds64_chunk_sizes.push_back(table_entry);
+    }
+
+    return true;
+}
+
+const RIFF_CHUNK *WAVReader::find_chunk(const char *id) {
+    for (const RIFF_CHUNK &chunk : this->chunks) {
+        if (memcmp(chunk.id, id, 4) == 0) {
+            return &chunk;
+        }
+    }
+
+    return nullptr;
+}
+
+bool WAVReader::load_fmt_chunk() {
+    const RIFF_CHUNK *fmt_chunk = this->find_chunk("fmt ");
+
+    this->report() << "\nReading the 'fmt' subchunk..." << std::endl;
+
+    // The 'fmt ' chunk precedes the 'data' chunk, so its fields were read while indexing the chunks
+    if (fmt_chunk == nullptr || this->fmt_data.size() < std::min<uint64_t>(fmt_chunk->size, WAV_FMT_MAX_SIZE)) {
+        std::cerr << "ERROR: The file has no readable 'fmt ' chunk before its 'data' chunk." << std::endl;
+
+        return false;
+    }
+
+    // Base format (16 bytes), its extension size (18 bytes) and the WAVE_FORMAT_EXTENSIBLE fields (40 bytes)
+    if (fmt_chunk->size < 16) {
+        std::cerr << "ERROR: Bad 'fmt ' chunk size (" << fmt_chunk->size << " bytes)." << std::endl;
+
+        return false;
+    }
+
+    const uint8_t *fmt = this->fmt_data.data();
+    uint16_t file_fmt_audio_format = read_uint16(fmt);
+    uint16_t file_fmt_num_channels = read_uint16(fmt + 2);
+    uint32_t file_fmt_sample_rate = read_uint32(fmt + 4);
+    uint32_t file_fmt_byte_rate = read_uint32(fmt + 8);
+    uint16_t file_fmt_block_align = read_uint16(fmt + 12);
+    uint16_t file_fmt_bit_depth = read_uint16(fmt + 14);
+    uint16_t file_fmt_valid_bit_depth = file_fmt_bit_depth;
+    uint32_t file_fmt_channel_mask = 0;
+
+    memcpy(this->fmt_subchunk_id, fmt_chunk->id, 4);
+    this->fmt_subchunk_size = fmt_chunk->size;
+
+    this->report() << "fmt subchunk size: Ok (" << fmt_chunk->size << " bytes)." << std::endl;
+
+    // The extensible format carries the actual encoding in the first bytes of its subformat GUID
+    if (file_fmt_audio_format == WAV_FORMAT_EXTENSIBLE) {
+        if (fmt_chunk->size < WAV_FMT_MAX_SIZE || read_uint16(fmt + 16) < 22) {
+            std::cerr << "ERROR: Bad WAVE_FORMAT_EXTENSIBLE 'fmt ' chunk." << std::endl;
+
+            return false;
+        }
+
+        file_fmt_valid_bit_depth = read_uint16(fmt + 18);
+        file_fmt_channel_mask = read_uint32(fmt + 20);
+        file_fmt_audio_format = read_uint16(fmt + 24);
+
+        this->report() << "Extensible format: Ok (" << file_fmt_valid_bit_depth << " valid bits, channel mask 0x" << std::hex
+                  << file_fmt_channel_mask << std::dec << ")." << std::endl;
+    }
+
+    // Checks the audio format
+    if (file_fmt_audio_format == WAV_FORMAT_PCM || file_fmt_audio_format == WAV_FORMAT_IEEE_FLOAT) {
+        this->report() << "Audio format: Ok (" << (file_fmt_audio_format == WAV_FORMAT_PCM ? "PCM" : "IEEE float") << ")."
+                  << std::endl;
 
         this->audio_format = file_fmt_audio_format;
     } else {
-        std::cerr << "Error: Bad audio format, only linear PCM encoded wav audio files are currently supported."
-                  << std::endl;
+        std::cerr << "ERROR: Bad audio format, only linear PCM and IEEE float encoded wav audio files are currently "
+                     "supported." << std::endl;
 
-        exit(EXIT_FAILURE);
+        return false;
     }
 
-    // Gets the number of channels
-    file->read(reinterpret_cast<char *> (&file_fmt_num_channels), sizeof(file_fmt_num_channels));
-
-    if (file_fmt_num_channels == 1 || file_fmt_num_channels == 2) {
+    // Checks the number of channels
+    if (file_fmt_num_channels >= 1 && file_fmt_num_channels <= MAX_NUM_CHANNELS) {
         if (file_fmt_num_channels == 1) {
-            std::cout << "Number of channels: 1 (mono)" << std::endl;
+            this->report() << "Number of channels: 1 (mono)" << std::endl;
+        } else if (file_fmt_num_channels == 2) {
+            this->report() << "Number of channels: 2 (stereo)" << std::endl;
         } else {
-            std::cout << "Number of channels: 2 (stereo)" << std::endl;
+            this->report() << "Number of channels: " << file_fmt_num_channels << std::endl;
         }
 
         this->num_channels = file_fmt_num_channels;
     } else {
-        std::cerr << "Error: Bad number of channels, only mono and stereo audio files are currently supported."
-                  << std::endl;
+        std::cerr << "ERROR: Bad number of channels, only audio files with up to " << MAX_NUM_CHANNELS
+                  << " channels are currently supported." << std::endl;
 
-        exit(EXIT_FAILURE);
+        return false;
     }
 
-    // Gets the sample rate
-    file->read(reinterpret_cast<char *> (&file_fmt_sample_rate), sizeof(file_fmt_sample_rate));
-
-    if (file_fmt_sample_rate == 44100 || file_fmt_sample_rate == 48000) {
-        std::cout << "Sample rate: Ok (" << file_fmt_sample_rate << " Hz)." << std::endl;
+    // Checks the sample rate
+    if (file_fmt_sample_rate >= MIN_SAMPLE_RATE && file_fmt_sample_rate <= MAX_SAMPLE_RATE) {
+        this->report() << "Sample rate: Ok (" << file_fmt_sample_rate << " Hz)." << std::endl;
 
         this->sample_rate = file_fmt_sample_rate;
     } else {
-        std::cerr << "Error: Bad sample rate, only audio files sampled at 44100 or 48000 Hz are currently supported."
-                  << std::endl;
+        std::cerr << "ERROR: Bad sample rate, only audio files sampled between " << MIN_SAMPLE_RATE << " and "
+                  << MAX_SAMPLE_RATE << " Hz are currently supported." << std::endl;
 
-        exit(EXIT_FAILURE);
+        return false;
     }
 
-    // Gets the byte rate
-    file->read(reinterpret_cast<char *> (&file_fmt_byte_rate), sizeof(file_fmt_byte_rate));
-
-    // Gets the block alignment
-    file->read(reinterpret_cast<char *> (&file_fmt_block_align), sizeof(file_fmt_block_align));
+    // Checks the bit depth (samples are decoded from their container, the valid bits are only informative)
+    if (file_fmt_bit_depth % 8 == 0 && file_fmt_bit_depth >= 8 && file_fmt_bit_depth <= 32 &&
+        file_fmt_valid_bit_depth <= file_fmt_bit_depth &&
+        (file_fmt_audio_format != WAV_FORMAT_IEEE_FLOAT || file_fmt_bit_depth == 32)) {
+        this->report() << "Bit Depth: Ok (" << file_fmt_bit_depth << " bits)." << std::endl;
 
-    // Gets the size of each sample (in bits)
-    file->read(reinterpret_cast<char *> (&file_fmt_bit_depth), sizeof(file_fmt_bit_depth));
-
-    // Checks the byte rate
-    if (file_fmt_byte_rate ==
-        (file_fmt_sample_rate * file_fmt_num_channels * (file_fmt_bit_depth / 8))) {
-        std::cout << "Byte rate: Ok (" << file_fmt_byte_rate << " bytes)." << std::endl;
-
-        this->byte_rate = file_fmt_byte_rate;
+        this->bit_depth = file_fmt_bit_depth;
     } else {
-        std::cerr << "Error: Bad byte rate" << std::endl;
+        std::cerr << "ERROR: Invalid bit depth (" << file_fmt_bit_depth << " bits)." << std::endl;
 
-        exit(EXIT_FAILURE);
+        return false;
     }
 
     // Checks the block alignment
     if (file_fmt_block_align == (file_fmt_num_channels * (file_fmt_bit_depth / 8))) {
-        std::cout << "Block alignment: Ok (" << file_fmt_block_align << " bytes)." << std::endl;
+        this->report() << "Block alignment: Ok (" << file_fmt_block_align << " bytes)." << std::endl;
 
-        this->byte_rate = file_fmt_byte_rate;
+        this->block_align = file_fmt_block_align;
     } else {
-        std::cerr << "Error: Bad block alignment" << std::endl;
+        std::cerr << "ERROR: Bad block alignment" << std::endl;
 
-        exit(EXIT_FAILURE);
+        return false;
     }
 
-    // Checks the bit depth
-    if (file_fmt_bit_depth % 8 == 0) {
-        std::cout << "Bit Depth: Ok (" << file_fmt_bit_depth << " bits)." << std::endl;
+    // Checks the byte rate (only a hint for streaming, so a wrong one is fixed rather than rejected)
+    this->byte_rate = file_fmt_sample_rate * file_fmt_block_align;
 
-        this->bit_depth = file_fmt_bit_depth;
+    if (file_fmt_byte_rate == this->byte_rate) {
+        this->report() << "Byte rate: Ok (" << file_fmt_byte_rate << " bytes)." << std::endl;
     } else {
-        std::cerr << "Error: Invalid bit depth" << std::endl;
-
-        exit(EXIT_FAILURE);
+        this->report() << "WARNING: Bad byte rate (" << file_fmt_byte_rate << " bytes), " << this->byte_rate
+                  << " bytes will be used instead." << std::endl;
     }
-};
 
-void WAVReader::load_data_subchunk(std::shared_ptr<std::ifstream> file) {
-    char file_data_id[5];
-    uint32_t file_data_size;
+    // Channels without a mask follow the default layout for their number
+    this->channel_mask = file_fmt_channel_mask != 0 ? file_fmt_channel_mask
+                                                    : get_default_channel_mask(file_fmt_num_channels);
 
-    std::cout << "\nReading the 'data' subchunk..." << std::endl;
+    return true;
+}
 
-    // Checks the data sbuchunk ID
-    file->read(file_data_id, sizeof(file_data_id) - 1);
+bool WAVReader::load_data_chunk() {
+    // The first 'data' chunk holds the audio, the chunks following it may have been indexed too
+    const RIFF_CHUNK &data_chunk = *this->find_chunk("data");
 
-    file_data_id[sizeof(file_data_id) - 1] = '\0';
+    this->report() << "\nReading the 'data' subchunk..." << std::endl;
 
-    if (strncmp(file_data_id, "data", sizeof(file_data_id)) == 0) {
-        std::cout << "data subchunk ID: Ok." << std::endl;
+    memcpy(this->data_subchunk_id, data_chunk.id, 4);
+    this->data_offset = data_chunk.offset;
 
-        strcpy(this->data_subchunk_id, file_data_id);
-    } else {
-        std::cerr << "Error: Invalid 'data' subchunk ID." << std::endl;
+    // Streaming writers leave the size unset (0xFFFFFFFF), the data then goes on until the end of the file
+    uint64_t available_size = this->file_size > this->data_offset ? this->file_size - this->data_offset : 0;
 
-        exit(EXIT_FAILURE);
-    }
+    this->is_data_size_known = true;
 
-    // Gets the data subchunk size
-    file->read(reinterpret_cast<char *> (&file_data_size), sizeof(file_data_size));
+    if (this->is_data_size_unset) {
+        this->report() << "WARNING: Unset 'data' subchunk size, the audio data will be read until the end of the file."
+                  << std::endl;
 
-    if (file_data_size >= 0) {
-        std::cout << "data subchunk size: Ok (" << file_data_size << " bytes)." << std::endl;
+        this->is_data_size_known = this->file_size != 0;
+        this->data_subchunk_size = this->is_data_size_known ? available_size : UINT64_MAX;
+    } else if (this->file_size != 0 && data_chunk.size > available_size) {
+        this->report() << "WARNING: Truncated 'data' subchunk (" << data_chunk.size << " bytes declared, " << available_size
+                  << " bytes available)." << std::endl;
 
-        this->data_subchunk_size = file_data_size;
+        this->data_subchunk_size = available_size;
     } else {
-        std::cerr << "Error: Bad 'data' subchunk size." << std::endl;
+        this->report() << "data subchunk size: Ok (" << data_chunk.size << " bytes)." << std::endl;
 
-        exit(EXIT_FAILURE);
+        this->data_subchunk_size = data_chunk.size;
     }
 
-    float duration = this->data_subchunk_size / this->byte_rate;
+    // Only whole frames are read
+    this->data_subchunk_size -= this->data_subchunk_size % this->block_align;
+
+    double duration = this->get_duration();
 
     this->audio_duration.minutes = (int) (duration / 60);
-    this->audio_duration.seconds = (int) duration - (this->audio_duration.minutes * 60);
-};
+    this->audio_duration.seconds = (int) (duration - this->audio_duration.minutes * 60.0);
 
-void WAVReader::load_data(std::shared_ptr<std::ifstream> file) {
-    int current_file_chunk = 0;
+    return true;
+}
 
-    // Initializes audio buffer chunk size to be equal to the file byte rate
-    this->audio_buffer_chunk_size = this->byte_rate;
+void WAVReader::load_data(uint64_t data_position) {
+    register_trace_thread("Reader", TRACE_READER_EVENTS);
 
-    while (file->good() && !file->eof()) {
-        if (!this->is_audio_buffer_ready || this->audio_buffer_chunks[current_file_chunk].is_written) {
-            // Allocates memory for the buffered chunks
-            this->audio_buffer_chunks[current_file_chunk].data = (BYTE *) malloc(this->audio_buffer_chunk_size);
+    std::shared_ptr<std::ifstream> file = this->data_file;
+    uint8_t *span;
+    size_t span_size;
+    uint64_t remaining_size = data_position < this->data_subchunk_size ? this->data_subchunk_size - data_position : 0;
+    size_t prefetched_position = 0;
 
-            file->read(reinterpret_cast<char *> (this->audio_buffer_chunks[current_file_chunk].data),
-                       this->audio_buffer_chunk_size);
+    // Starts with the audio data read along with the header (the file is positioned right after it)
+    while (prefetched_position < this->prefetched_data.size() && remaining_size > 0) {
+        if (!this->audio_buffer.wait_for_writable(1)) {
+            break;
+        }
 
-            this->audio_buffer_chunks[current_file_chunk].size = file->gcount() * sizeof(BYTE);
-            this->audio_buffer_chunks[current_file_chunk].is_written = FALSE;
-            this->audio_buffer_chunks[current_file_chunk].is_eof = file->eof();
+        span_size = std::min<uint64_t>(std::min(this->audio_buffer.acquire_write(&span),
+                                                this->prefetched_data.size() - prefetched_position), remaining_size);
 
-            if (!this->is_playback_started && (current_file_chunk == (MAX_AUDIO_BUFFER_CHUNKS - 1) || this->audio_buffer_chunks[current_file_chunk].is_eof)) {
-                this->is_audio_buffer_ready = TRUE;
-                this->cv.notify_one();
-            }
+        memcpy(span, this->prefetched_data.data() + prefetched_position, span_size);
 
-            current_file_chunk += 1;
+        this->audio_buffer.commit_write(span_size);
+        prefetched_position += span_size;
+        remaining_size -= span_size;
+    }
 
-            if (current_file_chunk == MAX_AUDIO_BUFFER_CHUNKS) {
-                current_file_chunk = 0;
-            }
-        } else {
-            std::this_thread::sleep_for(std::chrono::seconds(1));
+    // Stops at the end of the 'data' subchunk (anything after it isn't audio)
+    while (remaining_size > 0 && file->good() && !file->eof()) {
+        // Waits (without polling) until the consumer has freed a whole chunk, or until the reader is closed
+        if (!this->audio_buffer.wait_for_writable(this->audio_buffer_chunk_size)) {
+            break;
         }
+
+        // Reads the file straight into the free space of the audio buffer
+        span_size = this->audio_buffer.acquire_write(&span);
+
+        uint64_t read_start_time = begin_trace_span();
+
+        file->read(reinterpret_cast<char *> (span),
+                   std::min<uint64_t>(remaining_size, std::min<size_t>(span_size, this->audio_buffer_chunk_size)));
+
+        end_trace_span(TRACE_IO, read_start_time, (uint64_t) file->gcount());
+
+        this->audio_buffer.commit_write(file->gcount() * sizeof(uint8_t));
+        remaining_size -= file->gcount();
     }
 
-    file->close();
+    // Signals the consumer that no more data will be written
+    this->audio_buffer.close();
 }
 
-bool WAVReader::get_chunk(BYTE **chunk, uint32_t &chunk_size) {
-    bool stop = this->audio_buffer_chunks[this->current_audio_buffer_chunk].is_eof;
-    std::unique_lock<std::mutex> lck(this->mtx);
+bool WAVReader::map_data() {
+    if (!this->mapped_file.open(this->audio_file_path) || this->mapped_file.get_size() < this->data_offset) {
+        this->mapped_file.close();
 
-    while (!this->is_audio_buffer_ready) {
-        this->cv.wait(lck);
+        return false;
     }
 
-    while (this->audio_buffer_chunks[this->current_audio_buffer_chunk].data == nullptr) {
-        std::cout << "\nINFO: Writer blocked, waiting for new data to be loaded" << std::endl;
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    // Exposes the 'data' subchunk as it is laid out in the file (it may be truncated)
+    this->mapped_data_size = std::min<uint64_t>(this->data_subchunk_size,
+                                                this->mapped_file.get_size() - this->data_offset);
+    this->mapped_data_position = 0;
+    this->is_memory_mapped = true;
+
+    // Hints the kernel about the access pattern and starts reading the first chunks ahead
+    this->mapped_file.advise_sequential(this->data_offset, this->mapped_data_size);
+    this->mapped_file.prefetch(this->data_offset, (uint64_t) this->audio_buffer_chunk_size * MAX_AUDIO_BUFFER_CHUNKS);
+
+    return true;
+}
+
+bool WAVReader::get_mapped_chunk(AUDIO_CHUNK &chunk, uint32_t max_size) {
+    uint64_t remaining_size = this->mapped_data_size - this->mapped_data_position;
+
+    // Lends the chunk straight from the mapped file, the page cache is the only copy of the data
+    chunk.data = this->mapped_file.get_data() + this->data_offset + this->mapped_data_position;
+    chunk.size = (uint32_t) std::min<uint64_t>(remaining_size, max_size);
+    chunk.is_eof = (chunk.size == remaining_size);
+
+    // Keeps the read ahead window one internal buffer ahead of the consumer
+    this->mapped_file.prefetch(
+            this->data_offset + this->mapped_data_position + (uint64_t) this->audio_buffer_chunk_size * MAX_AUDIO_BUFFER_CHUNKS,
+            this->audio_buffer_chunk_size);
+
+    return chunk.is_eof;
+}
+
+AUDIO_FORMAT WAVReader::get_format() {
+    return make_audio_format(this->sample_rate, this->num_channels, this->bit_depth,
+                             this->audio_format == WAV_FORMAT_IEEE_FLOAT, this->channel_mask);
+}
+
+bool WAVReader::get_chunk(AUDIO_CHUNK &chunk, uint32_t max_size) {
+    // Chunks never exceed the audio buffer chunk size
+    max_size = std::min(max_size, this->audio_buffer_chunk_size);
+
+    if (this->is_memory_mapped) {
+        return this->get_mapped_chunk(chunk, max_size);
     }
 
-    if (this->is_playback_started == FALSE) {
-        this->is_playback_started = TRUE;
+    // Lends what the loader has read without waiting for the rest of the requested chunk, as chunks are requested from
+    // the render thread. A short chunk before the end of the stream is counted and traced as a stall rather than
+    // printed
+    uint64_t hand_off_start_time = begin_trace_span();
+    bool is_closed = this->audio_buffer.is_closed();
+
+    if (this->is_playback_started && this->audio_buffer.get_readable_size() < max_size && !is_closed) {
+        this->num_stalls += 1;
+
+        record_trace_event(TRACE_READER_STALL, max_size);
     }
 
-    *chunk = (BYTE *) malloc(this->audio_buffer_chunks[this->current_audio_buffer_chunk].size);
-    chunk_size = this->audio_buffer_chunks[this->current_audio_buffer_chunk].size;
+    this->is_playback_started = true;
 
-    memcpy(*chunk, this->audio_buffer_chunks[this->current_audio_buffer_chunk].data,
-           this->audio_buffer_chunks[this->current_audio_buffer_chunk].size);
-    free(this->audio_buffer_chunks[this->current_audio_buffer_chunk].data);
+    // Lends the chunk straight from the audio buffer storage, nothing is allocated or copied
+    const uint8_t *span;
+    size_t span_size = this->audio_buffer.acquire_read(&span);
 
-    this->audio_buffer_chunks[this->current_audio_buffer_chunk].is_written = TRUE;
-    this->current_audio_buffer_chunk += 1;
+    chunk.data = span;
+    chunk.size = (uint32_t) std::min<size_t>(span_size, max_size);
+    chunk.is_eof = is_closed && this->audio_buffer.get_readable_size() == chunk.size;
+
+    end_trace_span(TRACE_HAND_OFF, hand_off_start_time, chunk.size);
+
+    return chunk.is_eof;
+}
 
-    if (this->current_audio_buffer_chunk == MAX_AUDIO_BUFFER_CHUNKS) {
-        // Reinitializes the current audio buffer chunk so it points to the first chunk of the audio buffer
-        this->current_audio_buffer_chunk = 0;
+void WAVReader::wait_for_chunk(uint32_t timeout) {
+    // The mapped data is always there
+    if (!this->is_memory_mapped) {
+        this->audio_buffer.wait_for_readable(1, std::chrono::milliseconds(timeout));
     }
+}
+
+void WAVReader::release_chunk(AUDIO_CHUNK &chunk) {
+    // Gives the chunk storage back to the data loader (or moves past it in the mapped file)
+    if (this->is_memory_mapped) {
+        this->mapped_data_position += chunk.size;
+    } else {
+        this->audio_buffer.commit_read(chunk.size);
+    }
+
+    chunk.data = nullptr;
+    chunk.size = 0;
+}
 
-    return stop;
-}
\ No newline at end of file
+uint64_t WAVReader::get_num_frames() {
+    return this->block_align != 0 ? this->data_subchunk_size / this->block_align : 0;
+}
+
+double WAVReader::get_duration() {
+    // The duration of a stream whose size isn't known can't be computed
+    if (!this->is_data_size_known || this->sample_rate == 0) {
+        return 0.0;
+    }
+
+    return (double) this->get_num_frames() / this->sample_rate;
+}
+
+uint64_t WAVReader::get_num_stalls() {
+    return this->num_stalls;
+}
+
+bool WAVReader::seek(uint64_t frame) {
+    uint64_t data_position = std::min(frame, this->get_num_frames()) * this->block_align;
+
+    if (this->is_memory_mapped) {
+        this->mapped_data_position = std::min(data_position, this->mapped_data_size);
+
+        return true;
+    }
+
+    // Pipes can't seek, the playback goes on undisturbed from where it was
+    if (this->data_file == nullptr || this->file_size == 0) {
+        return false;
+    }
+
+    // Stops the data loader and discards what it has buffered
+    this->audio_buffer.close();
+
+    if (this->data_loader.joinable()) {
+        this->data_loader.join();
+    }
+
+    this->audio_buffer.reset();
+    this->is_playback_started = false;
+    this->prefetched_data.clear();
+
+    // Resumes loading from the new position (the stream may have hit the end of the file already). When the file
+    // fails to seek, the buffer is left closed so the stream ends rather than going on from an unknown position
+    this->data_file->clear();
+
+    if (!this->data_file->seekg((std::streamoff) (this->data_offset + data_position))) {
+        this->audio_buffer.close();
+
+        return false;
+    }
+
+    this->data_loader = std::thread(&WAVReader::load_data, this, data_position);
+
+    return true;
+}
+
+bool WAVReader::seek_to_time(double seconds) {
+    return this->seek(seconds > 0.0 ? (uint64_t) (seconds * this->sample_rate + 0.5) : 0);
+}
@@ -1,48 +1,116 @@
 #ifndef WASABI_WAVReader_H
 #define WASABI_WAVReader_H
 
+#include <cstdint>
 #include <fstream>
+#include <memory>
+#include <ostream>
 #include <string>
-#include <condition_variable>
-#include <mutex>
-#include <windows.h>
+#include <thread>
+#include <vector>
+#include "audio_decoder.hpp"
+#include "mapped_file.hpp"
+#include "ring_buffer.hpp"
 
+// Number of chunks (of one second each) that the audio buffer can hold
 #define MAX_AUDIO_BUFFER_CHUNKS 5
 
-typedef struct AUDIO_BUFFER_CHUNK {
-    BYTE *data{};
-    uint32_t size{};
-    bool is_written{};
-    bool is_eof{};
-} AUDIO_BUFFER_CHUNK;
+// Size of the region read at once from the start of the file, enough to hold the chunks preceding the audio data of
+// most files (tagged files included) so that opening them takes a single read
+#define WAV_HEADER_READ_SIZE (64 * 1024)
 
-class WAVReader {
+// Size of the regions read at once while indexing the chunks following the audio data, and the most chunks indexed
+// there (the walk stops at the first bytes that aren't a chunk, but a file may be padded with empty ones)
+#define WAV_TRAILER_READ_SIZE (4 * 1024)
+#define WAV_MAX_TRAILING_CHUNKS 64
+
+// Audio format codes of the fmt subchunk
+#define WAV_FORMAT_PCM 1
+#define WAV_FORMAT_IEEE_FLOAT 3
+#define WAV_FORMAT_EXTENSIBLE 0xFFFE
+
+// Size of the largest fmt subchunk read (WAVE_FORMAT_EXTENSIBLE), any extra bytes are ignored
+#define WAV_FMT_MAX_SIZE 40
+
+// Maximum number of channels (one per speaker position of the channel masks)
+#define MAX_NUM_CHANNELS 18
+
+// Location of a chunk of the RIFF file (the offset and size of its data, without its ID and size fields)
+typedef struct RIFF_CHUNK {
+    char id[5]{};
+    uint64_t offset{};
+    uint64_t size{};
+} RIFF_CHUNK;
+
+// Reader of WAV files. The audio data is streamed by a loader thread into a ring buffer (or memory mapped), and lent
+// to the consumer straight from there. Readers of other formats laying out their samples the same way (interleaved
+// frames in a single chunk) reuse this data path and only replace the parsing of the header.
+class WAVReader : public AudioDecoder {
 private:
-    AUDIO_BUFFER_CHUNK audio_buffer_chunks[MAX_AUDIO_BUFFER_CHUNKS]{};
-    int current_audio_buffer_chunk{};
-    bool is_audio_buffer_ready{};
+    RingBuffer audio_buffer;
+    std::shared_ptr<std::ifstream> data_file;
+    std::thread data_loader;
     bool is_playback_started{};
-    std::condition_variable cv;
-    std::mutex mtx;
+    uint64_t num_stalls{};
+    MappedFile mapped_file;
+    bool is_memory_mapped{};
+    uint64_t mapped_data_size{};
+    uint64_t mapped_data_position{};
+
+    std::vector<uint8_t> fmt_data;
+    uint64_t ds64_data_size{};
+    std::vector<RIFF_CHUNK> ds64_chunk_sizes;
+    bool is_data_size_unset{}; // Left for the end of the file by a streaming writer (a size of 0 is an empty chunk)
+
+    bool index_chunks(std::shared_ptr<std::ifstream> file);
+
+    bool resolve_rf64_chunk_size(RIFF_CHUNK &chunk);
+
+    void index_trailing_chunks(std::shared_ptr<std::ifstream> file, uint64_t offset);
+
+    bool load_ds64_chunk();
+
+    bool load_fmt_chunk();
+
+    bool load_data_chunk();
 
-    void check_riff_header(std::shared_ptr<std::ifstream> file);
+    void load_data(uint64_t data_position);
 
-    void load_fmt_subchunk(std::shared_ptr<std::ifstream> file);
+    bool map_data();
 
-    void load_data_subchunk(std::shared_ptr<std::ifstream> file);
+    bool get_mapped_chunk(AUDIO_CHUNK &chunk, uint32_t max_size);
 
-    void load_data(std::shared_ptr<std::ifstream> file);
+protected:
+    // Region of the file holding the header, the audio data read along with it is handed to the loader
+    std::vector<uint8_t> header;
+    uint64_t header_offset{};
+    std::vector<uint8_t> prefetched_data;
+    uint64_t file_size{}; // 0 when it can't be known (pipes)
+    uint64_t data_offset{};
+    bool is_data_size_known{};
+    std::ostream null_stream{nullptr};
+
+    // Gets the stream the header checks are reported to
+    std::ostream &report();
+
+    bool read_header_region(std::shared_ptr<std::ifstream> file, uint64_t offset);
+
+    // Parses the header, which must set the format fields, the location and size of the audio data and the duration,
+    // and leave the audio data read along with the header in the prefetched data
+    virtual bool load_header(std::shared_ptr<std::ifstream> file);
 
 public:
     WAVReader();
 
     WAVReader(WAVReader const &reader);
 
-    ~WAVReader();
+    ~WAVReader() override;
 
     std::string audio_file_path{};
+    std::vector<RIFF_CHUNK> chunks;
+    bool is_rf64{};
     char chunk_id[4]{};
-    uint32_t chunk_size{};
+    uint64_t chunk_size{};
     char format_descriptor[4]{};
     char fmt_subchunk_id[4]{};
     uint32_t fmt_subchunk_size{};
@@ -52,17 +120,44 @@ public:
     uint32_t byte_rate{};
     uint16_t block_align{};
     uint16_t bit_depth{};
+    uint32_t channel_mask{};
     char data_subchunk_id[4]{};
-    uint32_t data_subchunk_size{};
+    uint64_t data_subchunk_size{};
     uint32_t audio_buffer_chunk_size{};
     struct audio_duration {
         int minutes;
         int seconds;
     } audio_duration;
 
-    void load_file(std::string *file_path);
+    // Reads the header and indexes the chunks of the file (unknown chunks are skipped, and the ones following the audio
+    // data are only indexed when the file can seek), returns false (after printing the reason) if the file can't be
+    // played
+    bool load_file(std::string *file_path, bool use_memory_map = false) override;
+
+    const RIFF_CHUNK *find_chunk(const char *id);
+
+    AUDIO_FORMAT get_format() override;
+
+    bool get_chunk(AUDIO_CHUNK &chunk, uint32_t max_size = UINT32_MAX) override;
+
+    void release_chunk(AUDIO_CHUNK &chunk) override;
+
+    void wait_for_chunk(uint32_t timeout) override;
+
+    uint64_t get_num_frames() override;
+
+    // Gets the duration (in seconds) of the 'data' subchunk (0 when its size isn't known)
+    double get_duration() override;
+
+    // Gets how many times a chunk was requested before the loader had read it
+    uint64_t get_num_stalls() override;
+
+    // Moves to the given frame (its offset in the 'data' subchunk is computed from the block alignment), the buffered
+    // data is discarded and the loader resumes reading from there without reopening the file. Returns false when the
+    // input can't seek (pipes)
+    bool seek(uint64_t frame) override;
 
-    bool get_chunk(BYTE **chunk, uint32_t &chunk_size);
+    bool seek_to_time(double seconds);
 };
 
 #endif //WASABI_WAVReader_H
\ No newline at end of file
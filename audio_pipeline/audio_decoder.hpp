@@ -0,0 +1,40 @@
+#ifndef WASABI_AUDIO_DECODER_HPP
+#define WASABI_AUDIO_DECODER_HPP
+
+#include <cstdint>
+#include <string>
+#include "audio_source.hpp"
+
+// Range of supported sample rates (the stream is resampled to the rate of the sink)
+#define MIN_SAMPLE_RATE 1000
+#define MAX_SAMPLE_RATE 768000
+
+// Source decoding an audio file (of any container or codec) to interleaved LPCM. The decoders are created by the
+// decoder registry from the first bytes of the files, and the playlist only goes through this interface.
+class AudioDecoder : public AudioSource {
+public:
+	bool is_verbose{true}; // Whether the header checks are printed (errors always are)
+
+	// Reads the header of the file and starts decoding it in the background, returns false (after printing the
+	// reason) if the file can't be played. The audio data is memory mapped if requested and possible
+	virtual bool load_file(std::string *file_path, bool use_memory_map = false) = 0;
+
+	// Gets the number of frames of the stream
+	virtual uint64_t get_num_frames() = 0;
+
+	// Gets the duration (in seconds) of the stream (0 when unknown)
+	virtual double get_duration() = 0;
+
+	// Gets how many times a chunk was requested before the decoder had it ready (counted rather than printed, chunks
+	// are requested from the render thread)
+	virtual uint64_t get_num_stalls() {
+		return 0;
+	}
+
+	// Gets the number of blocks of the file that couldn't be decoded (they are played as silence)
+	virtual uint64_t get_num_decode_errors() {
+		return 0;
+	}
+};
+
+#endif //WASABI_AUDIO_DECODER_HPP
@@ -0,0 +1,98 @@
+#ifndef WASABI_AUDIO_FORMAT_HPP
+#define WASABI_AUDIO_FORMAT_HPP
+
+#include <cstdint>
+
+// Speaker positions of the channels (same bits as the WAVE_FORMAT_EXTENSIBLE dwChannelMask, whose channels are
+// interleaved in increasing bit order)
+#define CHANNEL_FRONT_LEFT 0x1
+#define CHANNEL_FRONT_RIGHT 0x2
+#define CHANNEL_FRONT_CENTER 0x4
+#define CHANNEL_LOW_FREQUENCY 0x8
+#define CHANNEL_BACK_LEFT 0x10
+#define CHANNEL_BACK_RIGHT 0x20
+#define CHANNEL_FRONT_LEFT_OF_CENTER 0x40
+#define CHANNEL_FRONT_RIGHT_OF_CENTER 0x80
+#define CHANNEL_BACK_CENTER 0x100
+#define CHANNEL_SIDE_LEFT 0x200
+#define CHANNEL_SIDE_RIGHT 0x400
+#define CHANNEL_TOP_CENTER 0x800
+#define CHANNEL_TOP_FRONT_LEFT 0x1000
+#define CHANNEL_TOP_FRONT_CENTER 0x2000
+#define CHANNEL_TOP_FRONT_RIGHT 0x4000
+#define CHANNEL_TOP_BACK_LEFT 0x8000
+#define CHANNEL_TOP_BACK_CENTER 0x10000
+#define CHANNEL_TOP_BACK_RIGHT 0x20000
+
+// Usual layouts (the ones Windows assumes for each number of channels when no mask is given)
+#define CHANNEL_LAYOUT_MONO CHANNEL_FRONT_CENTER
+#define CHANNEL_LAYOUT_STEREO (CHANNEL_FRONT_LEFT | CHANNEL_FRONT_RIGHT)
+#define CHANNEL_LAYOUT_QUAD (CHANNEL_LAYOUT_STEREO | CHANNEL_BACK_LEFT | CHANNEL_BACK_RIGHT)
+#define CHANNEL_LAYOUT_5_1 (CHANNEL_LAYOUT_STEREO | CHANNEL_FRONT_CENTER | CHANNEL_LOW_FREQUENCY | CHANNEL_BACK_LEFT | \
+	CHANNEL_BACK_RIGHT)
+#define CHANNEL_LAYOUT_5_1_SIDE (CHANNEL_LAYOUT_STEREO | CHANNEL_FRONT_CENTER | CHANNEL_LOW_FREQUENCY | \
+	CHANNEL_SIDE_LEFT | CHANNEL_SIDE_RIGHT)
+#define CHANNEL_LAYOUT_7_1 (CHANNEL_LAYOUT_5_1 | CHANNEL_SIDE_LEFT | CHANNEL_SIDE_RIGHT)
+
+// Description of an interleaved LPCM audio stream
+typedef struct AUDIO_FORMAT {
+	uint32_t sample_rate{};
+	uint16_t num_channels{};
+	uint16_t bit_depth{};
+	uint16_t block_align{};
+	uint32_t byte_rate{};
+	// Whether the samples are IEEE floats (otherwise they are integers, unsigned for 8 bits and signed for the rest)
+	bool is_float{};
+	// Whether the samples are stored most significant byte first, as AIFF files store them (their 8 bits samples are
+	// signed too). Only readers produce such streams, the format converter turns them into little-endian ones
+	bool is_big_endian{};
+	// Speaker position of each channel
+	uint32_t channel_mask{};
+} AUDIO_FORMAT;
+
+inline uint32_t get_default_channel_mask(uint16_t num_channels) {
+	switch (num_channels) {
+	case 1:
+		return CHANNEL_LAYOUT_MONO;
+	case 2:
+		return CHANNEL_LAYOUT_STEREO;
+	case 3:
+		return CHANNEL_LAYOUT_STEREO | CHANNEL_FRONT_CENTER;
+	case 4:
+		return CHANNEL_LAYOUT_QUAD;
+	case 5:
+		return CHANNEL_LAYOUT_QUAD | CHANNEL_FRONT_CENTER;
+	case 6:
+		return CHANNEL_LAYOUT_5_1;
+	case 7:
+		return CHANNEL_LAYOUT_5_1 | CHANNEL_BACK_CENTER;
+	case 8:
+		return CHANNEL_LAYOUT_7_1;
+	default:
+		// Assigns the positions in order
+		return num_channels >= 18 ? 0x3FFFF : (1u << num_channels) - 1;
+	}
+}
+
+inline AUDIO_FORMAT make_audio_format(uint32_t sample_rate, uint16_t num_channels, uint16_t bit_depth, bool is_float = false,
+	uint32_t channel_mask = 0) {
+	AUDIO_FORMAT format;
+
+	format.sample_rate = sample_rate;
+	format.num_channels = num_channels;
+	format.bit_depth = bit_depth;
+	format.is_float = is_float;
+	format.channel_mask = channel_mask != 0 ? channel_mask : get_default_channel_mask(num_channels);
+	format.block_align = (uint16_t)(num_channels * (bit_depth / 8));
+	format.byte_rate = sample_rate * format.block_align;
+
+	return format;
+}
+
+inline bool is_same_audio_format(const AUDIO_FORMAT& format, const AUDIO_FORMAT& other_format) {
+	return format.sample_rate == other_format.sample_rate && format.num_channels == other_format.num_channels &&
+		format.bit_depth == other_format.bit_depth && format.is_float == other_format.is_float &&
+		format.is_big_endian == other_format.is_big_endian && format.channel_mask == other_format.channel_mask;
+}
+
+#endif //WASABI_AUDIO_FORMAT_HPP
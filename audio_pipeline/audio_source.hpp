@@ -0,0 +1,47 @@
+#ifndef WASABI_AUDIO_SOURCE_HPP
+#define WASABI_AUDIO_SOURCE_HPP
+
+#include <cstdint>
+#include "audio_format.hpp"
+
+// Maximum time (in milliseconds) the consumers without deadlines wait for a source at once (they check whether they are
+// stopped in between)
+#define SOURCE_WAIT_INTERVAL 10
+
+// Read-only view of a chunk of audio data owned by the source, it stays valid until it is released
+typedef struct AUDIO_CHUNK {
+	const uint8_t *data{};
+	uint32_t size{};
+	bool is_eof{};
+} AUDIO_CHUNK;
+
+// Origin of an audio stream (a file reader, a processing stage...) that lends its audio in chunks. Chunks are lent
+// without ever waiting, as they are requested from the render thread: a source whose data isn't ready yet (a reader
+// behind the stream) lends what it has, possibly an empty chunk that isn't the last one, and the consumer tries again
+// later (on the next refill of the sink, or after wait_for_chunk when it has no deadline)
+class AudioSource {
+public:
+	virtual ~AudioSource() = default;
+
+	// Returns the format the chunks are provided in
+	virtual AUDIO_FORMAT get_format() = 0;
+
+	// Borrows the next chunk (of at most the given size in bytes), returns whether it's the last one
+	virtual bool get_chunk(AUDIO_CHUNK &chunk, uint32_t max_size) = 0;
+
+	// Gives the chunk back to the source once it has been consumed
+	virtual void release_chunk(AUDIO_CHUNK &chunk) = 0;
+
+	// Waits up to the given time (in milliseconds) for the data of the next chunk to be ready, for the consumers that
+	// got an empty chunk and have no deadline (never called from the render thread of a sink consuming in real time)
+	virtual void wait_for_chunk(uint32_t timeout) {
+	}
+
+	// Moves the stream to the given frame (in the sample rate of the chunks), discarding anything buffered. Returns
+	// whether the source supports seeking (no chunk must be borrowed when it is called)
+	virtual bool seek(uint64_t frame) {
+		return false;
+	}
+};
+
+#endif //WASABI_AUDIO_SOURCE_HPP
@@ -0,0 +1,194 @@
+#include "channel_mixer.hpp"
+#include <cmath>
+
+// Gain of a channel folded into two speakers (-3 dB, so its power is kept)
+#define FOLD_GAIN 0.70710678f
+
+// Maximum number of speakers a channel goes through before reaching an output channel
+#define MAX_ROUTING_DEPTH 4
+
+static uint16_t count_speakers(uint32_t channel_mask) {
+	uint16_t num_speakers = 0;
+
+	while (channel_mask != 0) {
+		channel_mask &= channel_mask - 1;
+		num_speakers++;
+	}
+
+	return num_speakers;
+}
+
+// Gets the index of the channel at the given speaker position (channels are interleaved in increasing bit order)
+static int get_channel_index(uint32_t channel_mask, uint32_t speaker) {
+	if ((channel_mask & speaker) == 0) {
+		return -1;
+	}
+
+	return count_speakers(channel_mask & (speaker - 1));
+}
+
+// Clears the speakers beyond the given number of channels (masks may describe more positions than there are channels)
+static uint32_t limit_channel_mask(uint32_t channel_mask, uint16_t num_channels) {
+	uint32_t limited_mask = 0;
+
+	for (uint16_t i = 0; i < num_channels && channel_mask != 0; i++) {
+		uint32_t lowest_speaker = channel_mask & (~channel_mask + 1);
+
+		limited_mask |= lowest_speaker;
+		channel_mask &= ~lowest_speaker;
+	}
+
+	return limited_mask;
+}
+
+ChannelMixer::ChannelMixer(const AUDIO_FORMAT &input_format, const AUDIO_FORMAT &output_format) {
+	this->num_input_channels = input_format.num_channels;
+	this->num_output_channels = output_format.num_channels;
+	this->remix = get_remix_kernel(this->num_input_channels, this->num_output_channels, get_simd_level());
+
+	if (this->remix == nullptr) {
+		return;
+	}
+
+	this->compute_matrix(limit_channel_mask(input_format.channel_mask, this->num_input_channels),
+		limit_channel_mask(output_format.channel_mask, this->num_output_channels));
+}
+
+void ChannelMixer::route_channel(uint16_t input_channel, uint32_t speaker, float gain, uint32_t output_mask, int depth) {
+	int output_channel = get_channel_index(output_mask, speaker);
+
+	if (output_channel != -1) {
+		this->matrix[(size_t)output_channel * this->num_input_channels + input_channel] += gain;
+
+		return;
+	}
+
+	if (depth == MAX_ROUTING_DEPTH) {
+		return;
+	}
+
+	// Folds the speaker into the nearest ones available
+	switch (speaker) {
+	case CHANNEL_FRONT_LEFT:
+	case CHANNEL_FRONT_RIGHT:
+		this->route_channel(input_channel, CHANNEL_FRONT_CENTER, gain * FOLD_GAIN, output_mask, depth + 1);
+		break;
+	case CHANNEL_FRONT_CENTER:
+		if ((output_mask & CHANNEL_LAYOUT_STEREO) != 0) {
+			this->route_channel(input_channel, CHANNEL_FRONT_LEFT, gain * FOLD_GAIN, output_mask, depth + 1);
+			this->route_channel(input_channel, CHANNEL_FRONT_RIGHT, gain * FOLD_GAIN, output_mask, depth + 1);
+		}
+		break;
+	case CHANNEL_LOW_FREQUENCY:
+		// Dropped, full range speakers already carry the low frequencies of the other channels
+		break;
+	case CHANNEL_BACK_LEFT:
+		this->route_channel(input_channel, (output_mask & CHANNEL_SIDE_LEFT) != 0 ? CHANNEL_SIDE_LEFT : CHANNEL_FRONT_LEFT,
+			(output_mask & CHANNEL_SIDE_LEFT) != 0 ? gain : gain * FOLD_GAIN, output_mask, depth + 1);
+		break;
+	case CHANNEL_BACK_RIGHT:
+		this->route_channel(input_channel, (output_mask & CHANNEL_SIDE_RIGHT) != 0 ? CHANNEL_SIDE_RIGHT : CHANNEL_FRONT_RIGHT,
+			(output_mask & CHANNEL_SIDE_RIGHT) != 0 ? gain : gain * FOLD_GAIN, output_mask, depth + 1);
+		break;
+	case CHANNEL_SIDE_LEFT:
+		this->route_channel(input_channel, (output_mask & CHANNEL_BACK_LEFT) != 0 ? CHANNEL_BACK_LEFT : CHANNEL_FRONT_LEFT,
+			(output_mask & CHANNEL_BACK_LEFT) != 0 ? gain : gain * FOLD_GAIN, output_mask, depth + 1);
+		break;
+	case CHANNEL_SIDE_RIGHT:
+		this->route_channel(input_channel, (output_mask & CHANNEL_BACK_RIGHT) != 0 ? CHANNEL_BACK_RIGHT : CHANNEL_FRONT_RIGHT,
+			(output_mask & CHANNEL_BACK_RIGHT) != 0 ? gain : gain * FOLD_GAIN, output_mask, depth + 1);
+		break;
+	case CHANNEL_FRONT_LEFT_OF_CENTER:
+		this->route_channel(input_channel, CHANNEL_FRONT_LEFT, gain, output_mask, depth + 1);
+		break;
+	case CHANNEL_FRONT_RIGHT_OF_CENTER:
+		this->route_channel(input_channel, CHANNEL_FRONT_RIGHT, gain, output_mask, depth + 1);
+		break;
+	case CHANNEL_BACK_CENTER:
+		this->route_channel(input_channel, CHANNEL_BACK_LEFT, gain * FOLD_GAIN, output_mask, depth + 1);
+		this->route_channel(input_channel, CHANNEL_BACK_RIGHT, gain * FOLD_GAIN, output_mask, depth + 1);
+		break;
+	case CHANNEL_TOP_CENTER:
+	case CHANNEL_TOP_FRONT_CENTER:
+		this->route_channel(input_channel, CHANNEL_FRONT_CENTER, gain * FOLD_GAIN, output_mask, depth + 1);
+		break;
+	case CHANNEL_TOP_FRONT_LEFT:
+		this->route_channel(input_channel, CHANNEL_FRONT_LEFT, gain * FOLD_GAIN, output_mask, depth + 1);
+		break;
+	case CHANNEL_TOP_FRONT_RIGHT:
+		this->route_channel(input_channel, CHANNEL_FRONT_RIGHT, gain * FOLD_GAIN, output_mask, depth + 1);
+		break;
+	case CHANNEL_TOP_BACK_LEFT:
+		this->route_channel(input_channel, CHANNEL_BACK_LEFT, gain * FOLD_GAIN, output_mask, depth + 1);
+		break;
+	case CHANNEL_TOP_BACK_CENTER:
+		this->route_channel(input_channel, CHANNEL_BACK_CENTER, gain * FOLD_GAIN, output_mask, depth + 1);
+		break;
+	case CHANNEL_TOP_BACK_RIGHT:
+		this->route_channel(input_channel, CHANNEL_BACK_RIGHT, gain * FOLD_GAIN, output_mask, depth + 1);
+		break;
+	default:
+		break;
+	}
+}
+
+void ChannelMixer::compute_matrix(uint32_t input_mask, uint32_t output_mask) {
+	this->matrix.assign((size_t)this->num_output_channels * this->num_input_channels, 0.0f);
+
+	uint16_t input_channel = 0;
+
+	for (uint32_t speaker = 1; speaker != 0 && input_mask != 0; speaker <<= 1) {
+		if ((input_mask & speaker) == 0) {
+			continue;
+		}
+
+		// A mono channel is played at full scale on both front speakers, like a stereo file with identical channels
+		if (this->num_input_channels == 1 && (output_mask & CHANNEL_FRONT_CENTER) == 0 &&
+			(output_mask & CHANNEL_LAYOUT_STEREO) == CHANNEL_LAYOUT_STEREO) {
+			this->route_channel(input_channel, CHANNEL_FRONT_LEFT, 1.0f, output_mask, 0);
+			this->route_channel(input_channel, CHANNEL_FRONT_RIGHT, 1.0f, output_mask, 0);
+		} else {
+			this->route_channel(input_channel, speaker, 1.0f, output_mask, 0);
+		}
+
+		input_mask &= ~speaker;
+		input_channel++;
+	}
+
+	// Channels without a position are copied to the output channel with the same index, if it has no position either
+	uint16_t num_positioned_output_channels = count_speakers(output_mask);
+
+	for (; input_channel < this->num_input_channels; input_channel++) {
+		if (input_channel >= num_positioned_output_channels && input_channel < this->num_output_channels) {
+			this->matrix[(size_t)input_channel * this->num_input_channels + input_channel] = 1.0f;
+		}
+	}
+
+	// Scales the rows whose gains add up to more than unity, so full scale inputs can't clip
+	for (uint16_t output_channel = 0; output_channel < this->num_output_channels; output_channel++) {
+		float *row = this->matrix.data() + (size_t)output_channel * this->num_input_channels;
+		float sum = 0.0f;
+
+		for (uint16_t i = 0; i < this->num_input_channels; i++) {
+			sum += std::fabs(row[i]);
+		}
+
+		if (sum > 1.0f + 1e-6f) {
+			for (uint16_t i = 0; i < this->num_input_channels; i++) {
+				row[i] /= sum;
+			}
+		}
+	}
+}
+
+bool ChannelMixer::is_supported() {
+	return this->remix != nullptr;
+}
+
+const std::vector<float> &ChannelMixer::get_matrix() {
+	return this->matrix;
+}
+
+void ChannelMixer::process(float *samples, uint32_t num_frames) {
+	this->remix(samples, num_frames, this->matrix.data(), this->num_input_channels, this->num_output_channels);
+}
@@ -0,0 +1,36 @@
+#ifndef WASABI_CHANNEL_MIXER_HPP
+#define WASABI_CHANNEL_MIXER_HPP
+
+#include <cstdint>
+#include <vector>
+#include "audio_format.hpp"
+#include "channel_mixer_kernels.hpp"
+
+// Upmixes or downmixes interleaved 32 bits float frames from a channel layout to another. The matrix is computed once
+// from the channel masks of both formats: channels present in both layouts are copied, the missing ones are folded
+// into their nearest speakers (the center to the front pair at -3 dB, the back and side channels into each other or the
+// front ones, etc.) and the low frequency channel is dropped. The rows that could clip are scaled down.
+class ChannelMixer {
+private:
+	uint16_t num_input_channels{};
+	uint16_t num_output_channels{};
+	std::vector<float> matrix;
+	REMIX_KERNEL remix{};
+
+	void route_channel(uint16_t input_channel, uint32_t speaker, float gain, uint32_t output_mask, int depth);
+
+	void compute_matrix(uint32_t input_mask, uint32_t output_mask);
+
+public:
+	ChannelMixer(const AUDIO_FORMAT &input_format, const AUDIO_FORMAT &output_format);
+
+	bool is_supported();
+
+	// Gets the gain of each input channel for each output channel (one row per output channel)
+	const std::vector<float> &get_matrix();
+
+	// Remixes the frames in place, the buffer must hold as many samples per frame as the largest channel count
+	void process(float *samples, uint32_t num_frames);
+};
+
+#endif //WASABI_CHANNEL_MIXER_HPP
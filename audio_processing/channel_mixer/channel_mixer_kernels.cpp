@@ -0,0 +1,198 @@
+#include "channel_mixer_kernels.hpp"
+#include <cstring>
+
+// Frames are processed forwards when the frames shrink and backwards when they grow, so each frame is read before the
+// frames written afterwards can overlap it
+static inline bool is_processed_backwards(uint16_t num_input_channels, uint16_t num_output_channels) {
+	return num_output_channels > num_input_channels;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Kernels specialised for a number of channels (the loops over the channels are unrolled by the compiler)
+// ---------------------------------------------------------------------------------------------------------------------
+
+template<uint16_t NUM_INPUT_CHANNELS, uint16_t NUM_OUTPUT_CHANNELS>
+static inline void remix_frame(float *samples, size_t frame, const float (&coefficients)[NUM_OUTPUT_CHANNELS][NUM_INPUT_CHANNELS]) {
+	float input_frame[NUM_INPUT_CHANNELS];
+	float *output_frame = samples + frame * NUM_OUTPUT_CHANNELS;
+
+	memcpy(input_frame, samples + frame * NUM_INPUT_CHANNELS, sizeof(input_frame));
+
+	for (uint16_t output_channel = 0; output_channel < NUM_OUTPUT_CHANNELS; output_channel++) {
+		float sample = 0.0f;
+
+		for (uint16_t input_channel = 0; input_channel < NUM_INPUT_CHANNELS; input_channel++) {
+			sample += coefficients[output_channel][input_channel] * input_frame[input_channel];
+		}
+
+		output_frame[output_channel] = sample;
+	}
+}
+
+template<uint16_t NUM_INPUT_CHANNELS, uint16_t NUM_OUTPUT_CHANNELS>
+static void remix_layout(float *samples, size_t num_frames, const float *matrix, uint16_t num_input_channels,
+	uint16_t num_output_channels) {
+	// Copies the matrix to a local array of known size, so its coefficients can stay in registers
+	float coefficients[NUM_OUTPUT_CHANNELS][NUM_INPUT_CHANNELS];
+
+	memcpy(coefficients, matrix, sizeof(coefficients));
+
+	if (is_processed_backwards(NUM_INPUT_CHANNELS, NUM_OUTPUT_CHANNELS)) {
+		for (size_t frame = num_frames; frame-- > 0;) {
+			remix_frame<NUM_INPUT_CHANNELS, NUM_OUTPUT_CHANNELS>(samples, frame, coefficients);
+		}
+	} else {
+		for (size_t frame = 0; frame < num_frames; frame++) {
+			remix_frame<NUM_INPUT_CHANNELS, NUM_OUTPUT_CHANNELS>(samples, frame, coefficients);
+		}
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Generic kernels
+// ---------------------------------------------------------------------------------------------------------------------
+
+static inline void remix_generic_frame(float *samples, size_t frame, const float *matrix, uint16_t num_input_channels,
+	uint16_t num_output_channels) {
+	float input_frame[CHANNEL_MIXER_MAX_CHANNELS];
+	float *output_frame = samples + frame * num_output_channels;
+
+	memcpy(input_frame, samples + frame * num_input_channels, num_input_channels * sizeof(float));
+
+	for (uint16_t output_channel = 0; output_channel < num_output_channels; output_channel++) {
+		const float *row = matrix + (size_t)output_channel * num_input_channels;
+		float sample = 0.0f;
+
+		for (uint16_t input_channel = 0; input_channel < num_input_channels; input_channel++) {
+			sample += row[input_channel] * input_frame[input_channel];
+		}
+
+		output_frame[output_channel] = sample;
+	}
+}
+
+static void remix_generic(float *samples, size_t num_frames, const float *matrix, uint16_t num_input_channels,
+	uint16_t num_output_channels) {
+	if (is_processed_backwards(num_input_channels, num_output_channels)) {
+		for (size_t frame = num_frames; frame-- > 0;) {
+			remix_generic_frame(samples, frame, matrix, num_input_channels, num_output_channels);
+		}
+	} else {
+		for (size_t frame = 0; frame < num_frames; frame++) {
+			remix_generic_frame(samples, frame, matrix, num_input_channels, num_output_channels);
+		}
+	}
+}
+
+#ifdef WASABI_SIMD_X86
+
+// The vectorised kernels compute a whole output frame at once (up to 8 channels), adding each input sample times the
+// matrix column of its channel
+#define SIMD_MAX_OUTPUT_CHANNELS 8
+
+static void transpose_matrix(const float *matrix, float (*columns)[SIMD_MAX_OUTPUT_CHANNELS], uint16_t num_input_channels,
+	uint16_t num_output_channels) {
+	for (uint16_t input_channel = 0; input_channel < num_input_channels; input_channel++) {
+		for (uint16_t output_channel = 0; output_channel < SIMD_MAX_OUTPUT_CHANNELS; output_channel++) {
+			columns[input_channel][output_channel] = output_channel < num_output_channels ?
+				matrix[(size_t)output_channel * num_input_channels + input_channel] : 0.0f;
+		}
+	}
+}
+
+static void remix_generic_sse2(float *samples, size_t num_frames, const float *matrix, uint16_t num_input_channels,
+	uint16_t num_output_channels) {
+	alignas(16) float columns[CHANNEL_MIXER_MAX_CHANNELS][SIMD_MAX_OUTPUT_CHANNELS];
+	alignas(16) float output_frame[SIMD_MAX_OUTPUT_CHANNELS];
+	bool is_backwards = is_processed_backwards(num_input_channels, num_output_channels);
+
+	transpose_matrix(matrix, columns, num_input_channels, num_output_channels);
+
+	for (size_t i = 0; i < num_frames; i++) {
+		size_t frame = is_backwards ? num_frames - 1 - i : i;
+		const float *input_frame = samples + frame * num_input_channels;
+		__m128 low_sum = _mm_setzero_ps();
+		__m128 high_sum = _mm_setzero_ps();
+
+		for (uint16_t input_channel = 0; input_channel < num_input_channels; input_channel++) {
+			__m128 sample = _mm_set1_ps(input_frame[input_channel]);
+
+			low_sum = _mm_add_ps(low_sum, _mm_mul_ps(sample, _mm_load_ps(columns[input_channel])));
+			high_sum = _mm_add_ps(high_sum, _mm_mul_ps(sample, _mm_load_ps(columns[input_channel] + 4)));
+		}
+
+		// Writing the whole vectors would overwrite the next input frames, so only the output channels are copied
+		_mm_store_ps(output_frame, low_sum);
+		_mm_store_ps(output_frame + 4, high_sum);
+
+		memcpy(samples + frame * num_output_channels, output_frame, num_output_channels * sizeof(float));
+	}
+}
+
+WASABI_TARGET_AVX2
+static void remix_generic_avx2(float *samples, size_t num_frames, const float *matrix, uint16_t num_input_channels,
+	uint16_t num_output_channels) {
+	alignas(32) float columns[CHANNEL_MIXER_MAX_CHANNELS][SIMD_MAX_OUTPUT_CHANNELS];
+	alignas(32) int32_t store_mask[SIMD_MAX_OUTPUT_CHANNELS];
+	bool is_backwards = is_processed_backwards(num_input_channels, num_output_channels);
+
+	transpose_matrix(matrix, columns, num_input_channels, num_output_channels);
+
+	// Only the lanes of the output channels are stored, so the next input frames aren't overwritten
+	for (uint16_t output_channel = 0; output_channel < SIMD_MAX_OUTPUT_CHANNELS; output_channel++) {
+		store_mask[output_channel] = output_channel < num_output_channels ? -1 : 0;
+	}
+
+	__m256i mask = _mm256_load_si256((const __m256i *) store_mask);
+
+	for (size_t i = 0; i < num_frames; i++) {
+		size_t frame = is_backwards ? num_frames - 1 - i : i;
+		const float *input_frame = samples + frame * num_input_channels;
+		__m256 sum = _mm256_setzero_ps();
+
+		for (uint16_t input_channel = 0; input_channel < num_input_channels; input_channel++) {
+			sum = _mm256_fmadd_ps(_mm256_set1_ps(input_frame[input_channel]), _mm256_load_ps(columns[input_channel]), sum);
+		}
+
+		_mm256_maskstore_ps(samples + frame * num_output_channels, mask, sum);
+	}
+}
+
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Dispatch
+// ---------------------------------------------------------------------------------------------------------------------
+
+REMIX_KERNEL get_remix_kernel(uint16_t num_input_channels, uint16_t num_output_channels, SIMD_LEVEL level) {
+	if (num_input_channels == 0 || num_output_channels == 0 || num_input_channels > CHANNEL_MIXER_MAX_CHANNELS ||
+		num_output_channels > CHANNEL_MIXER_MAX_CHANNELS) {
+		return nullptr;
+	}
+
+	if (num_input_channels == 1 && num_output_channels == 2) {
+		return remix_layout<1, 2>;
+	}
+
+	if (num_input_channels == 6 && num_output_channels == 2) {
+		return remix_layout<6, 2>;
+	}
+
+	if (num_input_channels == 8 && num_output_channels == 6) {
+		return remix_layout<8, 6>;
+	}
+
+#ifdef WASABI_SIMD_X86
+	if (num_output_channels <= SIMD_MAX_OUTPUT_CHANNELS) {
+		if (level >= SIMD_LEVEL_AVX2) {
+			return remix_generic_avx2;
+		}
+
+		if (level >= SIMD_LEVEL_SSE2) {
+			return remix_generic_sse2;
+		}
+	}
+#endif
+
+	return remix_generic;
+}
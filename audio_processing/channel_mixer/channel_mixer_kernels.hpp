@@ -0,0 +1,20 @@
+#ifndef WASABI_CHANNEL_MIXER_KERNELS_HPP
+#define WASABI_CHANNEL_MIXER_KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "simd.hpp"
+
+// Maximum number of input or output channels
+#define CHANNEL_MIXER_MAX_CHANNELS 32
+
+// Remixes interleaved 32 bits float frames in place with a matrix holding the gain of each input channel for each output
+// channel (one row per output channel). The buffer must hold as many samples per frame as the largest channel count.
+typedef void (*REMIX_KERNEL)(float *samples, size_t num_frames, const float *matrix, uint16_t num_input_channels,
+	uint16_t num_output_channels);
+
+// Return the kernel for the given channel counts and instruction set, the common layouts (mono to stereo, 5.1 to stereo
+// and 7.1 to 5.1) get kernels specialised at compile time for their number of channels
+REMIX_KERNEL get_remix_kernel(uint16_t num_input_channels, uint16_t num_output_channels, SIMD_LEVEL level);
+
+#endif //WASABI_CHANNEL_MIXER_KERNELS_HPP
@@ -0,0 +1,764 @@
+#include "conversion_kernels.hpp"
+#include <cmath>
+#include <cstring>
+
+// Integer samples are scaled by 2^(bit depth - 1), so full scale maps to [-1, 1)
+#define S8_SCALE 128.0f
+#define S16_SCALE 32768.0f
+#define S24_SCALE 8388608.0f
+#define S32_SCALE 2147483648.0f
+// Largest float below 2^31 (2^31 itself doesn't fit in an int32)
+#define S32_MAX_FLOAT 2147483520.0f
+#define RANDOM_SCALE (1.0f / 16777216.0f)
+
+void initialize_dither_state(DITHER_STATE *dither_state, uint32_t seed) {
+	// Seeds each lane differently (xorshift generators must never be seeded with 0)
+	for (int i = 0; i < DITHER_GROUP_SIZE; i++) {
+		seed = seed * 1664525u + 1013904223u;
+		dither_state->seeds[i] = seed != 0 ? seed : 0x9E3779B9u;
+	}
+
+	dither_state->noise_index = DITHER_GROUP_SIZE;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Scalar kernels
+// ---------------------------------------------------------------------------------------------------------------------
+
+static inline uint32_t next_random(uint32_t &state) {
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+
+	return state;
+}
+
+static inline float get_tpdf_dither(uint32_t &state) {
+	// The difference of two uniform variables in [0, 1) has a triangular distribution in (-1, 1)
+	float first = (float) (next_random(state) >> 8);
+	float second = (float) (next_random(state) >> 8);
+
+	return (first - second) * RANDOM_SCALE;
+}
+
+static inline float get_next_dither(DITHER_STATE *dither_state) {
+	// Draws the noise of the next group once the current one is used up, the same way the vectorised kernels do
+	if (dither_state->noise_index == DITHER_GROUP_SIZE) {
+		for (int i = 0; i < DITHER_GROUP_SIZE; i++) {
+			dither_state->noise[i] = get_tpdf_dither(dither_state->seeds[i]);
+		}
+
+		dither_state->noise_index = 0;
+	}
+
+	return dither_state->noise[dither_state->noise_index++];
+}
+
+// Gets how many samples are left in the group being dithered, the vectorised kernels dither them first so theirs are
+// aligned with the groups
+static inline size_t get_num_pending_dither(const DITHER_STATE *dither_state, size_t num_samples) {
+	if (dither_state == nullptr) {
+		return 0;
+	}
+
+	size_t num_pending_samples = (DITHER_GROUP_SIZE - dither_state->noise_index) % DITHER_GROUP_SIZE;
+
+	return num_pending_samples < num_samples ? num_pending_samples : num_samples;
+}
+
+static inline int32_t quantize(float sample, float scale, float min_value, float max_value, DITHER_STATE *dither_state) {
+	float value = sample * scale;
+
+	if (dither_state != nullptr) {
+		value += get_next_dither(dither_state);
+	}
+
+	value = value < min_value ? min_value : (value > max_value ? max_value : value);
+
+	return (int32_t) lrintf(value);
+}
+
+static void convert_u8_to_float(const uint8_t *input, float *output, size_t num_samples) {
+	for (size_t i = 0; i < num_samples; i++) {
+		output[i] = ((float) input[i] - 128.0f) * (1.0f / S8_SCALE);
+	}
+}
+
+static void convert_s16_to_float(const uint8_t *input, float *output, size_t num_samples) {
+	int16_t sample;
+
+	for (size_t i = 0; i < num_samples; i++) {
+		memcpy(&sample, input + i * 2, sizeof(sample));
+
+		output[i] = (float) sample * (1.0f / S16_SCALE);
+	}
+}
+
+static void convert_s24_to_float(const uint8_t *input, float *output, size_t num_samples) {
+	for (size_t i = 0; i < num_samples; i++) {
+		// Places the 3 bytes in the upper bytes of an int32, so its sign is preserved
+		int32_t sample = (int32_t) (((uint32_t) input[i * 3] << 8) | ((uint32_t) input[i * 3 + 1] << 16) |
+			((uint32_t) input[i * 3 + 2] << 24));
+
+		output[i] = (float) sample * (1.0f / S32_SCALE);
+	}
+}
+
+static void convert_s32_to_float(const uint8_t *input, float *output, size_t num_samples) {
+	int32_t sample;
+
+	for (size_t i = 0; i < num_samples; i++) {
+		memcpy(&sample, input + i * 4, sizeof(sample));
+
+		output[i] = (float) sample * (1.0f / S32_SCALE);
+	}
+}
+
+static void convert_f32_to_float(const uint8_t *input, float *output, size_t num_samples) {
+	memcpy(output, input, num_samples * sizeof(float));
+}
+
+static void convert_s8_to_float(const uint8_t *input, float *output, size_t num_samples) {
+	for (size_t i = 0; i < num_samples; i++) {
+		output[i] = (float) (int8_t) input[i] * (1.0f / S8_SCALE);
+	}
+}
+
+static void convert_s16be_to_float(const uint8_t *input, float *output, size_t num_samples) {
+	for (size_t i = 0; i < num_samples; i++) {
+		int16_t sample = (int16_t) (((uint32_t) input[i * 2] << 8) | input[i * 2 + 1]);
+
+		output[i] = (float) sample * (1.0f / S16_SCALE);
+	}
+}
+
+static void convert_s24be_to_float(const uint8_t *input, float *output, size_t num_samples) {
+	for (size_t i = 0; i < num_samples; i++) {
+		int32_t sample = (int32_t) (((uint32_t) input[i * 3] << 24) | ((uint32_t) input[i * 3 + 1] << 16) |
+			((uint32_t) input[i * 3 + 2] << 8));
+
+		output[i] = (float) sample * (1.0f / S32_SCALE);
+	}
+}
+
+static inline uint32_t load_uint32_be(const uint8_t *input) {
+	return ((uint32_t) input[0] << 24) | ((uint32_t) input[1] << 16) | ((uint32_t) input[2] << 8) | input[3];
+}
+
+static void convert_s32be_to_float(const uint8_t *input, float *output, size_t num_samples) {
+	for (size_t i = 0; i < num_samples; i++) {
+		output[i] = (float) (int32_t) load_uint32_be(input + i * 4) * (1.0f / S32_SCALE);
+	}
+}
+
+static void convert_f32be_to_float(const uint8_t *input, float *output, size_t num_samples) {
+	for (size_t i = 0; i < num_samples; i++) {
+		uint32_t sample = load_uint32_be(input + i * 4);
+
+		memcpy(output + i, &sample, sizeof(sample));
+	}
+}
+
+static void convert_float_to_u8(const float *input, uint8_t *output, size_t num_samples, DITHER_STATE *dither_state) {
+	for (size_t i = 0; i < num_samples; i++) {
+		output[i] = (uint8_t) (quantize(input[i], S8_SCALE, -S8_SCALE, S8_SCALE - 1.0f, dither_state) + 128);
+	}
+}
+
+static void convert_float_to_s16(const float *input, uint8_t *output, size_t num_samples, DITHER_STATE *dither_state) {
+	int16_t sample;
+
+	for (size_t i = 0; i < num_samples; i++) {
+		sample = (int16_t) quantize(input[i], S16_SCALE, -S16_SCALE, S16_SCALE - 1.0f, dither_state);
+
+		memcpy(output + i * 2, &sample, sizeof(sample));
+	}
+}
+
+static void convert_float_to_s24(const float *input, uint8_t *output, size_t num_samples, DITHER_STATE *dither_state) {
+	for (size_t i = 0; i < num_samples; i++) {
+		int32_t sample = quantize(input[i], S24_SCALE, -S24_SCALE, S24_SCALE - 1.0f, dither_state);
+
+		output[i * 3] = (uint8_t) sample;
+		output[i * 3 + 1] = (uint8_t) (sample >> 8);
+		output[i * 3 + 2] = (uint8_t) (sample >> 16);
+	}
+}
+
+static void convert_float_to_s32(const float *input, uint8_t *output, size_t num_samples, DITHER_STATE *dither_state) {
+	int32_t sample;
+
+	// Dithering 32 bits samples is pointless, their LSB is way below the float precision
+	for (size_t i = 0; i < num_samples; i++) {
+		sample = quantize(input[i], S32_SCALE, -S32_SCALE, S32_MAX_FLOAT, nullptr);
+
+		memcpy(output + i * 4, &sample, sizeof(sample));
+	}
+}
+
+static void convert_float_to_f32(const float *input, uint8_t *output, size_t num_samples, DITHER_STATE *dither_state) {
+	memcpy(output, input, num_samples * sizeof(float));
+}
+
+#ifdef WASABI_SIMD_X86
+
+// ---------------------------------------------------------------------------------------------------------------------
+// SSE2 kernels (4 samples per vector)
+// ---------------------------------------------------------------------------------------------------------------------
+
+static inline __m128i next_random_sse2(__m128i &state) {
+	state = _mm_xor_si128(state, _mm_slli_epi32(state, 13));
+	state = _mm_xor_si128(state, _mm_srli_epi32(state, 17));
+	state = _mm_xor_si128(state, _mm_slli_epi32(state, 5));
+
+	return state;
+}
+
+static inline __m128 get_tpdf_dither_sse2(__m128i &state) {
+	__m128 first = _mm_cvtepi32_ps(_mm_srli_epi32(next_random_sse2(state), 8));
+	__m128 second = _mm_cvtepi32_ps(_mm_srli_epi32(next_random_sse2(state), 8));
+
+	return _mm_mul_ps(_mm_sub_ps(first, second), _mm_set1_ps(RANDOM_SCALE));
+}
+
+static void convert_s16_to_float_sse2(const uint8_t *input, float *output, size_t num_samples) {
+	const __m128 scale = _mm_set1_ps(1.0f / S16_SCALE);
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8) {
+		__m128i samples = _mm_loadu_si128((const __m128i *) (input + i * 2));
+
+		// Sign extends the samples to 32 bits by placing them in the upper half of each lane
+		__m128i low_samples = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+		__m128i high_samples = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+
+		_mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(low_samples), scale));
+		_mm_storeu_ps(output + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high_samples), scale));
+	}
+
+	convert_s16_to_float(input + i * 2, output + i, num_samples - i);
+}
+
+static void convert_s32_to_float_sse2(const uint8_t *input, float *output, size_t num_samples) {
+	const __m128 scale = _mm_set1_ps(1.0f / S32_SCALE);
+	size_t i = 0;
+
+	for (; i + 4 <= num_samples; i += 4) {
+		__m128i samples = _mm_loadu_si128((const __m128i *) (input + i * 4));
+
+		_mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(samples), scale));
+	}
+
+	convert_s32_to_float(input + i * 4, output + i, num_samples - i);
+}
+
+static void convert_float_to_s16_sse2(const float *input, uint8_t *output, size_t num_samples, DITHER_STATE *dither_state) {
+	const __m128 scale = _mm_set1_ps(S16_SCALE);
+	const __m128 min_value = _mm_set1_ps(-S16_SCALE);
+	const __m128 max_value = _mm_set1_ps(S16_SCALE - 1.0f);
+	// A group of dithered samples spans two vectors, each with half of the lanes of the generator
+	__m128i low_random_state = _mm_setzero_si128();
+	__m128i high_random_state = _mm_setzero_si128();
+	size_t i = get_num_pending_dither(dither_state, num_samples);
+
+	convert_float_to_s16(input, output, i, dither_state);
+
+	if (dither_state != nullptr) {
+		low_random_state = _mm_loadu_si128((const __m128i *) dither_state->seeds);
+		high_random_state = _mm_loadu_si128((const __m128i *) (dither_state->seeds + 4));
+	}
+
+	for (; i + 8 <= num_samples; i += 8) {
+		__m128 low_samples = _mm_mul_ps(_mm_loadu_ps(input + i), scale);
+		__m128 high_samples = _mm_mul_ps(_mm_loadu_ps(input + i + 4), scale);
+
+		if (dither_state != nullptr) {
+			low_samples = _mm_add_ps(low_samples, get_tpdf_dither_sse2(low_random_state));
+			high_samples = _mm_add_ps(high_samples, get_tpdf_dither_sse2(high_random_state));
+		}
+
+		// Clamps before converting, out of range floats would convert to INT32_MIN whatever their sign
+		low_samples = _mm_min_ps(_mm_max_ps(low_samples, min_value), max_value);
+		high_samples = _mm_min_ps(_mm_max_ps(high_samples, min_value), max_value);
+
+		__m128i samples = _mm_packs_epi32(_mm_cvtps_epi32(low_samples), _mm_cvtps_epi32(high_samples));
+
+		_mm_storeu_si128((__m128i *) (output + i * 2), samples);
+	}
+
+	if (dither_state != nullptr) {
+		_mm_storeu_si128((__m128i *) dither_state->seeds, low_random_state);
+		_mm_storeu_si128((__m128i *) (dither_state->seeds + 4), high_random_state);
+	}
+
+	convert_float_to_s16(input + i, output + i * 2, num_samples - i, dither_state);
+}
+
+static void convert_float_to_s32_sse2(const float *input, uint8_t *output, size_t num_samples, DITHER_STATE *dither_state) {
+	const __m128 scale = _mm_set1_ps(S32_SCALE);
+	const __m128 min_value = _mm_set1_ps(-S32_SCALE);
+	const __m128 max_value = _mm_set1_ps(S32_MAX_FLOAT);
+	size_t i = 0;
+
+	for (; i + 4 <= num_samples; i += 4) {
+		__m128 samples = _mm_mul_ps(_mm_loadu_ps(input + i), scale);
+
+		samples = _mm_min_ps(_mm_max_ps(samples, min_value), max_value);
+
+		_mm_storeu_si128((__m128i *) (output + i * 4), _mm_cvtps_epi32(samples));
+	}
+
+	convert_float_to_s32(input + i, output + i * 4, num_samples - i, dither_state);
+}
+
+// SSE2 can only swap bytes with shifts: the bytes of each 16 bits word are swapped, then the words of each 32 bits lane
+static inline __m128i swap_word_bytes_sse2(__m128i samples) {
+	return _mm_or_si128(_mm_slli_epi16(samples, 8), _mm_srli_epi16(samples, 8));
+}
+
+static inline __m128i swap_dword_bytes_sse2(__m128i samples) {
+	samples = _mm_shufflehi_epi16(_mm_shufflelo_epi16(samples, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+
+	return swap_word_bytes_sse2(samples);
+}
+
+static void convert_s16be_to_float_sse2(const uint8_t *input, float *output, size_t num_samples) {
+	const __m128 scale = _mm_set1_ps(1.0f / S32_SCALE);
+	const __m128i zero = _mm_setzero_si128();
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8) {
+		__m128i samples = swap_word_bytes_sse2(_mm_loadu_si128((const __m128i *) (input + i * 2)));
+
+		// Unpacking below zeros places the samples in the upper half of each lane, which keeps their sign
+		__m128i low_samples = _mm_unpacklo_epi16(zero, samples);
+		__m128i high_samples = _mm_unpackhi_epi16(zero, samples);
+
+		_mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(low_samples), scale));
+		_mm_storeu_ps(output + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high_samples), scale));
+	}
+
+	convert_s16be_to_float(input + i * 2, output + i, num_samples - i);
+}
+
+static void convert_s32be_to_float_sse2(const uint8_t *input, float *output, size_t num_samples) {
+	const __m128 scale = _mm_set1_ps(1.0f / S32_SCALE);
+	size_t i = 0;
+
+	for (; i + 4 <= num_samples; i += 4) {
+		__m128i samples = swap_dword_bytes_sse2(_mm_loadu_si128((const __m128i *) (input + i * 4)));
+
+		_mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(samples), scale));
+	}
+
+	convert_s32be_to_float(input + i * 4, output + i, num_samples - i);
+}
+
+static void convert_f32be_to_float_sse2(const uint8_t *input, float *output, size_t num_samples) {
+	size_t i = 0;
+
+	for (; i + 4 <= num_samples; i += 4) {
+		__m128i samples = swap_dword_bytes_sse2(_mm_loadu_si128((const __m128i *) (input + i * 4)));
+
+		_mm_storeu_ps(output + i, _mm_castsi128_ps(samples));
+	}
+
+	convert_f32be_to_float(input + i * 4, output + i, num_samples - i);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// AVX2 kernels (8 samples per vector)
+// ---------------------------------------------------------------------------------------------------------------------
+
+WASABI_TARGET_AVX2
+static inline __m256i next_random_avx2(__m256i &state) {
+	state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 13));
+	state = _mm256_xor_si256(state, _mm256_srli_epi32(state, 17));
+	state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 5));
+
+	return state;
+}
+
+WASABI_TARGET_AVX2
+static inline __m256 get_tpdf_dither_avx2(__m256i &state) {
+	__m256 first = _mm256_cvtepi32_ps(_mm256_srli_epi32(next_random_avx2(state), 8));
+	__m256 second = _mm256_cvtepi32_ps(_mm256_srli_epi32(next_random_avx2(state), 8));
+
+	return _mm256_mul_ps(_mm256_sub_ps(first, second), _mm256_set1_ps(RANDOM_SCALE));
+}
+
+WASABI_TARGET_AVX2
+static void convert_s16_to_float_avx2(const uint8_t *input, float *output, size_t num_samples) {
+	const __m256 scale = _mm256_set1_ps(1.0f / S16_SCALE);
+	size_t i = 0;
+
+	for (; i + 16 <= num_samples; i += 16) {
+		__m128i low_samples = _mm_loadu_si128((const __m128i *) (input + i * 2));
+		__m128i high_samples = _mm_loadu_si128((const __m128i *) (input + i * 2 + 16));
+
+		_mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(low_samples)), scale));
+		_mm256_storeu_ps(output + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(high_samples)), scale));
+	}
+
+	convert_s16_to_float(input + i * 2, output + i, num_samples - i);
+}
+
+WASABI_TARGET_AVX2
+static void convert_s24_to_float_avx2(const uint8_t *input, float *output, size_t num_samples) {
+	const __m256 scale = _mm256_set1_ps(1.0f / S32_SCALE);
+	// Moves each group of 3 bytes to the upper 3 bytes of a 32 bits lane (0x80 zeroes the lowest byte)
+	const __m256i shuffle_mask = _mm256_setr_epi8(
+		-128, 0, 1, 2, -128, 3, 4, 5, -128, 6, 7, 8, -128, 9, 10, 11,
+		-128, 0, 1, 2, -128, 3, 4, 5, -128, 6, 7, 8, -128, 9, 10, 11);
+	size_t i = 0;
+
+	// Each iteration loads 16 bytes from offsets 0 and 12, so it stops early enough not to read past the input
+	for (; i + 10 <= num_samples; i += 8) {
+		__m128i low_bytes = _mm_loadu_si128((const __m128i *) (input + i * 3));
+		__m128i high_bytes = _mm_loadu_si128((const __m128i *) (input + i * 3 + 12));
+		__m256i bytes = _mm256_inserti128_si256(_mm256_castsi128_si256(low_bytes), high_bytes, 1);
+		__m256i samples = _mm256_shuffle_epi8(bytes, shuffle_mask);
+
+		_mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(samples), scale));
+	}
+
+	convert_s24_to_float(input + i * 3, output + i, num_samples - i);
+}
+
+WASABI_TARGET_AVX2
+static void convert_s32_to_float_avx2(const uint8_t *input, float *output, size_t num_samples) {
+	const __m256 scale = _mm256_set1_ps(1.0f / S32_SCALE);
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8) {
+		__m256i samples = _mm256_loadu_si256((const __m256i *) (input + i * 4));
+
+		_mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(samples), scale));
+	}
+
+	convert_s32_to_float(input + i * 4, output + i, num_samples - i);
+}
+
+WASABI_TARGET_AVX2
+static void convert_s16be_to_float_avx2(const uint8_t *input, float *output, size_t num_samples) {
+	const __m256 scale = _mm256_set1_ps(1.0f / S32_SCALE);
+	// Swaps the bytes of each sample into the upper half of a 32 bits lane (the lower lane takes the first 4 samples
+	// of the broadcast bytes, the upper lane the last 4)
+	const __m256i shuffle_mask = _mm256_setr_epi8(
+		-128, -128, 1, 0, -128, -128, 3, 2, -128, -128, 5, 4, -128, -128, 7, 6,
+		-128, -128, 9, 8, -128, -128, 11, 10, -128, -128, 13, 12, -128, -128, 15, 14);
+	size_t i = 0;
+
+	for (; i + 16 <= num_samples; i += 16) {
+		__m256i low_bytes = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) (input + i * 2)));
+		__m256i high_bytes = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) (input + i * 2 + 16)));
+		__m256i low_samples = _mm256_shuffle_epi8(low_bytes, shuffle_mask);
+		__m256i high_samples = _mm256_shuffle_epi8(high_bytes, shuffle_mask);
+
+		_mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(low_samples), scale));
+		_mm256_storeu_ps(output + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(high_samples), scale));
+	}
+
+	convert_s16be_to_float(input + i * 2, output + i, num_samples - i);
+}
+
+WASABI_TARGET_AVX2
+static void convert_s24be_to_float_avx2(const uint8_t *input, float *output, size_t num_samples) {
+	const __m256 scale = _mm256_set1_ps(1.0f / S32_SCALE);
+	// Same as the little-endian kernel, with the 3 bytes of each group reversed
+	const __m256i shuffle_mask = _mm256_setr_epi8(
+		-128, 2, 1, 0, -128, 5, 4, 3, -128, 8, 7, 6, -128, 11, 10, 9,
+		-128, 2, 1, 0, -128, 5, 4, 3, -128, 8, 7, 6, -128, 11, 10, 9);
+	size_t i = 0;
+
+	for (; i + 10 <= num_samples; i += 8) {
+		__m128i low_bytes = _mm_loadu_si128((const __m128i *) (input + i * 3));
+		__m128i high_bytes = _mm_loadu_si128((const __m128i *) (input + i * 3 + 12));
+		__m256i bytes = _mm256_inserti128_si256(_mm256_castsi128_si256(low_bytes), high_bytes, 1);
+		__m256i samples = _mm256_shuffle_epi8(bytes, shuffle_mask);
+
+		_mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(samples), scale));
+	}
+
+	convert_s24be_to_float(input + i * 3, output + i, num_samples - i);
+}
+
+WASABI_TARGET_AVX2
+static inline __m256i swap_dword_bytes_avx2(__m256i samples) {
+	const __m256i shuffle_mask = _mm256_setr_epi8(
+		3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+		3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+	return _mm256_shuffle_epi8(samples, shuffle_mask);
+}
+
+WASABI_TARGET_AVX2
+static void convert_s32be_to_float_avx2(const uint8_t *input, float *output, size_t num_samples) {
+	const __m256 scale = _mm256_set1_ps(1.0f / S32_SCALE);
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8) {
+		__m256i samples = swap_dword_bytes_avx2(_mm256_loadu_si256((const __m256i *) (input + i * 4)));
+
+		_mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(samples), scale));
+	}
+
+	convert_s32be_to_float(input + i * 4, output + i, num_samples - i);
+}
+
+WASABI_TARGET_AVX2
+static void convert_f32be_to_float_avx2(const uint8_t *input, float *output, size_t num_samples) {
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8) {
+		__m256i samples = swap_dword_bytes_avx2(_mm256_loadu_si256((const __m256i *) (input + i * 4)));
+
+		_mm256_storeu_ps(output + i, _mm256_castsi256_ps(samples));
+	}
+
+	convert_f32be_to_float(input + i * 4, output + i, num_samples - i);
+}
+
+WASABI_TARGET_AVX2
+static void convert_float_to_s16_avx2(const float *input, uint8_t *output, size_t num_samples, DITHER_STATE *dither_state) {
+	const __m256 scale = _mm256_set1_ps(S16_SCALE);
+	const __m256 min_value = _mm256_set1_ps(-S16_SCALE);
+	const __m256 max_value = _mm256_set1_ps(S16_SCALE - 1.0f);
+	__m256i random_state = _mm256_setzero_si256();
+	size_t i = get_num_pending_dither(dither_state, num_samples);
+
+	convert_float_to_s16(input, output, i, dither_state);
+
+	if (dither_state != nullptr) {
+		random_state = _mm256_loadu_si256((const __m256i *) dither_state->seeds);
+	}
+
+	// Each vector is a group of dithered samples
+	for (; i + 16 <= num_samples; i += 16) {
+		__m256 low_samples = _mm256_mul_ps(_mm256_loadu_ps(input + i), scale);
+		__m256 high_samples = _mm256_mul_ps(_mm256_loadu_ps(input + i + 8), scale);
+
+		if (dither_state != nullptr) {
+			low_samples = _mm256_add_ps(low_samples, get_tpdf_dither_avx2(random_state));
+			high_samples = _mm256_add_ps(high_samples, get_tpdf_dither_avx2(random_state));
+		}
+
+		low_samples = _mm256_min_ps(_mm256_max_ps(low_samples, min_value), max_value);
+		high_samples = _mm256_min_ps(_mm256_max_ps(high_samples, min_value), max_value);
+
+		// Packing works within 128 bits lanes, so the 64 bits blocks have to be put back in order afterwards
+		__m256i samples = _mm256_packs_epi32(_mm256_cvtps_epi32(low_samples), _mm256_cvtps_epi32(high_samples));
+
+		_mm256_storeu_si256((__m256i *) (output + i * 2), _mm256_permute4x64_epi64(samples, 0xD8));
+	}
+
+	if (dither_state != nullptr) {
+		_mm256_storeu_si256((__m256i *) dither_state->seeds, random_state);
+	}
+
+	convert_float_to_s16(input + i, output + i * 2, num_samples - i, dither_state);
+}
+
+WASABI_TARGET_AVX2
+static void convert_float_to_s24_avx2(const float *input, uint8_t *output, size_t num_samples, DITHER_STATE *dither_state) {
+	const __m256 scale = _mm256_set1_ps(S24_SCALE);
+	const __m256 min_value = _mm256_set1_ps(-S24_SCALE);
+	const __m256 max_value = _mm256_set1_ps(S24_SCALE - 1.0f);
+	// Packs the lower 3 bytes of each 32 bits lane in the first 12 bytes of each 128 bits lane
+	const __m256i shuffle_mask = _mm256_setr_epi8(
+		0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -128, -128, -128, -128,
+		0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -128, -128, -128, -128);
+	__m256i random_state = _mm256_setzero_si256();
+	size_t i = get_num_pending_dither(dither_state, num_samples);
+
+	convert_float_to_s24(input, output, i, dither_state);
+
+	if (dither_state != nullptr) {
+		random_state = _mm256_loadu_si256((const __m256i *) dither_state->seeds);
+	}
+
+	// Each iteration stores 16 bytes at offsets 0 and 12, so it stops early enough not to write past the output
+	for (; i + 10 <= num_samples; i += 8) {
+		__m256 samples = _mm256_mul_ps(_mm256_loadu_ps(input + i), scale);
+
+		if (dither_state != nullptr) {
+			samples = _mm256_add_ps(samples, get_tpdf_dither_avx2(random_state));
+		}
+
+		samples = _mm256_min_ps(_mm256_max_ps(samples, min_value), max_value);
+
+		__m256i bytes = _mm256_shuffle_epi8(_mm256_cvtps_epi32(samples), shuffle_mask);
+
+		_mm_storeu_si128((__m128i *) (output + i * 3), _mm256_castsi256_si128(bytes));
+		_mm_storeu_si128((__m128i *) (output + i * 3 + 12), _mm256_extracti128_si256(bytes, 1));
+	}
+
+	if (dither_state != nullptr) {
+		_mm256_storeu_si256((__m256i *) dither_state->seeds, random_state);
+	}
+
+	convert_float_to_s24(input + i, output + i * 3, num_samples - i, dither_state);
+}
+
+WASABI_TARGET_AVX2
+static void convert_float_to_s32_avx2(const float *input, uint8_t *output, size_t num_samples, DITHER_STATE *dither_state) {
+	const __m256 scale = _mm256_set1_ps(S32_SCALE);
+	const __m256 min_value = _mm256_set1_ps(-S32_SCALE);
+	const __m256 max_value = _mm256_set1_ps(S32_MAX_FLOAT);
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8) {
+		__m256 samples = _mm256_mul_ps(_mm256_loadu_ps(input + i), scale);
+
+		samples = _mm256_min_ps(_mm256_max_ps(samples, min_value), max_value);
+
+		_mm256_storeu_si256((__m256i *) (output + i * 4), _mm256_cvtps_epi32(samples));
+	}
+
+	convert_float_to_s32(input + i, output + i * 4, num_samples - i, dither_state);
+}
+
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Dispatch
+// ---------------------------------------------------------------------------------------------------------------------
+
+TO_FLOAT_KERNEL get_to_float_kernel(uint16_t bit_depth, bool is_float, SIMD_LEVEL level) {
+	if (is_float) {
+		return bit_depth == 32 ? convert_f32_to_float : nullptr;
+	}
+
+	switch (bit_depth) {
+	case 8:
+		return convert_u8_to_float;
+	case 16:
+#ifdef WASABI_SIMD_X86
+		if (level >= SIMD_LEVEL_AVX2) {
+			return convert_s16_to_float_avx2;
+		}
+
+		if (level >= SIMD_LEVEL_SSE2) {
+			return convert_s16_to_float_sse2;
+		}
+#endif
+		return convert_s16_to_float;
+	case 24:
+#ifdef WASABI_SIMD_X86
+		// Unpacking 3 bytes samples requires byte shuffles, which SSE2 doesn't have
+		if (level >= SIMD_LEVEL_AVX2) {
+			return convert_s24_to_float_avx2;
+		}
+#endif
+		return convert_s24_to_float;
+	case 32:
+#ifdef WASABI_SIMD_X86
+		if (level >= SIMD_LEVEL_AVX2) {
+			return convert_s32_to_float_avx2;
+		}
+
+		if (level >= SIMD_LEVEL_SSE2) {
+			return convert_s32_to_float_sse2;
+		}
+#endif
+		return convert_s32_to_float;
+	default:
+		return nullptr;
+	}
+}
+
+FROM_FLOAT_KERNEL get_from_float_kernel(uint16_t bit_depth, bool is_float, SIMD_LEVEL level) {
+	if (is_float) {
+		return bit_depth == 32 ? convert_float_to_f32 : nullptr;
+	}
+
+	switch (bit_depth) {
+	case 8:
+		return convert_float_to_u8;
+	case 16:
+#ifdef WASABI_SIMD_X86
+		if (level >= SIMD_LEVEL_AVX2) {
+			return convert_float_to_s16_avx2;
+		}
+
+		if (level >= SIMD_LEVEL_SSE2) {
+			return convert_float_to_s16_sse2;
+		}
+#endif
+		return convert_float_to_s16;
+	case 24:
+#ifdef WASABI_SIMD_X86
+		if (level >= SIMD_LEVEL_AVX2) {
+			return convert_float_to_s24_avx2;
+		}
+#endif
+		return convert_float_to_s24;
+	case 32:
+#ifdef WASABI_SIMD_X86
+		if (level >= SIMD_LEVEL_AVX2) {
+			return convert_float_to_s32_avx2;
+		}
+
+		if (level >= SIMD_LEVEL_SSE2) {
+			return convert_float_to_s32_sse2;
+		}
+#endif
+		return convert_float_to_s32;
+	default:
+		return nullptr;
+	}
+}
+
+TO_FLOAT_KERNEL get_big_endian_to_float_kernel(uint16_t bit_depth, bool is_float, SIMD_LEVEL level) {
+	if (is_float) {
+		if (bit_depth != 32) {
+			return nullptr;
+		}
+#ifdef WASABI_SIMD_X86
+		if (level >= SIMD_LEVEL_AVX2) {
+			return convert_f32be_to_float_avx2;
+		}
+
+		if (level >= SIMD_LEVEL_SSE2) {
+			return convert_f32be_to_float_sse2;
+		}
+#endif
+		return convert_f32be_to_float;
+	}
+
+	switch (bit_depth) {
+	case 8:
+		return convert_s8_to_float;
+	case 16:
+#ifdef WASABI_SIMD_X86
+		if (level >= SIMD_LEVEL_AVX2) {
+			return convert_s16be_to_float_avx2;
+		}
+
+		if (level >= SIMD_LEVEL_SSE2) {
+			return convert_s16be_to_float_sse2;
+		}
+#endif
+		return convert_s16be_to_float;
+	case 24:
+#ifdef WASABI_SIMD_X86
+		if (level >= SIMD_LEVEL_AVX2) {
+			return convert_s24be_to_float_avx2;
+		}
+#endif
+		return convert_s24be_to_float;
+	case 32:
+#ifdef WASABI_SIMD_X86
+		if (level >= SIMD_LEVEL_AVX2) {
+			return convert_s32be_to_float_avx2;
+		}
+
+		if (level >= SIMD_LEVEL_SSE2) {
+			return convert_s32be_to_float_sse2;
+		}
+#endif
+		return convert_s32be_to_float;
+	default:
+		return nullptr;
+	}
+}
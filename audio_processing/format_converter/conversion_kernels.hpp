@@ -0,0 +1,39 @@
+#ifndef WASABI_CONVERSION_KERNELS_HPP
+#define WASABI_CONVERSION_KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "simd.hpp"
+
+// Number of samples dithered together, each by its own lane of the random generator
+#define DITHER_GROUP_SIZE 8
+
+// Per-lane states of the random generator used for dithering, and the noise of the group of samples being dithered. The
+// samples are dithered by whole groups whatever the kernel, the rest of a group cut by the end of a block being kept
+// for the next one, so the noise of a sample only depends on its position in the stream (not on how the stream is
+// split into blocks, nor on the instruction set)
+typedef struct DITHER_STATE {
+	uint32_t seeds[DITHER_GROUP_SIZE]{};
+	float noise[DITHER_GROUP_SIZE]{};
+	uint32_t noise_index{DITHER_GROUP_SIZE}; // Of the next sample of the group (none is left when it's the group size)
+} DITHER_STATE;
+
+// Converts interleaved samples to 32 bits floats in [-1, 1)
+typedef void (*TO_FLOAT_KERNEL)(const uint8_t *input, float *output, size_t num_samples);
+
+// Converts 32 bits floats to interleaved samples, adding triangular (TPDF) dither of one LSB when a state is provided
+typedef void (*FROM_FLOAT_KERNEL)(const float *input, uint8_t *output, size_t num_samples, DITHER_STATE *dither_state);
+
+void initialize_dither_state(DITHER_STATE *dither_state, uint32_t seed);
+
+// Return the kernel for the given sample format and instruction set (or nullptr if the sample format isn't supported),
+// instruction sets without a specific kernel fall back to the closest lower one
+TO_FLOAT_KERNEL get_to_float_kernel(uint16_t bit_depth, bool is_float, SIMD_LEVEL level);
+
+FROM_FLOAT_KERNEL get_from_float_kernel(uint16_t bit_depth, bool is_float, SIMD_LEVEL level);
+
+// Returns the kernel converting big-endian samples (signed at 8 bits, as AIFF stores them), the AVX2 ones swap the
+// bytes with the same shuffles that widen the samples
+TO_FLOAT_KERNEL get_big_endian_to_float_kernel(uint16_t bit_depth, bool is_float, SIMD_LEVEL level);
+
+#endif //WASABI_CONVERSION_KERNELS_HPP
@@ -0,0 +1,131 @@
+#include "format_converter.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+FormatConverter::FormatConverter(AudioSource *source, const AUDIO_FORMAT &output_format, DITHER_TYPE dither_type,
+	uint32_t buffer_frames) {
+	this->source = source;
+	this->input_format = source->get_format();
+	this->output_format = make_audio_format(this->input_format.sample_rate, output_format.num_channels,
+		output_format.bit_depth, output_format.is_float, output_format.channel_mask);
+	this->is_passthrough = is_same_audio_format(this->input_format, this->output_format);
+
+	if (this->is_passthrough) {
+		return;
+	}
+
+	// Picks the kernels for the best instruction set available
+	SIMD_LEVEL simd_level = get_simd_level();
+
+	this->to_float = this->input_format.is_big_endian ?
+		get_big_endian_to_float_kernel(this->input_format.bit_depth, this->input_format.is_float, simd_level) :
+		get_to_float_kernel(this->input_format.bit_depth, this->input_format.is_float, simd_level);
+	this->from_float = get_from_float_kernel(this->output_format.bit_depth, this->output_format.is_float, simd_level);
+
+	// Only reducing the resolution of the samples needs dither (floats and 32 bits integers hold more than the source)
+	this->is_dithered = dither_type == DITHER_TPDF && !this->output_format.is_float && this->output_format.bit_depth < 32 &&
+		(this->input_format.is_float || this->input_format.bit_depth > this->output_format.bit_depth);
+
+	initialize_dither_state(&this->dither_state, 0x5EED);
+
+	if (this->input_format.num_channels != this->output_format.num_channels ||
+		this->input_format.channel_mask != this->output_format.channel_mask) {
+		this->channel_mixer = new ChannelMixer(this->input_format, this->output_format);
+	}
+
+	// Allocates the buffers once, they are reused for every chunk (remixing in place needs room for the largest frames)
+	uint16_t max_channels = std::max(this->input_format.num_channels, this->output_format.num_channels);
+	size_t num_samples = (size_t)buffer_frames * max_channels;
+
+	this->buffer_frames = buffer_frames;
+	this->float_buffer = (float*)malloc(num_samples * sizeof(float));
+	this->output_buffer = (uint8_t*)malloc(std::max((size_t)buffer_frames * this->output_format.block_align,
+		this->output_format.is_float ? num_samples * sizeof(float) : 0));
+}
+
+FormatConverter::~FormatConverter() {
+	// Frees all allocated memory
+	delete this->channel_mixer;
+	free(this->float_buffer);
+	free(this->output_buffer);
+}
+
+bool FormatConverter::is_supported() {
+	return this->is_passthrough || (this->to_float != nullptr && this->from_float != nullptr &&
+		(this->channel_mixer == nullptr || this->channel_mixer->is_supported()));
+}
+
+void FormatConverter::reseed_dither(uint32_t seed) {
+	initialize_dither_state(&this->dither_state, seed);
+}
+
+AUDIO_FORMAT FormatConverter::get_format() {
+	return this->output_format;
+}
+
+bool FormatConverter::get_chunk(AUDIO_CHUNK &chunk, uint32_t max_size) {
+	if (this->is_passthrough) {
+		return this->source->get_chunk(chunk, max_size);
+	}
+
+	// Requests as many input frames as output frames fit in the requested size (and in the buffers)
+	AUDIO_CHUNK input_chunk;
+	uint32_t num_frames = std::min(max_size / this->output_format.block_align, this->buffer_frames);
+	bool is_eof = this->source->get_chunk(input_chunk, num_frames * this->input_format.block_align);
+
+	// A trailing partial frame (truncated file) is dropped
+	num_frames = input_chunk.size / this->input_format.block_align;
+
+	size_t num_input_samples = (size_t)num_frames * this->input_format.num_channels;
+	size_t num_output_samples = (size_t)num_frames * this->output_format.num_channels;
+	DITHER_STATE *dither_state = this->is_dithered ? &this->dither_state : nullptr;
+
+	if (this->channel_mixer == nullptr && this->output_format.is_float) {
+		// Converts straight into the output buffer
+		this->to_float(input_chunk.data, (float*)this->output_buffer, num_input_samples);
+	} else if (this->channel_mixer == nullptr && this->input_format.is_float) {
+		// Converts straight from the input chunk
+		this->from_float((const float*)input_chunk.data, this->output_buffer, num_output_samples, dither_state);
+	} else {
+		// Remixes in the buffer the samples end up in (the output buffer itself for floats)
+		float *samples = this->output_format.is_float ? (float*)this->output_buffer : this->float_buffer;
+
+		this->to_float(input_chunk.data, samples, num_input_samples);
+
+		if (this->channel_mixer != nullptr) {
+			this->channel_mixer->process(samples, num_frames);
+		}
+
+		if (!this->output_format.is_float) {
+			this->from_float(samples, this->output_buffer, num_output_samples, dither_state);
+		}
+	}
+
+	this->source->release_chunk(input_chunk);
+
+	chunk.data = this->output_buffer;
+	chunk.size = num_frames * this->output_format.block_align;
+	chunk.is_eof = is_eof;
+
+	return is_eof;
+}
+
+void FormatConverter::release_chunk(AUDIO_CHUNK &chunk) {
+	if (this->is_passthrough) {
+		this->source->release_chunk(chunk);
+
+		return;
+	}
+
+	chunk.data = nullptr;
+	chunk.size = 0;
+}
+
+void FormatConverter::wait_for_chunk(uint32_t timeout) {
+	this->source->wait_for_chunk(timeout);
+}
+
+bool FormatConverter::seek(uint64_t frame) {
+	// Nothing is kept between chunks, the sample rate is the same on both sides
+	return this->source->seek(frame);
+}
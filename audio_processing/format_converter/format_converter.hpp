@@ -0,0 +1,63 @@
+#ifndef WASABI_FORMAT_CONVERTER_HPP
+#define WASABI_FORMAT_CONVERTER_HPP
+
+#include <cstdint>
+#include "audio_source.hpp"
+#include "channel_mixer.hpp"
+#include "conversion_kernels.hpp"
+
+// Number of frames converted per chunk by default
+#define FORMAT_CONVERTER_BUFFER_FRAMES 4096
+
+enum DITHER_TYPE {
+	DITHER_NONE,
+	DITHER_TPDF
+};
+
+// Processing stage converting the samples of its source to another sample format and channel layout (the sample rate is
+// kept). Samples go through 32 bits floats, with vectorised kernels picked at runtime for the instruction set of the CPU,
+// and are remixed in place in the float buffer. When both formats are the same, the chunks of the source are passed
+// through untouched.
+class FormatConverter : public AudioSource {
+private:
+	AudioSource *source;
+	AUDIO_FORMAT input_format;
+	AUDIO_FORMAT output_format;
+	bool is_passthrough{};
+	TO_FLOAT_KERNEL to_float{};
+	FROM_FLOAT_KERNEL from_float{};
+	ChannelMixer *channel_mixer{};
+	DITHER_STATE dither_state;
+	bool is_dithered{};
+	uint32_t buffer_frames{};
+	float *float_buffer{};
+	uint8_t *output_buffer{};
+
+public:
+	FormatConverter(AudioSource *source, const AUDIO_FORMAT &output_format, DITHER_TYPE dither_type,
+		uint32_t buffer_frames = FORMAT_CONVERTER_BUFFER_FRAMES);
+
+	FormatConverter(FormatConverter const &format_converter) = delete;
+
+	FormatConverter &operator=(FormatConverter const &format_converter) = delete;
+
+	~FormatConverter() override;
+
+	bool is_supported();
+
+	// Restarts the dither noise from the given seed (a stream rendered in parts gets the same noise whichever converter
+	// renders each part)
+	void reseed_dither(uint32_t seed);
+
+	AUDIO_FORMAT get_format() override;
+
+	bool get_chunk(AUDIO_CHUNK &chunk, uint32_t max_size) override;
+
+	void release_chunk(AUDIO_CHUNK &chunk) override;
+
+	void wait_for_chunk(uint32_t timeout) override;
+
+	bool seek(uint64_t frame) override;
+};
+
+#endif //WASABI_FORMAT_CONVERTER_HPP
@@ -0,0 +1,96 @@
+#include "gain_kernels.hpp"
+
+// The gains are computed from the index of the frame rather than accumulated, so long ramps don't drift (frame indexes
+// are exact in floats up to 2^24)
+static inline void apply_gain_ramp_from(float *samples, size_t num_samples, const float *frame_offsets,
+	size_t pattern_size, size_t pattern_position, float start_gain, float gain_step, float pattern_frame) {
+	for (size_t i = 0; i < num_samples; i++) {
+		samples[i] *= start_gain + gain_step * (pattern_frame + frame_offsets[pattern_position]);
+
+		if (++pattern_position == pattern_size) {
+			pattern_position = 0;
+			pattern_frame += GAIN_PATTERN_FRAMES;
+		}
+	}
+}
+
+static void apply_gain_ramp(float *samples, size_t num_samples, const float *frame_offsets, size_t pattern_size,
+	float start_gain, float gain_step) {
+	apply_gain_ramp_from(samples, num_samples, frame_offsets, pattern_size, 0, start_gain, gain_step, 0.0f);
+}
+
+void fill_gain_frame_offsets(float *frame_offsets, uint16_t num_channels) {
+	for (size_t i = 0; i < (size_t)num_channels * GAIN_PATTERN_FRAMES; i++) {
+		frame_offsets[i] = (float)(i / num_channels);
+	}
+}
+
+#ifdef WASABI_SIMD_X86
+
+static void apply_gain_ramp_sse2(float *samples, size_t num_samples, const float *frame_offsets, size_t pattern_size,
+	float start_gain, float gain_step) {
+	const __m128 start_gain_vector = _mm_set1_ps(start_gain);
+	const __m128 gain_step_vector = _mm_set1_ps(gain_step);
+	size_t pattern_position = 0;
+	float pattern_frame = 0.0f;
+	size_t i = 0;
+
+	for (; i + 4 <= num_samples; i += 4) {
+		__m128 frames = _mm_add_ps(_mm_set1_ps(pattern_frame), _mm_loadu_ps(frame_offsets + pattern_position));
+		__m128 gains = _mm_add_ps(start_gain_vector, _mm_mul_ps(gain_step_vector, frames));
+
+		_mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), gains));
+
+		pattern_position += 4;
+
+		if (pattern_position == pattern_size) {
+			pattern_position = 0;
+			pattern_frame += GAIN_PATTERN_FRAMES;
+		}
+	}
+
+	apply_gain_ramp_from(samples + i, num_samples - i, frame_offsets, pattern_size, pattern_position, start_gain,
+		gain_step, pattern_frame);
+}
+
+WASABI_TARGET_AVX2
+static void apply_gain_ramp_avx2(float *samples, size_t num_samples, const float *frame_offsets, size_t pattern_size,
+	float start_gain, float gain_step) {
+	const __m256 start_gain_vector = _mm256_set1_ps(start_gain);
+	const __m256 gain_step_vector = _mm256_set1_ps(gain_step);
+	size_t pattern_position = 0;
+	float pattern_frame = 0.0f;
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8) {
+		__m256 frames = _mm256_add_ps(_mm256_set1_ps(pattern_frame), _mm256_loadu_ps(frame_offsets + pattern_position));
+		__m256 gains = _mm256_fmadd_ps(gain_step_vector, frames, start_gain_vector);
+
+		_mm256_storeu_ps(samples + i, _mm256_mul_ps(_mm256_loadu_ps(samples + i), gains));
+
+		pattern_position += 8;
+
+		if (pattern_position == pattern_size) {
+			pattern_position = 0;
+			pattern_frame += GAIN_PATTERN_FRAMES;
+		}
+	}
+
+	apply_gain_ramp_from(samples + i, num_samples - i, frame_offsets, pattern_size, pattern_position, start_gain,
+		gain_step, pattern_frame);
+}
+
+#endif
+
+GAIN_RAMP_KERNEL get_gain_ramp_kernel(SIMD_LEVEL level) {
+#ifdef WASABI_SIMD_X86
+	if (level >= SIMD_LEVEL_AVX2) {
+		return apply_gain_ramp_avx2;
+	}
+
+	if (level >= SIMD_LEVEL_SSE2) {
+		return apply_gain_ramp_sse2;
+	}
+#endif
+	return apply_gain_ramp;
+}
@@ -0,0 +1,26 @@
+#ifndef WASABI_GAIN_KERNELS_HPP
+#define WASABI_GAIN_KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "simd.hpp"
+
+// Number of frames covered by a pattern of frame offsets, so its size (in samples) is a multiple of the width of every
+// vector
+#define GAIN_PATTERN_FRAMES 8
+
+// Scales interleaved 32 bits float samples in place by a gain ramping linearly from frame to frame: the samples of the
+// n-th frame are multiplied by start_gain + n * gain_step, so every channel of a frame gets the same gain. The index of
+// the frame of each sample is given as a pattern of GAIN_PATTERN_FRAMES frames (0 for the samples of the first frame, 1
+// for the ones of the second...), so vectors of gains are computed with one multiply-add whatever the number of channels.
+// The samples must start at the first channel of a frame. A constant gain is a ramp with a step of 0.
+typedef void (*GAIN_RAMP_KERNEL)(float *samples, size_t num_samples, const float *frame_offsets, size_t pattern_size,
+	float start_gain, float gain_step);
+
+// Fills a pattern of GAIN_PATTERN_FRAMES frames of frame offsets for the given number of channels
+void fill_gain_frame_offsets(float *frame_offsets, uint16_t num_channels);
+
+// Returns the kernel for the given instruction set
+GAIN_RAMP_KERNEL get_gain_ramp_kernel(SIMD_LEVEL level);
+
+#endif //WASABI_GAIN_KERNELS_HPP
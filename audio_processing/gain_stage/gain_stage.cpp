@@ -0,0 +1,191 @@
+#include "gain_stage.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+GainStage::GainStage(AudioSource *source, DITHER_TYPE dither_type, uint32_t buffer_frames) {
+	this->source = source;
+	this->format = source->get_format();
+
+	// Picks the kernels for the best instruction set available
+	SIMD_LEVEL simd_level = get_simd_level();
+
+	this->to_float = get_to_float_kernel(this->format.bit_depth, this->format.is_float, simd_level);
+	this->from_float = get_from_float_kernel(this->format.bit_depth, this->format.is_float, simd_level);
+	this->apply_gain_ramp = get_gain_ramp_kernel(simd_level);
+
+	// Scaling integer samples leaves a fraction of LSB to round (floats and 32 bits integers are left undithered)
+	this->is_dithered = dither_type == DITHER_TPDF && !this->format.is_float && this->format.bit_depth < 32;
+
+	initialize_dither_state(&this->dither_state, 0x6A1);
+
+	// Allocates the buffers once, they are reused for every chunk
+	size_t num_samples = (size_t)buffer_frames * this->format.num_channels;
+
+	this->buffer_frames = buffer_frames;
+	this->float_buffer = (float*)malloc(num_samples * sizeof(float));
+	this->output_buffer = (uint8_t*)malloc(std::max((size_t)buffer_frames * this->format.block_align,
+		num_samples * sizeof(float)));
+	this->pattern_size = (size_t)this->format.num_channels * GAIN_PATTERN_FRAMES;
+	this->frame_offsets = (float*)malloc(std::max(this->pattern_size, (size_t)1) * sizeof(float));
+
+	fill_gain_frame_offsets(this->frame_offsets, this->format.num_channels);
+}
+
+GainStage::~GainStage() {
+	// Frees all allocated memory
+	free(this->float_buffer);
+	free(this->output_buffer);
+	free(this->frame_offsets);
+}
+
+bool GainStage::is_supported() {
+	return this->to_float != nullptr && this->from_float != nullptr && this->format.num_channels > 0;
+}
+
+float GainStage::db_to_gain(float db) {
+	return db <= GAIN_SILENCE_DB ? 0.0f : std::pow(10.0f, db / 20.0f);
+}
+
+void GainStage::ramp_to(float target_gain, uint32_t num_frames) {
+	this->target_gain = target_gain;
+
+	if (num_frames == 0 || this->gain == target_gain) {
+		this->gain = target_gain;
+		this->gain_step = 0.0f;
+		this->num_ramp_frames = 0;
+
+		return;
+	}
+
+	this->gain_step = (target_gain - this->gain) / num_frames;
+	this->num_ramp_frames = num_frames;
+}
+
+void GainStage::set_gain(float gain, uint32_t num_ramp_frames) {
+	this->level = gain;
+
+	if (!this->is_fading_out_flag) {
+		this->ramp_to(gain, num_ramp_frames);
+	}
+}
+
+void GainStage::set_gain_db(float db, uint32_t num_ramp_frames) {
+	this->set_gain(GainStage::db_to_gain(db), num_ramp_frames);
+}
+
+void GainStage::fade_out(uint32_t num_frames) {
+	this->is_fading_out_flag = true;
+	this->ramp_to(0.0f, num_frames);
+}
+
+void GainStage::fade_in(uint32_t num_frames, float start_gain) {
+	this->is_fading_out_flag = false;
+	this->gain = start_gain;
+	this->ramp_to(this->level, num_frames);
+}
+
+bool GainStage::is_fading_out() {
+	return this->is_fading_out_flag && this->num_ramp_frames > 0;
+}
+
+bool GainStage::is_held() {
+	return this->is_fading_out_flag && this->num_ramp_frames == 0;
+}
+
+float GainStage::get_gain() {
+	return this->gain;
+}
+
+void GainStage::scale(float *samples, uint32_t num_frames) {
+	uint32_t num_ramped_frames = std::min(num_frames, this->num_ramp_frames);
+
+	if (num_ramped_frames > 0) {
+		this->apply_gain_ramp(samples, (size_t)num_ramped_frames * this->format.num_channels, this->frame_offsets,
+			this->pattern_size, this->gain, this->gain_step);
+
+		this->num_ramp_frames -= num_ramped_frames;
+
+		// Lands exactly on the target at the end of the ramp
+		this->gain = this->num_ramp_frames == 0 ? this->target_gain : this->gain + this->gain_step * num_ramped_frames;
+		this->gain_step = this->num_ramp_frames == 0 ? 0.0f : this->gain_step;
+	}
+
+	if (num_frames > num_ramped_frames) {
+		this->apply_gain_ramp(samples + (size_t)num_ramped_frames * this->format.num_channels,
+			(size_t)(num_frames - num_ramped_frames) * this->format.num_channels, this->frame_offsets, this->pattern_size,
+			this->gain, 0.0f);
+	}
+}
+
+AUDIO_FORMAT GainStage::get_format() {
+	return this->format;
+}
+
+bool GainStage::get_chunk(AUDIO_CHUNK &chunk, uint32_t max_size) {
+	this->is_chunk_passed_through = false;
+
+	if (this->is_held()) {
+		chunk.data = nullptr;
+		chunk.size = 0;
+		chunk.is_eof = true;
+
+		return true;
+	}
+
+	if (this->num_ramp_frames == 0 && this->gain == 1.0f) {
+		this->is_chunk_passed_through = true;
+
+		return this->source->get_chunk(chunk, max_size);
+	}
+
+	AUDIO_CHUNK input_chunk;
+	uint32_t num_frames = std::min(max_size / this->format.block_align, this->buffer_frames);
+
+	// A fade out ends with a chunk, so no frame is consumed once the stage is held
+	if (this->is_fading_out_flag) {
+		num_frames = std::min(num_frames, this->num_ramp_frames);
+	}
+
+	bool is_eof = this->source->get_chunk(input_chunk, num_frames * this->format.block_align);
+
+	// A trailing partial frame (truncated file) is dropped
+	num_frames = input_chunk.size / this->format.block_align;
+
+	size_t num_samples = (size_t)num_frames * this->format.num_channels;
+	float *samples = this->format.is_float ? (float*)this->output_buffer : this->float_buffer;
+
+	this->to_float(input_chunk.data, samples, num_samples);
+	this->scale(samples, num_frames);
+
+	if (!this->format.is_float) {
+		this->from_float(samples, this->output_buffer, num_samples, this->is_dithered ? &this->dither_state : nullptr);
+	}
+
+	this->source->release_chunk(input_chunk);
+
+	chunk.data = this->output_buffer;
+	chunk.size = num_frames * this->format.block_align;
+	chunk.is_eof = is_eof;
+
+	return is_eof;
+}
+
+void GainStage::release_chunk(AUDIO_CHUNK &chunk) {
+	if (this->is_chunk_passed_through) {
+		this->source->release_chunk(chunk);
+
+		return;
+	}
+
+	chunk.data = nullptr;
+	chunk.size = 0;
+}
+
+void GainStage::wait_for_chunk(uint32_t timeout) {
+	this->source->wait_for_chunk(timeout);
+}
+
+bool GainStage::seek(uint64_t frame) {
+	return this->source->seek(frame);
+}
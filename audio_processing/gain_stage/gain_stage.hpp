@@ -0,0 +1,97 @@
+#ifndef WASABI_GAIN_STAGE_HPP
+#define WASABI_GAIN_STAGE_HPP
+
+#include <cstdint>
+#include "audio_source.hpp"
+#include "conversion_kernels.hpp"
+#include "format_converter.hpp"
+#include "gain_kernels.hpp"
+
+// Number of frames scaled per chunk by default
+#define GAIN_STAGE_BUFFER_FRAMES 4096
+
+// Level (in dB) at and below which the gain is silence
+#define GAIN_SILENCE_DB -60.0f
+
+// Processing stage scaling the samples of its source (in its own format) by a gain. Gain changes are ramped linearly
+// over the given number of frames, so they are sample accurate and free of zipper noise, and the stage can fade out to
+// silence and hold there (lending no more frames until it fades in again, so nothing is skipped while it's held).
+// Integer samples go through 32 bits floats (with optional dither when they are scaled), and while the gain is exactly 1
+// the chunks of the source are passed through untouched.
+class GainStage : public AudioSource {
+private:
+	AudioSource *source;
+	AUDIO_FORMAT format;
+	TO_FLOAT_KERNEL to_float{};
+	FROM_FLOAT_KERNEL from_float{};
+	GAIN_RAMP_KERNEL apply_gain_ramp{};
+	DITHER_STATE dither_state;
+	bool is_dithered{};
+	uint32_t buffer_frames{};
+	float *float_buffer{};
+	uint8_t *output_buffer{};
+	float *frame_offsets{};
+	size_t pattern_size{};
+	bool is_chunk_passed_through{};
+
+	// Gain the stage settles at, and the ramp in progress
+	float level{1.0f};
+	float gain{1.0f};
+	float target_gain{1.0f};
+	float gain_step{};
+	uint32_t num_ramp_frames{};
+	bool is_fading_out_flag{};
+
+	void ramp_to(float target_gain, uint32_t num_frames);
+
+	void scale(float *samples, uint32_t num_frames);
+
+public:
+	GainStage(AudioSource *source, DITHER_TYPE dither_type, uint32_t buffer_frames = GAIN_STAGE_BUFFER_FRAMES);
+
+	GainStage(GainStage const &gain_stage) = delete;
+
+	GainStage &operator=(GainStage const &gain_stage) = delete;
+
+	~GainStage() override;
+
+	bool is_supported();
+
+	// Converts a level in dB to a linear gain (GAIN_SILENCE_DB and below are silence)
+	static float db_to_gain(float db);
+
+	// Ramps to the given gain over the given number of frames (0 jumps to it). While faded out, the gain is only
+	// applied by the next fade in
+	void set_gain(float gain, uint32_t num_ramp_frames);
+
+	void set_gain_db(float db, uint32_t num_ramp_frames);
+
+	// Ramps to silence over the given number of frames and holds there
+	void fade_out(uint32_t num_frames);
+
+	// Releases the hold and ramps from the given gain (0 to start from silence) to the one set over the given number of
+	// frames
+	void fade_in(uint32_t num_frames, float start_gain);
+
+	// Returns whether a fade out is still being lent
+	bool is_fading_out();
+
+	// Returns whether the fade out has been completed (the stage lends no more frames)
+	bool is_held();
+
+	float get_gain();
+
+	AUDIO_FORMAT get_format() override;
+
+	// Returns an empty chunk at the end of the stream while held
+	bool get_chunk(AUDIO_CHUNK &chunk, uint32_t max_size) override;
+
+	void release_chunk(AUDIO_CHUNK &chunk) override;
+
+	void wait_for_chunk(uint32_t timeout) override;
+
+	// Keeps the gain and the ramp in progress
+	bool seek(uint64_t frame) override;
+};
+
+#endif //WASABI_GAIN_STAGE_HPP
@@ -0,0 +1,262 @@
+#include "meter.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Surround speakers of BS.1770 (their loudness is weighted by about +1.5 dB)
+#define CHANNELS_SURROUND (CHANNEL_BACK_LEFT | CHANNEL_BACK_RIGHT | CHANNEL_SIDE_LEFT | CHANNEL_SIDE_RIGHT)
+#define SURROUND_WEIGHT 1.41f
+
+static float amplitude_to_db(double amplitude) {
+	return amplitude > 0.0 ? (float)(20.0 * std::log10(amplitude)) : -INFINITY;
+}
+
+static float power_to_db(double power) {
+	return power > 0.0 ? (float)(10.0 * std::log10(power)) : -INFINITY;
+}
+
+// The loudness of a 0 dBFS sine at 1 kHz in one channel is -3.01 LUFS
+static float energy_to_loudness(double energy) {
+	return energy > 0.0 ? (float)(-0.691 + 10.0 * std::log10(energy)) : -INFINITY;
+}
+
+Meter::Meter(AudioSource *source, uint64_t start_position, uint32_t buffer_frames) {
+	this->source = source;
+	this->format = source->get_format();
+	this->position = start_position;
+
+	this->summary.num_channels = std::min<uint16_t>(this->format.num_channels, METER_MAX_CHANNELS);
+	this->summary.max_momentary_loudness = -INFINITY;
+	this->summary.max_short_term_loudness = -INFINITY;
+	this->summary.integrated_loudness = -INFINITY;
+
+	for (float &max_peak : this->summary.max_peaks) {
+		max_peak = -INFINITY;
+	}
+
+	if (this->format.num_channels == 0 || this->format.num_channels > CHANNEL_MIXER_MAX_CHANNELS) {
+		return;
+	}
+
+	// Picks the kernels for the best instruction set available
+	SIMD_LEVEL simd_level = get_simd_level();
+
+	this->to_float = get_to_float_kernel(this->format.bit_depth, this->format.is_float, simd_level);
+	this->measure_peak_rms = get_peak_rms_kernel(simd_level);
+	this->apply_k_weighting = get_k_weighting_kernel(simd_level);
+
+	initialize_k_weighting_filter(&this->k_weighting_filter, this->format.sample_rate);
+
+	this->block_frames = std::max<uint32_t>(this->format.sample_rate * METER_BLOCK_DURATION / 1000, 1);
+
+	// The channels of the mask are interleaved in increasing bit order, the LFE channel isn't part of the loudness
+	uint16_t channel = 0;
+
+	for (uint32_t speaker = 1; speaker != 0 && channel < this->format.num_channels; speaker <<= 1) {
+		if (this->format.channel_mask & speaker) {
+			this->channel_weights[channel++] = speaker == CHANNEL_LOW_FREQUENCY ? 0.0f :
+				speaker & CHANNELS_SURROUND ? SURROUND_WEIGHT : 1.0f;
+		}
+	}
+
+	for (; channel < this->format.num_channels; channel++) {
+		this->channel_weights[channel] = 1.0f;
+	}
+
+	// Every block in a bin of the histogram counts as if its loudness was the center of the bin
+	for (size_t bin = 0; bin < METER_HISTOGRAM_SIZE; bin++) {
+		double loudness = METER_HISTOGRAM_MIN_LOUDNESS + (bin + 0.5) * METER_HISTOGRAM_RESOLUTION;
+
+		this->histogram_energies[bin] = std::pow(10.0, (loudness + 0.691) / 10.0);
+	}
+
+	// The integer sample formats are converted by parts of the buffer (floats are measured in the chunks)
+	if (!this->format.is_float) {
+		this->buffer_frames = buffer_frames;
+		this->float_buffer = (float *)allocate_aligned((size_t)buffer_frames * this->format.num_channels * sizeof(float));
+	}
+}
+
+Meter::~Meter() {
+	free_aligned(this->float_buffer);
+}
+
+bool Meter::is_supported() {
+	return this->to_float != nullptr && this->measure_peak_rms != nullptr &&
+		(this->format.is_float ? this->format.bit_depth == 32 : this->float_buffer != nullptr);
+}
+
+void Meter::restart(uint64_t position) {
+	this->position = position;
+	this->num_block_frames = 0;
+
+	memset(this->block_peaks, 0, sizeof(this->block_peaks));
+	memset(this->block_sums_of_squares, 0, sizeof(this->block_sums_of_squares));
+	memset(this->block_energies, 0, sizeof(this->block_energies));
+}
+
+bool Meter::receive_reading(METER_READING &reading) {
+	return this->readings.pop(reading);
+}
+
+METER_SUMMARY Meter::get_summary() {
+	return this->summary;
+}
+
+double Meter::get_mean_energy(size_t num_blocks) {
+	double energy = 0.0;
+
+	for (size_t i = 1; i <= num_blocks; i++) {
+		energy += this->block_loudness_energies[(this->num_blocks - i) % METER_SHORT_TERM_BLOCKS];
+	}
+
+	return energy / num_blocks;
+}
+
+float Meter::get_integrated_loudness() {
+	double total_energy = 0.0;
+	uint64_t num_gated_blocks = 0;
+
+	// The histogram only holds the blocks above the absolute gate
+	for (size_t bin = 0; bin < METER_HISTOGRAM_SIZE; bin++) {
+		total_energy += this->histogram[bin] * this->histogram_energies[bin];
+		num_gated_blocks += this->histogram[bin];
+	}
+
+	if (num_gated_blocks == 0) {
+		return -INFINITY;
+	}
+
+	// Then keeps the blocks above the relative gate, 10 LU below the loudness of the blocks above the absolute gate
+	double relative_gate = energy_to_loudness(total_energy / num_gated_blocks) - 10.0;
+	size_t first_bin = relative_gate <= METER_HISTOGRAM_MIN_LOUDNESS ? 0 :
+		(size_t)((relative_gate - METER_HISTOGRAM_MIN_LOUDNESS) / METER_HISTOGRAM_RESOLUTION);
+
+	total_energy = 0.0;
+	num_gated_blocks = 0;
+
+	for (size_t bin = first_bin; bin < METER_HISTOGRAM_SIZE; bin++) {
+		total_energy += this->histogram[bin] * this->histogram_energies[bin];
+		num_gated_blocks += this->histogram[bin];
+	}
+
+	return num_gated_blocks > 0 ? energy_to_loudness(total_energy / num_gated_blocks) : -INFINITY;
+}
+
+void Meter::end_block() {
+	METER_READING reading;
+	double energy = 0.0;
+
+	for (uint16_t channel = 0; channel < this->format.num_channels; channel++) {
+		energy += this->channel_weights[channel] * this->block_energies[channel];
+	}
+
+	this->block_loudness_energies[this->num_blocks % METER_SHORT_TERM_BLOCKS] = energy / this->block_frames;
+	this->num_blocks += 1;
+
+	reading.position = this->position;
+	reading.num_channels = this->summary.num_channels;
+
+	for (uint16_t channel = 0; channel < reading.num_channels; channel++) {
+		reading.peaks[channel] = amplitude_to_db(this->block_peaks[channel]);
+		reading.rms_levels[channel] = power_to_db((double)this->block_sums_of_squares[channel] / this->block_frames);
+
+		this->summary.max_peaks[channel] = std::max(this->summary.max_peaks[channel], reading.peaks[channel]);
+	}
+
+	// A gating block of 400 ms ends with every block (they overlap by 75 %)
+	reading.momentary_loudness = -INFINITY;
+
+	if (this->num_blocks >= METER_MOMENTARY_BLOCKS) {
+		reading.momentary_loudness = energy_to_loudness(this->get_mean_energy(METER_MOMENTARY_BLOCKS));
+
+		if (reading.momentary_loudness >= METER_HISTOGRAM_MIN_LOUDNESS) {
+			size_t bin = (size_t)((reading.momentary_loudness - METER_HISTOGRAM_MIN_LOUDNESS) / METER_HISTOGRAM_RESOLUTION);
+
+			this->histogram[std::min<size_t>(bin, METER_HISTOGRAM_SIZE - 1)] += 1;
+		}
+	}
+
+	// Over the blocks measured so far during the first 3 seconds
+	reading.short_term_loudness = energy_to_loudness(this->get_mean_energy(
+		std::min<uint64_t>(this->num_blocks, METER_SHORT_TERM_BLOCKS)));
+	reading.integrated_loudness = this->get_integrated_loudness();
+
+	this->summary.max_momentary_loudness = std::max(this->summary.max_momentary_loudness, reading.momentary_loudness);
+	this->summary.max_short_term_loudness = std::max(this->summary.max_short_term_loudness,
+		reading.short_term_loudness);
+	this->summary.integrated_loudness = reading.integrated_loudness;
+	this->summary.num_blocks = this->num_blocks;
+
+	if (!this->readings.push(reading)) {
+		this->summary.num_dropped_readings += 1;
+	}
+
+	this->restart(this->position);
+}
+
+void Meter::measure(const float *samples, uint32_t num_frames) {
+	// Splits the samples at the end of the blocks
+	while (num_frames > 0) {
+		uint32_t num_measured_frames = std::min(num_frames, this->block_frames - this->num_block_frames);
+
+		this->measure_peak_rms(samples, num_measured_frames, this->format.num_channels, this->block_peaks,
+			this->block_sums_of_squares);
+		this->apply_k_weighting(samples, num_measured_frames, this->format.num_channels, &this->k_weighting_filter,
+			this->block_energies);
+
+		samples += (size_t)num_measured_frames * this->format.num_channels;
+		num_frames -= num_measured_frames;
+		this->num_block_frames += num_measured_frames;
+		this->position += num_measured_frames;
+
+		if (this->num_block_frames == this->block_frames) {
+			this->end_block();
+		}
+	}
+}
+
+AUDIO_FORMAT Meter::get_format() {
+	return this->format;
+}
+
+bool Meter::get_chunk(AUDIO_CHUNK &chunk, uint32_t max_size) {
+	bool is_eof = this->source->get_chunk(chunk, max_size);
+	uint32_t num_frames = chunk.size / this->format.block_align;
+
+	if (this->format.is_float) {
+		this->measure((const float *)chunk.data, num_frames);
+
+		return is_eof;
+	}
+
+	for (uint32_t frame = 0; frame < num_frames;) {
+		uint32_t num_converted_frames = std::min(num_frames - frame, this->buffer_frames);
+
+		this->to_float(chunk.data + (size_t)frame * this->format.block_align, this->float_buffer,
+			(size_t)num_converted_frames * this->format.num_channels);
+		this->measure(this->float_buffer, num_converted_frames);
+
+		frame += num_converted_frames;
+	}
+
+	return is_eof;
+}
+
+void Meter::release_chunk(AUDIO_CHUNK &chunk) {
+	this->source->release_chunk(chunk);
+}
+
+void Meter::wait_for_chunk(uint32_t timeout) {
+	this->source->wait_for_chunk(timeout);
+}
+
+bool Meter::seek(uint64_t frame) {
+	if (!this->source->seek(frame)) {
+		return false;
+	}
+
+	this->restart(frame);
+
+	return true;
+}
@@ -0,0 +1,128 @@
+#ifndef WASABI_METER_HPP
+#define WASABI_METER_HPP
+
+#include <cstdint>
+#include "audio_source.hpp"
+#include "command_queue.hpp"
+#include "conversion_kernels.hpp"
+#include "meter_kernels.hpp"
+
+// Number of frames converted to floats per chunk by default (for the integer sample formats)
+#define METER_BUFFER_FRAMES 4096
+
+// Duration (in milliseconds) of the blocks the signal is measured over, a reading is published for each of them (the
+// momentary loudness is measured over 4 blocks and the short-term loudness over 30, as BS.1770 and EBU R 128 define)
+#define METER_BLOCK_DURATION 100
+#define METER_MOMENTARY_BLOCKS 4
+#define METER_SHORT_TERM_BLOCKS 30
+
+// Number of channels whose peak and RMS levels are published (every channel is part of the loudness)
+#define METER_MAX_CHANNELS 8
+
+// Maximum number of readings waiting for the UI (a fast sink may produce many of them between two updates)
+#define METER_READING_QUEUE_SIZE 256
+
+// Range (in LUFS) and resolution (in LU) of the histogram of the loudness of the gating blocks, which the integrated
+// loudness is computed from in constant memory (the lower bound is the absolute gate of BS.1770)
+#define METER_HISTOGRAM_MIN_LOUDNESS -70.0
+#define METER_HISTOGRAM_MAX_LOUDNESS 10.0
+#define METER_HISTOGRAM_RESOLUTION 0.1
+#define METER_HISTOGRAM_SIZE 800
+
+// Levels measured over a block, in dBFS and LUFS (-infinity for silence)
+typedef struct METER_READING {
+	uint64_t position{}; // Frame following the block, counted from the start of the stream
+	uint16_t num_channels{}; // Number of channels with levels (at most METER_MAX_CHANNELS)
+	float peaks[METER_MAX_CHANNELS]{}; // Sample peak of each channel over the block
+	float rms_levels[METER_MAX_CHANNELS]{}; // RMS level of each channel over the block
+	float momentary_loudness{}; // Over the last 400 ms
+	float short_term_loudness{}; // Over the last 3 seconds
+	float integrated_loudness{}; // Gated, over everything measured so far
+} METER_READING;
+
+// Levels measured over the whole stream
+typedef struct METER_SUMMARY {
+	uint16_t num_channels{};
+	float max_peaks[METER_MAX_CHANNELS]{}; // In dBFS
+	float max_momentary_loudness{}; // In LUFS
+	float max_short_term_loudness{};
+	float integrated_loudness{};
+	uint64_t num_blocks{};
+	uint64_t num_dropped_readings{}; // Readings published while the queue was full
+} METER_SUMMARY;
+
+// Processing stage measuring the signal flowing through it: the sample peak and RMS level of each channel and the
+// momentary, short-term and integrated loudness (ITU-R BS.1770, K-weighted and gated). The chunks of the source are lent
+// untouched, and measuring them only runs vectorised kernels and publishes a reading per block through a lock-free
+// queue, so it can sit right before the sink. Everything is allocated when the meter is created.
+class Meter : public AudioSource {
+private:
+	AudioSource *source;
+	AUDIO_FORMAT format;
+	TO_FLOAT_KERNEL to_float{};
+	PEAK_RMS_KERNEL measure_peak_rms{};
+	K_WEIGHTING_KERNEL apply_k_weighting{};
+	K_WEIGHTING_FILTER k_weighting_filter;
+	uint32_t buffer_frames{};
+	float *float_buffer{};
+
+	// Block being measured
+	uint32_t block_frames{};
+	uint32_t num_block_frames{};
+	uint64_t position{};
+	float channel_weights[CHANNEL_MIXER_MAX_CHANNELS]{};
+	float block_peaks[CHANNEL_MIXER_MAX_CHANNELS]{};
+	float block_sums_of_squares[CHANNEL_MIXER_MAX_CHANNELS]{};
+	float block_energies[CHANNEL_MIXER_MAX_CHANNELS]{};
+
+	// Loudness history
+	double block_loudness_energies[METER_SHORT_TERM_BLOCKS]{};
+	uint64_t num_blocks{};
+	uint64_t histogram[METER_HISTOGRAM_SIZE]{};
+	double histogram_energies[METER_HISTOGRAM_SIZE]{};
+	METER_SUMMARY summary;
+
+	CommandQueue<METER_READING, METER_READING_QUEUE_SIZE> readings;
+
+	void measure(const float *samples, uint32_t num_frames);
+
+	void end_block();
+
+	double get_mean_energy(size_t num_blocks);
+
+	float get_integrated_loudness();
+
+public:
+	// Counts the frames from the given position of the stream
+	Meter(AudioSource *source, uint64_t start_position = 0, uint32_t buffer_frames = METER_BUFFER_FRAMES);
+
+	Meter(Meter const &meter) = delete;
+
+	Meter &operator=(Meter const &meter) = delete;
+
+	~Meter() override;
+
+	bool is_supported();
+
+	// Drops the block being measured and counts the frames from the given position (once the stream has been moved
+	// without going through the meter), the loudness measured so far is kept
+	void restart(uint64_t position);
+
+	// Gets the next reading, returns false if there is none
+	bool receive_reading(METER_READING &reading);
+
+	// Gets the levels measured over the whole stream (only meaningful once the stream is no longer being pulled)
+	METER_SUMMARY get_summary();
+
+	AUDIO_FORMAT get_format() override;
+
+	bool get_chunk(AUDIO_CHUNK &chunk, uint32_t max_size) override;
+
+	void release_chunk(AUDIO_CHUNK &chunk) override;
+
+	void wait_for_chunk(uint32_t timeout) override;
+
+	bool seek(uint64_t frame) override;
+};
+
+#endif //WASABI_METER_HPP
@@ -0,0 +1,311 @@
+#include "meter_kernels.hpp"
+#include <algorithm>
+#include <cmath>
+
+#define PI 3.14159265358979323846
+
+// Number of frames of the patterns the vectorised peak and RMS kernels accumulate over
+#define PEAK_RMS_PATTERN_FRAMES 8
+
+static void measure_peak_rms(const float *samples, size_t num_frames, uint16_t num_channels, float *peaks,
+	float *sums_of_squares) {
+	for (size_t frame = 0; frame < num_frames; frame++) {
+		for (uint16_t channel = 0; channel < num_channels; channel++) {
+			float sample = samples[frame * num_channels + channel];
+
+			peaks[channel] = std::max(peaks[channel], std::fabs(sample));
+			sums_of_squares[channel] += sample * sample;
+		}
+	}
+}
+
+// Adds the samples that don't fill a whole pattern to the pattern, then folds it into the channels
+static inline void fold_peak_rms_pattern(const float *samples, size_t num_samples, uint16_t num_channels,
+	float *pattern_peaks, float *pattern_sums, float *peaks, float *sums_of_squares) {
+	size_t pattern_size = (size_t)num_channels * PEAK_RMS_PATTERN_FRAMES;
+
+	for (size_t i = 0; i < num_samples; i++) {
+		pattern_peaks[i] = std::max(pattern_peaks[i], std::fabs(samples[i]));
+		pattern_sums[i] += samples[i] * samples[i];
+	}
+
+	for (size_t i = 0; i < pattern_size; i++) {
+		peaks[i % num_channels] = std::max(peaks[i % num_channels], pattern_peaks[i]);
+		sums_of_squares[i % num_channels] += pattern_sums[i];
+	}
+}
+
+// Filters are stopped from decaying into denormals (which are very slow to compute) after silence
+static inline float flush_state(float state) {
+	return std::fabs(state) < 1e-15f ? 0.0f : state;
+}
+
+static void flush_k_weighting_states(K_WEIGHTING_FILTER *filter, uint16_t num_channels) {
+	for (uint16_t channel = 0; channel < num_channels; channel++) {
+		for (int i = 0; i < 2; i++) {
+			filter->shelf_states[i][channel] = flush_state(filter->shelf_states[i][channel]);
+			filter->high_pass_states[i][channel] = flush_state(filter->high_pass_states[i][channel]);
+		}
+	}
+}
+
+static void apply_k_weighting(const float *samples, size_t num_frames, uint16_t num_channels,
+	K_WEIGHTING_FILTER *filter, float *energies) {
+	const float *shelf = filter->shelf_coefficients;
+	const float *high_pass = filter->high_pass_coefficients;
+
+	for (uint16_t channel = 0; channel < num_channels; channel++) {
+		float shelf_state_1 = filter->shelf_states[0][channel];
+		float shelf_state_2 = filter->shelf_states[1][channel];
+		float high_pass_state_1 = filter->high_pass_states[0][channel];
+		float high_pass_state_2 = filter->high_pass_states[1][channel];
+		float energy = 0.0f;
+
+		for (size_t frame = 0; frame < num_frames; frame++) {
+			float sample = samples[frame * num_channels + channel];
+			float shelved = shelf[0] * sample + shelf_state_1;
+
+			shelf_state_1 = shelf[1] * sample - shelf[3] * shelved + shelf_state_2;
+			shelf_state_2 = shelf[2] * sample - shelf[4] * shelved;
+
+			float filtered = high_pass[0] * shelved + high_pass_state_1;
+
+			high_pass_state_1 = high_pass[1] * shelved - high_pass[3] * filtered + high_pass_state_2;
+			high_pass_state_2 = high_pass[2] * shelved - high_pass[4] * filtered;
+
+			energy += filtered * filtered;
+		}
+
+		filter->shelf_states[0][channel] = shelf_state_1;
+		filter->shelf_states[1][channel] = shelf_state_2;
+		filter->high_pass_states[0][channel] = high_pass_state_1;
+		filter->high_pass_states[1][channel] = high_pass_state_2;
+		energies[channel] += energy;
+	}
+
+	flush_k_weighting_states(filter, num_channels);
+}
+
+void initialize_k_weighting_filter(K_WEIGHTING_FILTER *filter, uint32_t sample_rate) {
+	*filter = K_WEIGHTING_FILTER();
+
+	// Analog prototypes of BS.1770 matched to any sample rate with the bilinear transform (the coefficients given for
+	// 48 kHz by the recommendation are found back)
+	double k = std::tan(PI * 1681.974450955533 / sample_rate);
+	double q = 0.7071752369554196;
+	double high_gain = std::pow(10.0, 3.999843853973347 / 20.0);
+	double band_gain = std::pow(high_gain, 0.4996667741545416);
+	double a0 = 1.0 + k / q + k * k;
+
+	filter->shelf_coefficients[0] = (float)((high_gain + band_gain * k / q + k * k) / a0);
+	filter->shelf_coefficients[1] = (float)(2.0 * (k * k - high_gain) / a0);
+	filter->shelf_coefficients[2] = (float)((high_gain - band_gain * k / q + k * k) / a0);
+	filter->shelf_coefficients[3] = (float)(2.0 * (k * k - 1.0) / a0);
+	filter->shelf_coefficients[4] = (float)((1.0 - k / q + k * k) / a0);
+
+	k = std::tan(PI * 38.13547087602444 / sample_rate);
+	q = 0.5003270373238773;
+	a0 = 1.0 + k / q + k * k;
+
+	filter->high_pass_coefficients[0] = 1.0f;
+	filter->high_pass_coefficients[1] = -2.0f;
+	filter->high_pass_coefficients[2] = 1.0f;
+	filter->high_pass_coefficients[3] = (float)(2.0 * (k * k - 1.0) / a0);
+	filter->high_pass_coefficients[4] = (float)((1.0 - k / q + k * k) / a0);
+}
+
+#ifdef WASABI_SIMD_X86
+
+static void measure_peak_rms_sse2(const float *samples, size_t num_frames, uint16_t num_channels, float *peaks,
+	float *sums_of_squares) {
+	alignas(32) float pattern_peaks[CHANNEL_MIXER_MAX_CHANNELS * PEAK_RMS_PATTERN_FRAMES] = {};
+	alignas(32) float pattern_sums[CHANNEL_MIXER_MAX_CHANNELS * PEAK_RMS_PATTERN_FRAMES] = {};
+	const __m128 sign_mask = _mm_set1_ps(-0.0f);
+	size_t pattern_size = (size_t)num_channels * PEAK_RMS_PATTERN_FRAMES;
+	size_t num_samples = num_frames * num_channels;
+	size_t i = 0;
+
+	for (; i + pattern_size <= num_samples; i += pattern_size) {
+		for (size_t j = 0; j < pattern_size; j += 4) {
+			__m128 sample = _mm_loadu_ps(samples + i + j);
+
+			_mm_store_ps(pattern_peaks + j, _mm_max_ps(_mm_load_ps(pattern_peaks + j), _mm_andnot_ps(sign_mask, sample)));
+			_mm_store_ps(pattern_sums + j, _mm_add_ps(_mm_load_ps(pattern_sums + j), _mm_mul_ps(sample, sample)));
+		}
+	}
+
+	fold_peak_rms_pattern(samples + i, num_samples - i, num_channels, pattern_peaks, pattern_sums, peaks,
+		sums_of_squares);
+}
+
+// Loads the channels of a group (up to 4) without reading past the frame
+static inline __m128 load_channels_sse2(const float *samples, size_t num_group_channels) {
+	switch (num_group_channels) {
+	case 1:
+		return _mm_load_ss(samples);
+	case 2:
+		return _mm_castpd_ps(_mm_load_sd((const double *)samples));
+	case 3:
+		return _mm_movelh_ps(_mm_castpd_ps(_mm_load_sd((const double *)samples)), _mm_load_ss(samples + 2));
+	default:
+		return _mm_loadu_ps(samples);
+	}
+}
+
+static void apply_k_weighting_sse2(const float *samples, size_t num_frames, uint16_t num_channels,
+	K_WEIGHTING_FILTER *filter, float *energies) {
+	const float *shelf = filter->shelf_coefficients;
+	const float *high_pass = filter->high_pass_coefficients;
+	const __m128 shelf_b0 = _mm_set1_ps(shelf[0]), shelf_b1 = _mm_set1_ps(shelf[1]), shelf_b2 = _mm_set1_ps(shelf[2]);
+	const __m128 shelf_a1 = _mm_set1_ps(shelf[3]), shelf_a2 = _mm_set1_ps(shelf[4]);
+	const __m128 high_pass_b0 = _mm_set1_ps(high_pass[0]), high_pass_b1 = _mm_set1_ps(high_pass[1]);
+	const __m128 high_pass_b2 = _mm_set1_ps(high_pass[2]), high_pass_a1 = _mm_set1_ps(high_pass[3]);
+	const __m128 high_pass_a2 = _mm_set1_ps(high_pass[4]);
+
+	for (uint16_t channel = 0; channel < num_channels; channel += 4) {
+		size_t num_group_channels = std::min(num_channels - channel, 4);
+		__m128 shelf_state_1 = _mm_loadu_ps(&filter->shelf_states[0][channel]);
+		__m128 shelf_state_2 = _mm_loadu_ps(&filter->shelf_states[1][channel]);
+		__m128 high_pass_state_1 = _mm_loadu_ps(&filter->high_pass_states[0][channel]);
+		__m128 high_pass_state_2 = _mm_loadu_ps(&filter->high_pass_states[1][channel]);
+		__m128 energy = _mm_setzero_ps();
+		alignas(16) float group_energies[4];
+
+		for (size_t frame = 0; frame < num_frames; frame++) {
+			__m128 sample = load_channels_sse2(samples + frame * num_channels + channel, num_group_channels);
+			__m128 shelved = _mm_add_ps(_mm_mul_ps(shelf_b0, sample), shelf_state_1);
+
+			shelf_state_1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(shelf_b1, sample), _mm_mul_ps(shelf_a1, shelved)),
+				shelf_state_2);
+			shelf_state_2 = _mm_sub_ps(_mm_mul_ps(shelf_b2, sample), _mm_mul_ps(shelf_a2, shelved));
+
+			__m128 filtered = _mm_add_ps(_mm_mul_ps(high_pass_b0, shelved), high_pass_state_1);
+
+			high_pass_state_1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(high_pass_b1, shelved),
+				_mm_mul_ps(high_pass_a1, filtered)), high_pass_state_2);
+			high_pass_state_2 = _mm_sub_ps(_mm_mul_ps(high_pass_b2, shelved), _mm_mul_ps(high_pass_a2, filtered));
+
+			energy = _mm_add_ps(energy, _mm_mul_ps(filtered, filtered));
+		}
+
+		_mm_storeu_ps(&filter->shelf_states[0][channel], shelf_state_1);
+		_mm_storeu_ps(&filter->shelf_states[1][channel], shelf_state_2);
+		_mm_storeu_ps(&filter->high_pass_states[0][channel], high_pass_state_1);
+		_mm_storeu_ps(&filter->high_pass_states[1][channel], high_pass_state_2);
+		_mm_store_ps(group_energies, energy);
+
+		for (size_t lane = 0; lane < num_group_channels; lane++) {
+			energies[channel + lane] += group_energies[lane];
+		}
+	}
+
+	flush_k_weighting_states(filter, num_channels);
+}
+
+WASABI_TARGET_AVX2
+static void measure_peak_rms_avx2(const float *samples, size_t num_frames, uint16_t num_channels, float *peaks,
+	float *sums_of_squares) {
+	alignas(32) float pattern_peaks[CHANNEL_MIXER_MAX_CHANNELS * PEAK_RMS_PATTERN_FRAMES] = {};
+	alignas(32) float pattern_sums[CHANNEL_MIXER_MAX_CHANNELS * PEAK_RMS_PATTERN_FRAMES] = {};
+	const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+	size_t pattern_size = (size_t)num_channels * PEAK_RMS_PATTERN_FRAMES;
+	size_t num_samples = num_frames * num_channels;
+	size_t i = 0;
+
+	for (; i + pattern_size <= num_samples; i += pattern_size) {
+		for (size_t j = 0; j < pattern_size; j += 8) {
+			__m256 sample = _mm256_loadu_ps(samples + i + j);
+
+			_mm256_store_ps(pattern_peaks + j, _mm256_max_ps(_mm256_load_ps(pattern_peaks + j),
+				_mm256_andnot_ps(sign_mask, sample)));
+			_mm256_store_ps(pattern_sums + j, _mm256_fmadd_ps(sample, sample, _mm256_load_ps(pattern_sums + j)));
+		}
+	}
+
+	fold_peak_rms_pattern(samples + i, num_samples - i, num_channels, pattern_peaks, pattern_sums, peaks,
+		sums_of_squares);
+}
+
+WASABI_TARGET_AVX2
+static void apply_k_weighting_avx2(const float *samples, size_t num_frames, uint16_t num_channels,
+	K_WEIGHTING_FILTER *filter, float *energies) {
+	const float *shelf = filter->shelf_coefficients;
+	const float *high_pass = filter->high_pass_coefficients;
+	const __m256 shelf_b0 = _mm256_set1_ps(shelf[0]), shelf_b1 = _mm256_set1_ps(shelf[1]);
+	const __m256 shelf_b2 = _mm256_set1_ps(shelf[2]), shelf_a1 = _mm256_set1_ps(shelf[3]);
+	const __m256 shelf_a2 = _mm256_set1_ps(shelf[4]);
+	const __m256 high_pass_b0 = _mm256_set1_ps(high_pass[0]), high_pass_b1 = _mm256_set1_ps(high_pass[1]);
+	const __m256 high_pass_b2 = _mm256_set1_ps(high_pass[2]), high_pass_a1 = _mm256_set1_ps(high_pass[3]);
+	const __m256 high_pass_a2 = _mm256_set1_ps(high_pass[4]);
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+	for (uint16_t channel = 0; channel < num_channels; channel += 8) {
+		size_t num_group_channels = std::min(num_channels - channel, 8);
+		// Masked loads never read the lanes past the frame
+		__m256i lane_mask = _mm256_cmpgt_epi32(_mm256_set1_epi32((int)num_group_channels), lanes);
+		__m256 shelf_state_1 = _mm256_loadu_ps(&filter->shelf_states[0][channel]);
+		__m256 shelf_state_2 = _mm256_loadu_ps(&filter->shelf_states[1][channel]);
+		__m256 high_pass_state_1 = _mm256_loadu_ps(&filter->high_pass_states[0][channel]);
+		__m256 high_pass_state_2 = _mm256_loadu_ps(&filter->high_pass_states[1][channel]);
+		__m256 energy = _mm256_setzero_ps();
+		alignas(32) float group_energies[8];
+
+		for (size_t frame = 0; frame < num_frames; frame++) {
+			const float *frame_samples = samples + frame * num_channels + channel;
+			__m256 sample = num_group_channels == 8 ? _mm256_loadu_ps(frame_samples) :
+				_mm256_maskload_ps(frame_samples, lane_mask);
+			__m256 shelved = _mm256_fmadd_ps(shelf_b0, sample, shelf_state_1);
+
+			shelf_state_1 = _mm256_fmadd_ps(shelf_b1, sample, _mm256_fnmadd_ps(shelf_a1, shelved, shelf_state_2));
+			shelf_state_2 = _mm256_fnmadd_ps(shelf_a2, shelved, _mm256_mul_ps(shelf_b2, sample));
+
+			__m256 filtered = _mm256_fmadd_ps(high_pass_b0, shelved, high_pass_state_1);
+
+			high_pass_state_1 = _mm256_fmadd_ps(high_pass_b1, shelved,
+				_mm256_fnmadd_ps(high_pass_a1, filtered, high_pass_state_2));
+			high_pass_state_2 = _mm256_fnmadd_ps(high_pass_a2, filtered, _mm256_mul_ps(high_pass_b2, shelved));
+
+			energy = _mm256_fmadd_ps(filtered, filtered, energy);
+		}
+
+		_mm256_storeu_ps(&filter->shelf_states[0][channel], shelf_state_1);
+		_mm256_storeu_ps(&filter->shelf_states[1][channel], shelf_state_2);
+		_mm256_storeu_ps(&filter->high_pass_states[0][channel], high_pass_state_1);
+		_mm256_storeu_ps(&filter->high_pass_states[1][channel], high_pass_state_2);
+		_mm256_store_ps(group_energies, energy);
+
+		for (size_t lane = 0; lane < num_group_channels; lane++) {
+			energies[channel + lane] += group_energies[lane];
+		}
+	}
+
+	flush_k_weighting_states(filter, num_channels);
+}
+
+#endif
+
+PEAK_RMS_KERNEL get_peak_rms_kernel(SIMD_LEVEL level) {
+#ifdef WASABI_SIMD_X86
+	if (level >= SIMD_LEVEL_AVX2) {
+		return measure_peak_rms_avx2;
+	}
+
+	if (level >= SIMD_LEVEL_SSE2) {
+		return measure_peak_rms_sse2;
+	}
+#endif
+	return measure_peak_rms;
+}
+
+K_WEIGHTING_KERNEL get_k_weighting_kernel(SIMD_LEVEL level) {
+#ifdef WASABI_SIMD_X86
+	if (level >= SIMD_LEVEL_AVX2) {
+		return apply_k_weighting_avx2;
+	}
+
+	if (level >= SIMD_LEVEL_SSE2) {
+		return apply_k_weighting_sse2;
+	}
+#endif
+	return apply_k_weighting;
+}
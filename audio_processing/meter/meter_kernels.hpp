@@ -0,0 +1,38 @@
+#ifndef WASABI_METER_KERNELS_HPP
+#define WASABI_METER_KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "channel_mixer_kernels.hpp"
+#include "simd.hpp"
+
+// Adds the interleaved 32 bits float samples of each channel to its sample peak (the largest magnitude) and to its sum
+// of squares. The vectorised kernels accumulate over a pattern of 8 frames, so any number of channels maps to whole
+// vectors, and fold the pattern into the channels once done.
+typedef void (*PEAK_RMS_KERNEL)(const float *samples, size_t num_frames, uint16_t num_channels, float *peaks,
+	float *sums_of_squares);
+
+// K-weighting filter of ITU-R BS.1770: a high shelf (the acoustic effect of the head) followed by a high-pass (the RLB
+// curve), both biquads in transposed direct form II, with a state for each channel
+typedef struct K_WEIGHTING_FILTER {
+	float shelf_coefficients[5]{}; // b0, b1, b2, a1, a2
+	float high_pass_coefficients[5]{};
+	float shelf_states[2][CHANNEL_MIXER_MAX_CHANNELS]{};
+	float high_pass_states[2][CHANNEL_MIXER_MAX_CHANNELS]{};
+} K_WEIGHTING_FILTER;
+
+// Filters the interleaved 32 bits float samples and adds the square of each filtered sample to the energy of its
+// channel. Filters are recursive, so the vectorised kernels run the channels of a frame in parallel (with the states
+// kept in registers across the frames) rather than consecutive frames.
+typedef void (*K_WEIGHTING_KERNEL)(const float *samples, size_t num_frames, uint16_t num_channels,
+	K_WEIGHTING_FILTER *filter, float *energies);
+
+// Computes the coefficients of the filter for the given sample rate and clears its states
+void initialize_k_weighting_filter(K_WEIGHTING_FILTER *filter, uint32_t sample_rate);
+
+// Return the kernels for the given instruction set
+PEAK_RMS_KERNEL get_peak_rms_kernel(SIMD_LEVEL level);
+
+K_WEIGHTING_KERNEL get_k_weighting_kernel(SIMD_LEVEL level);
+
+#endif //WASABI_METER_KERNELS_HPP
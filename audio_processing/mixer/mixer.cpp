@@ -0,0 +1,233 @@
+#include "mixer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#define PI 3.14159265358979323846
+#define SQRT_2 1.41421356237309504880
+
+// Speakers on each side of the listener
+#define CHANNELS_LEFT (CHANNEL_FRONT_LEFT | CHANNEL_BACK_LEFT | CHANNEL_FRONT_LEFT_OF_CENTER | CHANNEL_SIDE_LEFT | \
+	CHANNEL_TOP_FRONT_LEFT | CHANNEL_TOP_BACK_LEFT)
+#define CHANNELS_RIGHT (CHANNEL_FRONT_RIGHT | CHANNEL_BACK_RIGHT | CHANNEL_FRONT_RIGHT_OF_CENTER | CHANNEL_SIDE_RIGHT | \
+	CHANNEL_TOP_FRONT_RIGHT | CHANNEL_TOP_BACK_RIGHT)
+
+Mixer::Mixer(const AUDIO_FORMAT &format, DITHER_TYPE dither_type, RESAMPLER_QUALITY resampler_quality,
+	uint32_t block_frames) {
+	this->format = make_audio_format(format.sample_rate, format.num_channels, 32, true, format.channel_mask);
+	this->dither_type = dither_type;
+	this->resampler_quality = resampler_quality;
+	this->block_frames = block_frames;
+
+	if (this->format.num_channels == 0 || this->format.num_channels > CHANNEL_MIXER_MAX_CHANNELS) {
+		return;
+	}
+
+	SIMD_LEVEL level = get_simd_level();
+
+	this->mix = get_mix_kernel(level);
+	this->soft_clip = get_soft_clip_kernel(level);
+	this->mix_buffer = (float *)allocate_aligned((size_t)this->block_frames * this->format.block_align);
+
+	if (this->mix_buffer != nullptr) {
+		memset(this->mix_buffer, 0, (size_t)this->block_frames * this->format.block_align);
+	}
+}
+
+Mixer::~Mixer() {
+	free_aligned(this->mix_buffer);
+}
+
+void Mixer::compute_gain_pattern(MIXER_VOICE &voice) {
+	// Constant power (sine) pan law, scaled by sqrt(2) on the side the voice is panned away from, while
+	// the side it's panned to keeps its level (so a centered voice is left untouched)
+	float pan = std::min(std::max(voice.pan, -1.0f), 1.0f);
+	float angle = (pan + 1.0f) * (float)PI / 4.0f;
+	float left_gain = pan > 0.0f ? std::cos(angle) * (float)SQRT_2 * voice.gain : voice.gain;
+	float right_gain = pan < 0.0f ? std::sin(angle) * (float)SQRT_2 * voice.gain : voice.gain;
+	float channel_gains[CHANNEL_MIXER_MAX_CHANNELS];
+	uint32_t channel_mask = this->format.channel_mask;
+	uint16_t channel = 0;
+
+	// The channels of the mask are interleaved in increasing bit order
+	for (uint32_t speaker = 1; speaker != 0 && channel < this->format.num_channels; speaker <<= 1) {
+		if (channel_mask & speaker) {
+			channel_gains[channel++] = speaker & CHANNELS_LEFT ? left_gain :
+				speaker & CHANNELS_RIGHT ? right_gain : voice.gain;
+		}
+	}
+
+	// Channels without a position aren't panned
+	for (; channel < this->format.num_channels; channel++) {
+		channel_gains[channel] = voice.gain;
+	}
+
+	for (size_t i = 0; i < (size_t)this->format.num_channels * MIX_GAIN_PATTERN_FRAMES; i++) {
+		voice.gain_pattern[i] = channel_gains[i % this->format.num_channels];
+	}
+}
+
+bool Mixer::add_voice(AudioSource *source, float gain, float pan) {
+	if (this->mix_buffer == nullptr) {
+		return false;
+	}
+
+	std::unique_ptr<MIXER_VOICE> voice(new MIXER_VOICE());
+
+	// Resampling works on floats, so the channels are remixed on the side with the fewest of them, so fewer channels are
+	// resampled (as the playlist tracks are)
+	AUDIO_FORMAT source_format = source->get_format();
+	AUDIO_FORMAT decoded_format = this->format.num_channels < source_format.num_channels ?
+		make_audio_format(source_format.sample_rate, this->format.num_channels, 32, true, this->format.channel_mask) :
+		make_audio_format(source_format.sample_rate, source_format.num_channels, 32, true, source_format.channel_mask);
+
+	voice->source = source;
+	voice->decoder.reset(new FormatConverter(source, decoded_format, this->dither_type));
+	voice->resampler.reset(new Resampler(voice->decoder.get(), this->format.sample_rate, this->resampler_quality));
+	voice->encoder.reset(new FormatConverter(voice->resampler.get(), this->format, this->dither_type));
+
+	if (!voice->decoder->is_supported() || !voice->resampler->is_supported() || !voice->encoder->is_supported()) {
+		return false;
+	}
+
+	voice->gain = gain;
+	voice->pan = pan;
+
+	this->compute_gain_pattern(*voice);
+	this->voices.push_back(std::move(voice));
+
+	return true;
+}
+
+size_t Mixer::get_num_voices() {
+	return this->voices.size();
+}
+
+void Mixer::set_voice_gain(size_t voice, float gain) {
+	this->voices[voice]->gain = gain;
+
+	this->compute_gain_pattern(*this->voices[voice]);
+}
+
+void Mixer::set_voice_pan(size_t voice, float pan) {
+	this->voices[voice]->pan = pan;
+
+	this->compute_gain_pattern(*this->voices[voice]);
+}
+
+void Mixer::set_soft_clip_threshold(float threshold) {
+	this->soft_clip_threshold = std::min(std::max(threshold, 0.01f), 0.99f);
+}
+
+uint64_t Mixer::get_num_clipped_samples() {
+	return this->num_clipped_samples;
+}
+
+AUDIO_FORMAT Mixer::get_format() {
+	return this->format;
+}
+
+void Mixer::drop_lent_frames() {
+	uint32_t num_buffered_frames = 0;
+
+	for (std::unique_ptr<MIXER_VOICE> &voice : this->voices) {
+		voice->num_mixed_frames -= std::min(voice->num_mixed_frames, this->num_lent_frames);
+		num_buffered_frames = std::max(num_buffered_frames, voice->num_mixed_frames);
+	}
+
+	// Moves the frames waiting for the voices that are behind to the start of the buffer, and clears the rest of it
+	memmove(this->mix_buffer, this->mix_buffer + (size_t)this->num_lent_frames * this->format.num_channels,
+		(size_t)num_buffered_frames * this->format.block_align);
+	memset(this->mix_buffer + (size_t)num_buffered_frames * this->format.num_channels, 0,
+		(size_t)this->num_lent_frames * this->format.block_align);
+
+	this->num_lent_frames = 0;
+}
+
+bool Mixer::get_chunk(AUDIO_CHUNK &chunk, uint32_t max_size) {
+	uint32_t num_frames = std::min(this->block_frames, max_size / this->format.block_align);
+	uint32_t num_ready_frames = num_frames;
+	uint32_t num_buffered_frames = 0;
+	bool is_finished = true;
+
+	if (this->num_lent_frames > 0) {
+		this->drop_lent_frames();
+	}
+
+	for (std::unique_ptr<MIXER_VOICE> &voice : this->voices) {
+		// Pulls the voice until the block is full, it may lend it in several chunks or run out of ready data
+		while (!voice->is_finished && voice->num_mixed_frames < num_frames) {
+			AUDIO_CHUNK voice_chunk;
+
+			voice->is_finished = voice->encoder->get_chunk(voice_chunk,
+				(num_frames - voice->num_mixed_frames) * this->format.block_align);
+
+			uint32_t num_chunk_frames = voice_chunk.size / this->format.block_align;
+
+			this->mix(this->mix_buffer + (size_t)voice->num_mixed_frames * this->format.num_channels,
+				(const float *)voice_chunk.data, (size_t)num_chunk_frames * this->format.num_channels, voice->gain_pattern,
+				(size_t)this->format.num_channels * MIX_GAIN_PATTERN_FRAMES);
+
+			voice->encoder->release_chunk(voice_chunk);
+
+			voice->num_mixed_frames += num_chunk_frames;
+
+			if (num_chunk_frames == 0 && !voice->is_finished) {
+				break;
+			}
+		}
+
+		// The finished voices are silent past their end
+		if (!voice->is_finished) {
+			num_ready_frames = std::min(num_ready_frames, voice->num_mixed_frames);
+		}
+
+		num_buffered_frames = std::max(num_buffered_frames, voice->num_mixed_frames);
+		is_finished = is_finished && voice->is_finished;
+	}
+
+	num_ready_frames = std::min(num_ready_frames, num_buffered_frames);
+
+	this->num_clipped_samples += this->soft_clip(this->mix_buffer, (size_t)num_ready_frames * this->format.num_channels,
+		this->soft_clip_threshold);
+	this->num_lent_frames = num_ready_frames;
+
+	chunk.data = (const uint8_t *)this->mix_buffer;
+	chunk.size = num_ready_frames * this->format.block_align;
+	chunk.is_eof = is_finished && num_ready_frames == num_buffered_frames;
+
+	return chunk.is_eof;
+}
+
+void Mixer::release_chunk(AUDIO_CHUNK &chunk) {
+	chunk.data = nullptr;
+	chunk.size = 0;
+}
+
+void Mixer::wait_for_chunk(uint32_t timeout) {
+	// Waits for the voices that are behind the others
+	for (std::unique_ptr<MIXER_VOICE> &voice : this->voices) {
+		if (!voice->is_finished && voice->num_mixed_frames <= this->num_lent_frames) {
+			voice->encoder->wait_for_chunk(timeout);
+		}
+	}
+}
+
+bool Mixer::seek(uint64_t frame) {
+	bool is_seekable = true;
+
+	// Drops the frames mixed ahead (the ones of the voices that can't seek go on from where they were)
+	this->num_lent_frames = this->block_frames;
+	this->drop_lent_frames();
+
+	for (std::unique_ptr<MIXER_VOICE> &voice : this->voices) {
+		if (voice->encoder->seek(frame)) {
+			voice->is_finished = false;
+		}
+		else {
+			is_seekable = false;
+		}
+	}
+
+	return is_seekable;
+}
@@ -0,0 +1,99 @@
+#ifndef WASABI_MIXER_HPP
+#define WASABI_MIXER_HPP
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "audio_source.hpp"
+#include "channel_mixer_kernels.hpp"
+#include "format_converter.hpp"
+#include "mixer_kernels.hpp"
+#include "resampler.hpp"
+
+// Number of frames mixed per chunk by default
+#define MIXER_BLOCK_FRAMES 1024
+
+// Level (in full scale) above which the mix is soft clipped by default (-1 dBFS)
+#define MIXER_SOFT_CLIP_THRESHOLD 0.891f
+
+// Input stream of the mixer, converted to the format of the mix (as a playlist track is) before being summed
+typedef struct MIXER_VOICE {
+	AudioSource *source{};
+	std::unique_ptr<FormatConverter> decoder;
+	std::unique_ptr<Resampler> resampler;
+	std::unique_ptr<FormatConverter> encoder;
+	float gain{1.0f};
+	float pan{};
+	// Gain of each channel (with the pan applied), repeated over MIX_GAIN_PATTERN_FRAMES frames
+	float gain_pattern[CHANNEL_MIXER_MAX_CHANNELS * MIX_GAIN_PATTERN_FRAMES]{};
+	bool is_finished{};
+	uint32_t num_mixed_frames{}; // Summed into the mix buffer, from its start
+} MIXER_VOICE;
+
+// Processing stage playing several sources at once. Each voice has its own gain and pan and is converted from its own
+// format (sample format, rate and channels) to 32 bits floats in the format of the mix, then the voices are summed with
+// vectorised kernels and the sum is soft clipped, so it never exceeds full scale. Every buffer is allocated when the
+// voices are added, mixing a block only reads the voices and writes the mix buffer. Only the frames every voice has
+// been summed into are lent, the ones of the voices ahead of a voice whose reader is behind wait in the mix buffer for
+// the next chunk, so the voices stay aligned. The mix ends once every voice has.
+class Mixer : public AudioSource {
+private:
+	AUDIO_FORMAT format;
+	DITHER_TYPE dither_type{};
+	RESAMPLER_QUALITY resampler_quality{};
+	std::vector<std::unique_ptr<MIXER_VOICE>> voices;
+	MIX_KERNEL mix{};
+	SOFT_CLIP_KERNEL soft_clip{};
+	float soft_clip_threshold{MIXER_SOFT_CLIP_THRESHOLD};
+	uint64_t num_clipped_samples{};
+	uint32_t block_frames{};
+	float *mix_buffer{};
+	uint32_t num_lent_frames{}; // Lent from the start of the mix buffer by the last chunk
+
+	void compute_gain_pattern(MIXER_VOICE &voice);
+
+	// Drops the frames lent by the last chunk from the mix buffer
+	void drop_lent_frames();
+
+public:
+	// Mixes to the sample rate and channel layout of the given format (the mix is always made of 32 bits floats)
+	Mixer(const AUDIO_FORMAT &format, DITHER_TYPE dither_type, RESAMPLER_QUALITY resampler_quality,
+		uint32_t block_frames = MIXER_BLOCK_FRAMES);
+
+	Mixer(Mixer const &mixer) = delete;
+
+	Mixer &operator=(Mixer const &mixer) = delete;
+
+	~Mixer() override;
+
+	// Adds a voice playing the given source (which must outlive the mixer), returns false if its format can't be
+	// converted to the one of the mix. The pan goes from -1 (left) to 1 (right)
+	bool add_voice(AudioSource *source, float gain = 1.0f, float pan = 0.0f);
+
+	size_t get_num_voices();
+
+	void set_voice_gain(size_t voice, float gain);
+
+	// Pans along a constant power curve: the channels on the left of the listener are attenuated when panning to the
+	// right and the other way around, while the other side and the center channels keep their level
+	void set_voice_pan(size_t voice, float pan);
+
+	// Sets the level above which the mix is soft clipped (in (0, 1))
+	void set_soft_clip_threshold(float threshold);
+
+	// Gets the number of samples of the mix that were above the soft clipping threshold
+	uint64_t get_num_clipped_samples();
+
+	AUDIO_FORMAT get_format() override;
+
+	bool get_chunk(AUDIO_CHUNK &chunk, uint32_t max_size) override;
+
+	void release_chunk(AUDIO_CHUNK &chunk) override;
+
+	void wait_for_chunk(uint32_t timeout) override;
+
+	// Moves every voice to the given frame (in the sample rate of the mix)
+	bool seek(uint64_t frame) override;
+};
+
+#endif //WASABI_MIXER_HPP
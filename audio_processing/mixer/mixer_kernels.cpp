@@ -0,0 +1,185 @@
+#include "mixer_kernels.hpp"
+#include <cmath>
+
+// Mixes from the given position of the gain pattern (the vectorised kernels finish their blocks with it)
+static inline void mix_samples_from(float *mix, const float *samples, size_t num_samples, const float *gain_pattern,
+	size_t pattern_size, size_t pattern_position) {
+	for (size_t i = 0; i < num_samples; i++) {
+		mix[i] += samples[i] * gain_pattern[pattern_position];
+
+		pattern_position = pattern_position + 1 == pattern_size ? 0 : pattern_position + 1;
+	}
+}
+
+static void mix_samples(float *mix, const float *samples, size_t num_samples, const float *gain_pattern,
+	size_t pattern_size) {
+	mix_samples_from(mix, samples, num_samples, gain_pattern, pattern_size, 0);
+}
+
+// The curve above the threshold is t + (1 - t) * u / (1 + u), with u = (|x| - t) / (1 - t): it starts with a slope of 1
+// and tends to full scale
+static inline float soft_clip_sample(float sample, float threshold) {
+	float magnitude = std::fabs(sample);
+
+	if (magnitude <= threshold) {
+		return sample;
+	}
+
+	float range = 1.0f - threshold;
+	float excess = (magnitude - threshold) / range;
+	float clipped_magnitude = threshold + range * excess / (1.0f + excess);
+
+	return sample < 0.0f ? -clipped_magnitude : clipped_magnitude;
+}
+
+static size_t soft_clip_samples(float *samples, size_t num_samples, float threshold) {
+	size_t num_clipped_samples = 0;
+
+	for (size_t i = 0; i < num_samples; i++) {
+		num_clipped_samples += std::fabs(samples[i]) > threshold;
+		samples[i] = soft_clip_sample(samples[i], threshold);
+	}
+
+	return num_clipped_samples;
+}
+
+#ifdef WASABI_SIMD_X86
+
+static inline size_t count_set_bits(int mask) {
+	size_t count = 0;
+
+	for (; mask != 0; mask &= mask - 1) {
+		count++;
+	}
+
+	return count;
+}
+
+static void mix_samples_sse2(float *mix, const float *samples, size_t num_samples, const float *gain_pattern,
+	size_t pattern_size) {
+	size_t pattern_position = 0;
+	size_t i = 0;
+
+	// The voices start at any frame of the mix, so neither side is aligned
+	for (; i + 4 <= num_samples; i += 4) {
+		__m128 product = _mm_mul_ps(_mm_loadu_ps(samples + i), _mm_loadu_ps(gain_pattern + pattern_position));
+
+		_mm_storeu_ps(mix + i, _mm_add_ps(_mm_loadu_ps(mix + i), product));
+
+		pattern_position = pattern_position + 4 == pattern_size ? 0 : pattern_position + 4;
+	}
+
+	mix_samples_from(mix + i, samples + i, num_samples - i, gain_pattern, pattern_size, pattern_position);
+}
+
+static size_t soft_clip_samples_sse2(float *samples, size_t num_samples, float threshold) {
+	const __m128 sign_mask = _mm_set1_ps(-0.0f);
+	const __m128 threshold_vector = _mm_set1_ps(threshold);
+	const __m128 range = _mm_set1_ps(1.0f - threshold);
+	const __m128 inverse_range = _mm_set1_ps(1.0f / (1.0f - threshold));
+	const __m128 one = _mm_set1_ps(1.0f);
+	size_t num_clipped_samples = 0;
+	size_t i = 0;
+
+	for (; i + 4 <= num_samples; i += 4) {
+		__m128 sample = _mm_loadu_ps(samples + i);
+		__m128 magnitude = _mm_andnot_ps(sign_mask, sample);
+		__m128 is_clipped = _mm_cmpgt_ps(magnitude, threshold_vector);
+		int clipped_mask = _mm_movemask_ps(is_clipped);
+
+		// Most blocks stay below the threshold
+		if (clipped_mask == 0) {
+			continue;
+		}
+
+		__m128 excess = _mm_mul_ps(_mm_sub_ps(magnitude, threshold_vector), inverse_range);
+		__m128 clipped_magnitude = _mm_add_ps(threshold_vector,
+			_mm_mul_ps(range, _mm_div_ps(excess, _mm_add_ps(one, excess))));
+		__m128 clipped_sample = _mm_or_ps(clipped_magnitude, _mm_and_ps(sign_mask, sample));
+
+		_mm_storeu_ps(samples + i, _mm_or_ps(_mm_and_ps(is_clipped, clipped_sample), _mm_andnot_ps(is_clipped, sample)));
+
+		num_clipped_samples += count_set_bits(clipped_mask);
+	}
+
+	return num_clipped_samples + soft_clip_samples(samples + i, num_samples - i, threshold);
+}
+
+WASABI_TARGET_AVX2
+static void mix_samples_avx2(float *mix, const float *samples, size_t num_samples, const float *gain_pattern,
+	size_t pattern_size) {
+	size_t pattern_position = 0;
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8) {
+		__m256 sum = _mm256_fmadd_ps(_mm256_loadu_ps(samples + i), _mm256_loadu_ps(gain_pattern + pattern_position),
+			_mm256_loadu_ps(mix + i));
+
+		_mm256_storeu_ps(mix + i, sum);
+
+		pattern_position = pattern_position + 8 == pattern_size ? 0 : pattern_position + 8;
+	}
+
+	mix_samples_from(mix + i, samples + i, num_samples - i, gain_pattern, pattern_size, pattern_position);
+}
+
+WASABI_TARGET_AVX2
+static size_t soft_clip_samples_avx2(float *samples, size_t num_samples, float threshold) {
+	const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+	const __m256 threshold_vector = _mm256_set1_ps(threshold);
+	const __m256 range = _mm256_set1_ps(1.0f - threshold);
+	const __m256 inverse_range = _mm256_set1_ps(1.0f / (1.0f - threshold));
+	const __m256 one = _mm256_set1_ps(1.0f);
+	size_t num_clipped_samples = 0;
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8) {
+		__m256 sample = _mm256_loadu_ps(samples + i);
+		__m256 magnitude = _mm256_andnot_ps(sign_mask, sample);
+		__m256 is_clipped = _mm256_cmp_ps(magnitude, threshold_vector, _CMP_GT_OQ);
+		int clipped_mask = _mm256_movemask_ps(is_clipped);
+
+		if (clipped_mask == 0) {
+			continue;
+		}
+
+		__m256 excess = _mm256_mul_ps(_mm256_sub_ps(magnitude, threshold_vector), inverse_range);
+		__m256 clipped_magnitude = _mm256_fmadd_ps(range, _mm256_div_ps(excess, _mm256_add_ps(one, excess)),
+			threshold_vector);
+		__m256 clipped_sample = _mm256_or_ps(clipped_magnitude, _mm256_and_ps(sign_mask, sample));
+
+		_mm256_storeu_ps(samples + i, _mm256_blendv_ps(sample, clipped_sample, is_clipped));
+
+		num_clipped_samples += count_set_bits(clipped_mask);
+	}
+
+	return num_clipped_samples + soft_clip_samples(samples + i, num_samples - i, threshold);
+}
+
+#endif
+
+MIX_KERNEL get_mix_kernel(SIMD_LEVEL level) {
+#ifdef WASABI_SIMD_X86
+	if (level >= SIMD_LEVEL_AVX2) {
+		return mix_samples_avx2;
+	}
+
+	if (level >= SIMD_LEVEL_SSE2) {
+		return mix_samples_sse2;
+	}
+#endif
+	return mix_samples;
+}
+
+SOFT_CLIP_KERNEL get_soft_clip_kernel(SIMD_LEVEL level) {
+#ifdef WASABI_SIMD_X86
+	if (level >= SIMD_LEVEL_AVX2) {
+		return soft_clip_samples_avx2;
+	}
+
+	if (level >= SIMD_LEVEL_SSE2) {
+		return soft_clip_samples_sse2;
+	}
+#endif
+	return soft_clip_samples;
+}
@@ -0,0 +1,27 @@
+#ifndef WASABI_MIXER_KERNELS_HPP
+#define WASABI_MIXER_KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "simd.hpp"
+
+// Number of frames covered by a gain pattern, so its size (in samples) is a multiple of the width of every vector
+#define MIX_GAIN_PATTERN_FRAMES 8
+
+// Adds the interleaved 32 bits float samples of a voice to the mix, each one scaled by the gain of its channel. The
+// gains are given as a pattern of MIX_GAIN_PATTERN_FRAMES frames (the gain of each channel repeated), starting at the
+// first channel of a frame, so the vectors of samples are multiplied by vectors of the pattern without any shuffle.
+typedef void (*MIX_KERNEL)(float *mix, const float *samples, size_t num_samples, const float *gain_pattern,
+	size_t pattern_size);
+
+// Soft clips 32 bits float samples in place: they are left untouched up to the threshold (in (0, 1)), and above it they
+// are bent towards full scale, which they never reach, with a continuous slope. Returns the number of samples that were
+// above the threshold.
+typedef size_t (*SOFT_CLIP_KERNEL)(float *samples, size_t num_samples, float threshold);
+
+// Return the kernels for the given instruction set
+MIX_KERNEL get_mix_kernel(SIMD_LEVEL level);
+
+SOFT_CLIP_KERNEL get_soft_clip_kernel(SIMD_LEVEL level);
+
+#endif //WASABI_MIXER_KERNELS_HPP
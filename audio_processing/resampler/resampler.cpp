@@ -0,0 +1,300 @@
+#include "resampler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#define PI 3.14159265358979323846
+
+typedef struct RESAMPLER_PRESET {
+	// Taps per phase when upsampling
+	uint32_t num_taps;
+	// Shape of the Kaiser window (higher values attenuate the stop band more but widen the transition band)
+	double beta;
+	// Cutoff frequency relative to the Nyquist frequency of the lowest sample rate
+	double cutoff;
+} RESAMPLER_PRESET;
+
+static const RESAMPLER_PRESET RESAMPLER_PRESETS[] = {
+	{16, 5.0, 0.85},
+	{32, 7.0, 0.90},
+	{64, 9.0, 0.94},
+	{128, 12.0, 0.96}
+};
+
+static uint32_t get_greatest_common_divisor(uint32_t a, uint32_t b) {
+	while (b != 0) {
+		uint32_t remainder = a % b;
+
+		a = b;
+		b = remainder;
+	}
+
+	return a;
+}
+
+// Zeroth order modified Bessel function of the first kind (power series)
+static double get_bessel_i0(double x) {
+	double sum = 1.0;
+	double term = 1.0;
+
+	for (int k = 1; k < 64 && term > sum * 1e-12; k++) {
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+	}
+
+	return sum;
+}
+
+Resampler::Resampler(AudioSource *source, uint32_t output_sample_rate, RESAMPLER_QUALITY quality,
+	uint32_t block_frames) {
+	this->source = source;
+	this->input_format = source->get_format();
+	this->output_format = make_audio_format(output_sample_rate, this->input_format.num_channels,
+		this->input_format.bit_depth, this->input_format.is_float, this->input_format.channel_mask);
+	this->is_passthrough = this->input_format.sample_rate == output_sample_rate;
+
+	// Only 32 bits floats are resampled, the other formats have to go through a format converter first
+	if (this->is_passthrough || !this->input_format.is_float || this->input_format.bit_depth != 32 ||
+		this->input_format.sample_rate == 0 || output_sample_rate == 0) {
+		return;
+	}
+
+	uint32_t greatest_common_divisor = get_greatest_common_divisor(this->input_format.sample_rate, output_sample_rate);
+
+	this->interpolation_factor = output_sample_rate / greatest_common_divisor;
+	this->decimation_factor = this->input_format.sample_rate / greatest_common_divisor;
+	this->num_phases = std::min(this->interpolation_factor, (uint32_t)RESAMPLER_MAX_PHASES);
+	this->dot_product = get_dot_product_kernel(get_simd_level());
+
+	this->compute_coefficients(quality);
+
+	// Allocates the buffers once, the history holds the filter taps plus a block (and at least the frames skipped
+	// between two output frames)
+	uint32_t num_channels = this->input_format.num_channels;
+	uint32_t step_frames = this->decimation_factor / this->interpolation_factor + 1;
+
+	this->block_frames = std::max(block_frames, step_frames);
+	this->history_capacity = this->num_taps + this->block_frames;
+	this->history = (float*)allocate_aligned((size_t)this->history_capacity * num_channels * sizeof(float));
+	this->output_buffer = (float*)allocate_aligned((size_t)this->block_frames * num_channels * sizeof(float));
+
+	this->reset_history();
+}
+
+Resampler::~Resampler() {
+	// Frees all allocated memory
+	free_aligned(this->coefficients);
+	free_aligned(this->history);
+	free_aligned(this->output_buffer);
+}
+
+void Resampler::compute_coefficients(RESAMPLER_QUALITY quality) {
+	const RESAMPLER_PRESET &preset = RESAMPLER_PRESETS[quality];
+
+	// When downsampling, the cutoff follows the output Nyquist frequency and the filter is stretched accordingly
+	double ratio = (double)this->interpolation_factor / this->decimation_factor;
+	double cutoff = preset.cutoff * std::min(1.0, ratio);
+	uint32_t num_taps = (uint32_t)std::ceil(preset.num_taps / std::min(1.0, ratio));
+
+	num_taps = std::min(num_taps, (uint32_t)RESAMPLER_MAX_TAPS);
+	num_taps = (num_taps + RESAMPLER_KERNEL_TAPS_ALIGNMENT - 1) / RESAMPLER_KERNEL_TAPS_ALIGNMENT *
+		RESAMPLER_KERNEL_TAPS_ALIGNMENT;
+
+	this->num_taps = num_taps;
+	this->coefficients = (float*)allocate_aligned((size_t)this->num_phases * num_taps * sizeof(float));
+
+	double half_length = num_taps / 2.0;
+	double window_scale = 1.0 / get_bessel_i0(preset.beta);
+
+	for (uint32_t phase = 0; phase < this->num_phases; phase++) {
+		float *phase_coefficients = this->coefficients + (size_t)phase * num_taps;
+		double fraction = (double)phase / this->num_phases;
+		double sum = 0.0;
+
+		for (uint32_t tap = 0; tap < num_taps; tap++) {
+			// Distance (in input frames) between the tap and the output frame
+			double x = (double)tap - (half_length - 1.0) - fraction;
+			double sinc = x == 0.0 ? 1.0 : std::sin(PI * cutoff * x) / (PI * cutoff * x);
+			double window_position = x / half_length;
+			double window = std::fabs(window_position) >= 1.0 ? 0.0 :
+				get_bessel_i0(preset.beta * std::sqrt(1.0 - window_position * window_position)) * window_scale;
+
+			phase_coefficients[tap] = (float)(cutoff * sinc * window);
+			sum += phase_coefficients[tap];
+		}
+
+		// Normalises each phase to unity gain, so constant signals don't get modulated by the phase
+		for (uint32_t tap = 0; tap < num_taps; tap++) {
+			phase_coefficients[tap] = (float)(phase_coefficients[tap] / sum);
+		}
+	}
+}
+
+void Resampler::reset_history() {
+	// Starts with half a filter of silence, so the first output frame is aligned with the first input frame
+	this->num_history_frames = this->num_taps / 2 - 1;
+	this->position = this->num_history_frames;
+	this->phase_accumulator = 0;
+	this->is_source_eof = false;
+	this->is_flushed = false;
+
+	for (uint32_t channel = 0; channel < this->input_format.num_channels; channel++) {
+		memset(this->history + (size_t)channel * this->history_capacity, 0, this->num_history_frames * sizeof(float));
+	}
+}
+
+bool Resampler::fill_history() {
+	uint32_t num_channels = this->input_format.num_channels;
+
+	// Discards the frames that are no longer covered by the filter
+	uint32_t first_frame = this->position + 1 - this->num_taps / 2;
+	uint32_t num_discarded_frames = std::min(first_frame, this->num_history_frames);
+
+	if (num_discarded_frames > 0) {
+		uint32_t num_kept_frames = this->num_history_frames - num_discarded_frames;
+
+		for (uint32_t channel = 0; channel < num_channels; channel++) {
+			float *channel_history = this->history + (size_t)channel * this->history_capacity;
+
+			memmove(channel_history, channel_history + num_discarded_frames, num_kept_frames * sizeof(float));
+		}
+
+		this->num_history_frames = num_kept_frames;
+		this->position -= num_discarded_frames;
+	}
+
+	// Once the source is over, appends half a filter of silence so the last input frames get through the filter
+	if (this->is_source_eof) {
+		uint32_t num_silent_frames = this->num_taps / 2;
+
+		for (uint32_t channel = 0; channel < num_channels; channel++) {
+			memset(this->history + (size_t)channel * this->history_capacity + this->num_history_frames, 0,
+				num_silent_frames * sizeof(float));
+		}
+
+		this->num_history_frames += num_silent_frames;
+		this->is_flushed = true;
+
+		return true;
+	}
+
+	// Reads a block and splits its channels
+	AUDIO_CHUNK input_chunk;
+	uint32_t num_free_frames = std::min(this->history_capacity - this->num_history_frames, this->block_frames);
+
+	this->is_source_eof = this->source->get_chunk(input_chunk, num_free_frames * this->input_format.block_align);
+
+	uint32_t num_frames = input_chunk.size / this->input_format.block_align;
+	const float *samples = (const float*)input_chunk.data;
+
+	for (uint32_t channel = 0; channel < num_channels; channel++) {
+		float *channel_history = this->history + (size_t)channel * this->history_capacity + this->num_history_frames;
+
+		for (uint32_t frame = 0; frame < num_frames; frame++) {
+			channel_history[frame] = samples[(size_t)frame * num_channels + channel];
+		}
+	}
+
+	this->source->release_chunk(input_chunk);
+
+	this->num_history_frames += num_frames;
+
+	return num_frames > 0 || this->is_source_eof;
+}
+
+bool Resampler::is_supported() {
+	return this->is_passthrough || this->coefficients != nullptr;
+}
+
+uint32_t Resampler::get_num_taps() {
+	return this->num_taps;
+}
+
+AUDIO_FORMAT Resampler::get_format() {
+	return this->output_format;
+}
+
+bool Resampler::get_chunk(AUDIO_CHUNK &chunk, uint32_t max_size) {
+	if (this->is_passthrough) {
+		return this->source->get_chunk(chunk, max_size);
+	}
+
+	uint32_t num_channels = this->input_format.num_channels;
+	uint32_t max_frames = std::min(max_size / this->output_format.block_align, this->block_frames);
+	uint32_t num_frames = 0;
+	uint32_t half_taps = this->num_taps / 2;
+
+	while (num_frames < max_frames) {
+		// Waits for the history to hold every frame covered by the filter
+		if (this->position + half_taps >= this->num_history_frames) {
+			// Lends the frames computed so far when the source has nothing ready (it's tried again on the next chunk)
+			if (this->is_flushed || !this->fill_history()) {
+				break;
+			}
+
+			continue;
+		}
+
+		// Picks the phase matching the fraction of the position (the nearest lower one when there are fewer phases)
+		uint32_t phase = this->phase_accumulator;
+
+		if (this->num_phases != this->interpolation_factor) {
+			phase = (uint32_t)((uint64_t)phase * this->num_phases / this->interpolation_factor);
+		}
+
+		const float *phase_coefficients = this->coefficients + (size_t)phase * this->num_taps;
+		const float *samples = this->history + (this->position + 1 - half_taps);
+		float *output_frame = this->output_buffer + (size_t)num_frames * num_channels;
+
+		for (uint32_t channel = 0; channel < num_channels; channel++) {
+			output_frame[channel] = this->dot_product(samples + (size_t)channel * this->history_capacity,
+				phase_coefficients, this->num_taps);
+		}
+
+		num_frames++;
+
+		// Moves forward by the ratio between the input and output rates
+		this->phase_accumulator += this->decimation_factor;
+		this->position += this->phase_accumulator / this->interpolation_factor;
+		this->phase_accumulator %= this->interpolation_factor;
+	}
+
+	chunk.data = (const uint8_t*)this->output_buffer;
+	chunk.size = num_frames * this->output_format.block_align;
+	chunk.is_eof = this->is_flushed && this->position + half_taps >= this->num_history_frames;
+
+	return chunk.is_eof;
+}
+
+void Resampler::release_chunk(AUDIO_CHUNK &chunk) {
+	if (this->is_passthrough) {
+		this->source->release_chunk(chunk);
+
+		return;
+	}
+
+	chunk.data = nullptr;
+	chunk.size = 0;
+}
+
+void Resampler::wait_for_chunk(uint32_t timeout) {
+	this->source->wait_for_chunk(timeout);
+}
+
+bool Resampler::seek(uint64_t frame) {
+	if (this->is_passthrough) {
+		return this->source->seek(frame);
+	}
+
+	// Finds the input frame preceding the output frame and the phase between them
+	uint64_t input_position = frame * this->decimation_factor;
+
+	if (!this->source->seek(input_position / this->interpolation_factor)) {
+		return false;
+	}
+
+	this->reset_history();
+	this->phase_accumulator = (uint32_t)(input_position % this->interpolation_factor);
+
+	return true;
+}
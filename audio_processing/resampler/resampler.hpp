@@ -0,0 +1,87 @@
+#ifndef WASABI_RESAMPLER_HPP
+#define WASABI_RESAMPLER_HPP
+
+#include <cstdint>
+#include "audio_source.hpp"
+#include "resampler_kernels.hpp"
+
+// Number of input frames read from the source at once by default
+#define RESAMPLER_BLOCK_FRAMES 1024
+
+// Maximum number of filter phases, ratios needing more phases (odd sample rates) use the nearest phase
+#define RESAMPLER_MAX_PHASES 1024
+
+// Maximum number of taps per phase (the filters get longer as the ratio shrinks, to keep the same quality)
+#define RESAMPLER_MAX_TAPS 1024
+
+enum RESAMPLER_QUALITY {
+	RESAMPLER_QUALITY_LOW,
+	RESAMPLER_QUALITY_MEDIUM,
+	RESAMPLER_QUALITY_HIGH,
+	RESAMPLER_QUALITY_BEST
+};
+
+// Processing stage converting the sample rate of its source (32 bits float samples) with a polyphase windowed-sinc
+// (Kaiser) filter. The ratio between both rates is reduced to a fraction, so each output frame is computed with one of
+// the precomputed phases of the filter. Input is read in fixed size blocks into a planar history holding the taps of
+// the filter, so the latency is bounded by half the filter length and nothing is allocated once constructed. When both
+// rates are the same, the chunks of the source are passed through untouched.
+class Resampler : public AudioSource {
+private:
+	AudioSource *source;
+	AUDIO_FORMAT input_format;
+	AUDIO_FORMAT output_format;
+	bool is_passthrough{};
+	DOT_PRODUCT_KERNEL dot_product{};
+	// Reduced ratio between the output and input sample rates
+	uint32_t interpolation_factor{};
+	uint32_t decimation_factor{};
+	uint32_t num_phases{};
+	uint32_t num_taps{};
+	float *coefficients{};
+	uint32_t block_frames{};
+	// Planar history of each channel, the input frames the filter is applied to
+	float *history{};
+	uint32_t history_capacity{};
+	uint32_t num_history_frames{};
+	// Position of the next output frame, as the history frame preceding it plus a fraction (in 1 / interpolation factor)
+	uint32_t position{};
+	uint32_t phase_accumulator{};
+	bool is_source_eof{};
+	bool is_flushed{};
+	float *output_buffer{};
+
+	void compute_coefficients(RESAMPLER_QUALITY quality);
+
+	// Reads the next block of the source into the history, returns false if the source had nothing ready
+	bool fill_history();
+
+	void reset_history();
+
+public:
+	Resampler(AudioSource *source, uint32_t output_sample_rate, RESAMPLER_QUALITY quality,
+		uint32_t block_frames = RESAMPLER_BLOCK_FRAMES);
+
+	Resampler(Resampler const &resampler) = delete;
+
+	Resampler &operator=(Resampler const &resampler) = delete;
+
+	~Resampler() override;
+
+	bool is_supported();
+
+	// Gets the number of taps of each phase of the filter (the latency is half of it, in input frames)
+	uint32_t get_num_taps();
+
+	AUDIO_FORMAT get_format() override;
+
+	bool get_chunk(AUDIO_CHUNK &chunk, uint32_t max_size) override;
+
+	void release_chunk(AUDIO_CHUNK &chunk) override;
+
+	void wait_for_chunk(uint32_t timeout) override;
+
+	bool seek(uint64_t frame) override;
+};
+
+#endif //WASABI_RESAMPLER_HPP
@@ -0,0 +1,75 @@
+#include "resampler_kernels.hpp"
+
+static float get_dot_product(const float *samples, const float *coefficients, size_t num_taps) {
+	// Uses several accumulators, so the additions don't wait for each other
+	float sums[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+	for (size_t i = 0; i < num_taps; i += 4) {
+		sums[0] += samples[i] * coefficients[i];
+		sums[1] += samples[i + 1] * coefficients[i + 1];
+		sums[2] += samples[i + 2] * coefficients[i + 2];
+		sums[3] += samples[i + 3] * coefficients[i + 3];
+	}
+
+	return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+}
+
+#ifdef WASABI_SIMD_X86
+
+static float get_dot_product_sse2(const float *samples, const float *coefficients, size_t num_taps) {
+	__m128 first_sum = _mm_setzero_ps();
+	__m128 second_sum = _mm_setzero_ps();
+
+	// The coefficients are aligned, the samples start at any frame of the history
+	for (size_t i = 0; i < num_taps; i += 8) {
+		first_sum = _mm_add_ps(first_sum, _mm_mul_ps(_mm_loadu_ps(samples + i), _mm_load_ps(coefficients + i)));
+		second_sum = _mm_add_ps(second_sum, _mm_mul_ps(_mm_loadu_ps(samples + i + 4), _mm_load_ps(coefficients + i + 4)));
+	}
+
+	__m128 sum = _mm_add_ps(first_sum, second_sum);
+
+	// Adds the 4 lanes horizontally
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55));
+
+	return _mm_cvtss_f32(sum);
+}
+
+WASABI_TARGET_AVX2
+static float get_dot_product_avx2(const float *samples, const float *coefficients, size_t num_taps) {
+	__m256 first_sum = _mm256_setzero_ps();
+	__m256 second_sum = _mm256_setzero_ps();
+	size_t i = 0;
+
+	for (; i + 16 <= num_taps; i += 16) {
+		first_sum = _mm256_fmadd_ps(_mm256_loadu_ps(samples + i), _mm256_load_ps(coefficients + i), first_sum);
+		second_sum = _mm256_fmadd_ps(_mm256_loadu_ps(samples + i + 8), _mm256_load_ps(coefficients + i + 8), second_sum);
+	}
+
+	if (i < num_taps) {
+		first_sum = _mm256_fmadd_ps(_mm256_loadu_ps(samples + i), _mm256_load_ps(coefficients + i), first_sum);
+	}
+
+	__m256 sum = _mm256_add_ps(first_sum, second_sum);
+	__m128 half_sum = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+
+	half_sum = _mm_add_ps(half_sum, _mm_movehl_ps(half_sum, half_sum));
+	half_sum = _mm_add_ss(half_sum, _mm_shuffle_ps(half_sum, half_sum, 0x55));
+
+	return _mm_cvtss_f32(half_sum);
+}
+
+#endif
+
+DOT_PRODUCT_KERNEL get_dot_product_kernel(SIMD_LEVEL level) {
+#ifdef WASABI_SIMD_X86
+	if (level >= SIMD_LEVEL_AVX2) {
+		return get_dot_product_avx2;
+	}
+
+	if (level >= SIMD_LEVEL_SSE2) {
+		return get_dot_product_sse2;
+	}
+#endif
+	return get_dot_product;
+}
@@ -0,0 +1,18 @@
+#ifndef WASABI_RESAMPLER_KERNELS_HPP
+#define WASABI_RESAMPLER_KERNELS_HPP
+
+#include <cstddef>
+#include "simd.hpp"
+
+// Number of filter taps the kernels process at once (the filters are zero padded to a multiple of it)
+#define RESAMPLER_KERNEL_TAPS_ALIGNMENT 8
+
+// Returns the dot product of the samples and the coefficients of a filter phase (its length is a multiple of the taps
+// alignment)
+typedef float (*DOT_PRODUCT_KERNEL)(const float *samples, const float *coefficients, size_t num_taps);
+
+// Return the kernel for the given instruction set (instruction sets without a specific kernel fall back to the closest
+// lower one)
+DOT_PRODUCT_KERNEL get_dot_product_kernel(SIMD_LEVEL level);
+
+#endif //WASABI_RESAMPLER_KERNELS_HPP
@@ -0,0 +1,95 @@
+#include "simd.hpp"
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#if defined(WASABI_SIMD_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static SIMD_LEVEL max_simd_level = SIMD_LEVEL_AVX2;
+
+static SIMD_LEVEL detect_simd_level() {
+#if defined(WASABI_SIMD_X86) && defined(_MSC_VER)
+	int cpu_info[4];
+
+	__cpuid(cpu_info, 0);
+
+	int num_ids = cpu_info[0];
+
+	__cpuid(cpu_info, 1);
+
+	bool has_sse2 = (cpu_info[3] & (1 << 26)) != 0;
+	bool has_fma = (cpu_info[2] & (1 << 12)) != 0;
+	bool has_os_avx = (cpu_info[2] & (1 << 27)) != 0 && (cpu_info[2] & (1 << 28)) != 0 &&
+		(_xgetbv(0) & 0x6) == 0x6;
+	bool has_avx2 = false;
+
+	if (num_ids >= 7) {
+		__cpuidex(cpu_info, 7, 0);
+
+		has_avx2 = (cpu_info[1] & (1 << 5)) != 0;
+	}
+
+	if (has_avx2 && has_fma && has_os_avx) {
+		return SIMD_LEVEL_AVX2;
+	}
+
+	return has_sse2 ? SIMD_LEVEL_SSE2 : SIMD_LEVEL_SCALAR;
+#elif defined(WASABI_SIMD_X86)
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+		return SIMD_LEVEL_AVX2;
+	}
+
+	return __builtin_cpu_supports("sse2") ? SIMD_LEVEL_SSE2 : SIMD_LEVEL_SCALAR;
+#else
+	return SIMD_LEVEL_SCALAR;
+#endif
+}
+
+SIMD_LEVEL get_simd_level() {
+	static const SIMD_LEVEL detected_simd_level = detect_simd_level();
+
+	return detected_simd_level < max_simd_level ? detected_simd_level : max_simd_level;
+}
+
+void set_max_simd_level(SIMD_LEVEL level) {
+	max_simd_level = level;
+}
+
+const char *get_simd_level_name(SIMD_LEVEL level) {
+	switch (level) {
+	case SIMD_LEVEL_SSE2:
+		return "sse2";
+	case SIMD_LEVEL_AVX2:
+		return "avx2";
+	default:
+		return "scalar";
+	}
+}
+
+void *allocate_aligned(size_t size) {
+#ifdef _WIN32
+	return _aligned_malloc(size, SIMD_ALIGNMENT);
+#else
+	void *data = nullptr;
+
+	if (posix_memalign(&data, SIMD_ALIGNMENT, size) != 0) {
+		return nullptr;
+	}
+
+	return data;
+#endif
+}
+
+void free_aligned(void *data) {
+#ifdef _WIN32
+	_aligned_free(data);
+#else
+	free(data);
+#endif
+}
@@ -0,0 +1,43 @@
+#ifndef WASABI_SIMD_HPP
+#define WASABI_SIMD_HPP
+
+#include <cstddef>
+
+// Alignment (in bytes) of the buffers allocated for the kernels
+#define SIMD_ALIGNMENT 32
+
+// Instruction sets the processing kernels can be dispatched to, in increasing order
+enum SIMD_LEVEL {
+	SIMD_LEVEL_SCALAR = 0,
+	SIMD_LEVEL_SSE2 = 1,
+	SIMD_LEVEL_AVX2 = 2
+};
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define WASABI_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+// Functions using AVX2 intrinsics must be compiled for AVX2 even though the rest of the program isn't (MSVC allows
+// using any intrinsic without it)
+#if defined(WASABI_SIMD_X86) && !defined(_MSC_VER)
+#define WASABI_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define WASABI_TARGET_AVX2
+#endif
+
+// Returns the best instruction set supported by both the CPU and the OS (capped by set_max_simd_level)
+SIMD_LEVEL get_simd_level();
+
+// Caps the instruction set used by the kernels dispatched afterwards (to compare them or work around a faulty one)
+void set_max_simd_level(SIMD_LEVEL level);
+
+const char *get_simd_level_name(SIMD_LEVEL level);
+
+// Allocates memory aligned to the size of the widest vectors, so the kernels can use aligned loads (it must be freed
+// with free_aligned)
+void *allocate_aligned(size_t size);
+
+void free_aligned(void *data);
+
+#endif //WASABI_SIMD_HPP
@@ -0,0 +1,65 @@
+#include "audio_sink.hpp"
+#include "instrumentation.hpp"
+
+uint32_t AudioSink::refill(AudioSource& source, bool& is_eof) {
+	AUDIO_CHUNK chunk;
+	uint32_t num_padding_frames = this->get_padding();
+	uint32_t block_align = this->get_format().block_align;
+
+	// An empty buffer at refill time means the endpoint has already been starved
+	if (this->is_refilled && num_padding_frames == 0 && this->is_realtime()) {
+		this->statistics.num_underruns += 1;
+
+		record_trace_event(TRACE_UNDERRUN, num_padding_frames);
+	}
+
+	// Pulls chunks until the free space is filled, whatever their size (the source may split them at its wrap-around),
+	// or until the source has nothing ready (the rest is pulled on the next refill)
+	uint32_t num_free_bytes = (this->get_buffer_size() - num_padding_frames) * block_align;
+	uint32_t num_written_bytes = 0;
+
+	is_eof = false;
+
+	while (num_written_bytes < num_free_bytes && !is_eof) {
+		is_eof = source.get_chunk(chunk, num_free_bytes - num_written_bytes);
+
+		uint64_t write_start_time = begin_trace_span();
+
+		uint32_t chunk_size = chunk.size;
+
+		this->write_chunk(chunk.data, chunk_size, is_eof);
+		num_written_bytes += chunk_size;
+
+		end_trace_span(TRACE_WRITE, write_start_time, chunk_size);
+
+		source.release_chunk(chunk);
+
+		if (chunk_size == 0 && !is_eof) {
+			break;
+		}
+	}
+
+	this->statistics.num_written_frames += num_written_bytes / block_align;
+	this->statistics.num_refills += 1;
+	// A refill the source had nothing ready for leaves the endpoint as it was (empty before the first frames)
+	this->is_refilled = this->is_refilled || num_written_bytes > 0;
+
+	return num_written_bytes / block_align;
+}
+
+double AudioSink::get_output_latency() {
+	return (double)this->get_padding() / this->get_format().sample_rate;
+}
+
+bool AudioSink::set_stream_format(const AUDIO_FORMAT& format) {
+	return false;
+}
+
+AUDIO_SINK_STATISTICS AudioSink::get_statistics() {
+	return this->statistics;
+}
+
+void AudioSink::reset_statistics() {
+	this->statistics = AUDIO_SINK_STATISTICS();
+	this->is_refilled = false;
+}
@@ -0,0 +1,71 @@
+#ifndef WASABI_AUDIO_SINK_HPP
+#define WASABI_AUDIO_SINK_HPP
+
+#include <cstdint>
+#include "audio_format.hpp"
+#include "audio_source.hpp"
+
+// Counters describing how well the sink has been fed
+typedef struct AUDIO_SINK_STATISTICS {
+	uint64_t num_written_frames{};
+	uint64_t num_refills{};
+	// Refills that found the sink buffer already empty (the endpoint ran out of frames and played silence)
+	uint64_t num_underruns{};
+	// Writes that didn't fit in the free space of the sink buffer (the exceeding frames were dropped)
+	uint64_t num_overruns{};
+} AUDIO_SINK_STATISTICS;
+
+// Destination of the rendered audio stream (an audio endpoint, a file...)
+class AudioSink {
+protected:
+	AUDIO_SINK_STATISTICS statistics;
+	bool is_refilled{};
+
+public:
+	virtual ~AudioSink() = default;
+
+	// Returns the format the chunks are expected to be written in
+	virtual AUDIO_FORMAT get_format() = 0;
+
+	// Returns whether the sink consumes audio at the pace of its sample rate (otherwise it consumes it as fast as it's written)
+	virtual bool is_realtime() = 0;
+
+	// Returns the size of the sink buffer (in frames)
+	virtual uint32_t get_buffer_size() = 0;
+
+	// Returns the number of frames written to the sink buffer that haven't been played yet
+	virtual uint32_t get_padding() = 0;
+
+	// Blocks until the sink asks for more frames or the timeout (in milliseconds) expires, returns whether it was signaled
+	virtual bool wait_for_refill(uint32_t timeout) = 0;
+
+	virtual void write_chunk(const uint8_t* chunk, uint32_t chunk_size, bool stop) = 0;
+
+	// Pulls exactly as many frames as the sink buffer has room for from the source, returns the number of frames written
+	virtual uint32_t refill(AudioSource& source, bool& is_eof);
+
+	virtual void start() = 0;
+
+	virtual void stop() = 0;
+
+	// Discards the frames written to the sink buffer that haven't been played yet (the sink must be stopped)
+	virtual void flush() = 0;
+
+	virtual float get_volume() = 0;
+
+	virtual void set_volume(float volume) = 0;
+
+	// Returns the delay (in seconds) before the next frame written is heard: the frames queued ahead of it plus the
+	// latency of the device itself
+	virtual double get_output_latency();
+
+	// Adapts a stopped sink to another stream format, keeping what doesn't depend on it (the device...). Returns false
+	// if the sink has to be recreated instead
+	virtual bool set_stream_format(const AUDIO_FORMAT& format);
+
+	AUDIO_SINK_STATISTICS get_statistics();
+
+	void reset_statistics();
+};
+
+#endif //WASABI_AUDIO_SINK_HPP
@@ -0,0 +1,107 @@
+#include "file_sink.hpp"
+#include <iostream>
+
+FileSink::FileSink(const std::string& file_path, const AUDIO_FORMAT& format, bool is_raw) {
+	this->format = format;
+	this->is_raw = is_raw;
+	this->file.open(file_path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+	if (!this->file.is_open()) {
+		std::cerr << "ERROR: Unable to open the output file \"" << file_path << "\"." << std::endl;
+
+		return;
+	}
+
+	// Reserves the header, its sizes are filled in when the file is closed
+	if (!this->is_raw) {
+		this->write_wav_header(false);
+	}
+}
+
+FileSink::~FileSink() {
+	if (this->file.is_open()) {
+		if (!this->is_raw) {
+			this->file.seekp(0);
+			this->write_wav_header(true);
+		}
+
+		this->file.close();
+	}
+}
+
+void FileSink::write_wav_header(bool is_size_set) {
+	// Writes a canonical 44 bytes header (RIFF chunk, 16 bytes 'fmt ' subchunk and 'data' subchunk header)
+	uint32_t data_subchunk_size = this->data_size > UINT32_MAX - 36 ? UINT32_MAX - 36 : (uint32_t)this->data_size;
+	uint32_t chunk_size = 36 + data_subchunk_size;
+
+	if (!is_size_set) {
+		data_subchunk_size = UINT32_MAX;
+		chunk_size = UINT32_MAX;
+	}
+
+	uint32_t fmt_subchunk_size = 16;
+	uint16_t audio_format = this->format.is_float ? 3 : 1;
+
+	this->file.write("RIFF", 4);
+	this->file.write((const char*)&chunk_size, sizeof(chunk_size));
+	this->file.write("WAVE", 4);
+	this->file.write("fmt ", 4);
+	this->file.write((const char*)&fmt_subchunk_size, sizeof(fmt_subchunk_size));
+	this->file.write((const char*)&audio_format, sizeof(audio_format));
+	this->file.write((const char*)&this->format.num_channels, sizeof(this->format.num_channels));
+	this->file.write((const char*)&this->format.sample_rate, sizeof(this->format.sample_rate));
+	this->file.write((const char*)&this->format.byte_rate, sizeof(this->format.byte_rate));
+	this->file.write((const char*)&this->format.block_align, sizeof(this->format.block_align));
+	this->file.write((const char*)&this->format.bit_depth, sizeof(this->format.bit_depth));
+	this->file.write("data", 4);
+	this->file.write((const char*)&data_subchunk_size, sizeof(data_subchunk_size));
+}
+
+bool FileSink::is_open() {
+	return this->file.is_open();
+}
+
+AUDIO_FORMAT FileSink::get_format() {
+	return this->format;
+}
+
+bool FileSink::is_realtime() {
+	return false;
+}
+
+uint32_t FileSink::get_buffer_size() {
+	// Asks for one second of audio per refill, the file is written as fast as the chunks arrive
+	return this->format.sample_rate;
+}
+
+uint32_t FileSink::get_padding() {
+	return 0;
+}
+
+bool FileSink::wait_for_refill(uint32_t timeout) {
+	return true;
+}
+
+void FileSink::write_chunk(const uint8_t* chunk, uint32_t chunk_size, bool stop) {
+	this->file.write((const char*)chunk, chunk_size);
+	this->data_size += chunk_size;
+}
+
+void FileSink::start() {
+}
+
+void FileSink::stop() {
+	this->file.flush();
+}
+
+void FileSink::flush() {
+	// Frames are consumed as soon as they are written, there is nothing left to discard
+}
+
+float FileSink::get_volume() {
+	return this->volume;
+}
+
+void FileSink::set_volume(float volume) {
+	this->volume = volume;
+}
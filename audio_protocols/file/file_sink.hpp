@@ -0,0 +1,52 @@
+#ifndef WASABI_FILE_SINK_HPP
+#define WASABI_FILE_SINK_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include "audio_sink.hpp"
+
+// Sink that writes the audio to a file as fast as it's written, either as raw interleaved samples or as a WAV file
+class FileSink : public AudioSink {
+private:
+	std::ofstream file;
+	AUDIO_FORMAT format;
+	bool is_raw;
+	float volume{1.0f};
+	uint64_t data_size{};
+
+	// Writes the header with the sizes of the data written so far, or with unset sizes (0xFFFFFFFF) until the file is
+	// closed, so a file left unfinished is read until its end rather than as an empty one
+	void write_wav_header(bool is_size_set);
+
+public:
+	FileSink(const std::string& file_path, const AUDIO_FORMAT& format, bool is_raw);
+
+	~FileSink() override;
+
+	bool is_open();
+
+	AUDIO_FORMAT get_format() override;
+
+	bool is_realtime() override;
+
+	uint32_t get_buffer_size() override;
+
+	uint32_t get_padding() override;
+
+	bool wait_for_refill(uint32_t timeout) override;
+
+	void write_chunk(const uint8_t* chunk, uint32_t chunk_size, bool stop) override;
+
+	void start() override;
+
+	void stop() override;
+
+	void flush() override;
+
+	float get_volume() override;
+
+	void set_volume(float volume) override;
+};
+
+#endif //WASABI_FILE_SINK_HPP
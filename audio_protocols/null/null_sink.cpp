@@ -0,0 +1,135 @@
+#include "null_sink.hpp"
+#include <algorithm>
+
+NullSink::NullSink(const AUDIO_FORMAT& format, bool is_realtime, double buffer_duration) {
+	this->format = format;
+	this->realtime = is_realtime;
+	this->buffer_duration = buffer_duration;
+	this->buffer_size = std::max((uint32_t)(buffer_duration * format.sample_rate / 1000), 1u);
+
+	// Emulates the device period of an audio endpoint (10 ms, or half of the buffer when it's shorter than 20 ms)
+	this->period = std::max(std::min(std::chrono::microseconds(10000),
+		std::chrono::microseconds((uint64_t)(buffer_duration * 500))), std::chrono::microseconds(1));
+}
+
+NullSink::~NullSink() = default;
+
+uint64_t NullSink::get_played_frames() {
+	if (!this->realtime) {
+		return this->num_written_frames;
+	}
+
+	if (!this->is_started) {
+		return this->num_played_frames;
+	}
+
+	// Emulates an endpoint consuming the frames at the sample rate since it was started
+	auto elapsed = std::chrono::steady_clock::now() - this->start_time;
+	uint64_t num_elapsed_frames = (uint64_t)(std::chrono::duration<double>(elapsed).count() * this->format.sample_rate);
+
+	return this->num_played_frames + num_elapsed_frames;
+}
+
+uint64_t NullSink::get_written_frames() {
+	return this->num_written_frames;
+}
+
+AUDIO_FORMAT NullSink::get_format() {
+	return this->format;
+}
+
+bool NullSink::is_realtime() {
+	return this->realtime;
+}
+
+uint32_t NullSink::get_buffer_size() {
+	return this->buffer_size;
+}
+
+uint32_t NullSink::get_padding() {
+	uint64_t num_played_frames = this->get_played_frames();
+
+	if (num_played_frames >= this->num_written_frames) {
+		return 0;
+	}
+
+	return (uint32_t)(this->num_written_frames - num_played_frames);
+}
+
+bool NullSink::wait_for_refill(uint32_t timeout) {
+	if (!this->realtime) {
+		return true;
+	}
+
+	std::unique_lock<std::mutex> lck(this->mtx);
+	auto timeout_time = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+
+	// Nothing is consumed while the emulated endpoint is stopped
+	if (!this->is_started || this->next_period_time > timeout_time) {
+		this->cv.wait_until(lck, timeout_time);
+
+		return false;
+	}
+
+	// Sleeps until the end of the current period, as an endpoint signaling its buffer event would do
+	this->cv.wait_until(lck, this->next_period_time);
+
+	auto now = std::chrono::steady_clock::now();
+
+	while (this->next_period_time <= now) {
+		this->next_period_time += this->period;
+	}
+
+	return true;
+}
+
+void NullSink::write_chunk(const uint8_t* chunk, uint32_t chunk_size, bool stop) {
+	// Checks whether the emulated endpoint ran out of data before this chunk arrived
+	if (this->realtime && this->is_started && this->get_played_frames() > this->num_written_frames) {
+		// The endpoint restarts from the frames that are being written now
+		this->num_played_frames = this->num_written_frames;
+		this->start_time = std::chrono::steady_clock::now();
+	}
+
+	this->num_written_frames += chunk_size / this->format.block_align;
+}
+
+void NullSink::start() {
+	this->start_time = std::chrono::steady_clock::now();
+	this->next_period_time = this->start_time + this->period;
+	this->is_started = true;
+}
+
+void NullSink::stop() {
+	uint64_t num_played_frames = this->get_played_frames();
+
+	this->num_played_frames = num_played_frames < this->num_written_frames ? num_played_frames : this->num_written_frames;
+	this->is_started = false;
+
+	std::lock_guard<std::mutex> lck(this->mtx);
+	this->cv.notify_all();
+}
+
+void NullSink::flush() {
+	// The frames that haven't been played are dropped
+	this->num_written_frames = this->num_played_frames;
+	this->is_refilled = false;
+}
+
+float NullSink::get_volume() {
+	return this->volume;
+}
+
+void NullSink::set_volume(float volume) {
+	this->volume = volume;
+}
+
+bool NullSink::set_stream_format(const AUDIO_FORMAT& format) {
+	// Takes the format of the stream, as it did when it was created
+	this->format = format;
+	this->buffer_size = std::max((uint32_t)(this->buffer_duration * format.sample_rate / 1000), 1u);
+	this->num_written_frames = 0;
+	this->num_played_frames = 0;
+
+	return true;
+}
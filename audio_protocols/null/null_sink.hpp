@@ -0,0 +1,63 @@
+#ifndef WASABI_NULL_SINK_HPP
+#define WASABI_NULL_SINK_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include "audio_sink.hpp"
+
+// Sink that discards the audio, either emulating an audio endpoint consuming it in real time or consuming it as fast as
+// it's written (to measure the throughput of the pipeline without a sound card)
+class NullSink : public AudioSink {
+private:
+	AUDIO_FORMAT format;
+	bool realtime;
+	float volume{1.0f};
+	bool is_started{};
+	uint64_t num_written_frames{};
+	uint64_t num_played_frames{};
+	std::chrono::steady_clock::time_point start_time;
+	double buffer_duration{};
+	uint32_t buffer_size{};
+	std::chrono::microseconds period{};
+	std::chrono::steady_clock::time_point next_period_time;
+	std::mutex mtx;
+	std::condition_variable cv;
+
+	uint64_t get_played_frames();
+
+public:
+	// Emulates an endpoint buffer of the given duration (in milliseconds)
+	NullSink(const AUDIO_FORMAT& format, bool is_realtime, double buffer_duration);
+
+	~NullSink() override;
+
+	uint64_t get_written_frames();
+
+	AUDIO_FORMAT get_format() override;
+
+	bool is_realtime() override;
+
+	uint32_t get_buffer_size() override;
+
+	uint32_t get_padding() override;
+
+	bool wait_for_refill(uint32_t timeout) override;
+
+	void write_chunk(const uint8_t* chunk, uint32_t chunk_size, bool stop) override;
+
+	void start() override;
+
+	void stop() override;
+
+	void flush() override;
+
+	float get_volume() override;
+
+	void set_volume(float volume) override;
+
+	bool set_stream_format(const AUDIO_FORMAT& format) override;
+};
+
+#endif //WASABI_NULL_SINK_HPP
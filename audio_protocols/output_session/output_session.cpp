@@ -0,0 +1,102 @@
+#include "output_session.hpp"
+#include <iostream>
+#include "file_sink.hpp"
+#include "null_sink.hpp"
+
+#ifdef _WIN32
+#include "wasapi.hpp"
+#endif
+
+OutputSession::OutputSession() = default;
+
+OutputSession::~OutputSession() {
+	this->close();
+}
+
+std::unique_ptr<AudioSink> OutputSession::create_sink(const OUTPUT_SESSION_CONFIG &config) {
+	switch (config.sink_type) {
+	case SINK_WASAPI: {
+#ifdef _WIN32
+		std::unique_ptr<WASAPI> wasapi(new WASAPI(config.rendering_endpoint_buffer_duration, config.stream_format,
+			config.is_exclusive));
+
+		if (!wasapi->is_open()) {
+			return nullptr;
+		}
+
+		return std::unique_ptr<AudioSink>(wasapi.release());
+#else
+		std::cerr << "ERROR: The WASAPI sink is only available on Windows." << std::endl;
+
+		return nullptr;
+#endif
+	}
+	case SINK_NULL:
+		return std::unique_ptr<AudioSink>(new NullSink(config.stream_format, true,
+			config.rendering_endpoint_buffer_duration));
+	case SINK_NULL_UNTHROTTLED:
+		return std::unique_ptr<AudioSink>(new NullSink(config.stream_format, false,
+			config.rendering_endpoint_buffer_duration));
+	case SINK_WAV_FILE:
+	case SINK_RAW_FILE: {
+		std::unique_ptr<FileSink> file_sink(new FileSink(config.output_file_path, config.stream_format,
+			config.sink_type == SINK_RAW_FILE));
+
+		if (!file_sink->is_open()) {
+			return nullptr;
+		}
+
+		return std::unique_ptr<AudioSink>(file_sink.release());
+	}
+	}
+
+	return nullptr;
+}
+
+AudioSink *OutputSession::open(const OUTPUT_SESSION_CONFIG &config) {
+	bool is_reusable = this->sink != nullptr && config.sink_type == this->config.sink_type &&
+		config.rendering_endpoint_buffer_duration == this->config.rendering_endpoint_buffer_duration &&
+		config.is_exclusive == this->config.is_exclusive &&
+		config.sink_type != SINK_WAV_FILE && config.sink_type != SINK_RAW_FILE;
+
+	if (is_reusable) {
+		// Leaves the sink as a new one would be, then only renegotiates its format if the stream format has changed
+		this->sink->stop();
+		this->sink->flush();
+		this->sink->reset_statistics();
+
+		if (is_same_audio_format(config.stream_format, this->config.stream_format) ||
+			this->sink->set_stream_format(config.stream_format)) {
+			this->config = config;
+			this->num_reused_sinks += 1;
+
+			return this->sink.get();
+		}
+	}
+
+	// Releases the previous sink first, a device may not be opened twice
+	this->close();
+
+	this->sink = this->create_sink(config);
+
+	if (this->sink == nullptr) {
+		return nullptr;
+	}
+
+	this->config = config;
+	this->num_opened_sinks += 1;
+
+	return this->sink.get();
+}
+
+void OutputSession::close() {
+	this->sink.reset();
+}
+
+uint64_t OutputSession::get_num_opened_sinks() {
+	return this->num_opened_sinks;
+}
+
+uint64_t OutputSession::get_num_reused_sinks() {
+	return this->num_reused_sinks;
+}
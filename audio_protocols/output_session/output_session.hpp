@@ -0,0 +1,67 @@
+#ifndef WASABI_OUTPUT_SESSION_HPP
+#define WASABI_OUTPUT_SESSION_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "audio_format.hpp"
+#include "audio_sink.hpp"
+
+enum SINK_TYPE {
+	SINK_WASAPI,
+	SINK_NULL,
+	SINK_NULL_UNTHROTTLED,
+	SINK_WAV_FILE,
+	SINK_RAW_FILE
+};
+
+#ifdef _WIN32
+#define DEFAULT_SINK_TYPE SINK_WASAPI
+#else
+#define DEFAULT_SINK_TYPE SINK_NULL
+#endif
+
+// Description of the sink a stream is rendered to
+typedef struct OUTPUT_SESSION_CONFIG {
+	SINK_TYPE sink_type{DEFAULT_SINK_TYPE};
+	std::string output_file_path{};
+	double rendering_endpoint_buffer_duration{1000.0}; // In milliseconds (the minimum device period when 0 in exclusive mode)
+	bool is_exclusive{};
+	AUDIO_FORMAT stream_format; // Format the stream would rather be rendered in (devices may impose their own)
+} OUTPUT_SESSION_CONFIG;
+
+// Long-lived owner of the audio sink, so it's reused across plays instead of being opened for each one. The device,
+// its negotiated format and its render client are kept while the sink type and buffer duration don't change, and the
+// sink is only asked to renegotiate its format when the stream format changes (file sinks, which write a new file
+// each time, are always recreated)
+class OutputSession {
+private:
+	std::unique_ptr<AudioSink> sink;
+	OUTPUT_SESSION_CONFIG config;
+	uint64_t num_opened_sinks{};
+	uint64_t num_reused_sinks{};
+
+	std::unique_ptr<AudioSink> create_sink(const OUTPUT_SESSION_CONFIG &config);
+
+public:
+	OutputSession();
+
+	OutputSession(OutputSession const &output_session) = delete;
+
+	OutputSession &operator=(OutputSession const &output_session) = delete;
+
+	~OutputSession();
+
+	// Gets a stopped and empty sink for the given configuration, returns nullptr (after printing the reason) if it
+	// can't be opened. The sink belongs to the session and stays valid until the next call
+	AudioSink *open(const OUTPUT_SESSION_CONFIG &config);
+
+	// Releases the sink (and the device it holds)
+	void close();
+
+	uint64_t get_num_opened_sinks();
+
+	uint64_t get_num_reused_sinks();
+};
+
+#endif //WASABI_OUTPUT_SESSION_HPP
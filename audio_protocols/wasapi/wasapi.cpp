@@ -1,190 +1,513 @@
 #include "wasapi.hpp"
+#include <algorithm>
 #include <comdef.h>
+#include <cstdio>
+#include "instrumentation.hpp"
 
 #undef KSDATAFORMAT_SUBTYPE_PCM
+#undef KSDATAFORMAT_SUBTYPE_IEEE_FLOAT
 #define SAFE_RELEASE(pointer) if ((pointer) != NULL) {(pointer)->Release(); (pointer) = NULL;}
 
-WASAPI::WASAPI(int buffer_duration) {
+WASAPI::WASAPI(double buffer_duration, const AUDIO_FORMAT& stream_format, bool is_exclusive) {
 	this->buffer_duration = buffer_duration;
+	this->is_exclusive = is_exclusive;
+	this->is_com_initialized = false;
 	this->output_device = nullptr;
-	this->format = (WAVEFORMATEX*)malloc(sizeof(WAVEFORMATEX));
+	this->format = WAVEFORMATEXTENSIBLE();
+	this->stream_format = stream_format;
 	this->audio_client = nullptr;
 	this->audio_render_client = nullptr;
 	this->audio_volume_interface = nullptr;
-
+	this->audio_clock = nullptr;
+	this->buffer_event = nullptr;
+	this->buffer_size = 0;
+	this->device_period = 0;
+	this->is_buffer_requested = true;
+	this->num_stream_frames = 0;
+
+	// The device is only looked up once, the audio client is activated again when the format is renegotiated
 	this->set_concurrency_mode();
-	this->get_default_audio_endpoint();
-	this->create_audio_client();
-	this->set_mix_format();
-	this->initialize_audio_client();
-	this->get_audio_render_client();
-	this->get_audio_volume_interface();
+
+	if (this->get_default_audio_endpoint()) {
+		this->open_audio_client();
+	}
 }
 
 WASAPI::~WASAPI() {
 	// Frees all allocated memory
+	this->release_audio_client();
+
 	SAFE_RELEASE(this->output_device);
-	SAFE_RELEASE(this->audio_client);
-	SAFE_RELEASE(this->audio_render_client);
-	SAFE_RELEASE(this->audio_volume_interface);
+
+	if (this->is_com_initialized) {
+		CoUninitialize();
+	}
 }
 
-void WASAPI::get_default_audio_endpoint() {
+bool WASAPI::get_default_audio_endpoint() {
 	// Creates and initializes a device enumerator object and gets a reference to the interface that will be used to communicate with that object
 	const CLSID CLSID_MMDeviceEnumerator = __uuidof(MMDeviceEnumerator);
 	const IID IID_IMMDeviceEnumerator = __uuidof(IMMDeviceEnumerator);
 
-	IMMDeviceEnumerator* device_enumerator;
+	IMMDeviceEnumerator* device_enumerator = nullptr;
+
+	if (CoCreateInstance(CLSID_MMDeviceEnumerator, nullptr, CLSCTX_ALL, IID_IMMDeviceEnumerator,
+		(void**)&device_enumerator) != S_OK) {
+		std::cerr << "ERROR: Unable to create the audio device enumerator." << std::endl;
 
-	CoCreateInstance(CLSID_MMDeviceEnumerator, nullptr, CLSCTX_ALL, IID_IMMDeviceEnumerator,
-		(void**)&device_enumerator);
+		return false;
+	}
 
 	// Gets the reference to interface of the default audio endpoint
-	device_enumerator->GetDefaultAudioEndpoint(eRender, eMultimedia, &this->output_device);
+	HRESULT result = device_enumerator->GetDefaultAudioEndpoint(eRender, eMultimedia, &this->output_device);
 
 	// Frees allocated memory
 	SAFE_RELEASE(device_enumerator);
+
+	if (result != S_OK) {
+		std::cerr << "ERROR: There is no default audio endpoint." << std::endl;
+
+		return false;
+	}
+
+	return true;
 }
 
 void WASAPI::set_concurrency_mode() {
-	// Initializes the COM library for use by the calling thread and sets the thread's concurrency model
+	// Initializes the COM library for use by the calling thread and sets the thread's concurrency model (it must be
+	// uninitialized as many times as it was successfully initialized)
 	DWORD concurrency_model = COINIT_MULTITHREADED;
 
-	CoInitializeEx(nullptr, concurrency_model);
+	this->is_com_initialized = SUCCEEDED(CoInitializeEx(nullptr, concurrency_model));
 }
 
-void WASAPI::create_audio_client() {
+bool WASAPI::open_audio_client() {
+	if (!this->create_audio_client() || !this->set_mix_format() || !this->initialize_audio_client() ||
+		!this->get_audio_render_client() || !this->get_audio_volume_interface() ||
+		this->audio_client->GetService(__uuidof(IAudioClock), (void**)&this->audio_clock) != S_OK) {
+		this->release_audio_client();
+
+		return false;
+	}
+
+	return true;
+}
+
+void WASAPI::release_audio_client() {
+	// Frees the interfaces that depend on the negotiated format
+	SAFE_RELEASE(this->audio_render_client);
+	SAFE_RELEASE(this->audio_volume_interface);
+	SAFE_RELEASE(this->audio_clock);
+	SAFE_RELEASE(this->audio_client);
+
+	if (this->buffer_event != nullptr) {
+		CloseHandle(this->buffer_event);
+
+		this->buffer_event = nullptr;
+	}
+
+	this->buffer_size = 0;
+	this->is_buffer_requested = true;
+	this->num_stream_frames = 0;
+}
+
+bool WASAPI::create_audio_client() {
 	// Creates a COM object of the default audio endpoint with the audio client interface activated
-	this->output_device->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr, (void**)&this->audio_client);
+	if (this->output_device->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr, (void**)&this->audio_client) != S_OK) {
+		std::cerr << "ERROR: Unable to activate the audio client." << std::endl;
+
+		return false;
+	}
+
+	return true;
 }
 
-void WASAPI::find_best_mix_format(int& sample_rate, int& num_channels, int& bit_depth) {
-	// Gets the audio format used by the audio client interface (mmsys.cpl -> audio endpoint properties -> advanced options)
+static uint32_t get_channel_mask(const WAVEFORMATEX* format) {
+	// Only the extensible format describes the speaker positions
+	if (format->wFormatTag == WAVE_FORMAT_EXTENSIBLE && ((const WAVEFORMATEXTENSIBLE*)format)->dwChannelMask != 0) {
+		return ((const WAVEFORMATEXTENSIBLE*)format)->dwChannelMask;
+	}
+
+	return get_default_channel_mask(format->nChannels);
+}
+
+static bool is_float_format(const WAVEFORMATEX* format) {
+	const GUID KSDATAFORMAT_SUBTYPE_IEEE_FLOAT = { 0x00000003, 0x0000, 0x0010,
+												  {0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71} };
+
+	if (format->wFormatTag == WAVE_FORMAT_EXTENSIBLE) {
+		return IsEqualGUID(((const WAVEFORMATEXTENSIBLE*)format)->SubFormat, KSDATAFORMAT_SUBTYPE_IEEE_FLOAT);
+	}
 
-	// TODO
+	return format->wFormatTag == WAVE_FORMAT_IEEE_FLOAT;
+}
 
-	sample_rate = 48000;
-	num_channels = 2;
-	bit_depth = 16;
+static AUDIO_FORMAT get_audio_format(const WAVEFORMATEX* format) {
+	return make_audio_format(format->nSamplesPerSec, format->nChannels, format->wBitsPerSample, is_float_format(format),
+		get_channel_mask(format));
 }
 
-void WASAPI::set_mix_format() {
+static WAVEFORMATEXTENSIBLE get_wave_format(const AUDIO_FORMAT& format) {
 	const GUID KSDATAFORMAT_SUBTYPE_PCM = { 0x00000001, 0x0000, 0x0010,
 										   {0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71} };
+	const GUID KSDATAFORMAT_SUBTYPE_IEEE_FLOAT = { 0x00000003, 0x0000, 0x0010,
+												  {0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71} };
+
+	// Describes the format with the extensible structure, so the speaker positions are kept
+	WAVEFORMATEXTENSIBLE wave_format;
+
+	wave_format.Format.wFormatTag = WAVE_FORMAT_EXTENSIBLE;
+	wave_format.Format.nSamplesPerSec = format.sample_rate;
+	wave_format.Format.nChannels = format.num_channels;
+	wave_format.Format.wBitsPerSample = format.bit_depth;
+	wave_format.Format.nBlockAlign = format.block_align;
+	wave_format.Format.nAvgBytesPerSec = format.byte_rate;
+	wave_format.Format.cbSize = sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX);
+	wave_format.Samples.wValidBitsPerSample = format.bit_depth;
+	wave_format.SubFormat = format.is_float ? KSDATAFORMAT_SUBTYPE_IEEE_FLOAT : KSDATAFORMAT_SUBTYPE_PCM;
+	wave_format.dwChannelMask = format.channel_mask;
+
+	return wave_format;
+}
+
+AUDIO_FORMAT WASAPI::find_best_mix_format() {
+	// Gets the audio format used by the audio client interface (mmsys.cpl -> audio endpoint properties -> advanced options)
+	WAVEFORMATEX* device_format = nullptr;
 
-	//
-	int sample_rate;
-	int num_channels;
-	int bit_depth;
+	if (this->audio_client->GetMixFormat(&device_format) != S_OK) {
+		std::cout << "WARNING: Unable to get the mix format of the audio endpoint, a default one will be tried instead."
+			<< std::endl;
+
+		return make_audio_format(48000, 2, 16);
+	}
 
-	this->find_best_mix_format(sample_rate, num_channels, bit_depth);
+	AUDIO_FORMAT mix_format = get_audio_format(device_format);
+
+	// Frees allocated memory
+	CoTaskMemFree(device_format);
 
-	//
-	WAVEFORMATEXTENSIBLE mix_format;
+	return mix_format;
+}
 
-	mix_format.Format.wFormatTag = WAVE_FORMAT_EXTENSIBLE;
-	mix_format.Format.nSamplesPerSec = sample_rate;
-	mix_format.Format.nChannels = num_channels;
-	mix_format.Format.wBitsPerSample = bit_depth;
-	mix_format.Format.nBlockAlign = (num_channels * bit_depth) / 8;
-	mix_format.Format.nAvgBytesPerSec = sample_rate * mix_format.Format.nBlockAlign;
-	mix_format.Format.cbSize = sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX);
-	mix_format.Samples.wValidBitsPerSample = bit_depth;
-	mix_format.SubFormat = KSDATAFORMAT_SUBTYPE_PCM;
-	mix_format.dwChannelMask = KSAUDIO_SPEAKER_STEREO;
+bool WASAPI::set_mix_format() {
+	AUDCLNT_SHAREMODE share_mode = this->is_exclusive ? AUDCLNT_SHAREMODE_EXCLUSIVE : AUDCLNT_SHAREMODE_SHARED;
 
 	std::cout << "[Checking supported mix format]" << std::endl;
 
+	// Renders the stream untouched when the endpoint accepts its format
+	if (this->stream_format.sample_rate != 0) {
+		WAVEFORMATEXTENSIBLE wave_format = get_wave_format(this->stream_format);
+		WAVEFORMATEX* closest_format = nullptr;
+
+		HRESULT result = this->audio_client->IsFormatSupported(share_mode, (WAVEFORMATEX*)&wave_format,
+			this->is_exclusive ? nullptr : &closest_format);
+
+		CoTaskMemFree(closest_format);
+
+		if (result == S_OK) {
+			std::cout << "\nThe format of the stream is supported!" << std::endl;
+
+			this->format = wave_format;
+			this->device_format = this->stream_format;
+
+			return true;
+		}
+	}
+
+	// Otherwise the stream is converted to the format the endpoint mixes in before being written
+	AUDIO_FORMAT mix_format = this->find_best_mix_format();
+
+	if (this->is_exclusive) {
+		// Exclusive mode doesn't suggest a closest match, so the usual device formats are tried at the mix rate and
+		// layout (starting with the mix format itself)
+		AUDIO_FORMAT candidate_formats[] = {
+			mix_format,
+			make_audio_format(mix_format.sample_rate, mix_format.num_channels, 32, true, mix_format.channel_mask),
+			make_audio_format(mix_format.sample_rate, mix_format.num_channels, 32, false, mix_format.channel_mask),
+			make_audio_format(mix_format.sample_rate, mix_format.num_channels, 24, false, mix_format.channel_mask),
+			make_audio_format(mix_format.sample_rate, mix_format.num_channels, 16, false, mix_format.channel_mask)
+		};
+
+		for (const AUDIO_FORMAT& candidate_format : candidate_formats) {
+			WAVEFORMATEXTENSIBLE wave_format = get_wave_format(candidate_format);
+
+			if (this->audio_client->IsFormatSupported(AUDCLNT_SHAREMODE_EXCLUSIVE, (WAVEFORMATEX*)&wave_format,
+				nullptr) == S_OK) {
+				std::cout << "\nThe format is supported in exclusive mode (" << candidate_format.bit_depth << " bits"
+					<< (candidate_format.is_float ? " float" : "") << ")!" << std::endl;
+
+				this->format = wave_format;
+				this->device_format = candidate_format;
+
+				return true;
+			}
+		}
+
+		std::cerr << "ERROR: Unable to establish a format supported in exclusive mode." << std::endl;
+
+		return false;
+	}
+
+	WAVEFORMATEXTENSIBLE wave_format = get_wave_format(mix_format);
 	WAVEFORMATEX* closest_format = nullptr;
 
-	HRESULT result = this->audio_client->IsFormatSupported(AUDCLNT_SHAREMODE_SHARED, (WAVEFORMATEX*)&mix_format,
+	HRESULT result = this->audio_client->IsFormatSupported(AUDCLNT_SHAREMODE_SHARED, (WAVEFORMATEX*)&wave_format,
 		&closest_format);
 
 	if (result == S_OK) {
 		std::cout << "\nThe mix format is supported!" << std::endl;
 
-		this->format->wFormatTag = WAVE_FORMAT_PCM;
-		this->format->nSamplesPerSec = mix_format.Format.nSamplesPerSec;
-		this->format->nChannels = mix_format.Format.nChannels;
-		this->format->wBitsPerSample = mix_format.Format.wBitsPerSample;
-		this->format->nBlockAlign = (mix_format.Format.nChannels * mix_format.Format.wBitsPerSample) / 8;
-		this->format->nAvgBytesPerSec = mix_format.Format.nSamplesPerSec * mix_format.Format.nBlockAlign;
-		this->format->cbSize = 0;
+		this->format = wave_format;
+		this->device_format = mix_format;
 	}
-	else if (result == S_FALSE) {
+	else if (result == S_FALSE && closest_format != nullptr) {
 		std::cout
 			<< "WARNING: The requested mix format is not supported, a closest match will be tried instead (it may not work)."
 			<< std::endl;
 
-		this->format->wFormatTag = WAVE_FORMAT_PCM;
-		this->format->nSamplesPerSec = closest_format->nSamplesPerSec;
-		this->format->nChannels = closest_format->nChannels;
-		this->format->wBitsPerSample = closest_format->wBitsPerSample;
-		this->format->nBlockAlign = (closest_format->nChannels * closest_format->wBitsPerSample) / 8;
-		this->format->nAvgBytesPerSec = closest_format->nSamplesPerSec * closest_format->nBlockAlign;
-		this->format->cbSize = 0;
+		this->device_format = get_audio_format(closest_format);
+		this->format = get_wave_format(this->device_format);
 	}
 	else {
 		std::cerr << "ERROR: Unable to establish a supported mix format." << std::endl;
 
-		exit(EXIT_FAILURE);
+		CoTaskMemFree(closest_format);
+
+		return false;
 	}
 
 	// Frees allocated memory
 	CoTaskMemFree(closest_format);
+
+	return true;
 }
 
-void WASAPI::initialize_audio_client() {
-	const int REFTIMES_PER_SEC = 10000000;
-	REFERENCE_TIME req_duration = this->buffer_duration * REFTIMES_PER_SEC;
+bool WASAPI::initialize_audio_client() {
+	const double REFTIMES_PER_MILLISEC = 10000.0;
+	REFERENCE_TIME req_duration = (REFERENCE_TIME)(this->buffer_duration * REFTIMES_PER_MILLISEC + 0.5);
+	REFERENCE_TIME default_period = 0;
+	REFERENCE_TIME minimum_period = 0;
+	HRESULT result;
+
+	this->audio_client->GetDevicePeriod(&default_period, &minimum_period);
+
+	printf("Device period: %.3f ms (minimum %.3f ms)\n", default_period / REFTIMES_PER_MILLISEC,
+		minimum_period / REFTIMES_PER_MILLISEC);
+
+	// Initializes the audio client interface in event-driven mode, so the endpoint signals when it needs more frames
+	if (this->is_exclusive) {
+		// The buffer is a single period (the endpoint alternates between two of them), which must match the requested
+		// duration in exclusive event-driven mode
+		this->device_period = std::max(req_duration, minimum_period);
+
+		result = this->audio_client->Initialize(AUDCLNT_SHAREMODE_EXCLUSIVE, AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+			this->device_period, this->device_period, (WAVEFORMATEX*)&this->format, nullptr);
+
+		if (result == AUDCLNT_E_BUFFER_SIZE_NOT_ALIGNED) {
+			// Retries with the period rounded to the buffer size the device aligned it to (the audio client must be
+			// activated again after a failed initialization)
+			uint32_t aligned_buffer_size = 0;
+
+			this->audio_client->GetBufferSize(&aligned_buffer_size);
+			this->device_period = (REFERENCE_TIME)(REFTIMES_PER_MILLISEC * 1000.0 * aligned_buffer_size /
+				this->format.Format.nSamplesPerSec + 0.5);
+
+			SAFE_RELEASE(this->audio_client);
+
+			if (!this->create_audio_client()) {
+				return false;
+			}
+
+			result = this->audio_client->Initialize(AUDCLNT_SHAREMODE_EXCLUSIVE, AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+				this->device_period, this->device_period, (WAVEFORMATEX*)&this->format, nullptr);
+		}
+
+		if (result == S_OK) {
+			printf("Exclusive mode: %.3f ms period\n", this->device_period / REFTIMES_PER_MILLISEC);
+		}
+	}
+	else {
+		this->device_period = default_period;
 
-	// Initializes the audio client interface
-	HRESULT result = this->audio_client->Initialize(AUDCLNT_SHAREMODE_SHARED, 0, req_duration, 0, this->format, nullptr);
+		result = this->audio_client->Initialize(AUDCLNT_SHAREMODE_SHARED, AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+			req_duration, 0, (WAVEFORMATEX*)&this->format, nullptr);
+	}
 
 	if (result != S_OK) {
 		std::cerr << "ERROR: Unable to initialize audio client." << std::endl;
 
-		exit(EXIT_FAILURE);
+		return false;
 	}
+
+	// Registers the event the endpoint will signal each time a device period has been consumed
+	this->buffer_event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	this->audio_client->SetEventHandle(this->buffer_event);
+
+	// Gets the size of the rendering endpoint buffer (in frames)
+	this->audio_client->GetBufferSize(&this->buffer_size);
+
+	return true;
 }
 
-void WASAPI::get_audio_render_client() {
+bool WASAPI::get_audio_render_client() {
 	// Gets a reference to the audio render client interface of the audio client
-	this->audio_client->GetService(__uuidof(IAudioRenderClient), (void**)&this->audio_render_client);
+	return this->audio_client->GetService(__uuidof(IAudioRenderClient), (void**)&this->audio_render_client) == S_OK;
 }
 
-void WASAPI::write_chunk(BYTE* chunk, uint32_t chunk_size, bool stop) {
-	// Declares rendering endpoint buffer flags
-	DWORD buffer_flags = 0;
+bool WASAPI::is_open() {
+	return this->audio_render_client != nullptr;
+}
 
-	// Gets the number of audio frames available in the rendering endpoint buffer
-	uint32_t num_buffer_frames;
+AUDIO_FORMAT WASAPI::get_format() {
+	return this->device_format;
+}
+
+bool WASAPI::is_realtime() {
+	return true;
+}
 
-	this->audio_client->GetBufferSize(&num_buffer_frames);
+uint32_t WASAPI::get_buffer_size() {
+	return this->buffer_size;
+}
 
+uint32_t WASAPI::query_padding() {
 	// Gets the amount of valid data that is currently stored in the buffer but hasn't been read yet
-	uint32_t num_padding_frames;
+	uint32_t num_padding_frames = 0;
 
 	this->audio_client->GetCurrentPadding(&num_padding_frames);
 
-	// Gets the amount of available space in the buffer
-	num_buffer_frames -= num_padding_frames;
+	return num_padding_frames;
+}
+
+uint32_t WASAPI::get_padding() {
+	// In exclusive mode the whole buffer is written each time the endpoint asks for it, so it's either empty or full
+	if (this->is_exclusive) {
+		return this->is_buffer_requested ? 0 : this->buffer_size;
+	}
+
+	return this->query_padding();
+}
+
+bool WASAPI::wait_for_refill(uint32_t timeout) {
+	if (WaitForSingleObject(this->buffer_event, timeout) != WAIT_OBJECT_0) {
+		return false;
+	}
+
+	this->is_buffer_requested = true;
+
+	return true;
+}
+
+void WASAPI::write_chunk(const uint8_t* chunk, uint32_t chunk_size, bool stop) {
+	// Gets the number of frames held by the chunk
+	uint32_t num_chunk_frames = chunk_size / this->format.Format.nBlockAlign;
+	uint32_t num_free_frames = this->buffer_size - this->get_padding();
+
+	if (num_chunk_frames > num_free_frames) {
+		// Drops the frames that don't fit in the rendering endpoint buffer
+		this->statistics.num_overruns += 1;
+
+		num_chunk_frames = num_free_frames;
+	}
+
+	if (num_chunk_frames == 0) {
+		return;
+	}
 
 	// Retrieves a pointer to the next available memory space in the rendering endpoint buffer
 	BYTE* buffer;
 
-	this->audio_render_client->GetBuffer(num_buffer_frames, &buffer);
+	if (this->audio_render_client->GetBuffer(num_chunk_frames, &buffer) != S_OK) {
+		this->statistics.num_overruns += 1;
 
-	//
-	memcpy(buffer, chunk, chunk_size);
-	free(chunk);
-	this->audio_client->GetCurrentPadding(&num_padding_frames);
+		return;
+	}
+
+	// Copies the chunk straight into the rendering endpoint buffer (the chunk is owned by the caller)
+	memcpy(buffer, chunk, num_chunk_frames * this->format.Format.nBlockAlign);
+
+	this->audio_render_client->ReleaseBuffer(num_chunk_frames, 0);
+	this->statistics.num_written_frames += num_chunk_frames;
+}
+
+uint32_t WASAPI::refill(AudioSource& source, bool& is_eof) {
+	AUDIO_CHUNK chunk;
+	uint32_t block_align = this->format.Format.nBlockAlign;
+
+	is_eof = false;
+
+	// Gets the amount of available space in the buffer
+	uint32_t num_padding_frames = this->get_padding();
+	uint32_t num_free_frames = this->buffer_size - num_padding_frames;
+
+	// An empty buffer at refill time means the endpoint has already been starved (in exclusive mode, the endpoint
+	// still holds the other half of its double buffer when it asks for one)
+	if (this->is_refilled && num_free_frames > 0 && this->query_padding() == 0) {
+		this->statistics.num_underruns += 1;
+
+		record_trace_event(TRACE_UNDERRUN, num_padding_frames);
+	}
+
+	if (num_free_frames == 0) {
+		return 0;
+	}
+
+	// Retrieves a pointer to the whole free space of the rendering endpoint buffer
+	BYTE* buffer;
+
+	if (this->audio_render_client->GetBuffer(num_free_frames, &buffer) != S_OK) {
+		this->statistics.num_overruns += 1;
+
+		return 0;
+	}
+
+	// Copies the borrowed chunks straight into the endpoint buffer until it is full, whatever their size (the source may
+	// split them at its wrap-around or run out of data)
+	uint32_t num_free_bytes = num_free_frames * block_align;
+	uint32_t num_written_bytes = 0;
+
+	while (num_written_bytes < num_free_bytes && !is_eof) {
+		is_eof = source.get_chunk(chunk, num_free_bytes - num_written_bytes);
 
-	if (stop) {
-		buffer_flags = AUDCLNT_BUFFERFLAGS_SILENT;
+		uint64_t write_start_time = begin_trace_span();
+
+		uint32_t chunk_size = chunk.size;
+
+		memcpy(buffer + num_written_bytes, chunk.data, chunk_size);
+		num_written_bytes += chunk_size;
+
+		end_trace_span(TRACE_WRITE, write_start_time, chunk_size);
+
+		source.release_chunk(chunk);
+
+		// Leaves the rest of the buffer to the next refill when the source has nothing ready
+		if (chunk_size == 0 && !is_eof) {
+			break;
+		}
 	}
 
-	this->audio_render_client->ReleaseBuffer(num_buffer_frames, buffer_flags);
+	// Completes a trailing partial frame with silence, and only releases the frames that were actually written (the
+	// whole buffer in exclusive mode, the rest of it being silent)
+	uint32_t num_written_frames = (num_written_bytes + block_align - 1) / block_align;
+
+	if (this->is_exclusive) {
+		num_written_frames = num_free_frames;
+	}
+
+	memset(buffer + num_written_bytes, this->format.Format.wBitsPerSample == 8 ? 0x80 : 0,
+		num_written_frames * block_align - num_written_bytes);
+
+	this->audio_render_client->ReleaseBuffer(num_written_frames, 0);
+
+	this->is_buffer_requested = false;
+	this->num_stream_frames += num_written_frames;
+
+	this->statistics.num_written_frames += num_written_frames;
+	this->statistics.num_refills += 1;
+	// A refill the source had nothing ready for leaves the endpoint as it was (empty before the first frames)
+	this->is_refilled = this->is_refilled || num_written_bytes > 0;
+
+	return num_written_frames;
 }
 
 void WASAPI::start() {
@@ -195,9 +518,17 @@ void WASAPI::stop() {
 	this->audio_client->Stop();
 }
 
-void WASAPI::get_audio_volume_interface() {
+void WASAPI::flush() {
+	// Empties the endpoint buffer, the next refill must not count the empty buffer as an underrun
+	this->audio_client->Reset();
+	this->is_refilled = false;
+	this->is_buffer_requested = true;
+	this->num_stream_frames = 0;
+}
+
+bool WASAPI::get_audio_volume_interface() {
 	// Gets a reference to the session volume control interface of the audio client
-	this->audio_client->GetService(__uuidof(ISimpleAudioVolume), (void**)&this->audio_volume_interface);
+	return this->audio_client->GetService(__uuidof(ISimpleAudioVolume), (void**)&this->audio_volume_interface) == S_OK;
 }
 
 float WASAPI::get_volume() {
@@ -212,4 +543,41 @@ float WASAPI::get_volume() {
 void WASAPI::set_volume(float volume) {
 	// Sets the session master volume of the audio client
 	this->audio_volume_interface->SetMasterVolume(volume, nullptr);
+}
+
+double WASAPI::get_output_latency() {
+	// Measures how far the device clock lags behind the frames written, plus the latency of the stream itself (the
+	// clock position is reset along with the stream)
+	UINT64 clock_frequency = 0;
+	UINT64 clock_position = 0;
+	REFERENCE_TIME stream_latency = 0;
+
+	if (this->audio_clock->GetFrequency(&clock_frequency) != S_OK || clock_frequency == 0 ||
+		this->audio_clock->GetPosition(&clock_position, nullptr) != S_OK) {
+		return AudioSink::get_output_latency();
+	}
+
+	this->audio_client->GetStreamLatency(&stream_latency);
+
+	double written_time = (double)this->num_stream_frames / this->format.Format.nSamplesPerSec;
+	double played_time = (double)clock_position / clock_frequency;
+
+	return std::max(written_time - played_time, 0.0) + stream_latency / 10000000.0;
+}
+
+bool WASAPI::set_stream_format(const AUDIO_FORMAT& format) {
+	this->stream_format = format;
+
+	// Keeps the device, and its volume, across the new audio client
+	float volume = this->is_open() ? this->get_volume() : 1.0f;
+
+	this->release_audio_client();
+
+	if (!this->open_audio_client()) {
+		return false;
+	}
+
+	this->set_volume(volume);
+
+	return true;
 }
\ No newline at end of file
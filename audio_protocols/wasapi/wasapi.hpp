@@ -5,47 +5,92 @@
 #include <mmdeviceapi.h>
 #include <audioclient.h>
 #include <cstdint>
+#include "audio_sink.hpp"
 
-class WASAPI {
+class WASAPI : public AudioSink {
 private:
+	bool is_com_initialized;
 	IMMDevice* output_device;
-	WAVEFORMATEX* format;
+	WAVEFORMATEXTENSIBLE format;
+	AUDIO_FORMAT device_format;
+	AUDIO_FORMAT stream_format;
 	IAudioClient* audio_client;
 	IAudioRenderClient* audio_render_client;
 	ISimpleAudioVolume* audio_volume_interface;
+	IAudioClock* audio_clock;
+	HANDLE buffer_event;
+	uint32_t buffer_size;
+	bool is_exclusive;
+	REFERENCE_TIME device_period;
+	// Whether the endpoint has asked for a whole buffer (exclusive mode buffers are always written whole)
+	bool is_buffer_requested;
+	// Frames written since the stream was started or reset, compared to the position of the device clock
+	uint64_t num_stream_frames;
 
 	void set_concurrency_mode();
 
-	void get_default_audio_endpoint();
+	bool get_default_audio_endpoint();
 
-	void create_audio_client();
+	bool open_audio_client();
 
-	void find_best_mix_format(int& sample_rate, int& num_channels, int& bit_depth);
+	void release_audio_client();
 
-	void set_mix_format();
+	bool create_audio_client();
 
-	void initialize_audio_client();
+	AUDIO_FORMAT find_best_mix_format();
 
-	void get_audio_render_client();
+	bool set_mix_format();
 
-	void get_audio_volume_interface();
+	bool initialize_audio_client();
+
+	bool get_audio_render_client();
+
+	bool get_audio_volume_interface();
+
+	uint32_t query_padding();
 
 public:
-	WASAPI(int rendering_endpoint_buffer_duration);
+	// Opens the default endpoint with a buffer of the given duration (in milliseconds). In exclusive mode the stream
+	// bypasses the shared mode mixer, and the buffer is a device period (the minimum one unless a longer duration is
+	// requested) double buffered by the endpoint
+	WASAPI(double rendering_endpoint_buffer_duration, const AUDIO_FORMAT& stream_format, bool is_exclusive = false);
+
+	~WASAPI() override;
+
+	double buffer_duration;
+
+	// Returns whether the endpoint was opened (the reason was printed otherwise)
+	bool is_open();
+
+	AUDIO_FORMAT get_format() override;
+
+	bool is_realtime() override;
+
+	uint32_t get_buffer_size() override;
+
+	uint32_t get_padding() override;
+
+	bool wait_for_refill(uint32_t timeout) override;
+
+	void write_chunk(const uint8_t* chunk, uint32_t chunk_size, bool stop) override;
+
+	uint32_t refill(AudioSource& source, bool& is_eof) override;
 
-	~WASAPI();
+	void start() override;
 
-	int buffer_duration;
+	void stop() override;
 
-	void write_chunk(BYTE* chunk, uint32_t chunk_size, bool stop);
+	void flush() override;
 
-	void start();
+	float get_volume() override;
 
-	void stop();
+	void set_volume(float volume) override;
 
-	float get_volume();
+	double get_output_latency() override;
 
-	void set_volume(float volume);
+	// Renegotiates the format with the endpoint already opened (the audio client can only be initialized once, so it's
+	// activated again, but the device and the COM library are kept)
+	bool set_stream_format(const AUDIO_FORMAT& format) override;
 };
 
 
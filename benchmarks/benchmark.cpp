@@ -0,0 +1,90 @@
+#include "benchmark.hpp"
+#include <algorithm>
+#include <cstdio>
+
+// File the results are written to as JSON lines (none when null)
+static FILE *results_file = nullptr;
+
+static std::string get_channels_name(uint16_t num_channels) {
+	switch (num_channels) {
+		case 1:
+			return "mono";
+		case 2:
+			return "stereo";
+		case 6:
+			return "5.1";
+		case 8:
+			return "7.1";
+		default:
+			return std::to_string(num_channels) + "ch";
+	}
+}
+
+static std::string get_sample_type_name(uint16_t bit_depth, bool is_float) {
+	// 8 bits samples are unsigned in WAV files
+	return (is_float ? "f" : bit_depth == 8 ? "u" : "s") + std::to_string(bit_depth);
+}
+
+std::vector<BENCHMARK_FORMAT> get_benchmark_formats(const BENCHMARK_OPTIONS &options,
+	const std::vector<BENCHMARK_FORMAT> &default_formats) {
+	if (options.channel_counts.empty() && options.sample_types.empty()) {
+		return default_formats;
+	}
+
+	std::vector<uint16_t> channel_counts = options.channel_counts.empty() ? std::vector<uint16_t>{2} :
+		options.channel_counts;
+	std::vector<BENCHMARK_FORMAT> sample_types = options.sample_types;
+	std::vector<BENCHMARK_FORMAT> formats;
+
+	if (sample_types.empty()) {
+		sample_types = {{"", 0, 16, false}, {"", 0, 24, false}, {"", 0, 32, true}};
+	}
+
+	for (const BENCHMARK_FORMAT &sample_type : sample_types) {
+		for (uint16_t num_channels : channel_counts) {
+			formats.push_back({get_sample_type_name(sample_type.bit_depth, sample_type.is_float) + " " +
+				get_channels_name(num_channels), num_channels, sample_type.bit_depth, sample_type.is_float});
+		}
+	}
+
+	return formats;
+}
+
+std::vector<uint16_t> get_benchmark_channel_counts(const BENCHMARK_OPTIONS &options) {
+	return options.channel_counts.empty() ? std::vector<uint16_t>{2} : options.channel_counts;
+}
+
+bool is_benchmark_sample_type(const BENCHMARK_OPTIONS &options, uint16_t bit_depth, bool is_float) {
+	return options.sample_types.empty() || std::any_of(options.sample_types.begin(), options.sample_types.end(),
+		[&](const BENCHMARK_FORMAT &sample_type) {
+			return sample_type.bit_depth == bit_depth && sample_type.is_float == is_float;
+		});
+}
+
+bool open_benchmark_results(const std::string &file_path) {
+	close_benchmark_results();
+
+	results_file = fopen(file_path.c_str(), "w");
+
+	return results_file != nullptr;
+}
+
+void close_benchmark_results() {
+	if (results_file != nullptr) {
+		fclose(results_file);
+		results_file = nullptr;
+	}
+}
+
+void record_benchmark_result(const char *benchmark, const char *name, SIMD_LEVEL level, uint16_t num_channels,
+	uint16_t bit_depth, bool is_float, const char *metric, double value) {
+	if (results_file == nullptr) {
+		return;
+	}
+
+	// The names are made by the benchmarks (no character needs escaping)
+	fprintf(results_file, "{\"benchmark\": \"%s\", \"name\": \"%s\", \"simd\": \"%s\", \"channels\": %u, "
+		"\"sample_type\": \"%s\", \"metric\": \"%s\", \"value\": %.6g}\n", benchmark, name, get_simd_level_name(level),
+		num_channels, get_sample_type_name(bit_depth, is_float).c_str(), metric, value);
+	fflush(results_file);
+}
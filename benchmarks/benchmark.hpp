@@ -0,0 +1,99 @@
+#ifndef WASABI_BENCHMARK_HPP
+#define WASABI_BENCHMARK_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "simd.hpp"
+
+// Minimum time (in seconds) each measured function is run for
+#define BENCHMARK_MIN_DURATION 0.25
+
+// Runs the function repeatedly for at least the given time and returns the fastest run (in seconds), which is the
+// least disturbed by the scheduler and the other processes
+template<typename FUNCTION>
+double measure_best_time(FUNCTION function, double min_duration = BENCHMARK_MIN_DURATION) {
+	double best_time = 1e30;
+	double total_time = 0.0;
+
+	// Warms up the caches and the branch predictors
+	function();
+
+	while (total_time < min_duration) {
+		auto start_time = std::chrono::steady_clock::now();
+
+		function();
+
+		double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+		best_time = time < best_time ? time : best_time;
+		total_time += time;
+	}
+
+	return best_time;
+}
+
+// Keeps the compiler from discarding the results of the measured functions
+inline void do_not_optimize(const void *data) {
+#if defined(__GNUC__)
+	__asm__ __volatile__("" : : "r"(data) : "memory");
+#else
+	static const void *volatile sink;
+
+	sink = data;
+#endif
+}
+
+// Channel count and sample type of the streams of a benchmark case
+typedef struct BENCHMARK_FORMAT {
+	std::string name;
+	uint16_t num_channels;
+	uint16_t bit_depth;
+	bool is_float;
+} BENCHMARK_FORMAT;
+
+// Settings of the benchmarks, from the command line
+typedef struct BENCHMARK_OPTIONS {
+	std::vector<uint16_t> channel_counts; // Empty for the channel counts of each benchmark
+	std::vector<BENCHMARK_FORMAT> sample_types; // Bit depths (channels unset), empty for the ones of each benchmark
+	std::vector<std::string> benchmark_names; // Empty to run them all
+	std::string work_directory; // Where the synthetic files are generated
+} BENCHMARK_OPTIONS;
+
+// Gets the formats a benchmark runs with: its own ones, unless channel counts or bit depths were given (the formats
+// are then every combination of them, stereo or 16/24 bits integers and 32 bits floats filling the one not given)
+std::vector<BENCHMARK_FORMAT> get_benchmark_formats(const BENCHMARK_OPTIONS &options,
+	const std::vector<BENCHMARK_FORMAT> &default_formats);
+
+// Gets the channel counts a benchmark of channel independent kernels reports per frame costs for
+std::vector<uint16_t> get_benchmark_channel_counts(const BENCHMARK_OPTIONS &options);
+
+// Gets whether a sample type was given on the command line (any sample type when none was)
+bool is_benchmark_sample_type(const BENCHMARK_OPTIONS &options, uint16_t bit_depth, bool is_float);
+
+// Opens the file every result is also written to as a line of JSON, so they can be tracked across releases
+bool open_benchmark_results(const std::string &file_path);
+
+void close_benchmark_results();
+
+// Writes a result to the results file (when one is open), the metric is its unit ("ns/frame", "MB/s"...)
+void record_benchmark_result(const char *benchmark, const char *name, SIMD_LEVEL level, uint16_t num_channels,
+	uint16_t bit_depth, bool is_float, const char *metric, double value);
+
+// Benchmarks of each processing stage
+void run_format_converter_benchmarks(const BENCHMARK_OPTIONS &options);
+
+void run_resampler_benchmarks(const BENCHMARK_OPTIONS &options);
+
+void run_mixer_benchmarks(const BENCHMARK_OPTIONS &options);
+
+void run_gain_stage_benchmarks(const BENCHMARK_OPTIONS &options);
+
+void run_meter_benchmarks(const BENCHMARK_OPTIONS &options);
+
+void run_flac_benchmarks(const BENCHMARK_OPTIONS &options);
+
+void run_wav_reader_benchmarks(const BENCHMARK_OPTIONS &options);
+
+#endif //WASABI_BENCHMARK_HPP
@@ -0,0 +1,76 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "benchmark.hpp"
+#include "flac_kernels.hpp"
+
+// Typical block size of FLAC streams, and number of blocks restored per run
+#define BENCHMARK_FLAC_BLOCK_SIZE 4096
+#define BENCHMARK_FLAC_NUM_BLOCKS 64
+
+// Shift of the measured predictors (the coefficients are 12 bits fractions)
+#define BENCHMARK_FLAC_LPC_SHIFT 12
+
+// Orders of the predictors picked by the usual compression levels (and the highest one)
+static const uint32_t LPC_ORDERS[] = {8, 12, 32};
+
+void run_flac_benchmarks(const BENCHMARK_OPTIONS &options) {
+	SIMD_LEVEL max_level = get_simd_level();
+	std::vector<int32_t> residuals((size_t)BENCHMARK_FLAC_BLOCK_SIZE * BENCHMARK_FLAC_NUM_BLOCKS);
+	std::vector<int32_t> samples(residuals.size());
+	int32_t coefficients[FLAC_MAX_LPC_ORDER];
+	uint32_t random_state = 1;
+	char name[32];
+
+	// Residuals of a 16 bits stream
+	for (int32_t &residual : residuals) {
+		random_state = random_state * 1664525u + 1013904223u;
+		residual = (int32_t)(random_state >> 16) - 32768;
+	}
+
+	// The sum of the absolute values of the coefficients stays below one, so the restored samples stay bounded
+	coefficients[0] = 3000;
+
+	for (uint32_t i = 1; i < FLAC_MAX_LPC_ORDER; i++) {
+		coefficients[i] = i % 2 != 0 ? 16 : -16;
+	}
+
+	printf("\n[FLAC LPC restoration, %d blocks of %d samples per run]\n", BENCHMARK_FLAC_NUM_BLOCKS,
+		BENCHMARK_FLAC_BLOCK_SIZE);
+
+	for (uint32_t order : LPC_ORDERS) {
+		for (int is_wide = 0; is_wide <= 1; is_wide++) {
+			double scalar_time = 0.0;
+
+			for (int level = SIMD_LEVEL_SCALAR; level <= max_level; level++) {
+				LPC_RESTORE_KERNEL restore = is_wide ? get_wide_lpc_restore_kernel((SIMD_LEVEL)level) :
+					get_lpc_restore_kernel((SIMD_LEVEL)level);
+
+				// The residuals are copied back before each run, as the kernels restore them in place
+				double time = measure_best_time([&]() {
+					memcpy(samples.data(), residuals.data(), residuals.size() * sizeof(int32_t));
+
+					for (size_t block = 0; block < BENCHMARK_FLAC_NUM_BLOCKS; block++) {
+						restore(samples.data() + block * BENCHMARK_FLAC_BLOCK_SIZE, BENCHMARK_FLAC_BLOCK_SIZE,
+							coefficients, order, BENCHMARK_FLAC_LPC_SHIFT);
+					}
+
+					do_not_optimize(samples.data());
+				});
+
+				scalar_time = level == SIMD_LEVEL_SCALAR ? time : scalar_time;
+
+				printf("  order %-2u %-6s %-8s %8.3f ns/sample %6.2fx\n", order, is_wide ? "wide" : "narrow",
+					get_simd_level_name((SIMD_LEVEL)level), time * 1e9 / residuals.size(), scalar_time / time);
+
+				// Each channel is a subframe of its own, the wide kernel restores the 24 bits streams
+				snprintf(name, sizeof(name), "order %u", order);
+
+				for (uint16_t num_channels : get_benchmark_channel_counts(options)) {
+					record_benchmark_result("flac", name, (SIMD_LEVEL)level, num_channels, is_wide ? 24 : 16, false,
+						"ns/frame", time * 1e9 / residuals.size() * num_channels);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,137 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "benchmark.hpp"
+#include "conversion_kernels.hpp"
+
+// Number of samples converted per run (fits in the L2 cache, so the kernels are measured rather than the memory)
+#define NUM_BENCHMARK_SAMPLES (1 << 16)
+
+typedef struct SAMPLE_FORMAT {
+	const char *name;
+	uint16_t bit_depth;
+	bool is_float;
+	bool is_dithered;
+	bool is_big_endian; // Only decoded (AIFF samples)
+} SAMPLE_FORMAT;
+
+static const SAMPLE_FORMAT SAMPLE_FORMATS[] = {
+	{"s16", 16, false, false, false},
+	{"s16+tpdf", 16, false, true, false},
+	{"s24", 24, false, false, false},
+	{"s24+tpdf", 24, false, true, false},
+	{"s32", 32, false, false, false},
+	{"f32", 32, true, false, false},
+	{"s16be", 16, false, false, true},
+	{"s24be", 24, false, false, true},
+	{"s32be", 32, false, false, true},
+	{"f32be", 32, true, false, true}
+};
+
+static TO_FLOAT_KERNEL get_benchmark_to_float_kernel(const SAMPLE_FORMAT &sample_format, SIMD_LEVEL level) {
+	if (sample_format.is_big_endian) {
+		return get_big_endian_to_float_kernel(sample_format.bit_depth, sample_format.is_float, level);
+	}
+
+	return get_to_float_kernel(sample_format.bit_depth, sample_format.is_float, level);
+}
+
+static void print_result(const BENCHMARK_OPTIONS &options, const SAMPLE_FORMAT &sample_format, const char *name,
+	SIMD_LEVEL level, double time, double scalar_time) {
+	double ns_per_sample = time * 1e9 / NUM_BENCHMARK_SAMPLES;
+
+	// One hour of 48 kHz stereo audio
+	double hour_time = ns_per_sample * 1e-9 * 48000.0 * 2.0 * 3600.0;
+
+	printf("  %-18s %-8s %8.3f ns/sample %8.2fx %10.1f ms/hour\n", name, get_simd_level_name(level), ns_per_sample,
+		scalar_time / time, hour_time * 1000.0);
+
+	// The kernels run on interleaved samples, so a frame costs as many samples as it has channels
+	for (uint16_t num_channels : get_benchmark_channel_counts(options)) {
+		record_benchmark_result("format_converter", name, level, num_channels, sample_format.bit_depth,
+			sample_format.is_float, "ns/frame", ns_per_sample * num_channels);
+	}
+}
+
+void run_format_converter_benchmarks(const BENCHMARK_OPTIONS &options) {
+	SIMD_LEVEL max_level = get_simd_level();
+	std::vector<uint8_t> samples(NUM_BENCHMARK_SAMPLES * 4);
+	std::vector<float> float_samples(NUM_BENCHMARK_SAMPLES);
+	DITHER_STATE dither_state;
+	char name[32];
+
+	// Fills the buffers with noise, the same input is used for every kernel
+	srand(1);
+
+	for (size_t i = 0; i < samples.size(); i++) {
+		samples[i] = (uint8_t)(rand() & 0xFF);
+	}
+
+	for (size_t i = 0; i < float_samples.size(); i++) {
+		float_samples[i] = ((float)rand() / RAND_MAX) * 2.0f - 1.0f;
+	}
+
+	initialize_dither_state(&dither_state, 1);
+
+	printf("\n[Sample format conversion, %d samples per run, best instruction set: %s]\n", NUM_BENCHMARK_SAMPLES,
+		get_simd_level_name(max_level));
+
+	for (const SAMPLE_FORMAT &sample_format : SAMPLE_FORMATS) {
+		double scalar_time = 0.0;
+
+		if (!is_benchmark_sample_type(options, sample_format.bit_depth, sample_format.is_float)) {
+			continue;
+		}
+
+		// Decoding to floats (dither only applies to the other direction)
+		if (!sample_format.is_dithered) {
+			snprintf(name, sizeof(name), "%s -> f32", sample_format.name);
+
+			for (int level = SIMD_LEVEL_SCALAR; level <= max_level; level++) {
+				TO_FLOAT_KERNEL kernel = get_benchmark_to_float_kernel(sample_format, (SIMD_LEVEL)level);
+
+				// Skips the instruction sets without a specific kernel (they would measure the fallback again)
+				if (level > SIMD_LEVEL_SCALAR && kernel == get_benchmark_to_float_kernel(sample_format, (SIMD_LEVEL)(level - 1))) {
+					continue;
+				}
+
+				double time = measure_best_time([&]() {
+					kernel(samples.data(), float_samples.data(), NUM_BENCHMARK_SAMPLES);
+					do_not_optimize(float_samples.data());
+				});
+
+				scalar_time = level == SIMD_LEVEL_SCALAR ? time : scalar_time;
+
+				print_result(options, sample_format, name, (SIMD_LEVEL)level, time, scalar_time);
+			}
+		}
+
+		// Encoding from floats (the float copy was already measured, big-endian samples are never written)
+		if (sample_format.is_float || sample_format.is_big_endian) {
+			continue;
+		}
+
+		snprintf(name, sizeof(name), "f32 -> %s", sample_format.name);
+
+		for (int level = SIMD_LEVEL_SCALAR; level <= max_level; level++) {
+			FROM_FLOAT_KERNEL kernel = get_from_float_kernel(sample_format.bit_depth, sample_format.is_float,
+				(SIMD_LEVEL)level);
+
+			if (level > SIMD_LEVEL_SCALAR &&
+				kernel == get_from_float_kernel(sample_format.bit_depth, sample_format.is_float, (SIMD_LEVEL)(level - 1))) {
+				continue;
+			}
+
+			DITHER_STATE *kernel_dither_state = sample_format.is_dithered ? &dither_state : nullptr;
+
+			double time = measure_best_time([&]() {
+				kernel(float_samples.data(), samples.data(), NUM_BENCHMARK_SAMPLES, kernel_dither_state);
+				do_not_optimize(samples.data());
+			});
+
+			scalar_time = level == SIMD_LEVEL_SCALAR ? time : scalar_time;
+
+			print_result(options, sample_format, name, (SIMD_LEVEL)level, time, scalar_time);
+		}
+	}
+}
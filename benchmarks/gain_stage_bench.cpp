@@ -0,0 +1,85 @@
+#include <cstdio>
+#include <vector>
+#include "benchmark.hpp"
+#include "gain_stage.hpp"
+#include "synthetic_source.hpp"
+
+// Sample rate of the scaled stream, one second of it is scaled per run
+#define BENCHMARK_GAIN_SAMPLE_RATE 48000
+
+typedef struct GAIN_FORMAT {
+	BENCHMARK_FORMAT format;
+	DITHER_TYPE dither_type;
+} GAIN_FORMAT;
+
+// Floats are scaled in place, integers go through floats (and dither)
+static const std::vector<GAIN_FORMAT> GAIN_FORMATS = {
+	{{"f32 stereo", 2, 32, true}, DITHER_NONE},
+	{{"f32 5.1", 6, 32, true}, DITHER_NONE},
+	{{"s16 stereo", 2, 16, false}, DITHER_NONE},
+	{{"s16+tpdf stereo", 2, 16, false}, DITHER_TPDF},
+	{{"s24 stereo", 2, 24, false}, DITHER_NONE}
+};
+
+void run_gain_stage_benchmarks(const BENCHMARK_OPTIONS &options) {
+	SIMD_LEVEL max_level = get_simd_level();
+	std::vector<GAIN_FORMAT> gain_formats = GAIN_FORMATS;
+
+	// The formats given on the command line are scaled without dither
+	if (!options.channel_counts.empty() || !options.sample_types.empty()) {
+		gain_formats.clear();
+
+		for (const BENCHMARK_FORMAT &format : get_benchmark_formats(options, {})) {
+			gain_formats.push_back({format, DITHER_NONE});
+		}
+	}
+
+	printf("\n[Gain stage, one second at %d Hz per run, constant gain and gain ramping over the whole run]\n",
+		BENCHMARK_GAIN_SAMPLE_RATE);
+
+	for (const GAIN_FORMAT &gain_format : gain_formats) {
+		for (int is_ramped = 0; is_ramped <= 1; is_ramped++) {
+			double scalar_time = 0.0;
+
+			for (int level = SIMD_LEVEL_SCALAR; level <= max_level; level++) {
+				// The kernels are picked when the stage is constructed
+				set_max_simd_level((SIMD_LEVEL)level);
+
+				AUDIO_FORMAT format = make_audio_format(BENCHMARK_GAIN_SAMPLE_RATE, gain_format.format.num_channels,
+					gain_format.format.bit_depth, gain_format.format.is_float);
+				SyntheticSource source(format, UINT64_MAX);
+				GainStage gain_stage(&source, gain_format.dither_type);
+				float gain = 0.5f;
+
+				double time = measure_best_time([&]() {
+					AUDIO_CHUNK chunk;
+
+					// Ramps back and forth, so every frame of the run is on a ramp
+					gain = gain == 0.5f ? 0.25f : 0.5f;
+					gain_stage.set_gain(gain, is_ramped ? BENCHMARK_GAIN_SAMPLE_RATE : 0);
+
+					for (uint32_t num_frames = 0; num_frames < BENCHMARK_GAIN_SAMPLE_RATE;) {
+						gain_stage.get_chunk(chunk, UINT32_MAX);
+						num_frames += chunk.size / format.block_align;
+						do_not_optimize(chunk.data);
+						gain_stage.release_chunk(chunk);
+					}
+				});
+
+				scalar_time = level == SIMD_LEVEL_SCALAR ? time : scalar_time;
+
+				printf("  %-16s %-9s %-8s %8.3f ns/frame %8.3f ms/s %6.2fx\n", gain_format.format.name.c_str(),
+					is_ramped ? "ramp" : "constant", get_simd_level_name((SIMD_LEVEL)level),
+					time * 1e9 / BENCHMARK_GAIN_SAMPLE_RATE, time * 1000.0, scalar_time / time);
+
+				std::string name = gain_format.format.name + (is_ramped ? " ramp" : " constant");
+
+				record_benchmark_result("gain_stage", name.c_str(), (SIMD_LEVEL)level, gain_format.format.num_channels,
+					gain_format.format.bit_depth, gain_format.format.is_float, "ns/frame",
+					time * 1e9 / BENCHMARK_GAIN_SAMPLE_RATE);
+			}
+
+			set_max_simd_level(max_level);
+		}
+	}
+}
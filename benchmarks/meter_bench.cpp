@@ -0,0 +1,62 @@
+#include <cstdio>
+#include <vector>
+#include "benchmark.hpp"
+#include "meter.hpp"
+#include "synthetic_source.hpp"
+
+// Sample rate of the measured stream, one second of it is measured per run
+#define BENCHMARK_METER_SAMPLE_RATE 48000
+
+// Floats are measured in place, integers are converted to floats first
+static const std::vector<BENCHMARK_FORMAT> METER_FORMATS = {
+	{"f32 stereo", 2, 32, true},
+	{"f32 5.1", 6, 32, true},
+	{"s16 stereo", 2, 16, false}
+};
+
+void run_meter_benchmarks(const BENCHMARK_OPTIONS &options) {
+	SIMD_LEVEL max_level = get_simd_level();
+
+	printf("\n[Meter (peak, RMS, K-weighted loudness), one second at %d Hz per run]\n", BENCHMARK_METER_SAMPLE_RATE);
+
+	for (const BENCHMARK_FORMAT &meter_format : get_benchmark_formats(options, METER_FORMATS)) {
+		double scalar_time = 0.0;
+
+		for (int level = SIMD_LEVEL_SCALAR; level <= max_level; level++) {
+			// The kernels are picked when the meter is constructed
+			set_max_simd_level((SIMD_LEVEL)level);
+
+			AUDIO_FORMAT format = make_audio_format(BENCHMARK_METER_SAMPLE_RATE, meter_format.num_channels,
+				meter_format.bit_depth, meter_format.is_float);
+			SyntheticSource source(format, UINT64_MAX);
+			Meter meter(&source);
+			METER_READING reading;
+
+			double time = measure_best_time([&]() {
+				AUDIO_CHUNK chunk;
+
+				for (uint32_t num_frames = 0; num_frames < BENCHMARK_METER_SAMPLE_RATE;) {
+					meter.get_chunk(chunk, UINT32_MAX);
+					num_frames += chunk.size / format.block_align;
+					do_not_optimize(chunk.data);
+					meter.release_chunk(chunk);
+				}
+
+				// Nobody else takes the readings, so the queue never fills up
+				while (meter.receive_reading(reading)) {
+					do_not_optimize(&reading);
+				}
+			});
+
+			scalar_time = level == SIMD_LEVEL_SCALAR ? time : scalar_time;
+
+			printf("  %-16s %-8s %8.3f ns/frame %8.3f ms/s %6.2fx\n", meter_format.name.c_str(),
+				get_simd_level_name((SIMD_LEVEL)level), time * 1e9 / BENCHMARK_METER_SAMPLE_RATE, time * 1000.0,
+				scalar_time / time);
+			record_benchmark_result("meter", meter_format.name.c_str(), (SIMD_LEVEL)level, meter_format.num_channels,
+				meter_format.bit_depth, meter_format.is_float, "ns/frame", time * 1e9 / BENCHMARK_METER_SAMPLE_RATE);
+		}
+
+		set_max_simd_level(max_level);
+	}
+}
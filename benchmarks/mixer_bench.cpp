@@ -0,0 +1,88 @@
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include "benchmark.hpp"
+#include "mixer.hpp"
+#include "synthetic_source.hpp"
+
+// Number of voices mixed at once, and sample rate of the mix
+#define NUM_BENCHMARK_VOICES 32
+#define BENCHMARK_MIX_SAMPLE_RATE 48000
+
+typedef struct VOICE_FORMAT {
+	BENCHMARK_FORMAT format;
+	uint32_t sample_rate;
+} VOICE_FORMAT;
+
+// From the voices that are only summed to the ones converted, remixed and resampled
+static const std::vector<VOICE_FORMAT> VOICE_FORMATS = {
+	{{"f32 stereo 48 kHz", 2, 32, true}, 48000},
+	{{"s16 stereo 48 kHz", 2, 16, false}, 48000},
+	{{"s16 mono 48 kHz", 1, 16, false}, 48000},
+	{{"s24 5.1 48 kHz", 6, 24, false}, 48000},
+	{{"s16 stereo 44.1 kHz", 2, 16, false}, 44100}
+};
+
+void run_mixer_benchmarks(const BENCHMARK_OPTIONS &options) {
+	SIMD_LEVEL max_level = get_simd_level();
+	AUDIO_FORMAT mix_format = make_audio_format(BENCHMARK_MIX_SAMPLE_RATE, 2, 32, true);
+	std::vector<VOICE_FORMAT> voice_formats = VOICE_FORMATS;
+
+	// The voices of the formats given on the command line are at the rate of the mix (they aren't resampled)
+	if (!options.channel_counts.empty() || !options.sample_types.empty()) {
+		voice_formats.clear();
+
+		for (const BENCHMARK_FORMAT &format : get_benchmark_formats(options, {})) {
+			voice_formats.push_back({format, BENCHMARK_MIX_SAMPLE_RATE});
+		}
+	}
+
+	printf("\n[Mixing, %d voices to stereo at %d Hz, one second of audio per run, single thread]\n",
+		NUM_BENCHMARK_VOICES, BENCHMARK_MIX_SAMPLE_RATE);
+
+	for (const VOICE_FORMAT &voice_format : voice_formats) {
+		double scalar_time = 0.0;
+
+		for (int level = SIMD_LEVEL_SCALAR; level <= max_level; level++) {
+			// The kernels of the mixer and of the conversions of its voices are picked when they are constructed
+			set_max_simd_level((SIMD_LEVEL)level);
+
+			std::vector<std::unique_ptr<SyntheticSource>> sources;
+			Mixer mixer(mix_format, DITHER_NONE, RESAMPLER_QUALITY_HIGH);
+
+			for (int voice = 0; voice < NUM_BENCHMARK_VOICES; voice++) {
+				sources.emplace_back(new SyntheticSource(make_audio_format(voice_format.sample_rate,
+					voice_format.format.num_channels, voice_format.format.bit_depth, voice_format.format.is_float),
+					UINT64_MAX));
+
+				// Spreads the voices across the stereo field, scaled so their sum stays mostly below full scale
+				mixer.add_voice(sources.back().get(), 1.0f / NUM_BENCHMARK_VOICES,
+					(float)voice / (NUM_BENCHMARK_VOICES - 1) * 2.0f - 1.0f);
+			}
+
+			double time = measure_best_time([&]() {
+				AUDIO_CHUNK chunk;
+
+				for (uint32_t num_frames = 0; num_frames < BENCHMARK_MIX_SAMPLE_RATE;) {
+					mixer.get_chunk(chunk, UINT32_MAX);
+					num_frames += chunk.size / mix_format.block_align;
+					do_not_optimize(chunk.data);
+					mixer.release_chunk(chunk);
+				}
+			});
+
+			scalar_time = level == SIMD_LEVEL_SCALAR ? time : scalar_time;
+
+			// One second of audio is mixed per run, so a core keeps up with this many voices in real time (the cost per
+			// frame is the one of a frame of the mix, all the voices included)
+			printf("  %-20s %-8s %8.3f ns/frame %8.3f ms/s %10.0f voices/core %6.2fx\n",
+				voice_format.format.name.c_str(), get_simd_level_name((SIMD_LEVEL)level),
+				time * 1e9 / BENCHMARK_MIX_SAMPLE_RATE, time * 1000.0, NUM_BENCHMARK_VOICES / time, scalar_time / time);
+			record_benchmark_result("mixer", voice_format.format.name.c_str(), (SIMD_LEVEL)level,
+				voice_format.format.num_channels, voice_format.format.bit_depth, voice_format.format.is_float,
+				"ns/frame", time * 1e9 / BENCHMARK_MIX_SAMPLE_RATE);
+		}
+
+		set_max_simd_level(max_level);
+	}
+}
@@ -0,0 +1,76 @@
+#include <cstdio>
+#include "benchmark.hpp"
+#include "resampler.hpp"
+#include "synthetic_source.hpp"
+
+// Number of input frames resampled per run
+#define NUM_BENCHMARK_FRAMES (1 << 18)
+
+typedef struct RESAMPLING_RATIO {
+	uint32_t input_sample_rate;
+	uint32_t output_sample_rate;
+} RESAMPLING_RATIO;
+
+static const RESAMPLING_RATIO RESAMPLING_RATIOS[] = {
+	{44100, 48000},
+	{48000, 44100},
+	{48000, 96000},
+	{96000, 48000}
+};
+
+static const char *QUALITY_NAMES[] = {"low", "medium", "high", "best"};
+
+void run_resampler_benchmarks(const BENCHMARK_OPTIONS &options) {
+	SIMD_LEVEL max_level = get_simd_level();
+	char name[32];
+
+	// The resampler runs on floats, only the channel counts apply
+	for (uint16_t num_channels : get_benchmark_channel_counts(options)) {
+		printf("\n[Resampling, %u channels, %d input frames per run, single thread]\n", num_channels,
+			NUM_BENCHMARK_FRAMES);
+
+		for (const RESAMPLING_RATIO &ratio : RESAMPLING_RATIOS) {
+			for (int quality = RESAMPLER_QUALITY_LOW; quality <= RESAMPLER_QUALITY_BEST; quality++) {
+				double scalar_time = 0.0;
+
+				snprintf(name, sizeof(name), "%u -> %u %s", ratio.input_sample_rate, ratio.output_sample_rate,
+					QUALITY_NAMES[quality]);
+
+				for (int level = SIMD_LEVEL_SCALAR; level <= max_level; level++) {
+					// The kernels are picked when the resampler is constructed
+					set_max_simd_level((SIMD_LEVEL)level);
+
+					// The source never ends, so the same resampler keeps streaming across the runs
+					SyntheticSource source(make_audio_format(ratio.input_sample_rate, num_channels, 32, true),
+						UINT64_MAX);
+					Resampler resampler(&source, ratio.output_sample_rate, (RESAMPLER_QUALITY)quality);
+					uint64_t num_output_frames = (uint64_t)NUM_BENCHMARK_FRAMES * ratio.output_sample_rate /
+						ratio.input_sample_rate;
+
+					double time = measure_best_time([&]() {
+						AUDIO_CHUNK chunk;
+
+						for (uint64_t num_frames = 0; num_frames < num_output_frames;) {
+							resampler.get_chunk(chunk, UINT32_MAX);
+							num_frames += chunk.size / resampler.get_format().block_align;
+							do_not_optimize(chunk.data);
+							resampler.release_chunk(chunk);
+						}
+					});
+
+					scalar_time = level == SIMD_LEVEL_SCALAR ? time : scalar_time;
+
+					// Costs are per output frame
+					printf("  %-23s %4u taps %-8s %8.3f ns/frame %8.1fx real time %6.2fx\n", name,
+						resampler.get_num_taps(), get_simd_level_name((SIMD_LEVEL)level),
+						time * 1e9 / num_output_frames, num_output_frames / time / ratio.output_sample_rate,
+						scalar_time / time);
+					record_benchmark_result("resampler", name, (SIMD_LEVEL)level, num_channels, 32, true, "ns/frame",
+						time * 1e9 / num_output_frames);
+				}
+
+				set_max_simd_level(max_level);
+			}
+		}
+	}
+}
@@ -0,0 +1,56 @@
+#include "synthetic_source.hpp"
+#include <algorithm>
+#include <cstring>
+
+SyntheticSource::SyntheticSource(const AUDIO_FORMAT &format, uint64_t num_frames) {
+	this->format = format;
+	this->num_frames = num_frames;
+	this->block.resize((size_t)SYNTHETIC_SOURCE_BLOCK_FRAMES * format.block_align);
+
+	// Fills the block with white noise at half scale (floats are kept in [-0.5, 0.5))
+	uint32_t state = 0x12345678;
+	size_t num_samples = (size_t)SYNTHETIC_SOURCE_BLOCK_FRAMES * format.num_channels;
+	size_t sample_size = format.bit_depth / 8;
+
+	for (size_t i = 0; i < num_samples; i++) {
+		state = state * 1664525u + 1013904223u;
+
+		if (format.is_float) {
+			float sample = (float)(int32_t)state / 4294967296.0f;
+
+			memcpy(this->block.data() + i * sample_size, &sample, sizeof(sample));
+		} else {
+			// Keeps the most significant bytes (little endian), so every bit depth gets the same signal
+			int32_t sample = (int32_t)state >> 1;
+
+			memcpy(this->block.data() + i * sample_size, (const uint8_t*)&sample + (4 - sample_size), sample_size);
+		}
+	}
+}
+
+void SyntheticSource::rewind() {
+	this->num_produced_frames = 0;
+}
+
+AUDIO_FORMAT SyntheticSource::get_format() {
+	return this->format;
+}
+
+bool SyntheticSource::get_chunk(AUDIO_CHUNK &chunk, uint32_t max_size) {
+	uint64_t num_frames = std::min((uint64_t)(max_size / this->format.block_align), this->num_frames - this->num_produced_frames);
+
+	num_frames = std::min(num_frames, (uint64_t)SYNTHETIC_SOURCE_BLOCK_FRAMES);
+
+	this->num_produced_frames += num_frames;
+
+	chunk.data = this->block.data();
+	chunk.size = (uint32_t)num_frames * this->format.block_align;
+	chunk.is_eof = this->num_produced_frames == this->num_frames;
+
+	return chunk.is_eof;
+}
+
+void SyntheticSource::release_chunk(AUDIO_CHUNK &chunk) {
+	chunk.data = nullptr;
+	chunk.size = 0;
+}
@@ -0,0 +1,34 @@
+#ifndef WASABI_SYNTHETIC_SOURCE_HPP
+#define WASABI_SYNTHETIC_SOURCE_HPP
+
+#include <cstdint>
+#include <vector>
+#include "audio_source.hpp"
+
+// Number of frames generated once and lent over and over
+#define SYNTHETIC_SOURCE_BLOCK_FRAMES 4096
+
+// Audio source lending the same block of noise until the requested number of frames has been produced, so the
+// benchmarks measure the processing stages rather than the storage
+class SyntheticSource : public AudioSource {
+private:
+	AUDIO_FORMAT format;
+	std::vector<uint8_t> block;
+	uint64_t num_frames{};
+	uint64_t num_produced_frames{};
+
+public:
+	// The source never ends when the number of frames is UINT64_MAX
+	SyntheticSource(const AUDIO_FORMAT &format, uint64_t num_frames);
+
+	// Starts producing the frames again
+	void rewind();
+
+	AUDIO_FORMAT get_format() override;
+
+	bool get_chunk(AUDIO_CHUNK &chunk, uint32_t max_size) override;
+
+	void release_chunk(AUDIO_CHUNK &chunk) override;
+};
+
+#endif //WASABI_SYNTHETIC_SOURCE_HPP
@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include "benchmark.hpp"
+#include "simd.hpp"
+#include "wav_reader.hpp"
+
+// Splits a comma separated list of the command line
+static std::vector<std::string> split_list(const char *list) {
+	std::vector<std::string> items;
+	std::stringstream stream(list);
+	std::string item;
+
+	while (std::getline(stream, item, ',')) {
+		if (!item.empty()) {
+			items.push_back(item);
+		}
+	}
+
+	return items;
+}
+
+static bool is_selected(const BENCHMARK_OPTIONS &options, const char *benchmark_name) {
+	return options.benchmark_names.empty() || std::find(options.benchmark_names.begin(),
+		options.benchmark_names.end(), benchmark_name) != options.benchmark_names.end();
+}
+
+int main(int argc, char* argv[]) {
+	BENCHMARK_OPTIONS options;
+	const char *results_path = nullptr;
+	const char *temp_directory = getenv("TMPDIR");
+
+	options.work_directory = temp_directory != nullptr && temp_directory[0] != '\0' ? temp_directory : "/tmp";
+
+	for (int i = 0; i < argc; i++) {
+		// Allows capping the instruction set, so the dispatched kernels can be compared against the scalar ones
+		if (strcmp(argv[i], "--max_simd_level") == 0 && (i + 1) < argc) {
+			if (strcmp(argv[i + 1], "scalar") == 0) {
+				set_max_simd_level(SIMD_LEVEL_SCALAR);
+			}
+			else if (strcmp(argv[i + 1], "sse2") == 0) {
+				set_max_simd_level(SIMD_LEVEL_SSE2);
+			}
+			else if (strcmp(argv[i + 1], "avx2") == 0) {
+				set_max_simd_level(SIMD_LEVEL_AVX2);
+			}
+			else {
+				std::cerr << "WARNING: Unknown instruction set \"" << argv[i + 1] << "\", the best one will be used."
+					<< std::endl;
+			}
+		}
+		// Channel counts of the streams (e.g. "1,2,6")
+		else if (strcmp(argv[i], "--channels") == 0 && (i + 1) < argc) {
+			for (const std::string &item : split_list(argv[i + 1])) {
+				int num_channels = atoi(item.c_str());
+
+				if (num_channels >= 1 && num_channels <= MAX_NUM_CHANNELS) {
+					options.channel_counts.push_back((uint16_t)num_channels);
+				}
+				else {
+					std::cerr << "WARNING: Invalid channel count \"" << item << "\", it will be ignored." << std::endl;
+				}
+			}
+		}
+		// Sample types of the streams: integer bit depths (8, 16, 24 or 32) or 32 bits floats ("f32")
+		else if (strcmp(argv[i], "--bit_depths") == 0 && (i + 1) < argc) {
+			for (const std::string &item : split_list(argv[i + 1])) {
+				if (item == "f32") {
+					options.sample_types.push_back({"", 0, 32, true});
+				}
+				else if (item == "8" || item == "16" || item == "24" || item == "32") {
+					options.sample_types.push_back({"", 0, (uint16_t)atoi(item.c_str()), false});
+				}
+				else {
+					std::cerr << "WARNING: Invalid bit depth \"" << item << "\", it will be ignored." << std::endl;
+				}
+			}
+		}
+		else if (strcmp(argv[i], "--benchmarks") == 0 && (i + 1) < argc) {
+			options.benchmark_names = split_list(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "--work_dir") == 0 && (i + 1) < argc) {
+			options.work_directory = argv[i + 1];
+		}
+		else if (strcmp(argv[i], "--results") == 0 && (i + 1) < argc) {
+			results_path = argv[i + 1];
+		}
+	}
+
+	if (results_path != nullptr && !open_benchmark_results(results_path)) {
+		std::cerr << "ERROR: Unable to open the results file \"" << results_path << "\"." << std::endl;
+
+		return 1;
+	}
+
+	if (is_selected(options, "format_converter")) {
+		run_format_converter_benchmarks(options);
+	}
+
+	if (is_selected(options, "resampler")) {
+		run_resampler_benchmarks(options);
+	}
+
+	if (is_selected(options, "mixer")) {
+		run_mixer_benchmarks(options);
+	}
+
+	if (is_selected(options, "gain_stage")) {
+		run_gain_stage_benchmarks(options);
+	}
+
+	if (is_selected(options, "meter")) {
+		run_meter_benchmarks(options);
+	}
+
+	if (is_selected(options, "flac")) {
+		run_flac_benchmarks(options);
+	}
+
+	if (is_selected(options, "wav_reader")) {
+		run_wav_reader_benchmarks(options);
+	}
+
+	close_benchmark_results();
+
+	return 0;
+}
@@ -0,0 +1,316 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "benchmark.hpp"
+#include "synthetic_source.hpp"
+#include "wav_reader.hpp"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Sample rate and duration (in seconds) of the generated files
+#define BENCHMARK_WAV_SAMPLE_RATE 48000
+#define BENCHMARK_WAV_DURATION 30
+
+// Number of cold reads of each file, each one preceded by dropping the file from the page cache
+#define BENCHMARK_COLD_RUNS 3
+
+// Size of the chunk of unknown data written ahead of the samples of the tagged files, larger than the region read
+// along with the header so that reaching the 'data' chunk takes a second read
+#define BENCHMARK_TAG_SIZE (WAV_HEADER_READ_SIZE * 2)
+
+// Sizes (in frames) of the chunks requested from the reader when measuring the hand-off
+static const uint32_t HAND_OFF_CHUNK_FRAMES[] = {64, 256, 1024, 4096};
+
+// Streams of the files, from the defaults of the command line
+static const std::vector<BENCHMARK_FORMAT> WAV_FORMATS = {
+	{"s16 stereo", 2, 16, false},
+	{"s24 stereo", 2, 24, false}
+};
+
+// Reader only parsing the header, so its cost is measured without starting the loader thread
+class HeaderParser : public WAVReader {
+public:
+	bool parse(const std::string &file_path) {
+		std::shared_ptr<std::ifstream> file = std::make_shared<std::ifstream>(file_path,
+			std::ios::in | std::ios::binary);
+
+		return file->is_open() && this->load_header(file);
+	}
+};
+
+static void write_uint16(std::ofstream &file, uint16_t value) {
+	file.write((const char*)&value, sizeof(value));
+}
+
+static void write_uint32(std::ofstream &file, uint32_t value) {
+	file.write((const char*)&value, sizeof(value));
+}
+
+// Writes a WAV file of noise, the tagged ones have a LIST chunk and a large JUNK chunk ahead of the samples
+static bool write_wav_file(const std::string &file_path, const AUDIO_FORMAT &format, uint64_t num_frames,
+	bool is_tagged) {
+	std::ofstream file(file_path, std::ios::out | std::ios::binary | std::ios::trunc);
+	static const char list_data[] = "INFOINAM\x0c\0\0\0wasabi bench";
+	uint32_t tags_size = is_tagged ? (8 + sizeof(list_data) - 1) + (8 + BENCHMARK_TAG_SIZE) : 0;
+	uint32_t data_size = (uint32_t)(num_frames * format.block_align);
+
+	if (!file.is_open()) {
+		return false;
+	}
+
+	file.write("RIFF", 4);
+	write_uint32(file, 4 + (8 + 16) + tags_size + 8 + data_size);
+	file.write("WAVE", 4);
+	file.write("fmt ", 4);
+	write_uint32(file, 16);
+	write_uint16(file, format.is_float ? WAV_FORMAT_IEEE_FLOAT : WAV_FORMAT_PCM);
+	write_uint16(file, format.num_channels);
+	write_uint32(file, format.sample_rate);
+	write_uint32(file, format.byte_rate);
+	write_uint16(file, format.block_align);
+	write_uint16(file, format.bit_depth);
+
+	if (is_tagged) {
+		std::vector<char> junk(BENCHMARK_TAG_SIZE);
+
+		file.write("LIST", 4);
+		write_uint32(file, sizeof(list_data) - 1);
+		file.write(list_data, sizeof(list_data) - 1);
+		file.write("JUNK", 4);
+		write_uint32(file, BENCHMARK_TAG_SIZE);
+		file.write(junk.data(), junk.size());
+	}
+
+	file.write("data", 4);
+	write_uint32(file, data_size);
+
+	SyntheticSource source(format, num_frames);
+	AUDIO_CHUNK chunk;
+	bool is_eof = num_frames == 0;
+
+	while (!is_eof) {
+		is_eof = source.get_chunk(chunk, UINT32_MAX);
+		file.write((const char*)chunk.data, chunk.size);
+		source.release_chunk(chunk);
+	}
+
+	return file.good();
+}
+
+// Drops the file from the page cache, returns false if it couldn't be (not on Linux, or on file systems keeping their
+// files in memory such as tmpfs)
+static bool drop_from_page_cache(const std::string &file_path) {
+#ifdef __linux__
+	int fd = open(file_path.c_str(), O_RDONLY);
+	struct stat file_status;
+
+	if (fd < 0) {
+		return false;
+	}
+
+	if (fstat(fd, &file_status) != 0 || file_status.st_size == 0) {
+		close(fd);
+
+		return false;
+	}
+
+	// Dirty pages aren't dropped, so the file is written back first
+	fdatasync(fd);
+	posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+
+	// Checks how much of the file is still cached (mapping it doesn't read it)
+	size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+	size_t num_pages = ((size_t)file_status.st_size + page_size - 1) / page_size;
+	std::vector<unsigned char> residency(num_pages);
+	size_t num_cached_pages = num_pages;
+	void *data = mmap(nullptr, (size_t)file_status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+	if (data != MAP_FAILED) {
+		if (mincore(data, (size_t)file_status.st_size, residency.data()) == 0) {
+			num_cached_pages = 0;
+
+			for (unsigned char page : residency) {
+				num_cached_pages += page & 1;
+			}
+		}
+
+		munmap(data, (size_t)file_status.st_size);
+	}
+
+	close(fd);
+
+	// Allows for a few pages read back in the meantime by someone else
+	return num_cached_pages <= num_pages / 16;
+#else
+	return false;
+#endif
+}
+
+// Streams the whole file through a reader, reading every cache line of the chunks like the format converter would.
+// Returns the number of chunks lent (0 if the file couldn't be opened)
+static uint64_t read_file(const std::string &file_path, bool use_memory_map, uint32_t max_size) {
+	WAVReader reader;
+	std::string path = file_path;
+	AUDIO_CHUNK chunk;
+	bool is_eof = false;
+	uint64_t num_chunks = 0;
+	uint8_t checksum = 0;
+
+	reader.is_verbose = false;
+
+	if (!reader.load_file(&path, use_memory_map)) {
+		return 0;
+	}
+
+	while (!is_eof) {
+		is_eof = reader.get_chunk(chunk, max_size);
+
+		for (uint32_t i = 0; i < chunk.size; i += CACHE_LINE_SIZE) {
+			checksum += chunk.data[i];
+		}
+
+		// Only the chunks carrying data are counted, the reader lends empty ones while it waits for the disk
+		num_chunks += chunk.size > 0 ? 1 : 0;
+		reader.release_chunk(chunk);
+
+		if (chunk.size == 0 && !is_eof) {
+			reader.wait_for_chunk(SOURCE_WAIT_INTERVAL);
+		}
+	}
+
+	do_not_optimize(&checksum);
+
+	return num_chunks;
+}
+
+// Gets the best time of a few reads of the file, each one from the disk rather than from the page cache (0 if the file
+// couldn't be dropped from it)
+static double measure_cold_read_time(const std::string &file_path, bool use_memory_map) {
+	double best_time = 0.0;
+
+	for (int run = 0; run < BENCHMARK_COLD_RUNS; run++) {
+		if (!drop_from_page_cache(file_path)) {
+			return 0.0;
+		}
+
+		auto start_time = std::chrono::steady_clock::now();
+
+		read_file(file_path, use_memory_map, UINT32_MAX);
+
+		double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+		best_time = run == 0 || time < best_time ? time : best_time;
+	}
+
+	return best_time;
+}
+
+static void print_read_result(const BENCHMARK_FORMAT &format, const char *name, double time, uint64_t num_frames,
+	uint64_t num_bytes) {
+	printf("  %-12s %-24s %8.3f ns/frame %8.1f MB/s\n", format.name.c_str(), name, time * 1e9 / num_frames,
+		num_bytes / time / 1e6);
+	record_benchmark_result("wav_reader", name, get_simd_level(), format.num_channels, format.bit_depth,
+		format.is_float, "ns/frame", time * 1e9 / num_frames);
+	record_benchmark_result("wav_reader", name, get_simd_level(), format.num_channels, format.bit_depth,
+		format.is_float, "MB/s", num_bytes / time / 1e6);
+}
+
+void run_wav_reader_benchmarks(const BENCHMARK_OPTIONS &options) {
+	uint64_t num_frames = (uint64_t)BENCHMARK_WAV_SAMPLE_RATE * BENCHMARK_WAV_DURATION;
+	bool is_cold_measured = true;
+	char name[32];
+
+	printf("\n[WAV reader, %d s files at %d Hz generated in \"%s\", cold reads are the best of %d]\n",
+		BENCHMARK_WAV_DURATION, BENCHMARK_WAV_SAMPLE_RATE, options.work_directory.c_str(), BENCHMARK_COLD_RUNS);
+
+	for (const BENCHMARK_FORMAT &wav_format : get_benchmark_formats(options, WAV_FORMATS)) {
+		AUDIO_FORMAT format = make_audio_format(BENCHMARK_WAV_SAMPLE_RATE, wav_format.num_channels,
+			wav_format.bit_depth, wav_format.is_float);
+		std::string file_path = options.work_directory + "/wasabi_bench_" + std::to_string(wav_format.num_channels) +
+			"_" + std::to_string(wav_format.bit_depth) + (wav_format.is_float ? "f" : "") + ".wav";
+		std::string tagged_file_path = file_path.substr(0, file_path.size() - 4) + "_tagged.wav";
+		uint64_t num_bytes = num_frames * format.block_align;
+
+		if (!write_wav_file(file_path, format, num_frames, false) ||
+			!write_wav_file(tagged_file_path, format, BENCHMARK_WAV_SAMPLE_RATE, true)) {
+			fprintf(stderr, "ERROR: Unable to generate the %s file in \"%s\".\n", wav_format.name.c_str(),
+				options.work_directory.c_str());
+
+			std::remove(file_path.c_str());
+			std::remove(tagged_file_path.c_str());
+
+			continue;
+		}
+
+		// Opening the file, reading the region holding the header and checking it (the tagged file takes two reads)
+		for (int is_tagged = 0; is_tagged <= 1; is_tagged++) {
+			const std::string &header_file_path = is_tagged ? tagged_file_path : file_path;
+
+			double time = measure_best_time([&]() {
+				HeaderParser parser;
+
+				parser.is_verbose = false;
+				parser.parse(header_file_path);
+				do_not_optimize(&parser);
+			});
+
+			snprintf(name, sizeof(name), "header %s", is_tagged ? "tagged" : "plain");
+			printf("  %-12s %-24s %8.3f us/file\n", wav_format.name.c_str(), name, time * 1e6);
+			record_benchmark_result("wav_reader", name, get_simd_level(), wav_format.num_channels,
+				wav_format.bit_depth, wav_format.is_float, "ns/file", time * 1e9);
+		}
+
+		// Throughput of the loader thread and of the memory mapping, from the page cache and from the disk
+		for (int use_memory_map = 0; use_memory_map <= 1; use_memory_map++) {
+			const char *data_path = use_memory_map ? "mapped" : "stream";
+
+			double time = measure_best_time([&]() {
+				read_file(file_path, use_memory_map != 0, UINT32_MAX);
+			});
+
+			snprintf(name, sizeof(name), "%s page cache", data_path);
+			print_read_result(wav_format, name, time, num_frames, num_bytes);
+
+			time = is_cold_measured ? measure_cold_read_time(file_path, use_memory_map != 0) : 0.0;
+
+			if (time > 0.0) {
+				snprintf(name, sizeof(name), "%s cold", data_path);
+				print_read_result(wav_format, name, time, num_frames, num_bytes);
+			} else if (is_cold_measured) {
+				fprintf(stderr, "WARNING: The files can't be dropped from the page cache, the cold reads are skipped "
+					"(use --work_dir to generate them on a disk).\n");
+
+				is_cold_measured = false;
+			}
+		}
+
+		// Cost of lending a chunk from the ring buffer filled by the loader thread, for chunks of the sizes requested
+		// by the sinks (the file is in the page cache, so the loader stays ahead)
+		for (uint32_t chunk_frames : HAND_OFF_CHUNK_FRAMES) {
+			uint64_t num_chunks = 0;
+
+			double time = measure_best_time([&]() {
+				num_chunks = read_file(file_path, false, chunk_frames * format.block_align);
+			});
+
+			snprintf(name, sizeof(name), "hand-off %u frames", chunk_frames);
+			printf("  %-12s %-24s %8.3f ns/frame %8.1f ns/chunk\n", wav_format.name.c_str(), name,
+				time * 1e9 / num_frames, time * 1e9 / num_chunks);
+			record_benchmark_result("wav_reader", name, get_simd_level(), wav_format.num_channels,
+				wav_format.bit_depth, wav_format.is_float, "ns/frame", time * 1e9 / num_frames);
+			record_benchmark_result("wav_reader", name, get_simd_level(), wav_format.num_channels,
+				wav_format.bit_depth, wav_format.is_float, "ns/chunk", time * 1e9 / num_chunks);
+		}
+
+		std::remove(file_path.c_str());
+		std::remove(tagged_file_path.c_str());
+	}
+}
@@ -0,0 +1,287 @@
+#include "instrumentation.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+typedef struct TRACE_EVENT {
+	uint64_t start_time;
+	uint64_t duration;
+	uint64_t value;
+	TRACE_EVENT_TYPE type;
+} TRACE_EVENT;
+
+// Measurements of a thread. Only the thread writes them, so the counters are updated without read-modify-write
+// instructions, and the events are published by their count (so they can be read while the thread is recording)
+class TraceBuffer {
+public:
+	std::string thread_name;
+	uint32_t thread_index{};
+	std::vector<TRACE_EVENT> events; // Fixed size (empty when no trace is written)
+	std::atomic<size_t> num_events{};
+	std::atomic<uint64_t> num_dropped_events{};
+	std::atomic<uint64_t> histogram_counts[TRACE_NUM_STAGES][TRACE_HISTOGRAM_NUM_BUCKETS]{};
+	std::atomic<uint64_t> total_values[TRACE_NUM_STAGES]{};
+	std::atomic<uint64_t> max_values[TRACE_NUM_STAGES]{};
+	std::atomic<uint64_t> counts[TRACE_NUM_EVENT_TYPES]{};
+};
+
+std::atomic<bool> is_instrumentation_enabled_flag{};
+
+static bool is_tracing = false;
+static uint64_t trace_start_time = 0;
+static std::mutex trace_buffers_mtx;
+static std::vector<std::unique_ptr<TraceBuffer>> trace_buffers; // Kept once their thread has exited
+static thread_local TraceBuffer *thread_trace_buffer = nullptr;
+
+static inline void add(std::atomic<uint64_t> &counter, uint64_t value) {
+	counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+static size_t get_histogram_bucket(uint64_t value) {
+	if (value < TRACE_HISTOGRAM_SUB_BUCKETS) {
+		return (size_t)value;
+	}
+
+	value = std::min<uint64_t>(value, (2ull << TRACE_HISTOGRAM_MAX_EXPONENT) - 1);
+
+	// The most significant bits pick the bucket within the power of two
+	int exponent = 63;
+
+	while ((value >> exponent) == 0) {
+		exponent -= 1;
+	}
+
+	int shift = exponent - TRACE_HISTOGRAM_SUB_BUCKET_BITS;
+
+	return (size_t)(shift + 1) * TRACE_HISTOGRAM_SUB_BUCKETS + (size_t)((value >> shift) - TRACE_HISTOGRAM_SUB_BUCKETS);
+}
+
+static uint64_t get_histogram_bucket_max_value(size_t bucket) {
+	if (bucket < TRACE_HISTOGRAM_SUB_BUCKETS) {
+		return bucket;
+	}
+
+	int shift = (int)(bucket / TRACE_HISTOGRAM_SUB_BUCKETS) - 1;
+	uint64_t sub_bucket = bucket % TRACE_HISTOGRAM_SUB_BUCKETS;
+
+	return ((TRACE_HISTOGRAM_SUB_BUCKETS + sub_bucket + 1) << shift) - 1;
+}
+
+void start_instrumentation(bool is_tracing_enabled) {
+	is_tracing = is_tracing_enabled;
+	trace_start_time = get_trace_time();
+
+	is_instrumentation_enabled_flag.store(true);
+}
+
+void register_trace_thread(const char *name, size_t num_events) {
+	if (!is_instrumentation_enabled() || thread_trace_buffer != nullptr) {
+		return;
+	}
+
+	std::unique_ptr<TraceBuffer> trace_buffer(new TraceBuffer());
+
+	trace_buffer->thread_name = name;
+	trace_buffer->events.resize(is_tracing ? num_events : 0);
+
+	std::lock_guard<std::mutex> lck(trace_buffers_mtx);
+
+	trace_buffer->thread_index = (uint32_t)trace_buffers.size() + 1;
+	thread_trace_buffer = trace_buffer.get();
+	trace_buffers.push_back(std::move(trace_buffer));
+}
+
+static TraceBuffer *get_thread_trace_buffer() {
+	if (thread_trace_buffer == nullptr) {
+		register_trace_thread("Worker", TRACE_READER_EVENTS);
+	}
+
+	return thread_trace_buffer;
+}
+
+static void record_event(TraceBuffer *trace_buffer, TRACE_EVENT_TYPE type, uint64_t start_time, uint64_t duration,
+	uint64_t value) {
+	if (!is_tracing) {
+		return;
+	}
+
+	size_t num_events = trace_buffer->num_events.load(std::memory_order_relaxed);
+
+	if (num_events == trace_buffer->events.size()) {
+		add(trace_buffer->num_dropped_events, 1);
+
+		return;
+	}
+
+	trace_buffer->events[num_events] = {start_time, duration, value, type};
+	trace_buffer->num_events.store(num_events + 1, std::memory_order_release);
+}
+
+uint64_t end_trace_span(TRACE_EVENT_TYPE type, uint64_t start_time, uint64_t value) {
+	if (start_time == 0) {
+		return 0;
+	}
+
+	uint64_t duration = get_trace_time() - start_time;
+	TraceBuffer *trace_buffer = get_thread_trace_buffer();
+
+	if (type < TRACE_NUM_STAGES) {
+		add(trace_buffer->histogram_counts[type][get_histogram_bucket(duration)], 1);
+		add(trace_buffer->total_values[type], duration);
+
+		if (duration > trace_buffer->max_values[type].load(std::memory_order_relaxed)) {
+			trace_buffer->max_values[type].store(duration, std::memory_order_relaxed);
+		}
+	}
+
+	add(trace_buffer->counts[type], 1);
+	record_event(trace_buffer, type, start_time, duration, value);
+
+	return duration;
+}
+
+void record_trace_event(TRACE_EVENT_TYPE type, uint64_t value) {
+	if (!is_instrumentation_enabled()) {
+		return;
+	}
+
+	TraceBuffer *trace_buffer = get_thread_trace_buffer();
+
+	add(trace_buffer->counts[type], 1);
+	record_event(trace_buffer, type, get_trace_time(), 0, value);
+}
+
+INSTRUMENTATION_SUMMARY get_instrumentation_summary() {
+	INSTRUMENTATION_SUMMARY summary;
+	std::lock_guard<std::mutex> lck(trace_buffers_mtx);
+
+	for (const std::unique_ptr<TraceBuffer> &trace_buffer : trace_buffers) {
+		for (int stage = 0; stage < TRACE_NUM_STAGES; stage++) {
+			LATENCY_HISTOGRAM &histogram = summary.histograms[stage];
+
+			for (size_t bucket = 0; bucket < TRACE_HISTOGRAM_NUM_BUCKETS; bucket++) {
+				uint64_t count = trace_buffer->histogram_counts[stage][bucket].load(std::memory_order_relaxed);
+
+				histogram.counts[bucket] += count;
+				histogram.num_values += count;
+			}
+
+			histogram.total_value += trace_buffer->total_values[stage].load(std::memory_order_relaxed);
+			histogram.max_value = std::max(histogram.max_value,
+				trace_buffer->max_values[stage].load(std::memory_order_relaxed));
+		}
+
+		for (int type = 0; type < TRACE_NUM_EVENT_TYPES; type++) {
+			summary.counts[type] += trace_buffer->counts[type].load(std::memory_order_relaxed);
+		}
+
+		summary.num_events += trace_buffer->num_events.load(std::memory_order_acquire);
+		summary.num_dropped_events += trace_buffer->num_dropped_events.load(std::memory_order_relaxed);
+	}
+
+	return summary;
+}
+
+uint64_t get_latency_percentile(const LATENCY_HISTOGRAM &histogram, double percentile) {
+	uint64_t target_count = (uint64_t)((double)histogram.num_values * percentile / 100.0 + 0.5);
+	uint64_t count = 0;
+
+	if (histogram.num_values == 0) {
+		return 0;
+	}
+
+	for (size_t bucket = 0; bucket < TRACE_HISTOGRAM_NUM_BUCKETS; bucket++) {
+		count += histogram.counts[bucket];
+
+		if (count >= std::max<uint64_t>(target_count, 1)) {
+			// The bucket of the maximum holds nothing above it
+			return std::min(get_histogram_bucket_max_value(bucket), histogram.max_value);
+		}
+	}
+
+	return histogram.max_value;
+}
+
+static const char *get_trace_event_name(TRACE_EVENT_TYPE type) {
+	switch (type) {
+	case TRACE_IO:
+		return "read";
+	case TRACE_HAND_OFF:
+		return "hand-off";
+	case TRACE_REFILL:
+		return "refill";
+	case TRACE_WRITE:
+		return "write";
+	case TRACE_READER_STALL:
+		return "reader stall";
+	case TRACE_UNDERRUN:
+		return "underrun";
+	case TRACE_LATE_REFILL:
+		return "late refill";
+	default:
+		return "event";
+	}
+}
+
+static const char *get_trace_event_value_name(TRACE_EVENT_TYPE type) {
+	switch (type) {
+	case TRACE_REFILL:
+	case TRACE_UNDERRUN:
+	case TRACE_LATE_REFILL:
+		return "frames";
+	default:
+		return "bytes";
+	}
+}
+
+int64_t write_chrome_trace(const std::string &file_path) {
+	FILE *file = fopen(file_path.c_str(), "w");
+	int64_t num_written_events = 0;
+
+	if (file == nullptr) {
+		return -1;
+	}
+
+	std::lock_guard<std::mutex> lck(trace_buffers_mtx);
+
+	// Names the threads, then writes their events (timestamps and durations are in microseconds)
+	fprintf(file, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+	fprintf(file, "{\"ph\": \"M\", \"pid\": 1, \"name\": \"process_name\", \"args\": {\"name\": \"wasabi\"}}");
+
+	for (const std::unique_ptr<TraceBuffer> &trace_buffer : trace_buffers) {
+		fprintf(file, ",\n{\"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"name\": \"thread_name\", "
+			"\"args\": {\"name\": \"%s\"}}", trace_buffer->thread_index, trace_buffer->thread_name.c_str());
+	}
+
+	for (const std::unique_ptr<TraceBuffer> &trace_buffer : trace_buffers) {
+		size_t num_events = trace_buffer->num_events.load(std::memory_order_acquire);
+
+		for (size_t i = 0; i < num_events; i++) {
+			const TRACE_EVENT &event = trace_buffer->events[i];
+			double timestamp = (double)(event.start_time - std::min(event.start_time, trace_start_time)) / 1000.0;
+
+			fprintf(file, ",\n{\"ph\": \"%s\", \"pid\": 1, \"tid\": %u, \"name\": \"%s\", \"ts\": %.3f",
+				event.type < TRACE_NUM_STAGES ? "X" : "i", trace_buffer->thread_index, get_trace_event_name(event.type),
+				timestamp);
+
+			if (event.type < TRACE_NUM_STAGES) {
+				fprintf(file, ", \"dur\": %.3f", (double)event.duration / 1000.0);
+			}
+			else {
+				fprintf(file, ", \"s\": \"t\"");
+			}
+
+			fprintf(file, ", \"args\": {\"%s\": %llu}}", get_trace_event_value_name(event.type),
+				(unsigned long long)event.value);
+		}
+
+		num_written_events += (int64_t)num_events;
+	}
+
+	fprintf(file, "\n]}\n");
+	fclose(file);
+
+	return num_written_events;
+}
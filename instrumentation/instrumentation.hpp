@@ -0,0 +1,95 @@
+#ifndef WASABI_INSTRUMENTATION_HPP
+#define WASABI_INSTRUMENTATION_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Number of events each thread can record for the trace, the threads feeding the sink record a few per refill while
+// the other ones (loaders, decoders) record a few per second of audio. Events past it are dropped and counted
+#define TRACE_THREAD_EVENTS (1 << 18)
+#define TRACE_READER_EVENTS (1 << 14)
+
+// Buckets of the latency histograms: values below 2^TRACE_HISTOGRAM_SUB_BUCKET_BITS nanoseconds are exact, and each
+// power of two above is split into as many linear buckets (so values are recorded within 1/16 of themselves, like HDR
+// histograms with one significant digit), up to 2^TRACE_HISTOGRAM_MAX_EXPONENT nanoseconds (about 18 minutes)
+#define TRACE_HISTOGRAM_SUB_BUCKET_BITS 4
+#define TRACE_HISTOGRAM_SUB_BUCKETS (1 << TRACE_HISTOGRAM_SUB_BUCKET_BITS)
+#define TRACE_HISTOGRAM_MAX_EXPONENT 40
+#define TRACE_HISTOGRAM_NUM_BUCKETS \
+	((TRACE_HISTOGRAM_MAX_EXPONENT - TRACE_HISTOGRAM_SUB_BUCKET_BITS + 2) * TRACE_HISTOGRAM_SUB_BUCKETS)
+
+// What an event measures. The stages (spans with a latency histogram) come first, then the incidents (counted)
+enum TRACE_EVENT_TYPE {
+	TRACE_IO, // Read of the file by a loader thread (value: bytes read)
+	TRACE_HAND_OFF, // Chunk lent by a reader to the pipeline (value: bytes lent)
+	TRACE_REFILL, // Refill of the sink by the render loop, pulling the pipeline included (value: frames written)
+	TRACE_WRITE, // Chunk written to the sink (value: bytes written)
+	TRACE_READER_STALL, // Chunk requested before the reader had it ready, a shorter one is lent (value: bytes requested)
+	TRACE_UNDERRUN, // Refill finding the sink already starved (value: frames the sink held)
+	TRACE_LATE_REFILL, // Refill taking longer than the sink takes to play the frames it's refilled at (value: frames)
+	TRACE_NUM_EVENT_TYPES
+};
+
+#define TRACE_NUM_STAGES (TRACE_WRITE + 1)
+
+// Latencies (in nanoseconds) of a stage, merged from every thread
+typedef struct LATENCY_HISTOGRAM {
+	uint64_t counts[TRACE_HISTOGRAM_NUM_BUCKETS]{};
+	uint64_t num_values{};
+	uint64_t total_value{};
+	uint64_t max_value{};
+} LATENCY_HISTOGRAM;
+
+typedef struct INSTRUMENTATION_SUMMARY {
+	LATENCY_HISTOGRAM histograms[TRACE_NUM_STAGES];
+	uint64_t counts[TRACE_NUM_EVENT_TYPES]{};
+	uint64_t num_events{}; // Recorded for the trace
+	uint64_t num_dropped_events{}; // Recorded once the buffer of their thread was full
+} INSTRUMENTATION_SUMMARY;
+
+// Whether the pipeline is instrumented, set once before the playback starts (read on every chunk, so it's the only
+// cost of the instrumentation when it's disabled)
+extern std::atomic<bool> is_instrumentation_enabled_flag;
+
+inline bool is_instrumentation_enabled() {
+	return is_instrumentation_enabled_flag.load(std::memory_order_relaxed);
+}
+
+// Gets the time events are timestamped with (in nanoseconds, never 0)
+inline uint64_t get_trace_time() {
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count() | 1;
+}
+
+// Enables the histograms and the counters, and the recording of the events when a trace is to be written
+void start_instrumentation(bool is_tracing);
+
+// Names the thread in the trace and allocates its buffers, so it doesn't have to when recording its first event (the
+// threads recording without having been registered are registered then, with room for TRACE_READER_EVENTS events)
+void register_trace_thread(const char *name, size_t num_events);
+
+// Starts measuring a span, returns 0 when the instrumentation is disabled
+inline uint64_t begin_trace_span() {
+	return is_instrumentation_enabled() ? get_trace_time() : 0;
+}
+
+// Ends a span started by begin_trace_span on the same thread, recording its latency and its event. Returns its
+// duration (in nanoseconds, 0 when the instrumentation is disabled)
+uint64_t end_trace_span(TRACE_EVENT_TYPE type, uint64_t start_time, uint64_t value);
+
+// Counts an incident and records its event (lasting no time)
+void record_trace_event(TRACE_EVENT_TYPE type, uint64_t value);
+
+// Gets the latencies and counters of every thread (they may still be recording)
+INSTRUMENTATION_SUMMARY get_instrumentation_summary();
+
+// Gets the latency under which the given percentage of the values were (the highest value of its bucket)
+uint64_t get_latency_percentile(const LATENCY_HISTOGRAM &histogram, double percentile);
+
+// Writes the events recorded so far in the Chrome trace event format (chrome://tracing, Perfetto), returns the
+// number of events written or -1 if the file couldn't be opened
+int64_t write_chrome_trace(const std::string &file_path);
+
+#endif //WASABI_INSTRUMENTATION_HPP
@@ -0,0 +1,193 @@
+#include "console.hpp"
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+Console::Console() {
+	DWORD mode;
+
+	this->is_interactive = GetConsoleMode(GetStdHandle(STD_OUTPUT_HANDLE), &mode) != 0;
+}
+
+Console::~Console() = default;
+
+void Console::block_std_input() {
+	// Block standard input to be shown in the console
+	HANDLE h = GetStdHandle(STD_INPUT_HANDLE);
+	DWORD mode;
+
+	if (GetConsoleMode(h, &mode)) {
+		mode &= ~ENABLE_ECHO_INPUT;
+
+		SetConsoleMode(h, mode);
+	}
+}
+
+void Console::hide_cursor() {
+	HANDLE consoleHandle = GetStdHandle(STD_OUTPUT_HANDLE);
+	CONSOLE_CURSOR_INFO info;
+
+	info.dwSize = 100;
+	info.bVisible = FALSE;
+
+	SetConsoleCursorInfo(consoleHandle, &info);
+}
+
+int Console::get_pressed_keys() {
+	int keys = 0;
+
+	// Only listens to the keyboard while the console window is focused
+	if (GetConsoleWindow() != GetForegroundWindow()) {
+		return keys;
+	}
+
+	if (GetAsyncKeyState(VK_SPACE) & 0x01) {
+		keys |= CONSOLE_KEY_SPACE;
+	}
+
+	if (GetAsyncKeyState(VK_UP) & 0x01) {
+		keys |= CONSOLE_KEY_UP;
+	}
+
+	if (GetAsyncKeyState(VK_DOWN) & 0x01) {
+		keys |= CONSOLE_KEY_DOWN;
+	}
+
+	if (GetAsyncKeyState(VK_LEFT) & 0x01) {
+		keys |= CONSOLE_KEY_LEFT;
+	}
+
+	if (GetAsyncKeyState(VK_RIGHT) & 0x01) {
+		keys |= CONSOLE_KEY_RIGHT;
+	}
+
+	if (GetAsyncKeyState('Q') & 0x01) {
+		keys |= CONSOLE_KEY_QUIT;
+	}
+
+	return keys;
+}
+
+void Console::print_above(int num_lines, const char* text) {
+	if (!this->is_interactive) {
+		return;
+	}
+
+	CONSOLE_SCREEN_BUFFER_INFO info;
+	COORD line_cursor_position, current_cursor_position;
+
+	GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info);
+
+	current_cursor_position.X = 0;
+	current_cursor_position.Y = info.dwCursorPosition.Y;
+	line_cursor_position.X = 0;
+	line_cursor_position.Y = info.dwCursorPosition.Y - num_lines;
+
+	SetConsoleCursorPosition(GetStdHandle(STD_OUTPUT_HANDLE), line_cursor_position);
+	printf("%s", text);
+	SetConsoleCursorPosition(GetStdHandle(STD_OUTPUT_HANDLE), current_cursor_position);
+}
+
+#else
+
+Console::Console() {
+	this->is_interactive = isatty(STDOUT_FILENO) != 0;
+}
+
+Console::~Console() {
+	// Restores the terminal to the state it was found in
+	if (this->is_input_blocked) {
+		tcsetattr(STDIN_FILENO, TCSANOW, &this->original_input_mode);
+	}
+
+	if (this->is_cursor_hidden) {
+		printf("\033[?25h");
+		fflush(stdout);
+	}
+}
+
+void Console::block_std_input() {
+	// Block standard input to be shown in the console, and make it readable key by key without blocking
+	struct termios mode;
+
+	if (isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &this->original_input_mode) == 0) {
+		mode = this->original_input_mode;
+		mode.c_lflag &= ~(ECHO | ICANON);
+		mode.c_cc[VMIN] = 0;
+		mode.c_cc[VTIME] = 0;
+
+		this->is_input_blocked = tcsetattr(STDIN_FILENO, TCSANOW, &mode) == 0;
+	}
+}
+
+void Console::hide_cursor() {
+	if (this->is_interactive) {
+		printf("\033[?25l");
+		fflush(stdout);
+
+		this->is_cursor_hidden = true;
+	}
+}
+
+int Console::get_pressed_keys() {
+	int keys = 0;
+	char input[32];
+	ssize_t input_size;
+
+	if (!this->is_input_blocked) {
+		return keys;
+	}
+
+	// Consumes everything typed since the last check (arrow keys arrive as "ESC [ A" to "ESC [ D")
+	while ((input_size = read(STDIN_FILENO, input, sizeof(input))) > 0) {
+		for (ssize_t i = 0; i < input_size; i++) {
+			if (input[i] == ' ') {
+				keys |= CONSOLE_KEY_SPACE;
+			} else if (input[i] == 'q' || input[i] == 'Q') {
+				keys |= CONSOLE_KEY_QUIT;
+			} else if (input[i] == '\033' && i + 2 < input_size && input[i + 1] == '[') {
+				if (input[i + 2] == 'A') {
+					keys |= CONSOLE_KEY_UP;
+				} else if (input[i + 2] == 'B') {
+					keys |= CONSOLE_KEY_DOWN;
+				} else if (input[i + 2] == 'C') {
+					keys |= CONSOLE_KEY_RIGHT;
+				} else if (input[i + 2] == 'D') {
+					keys |= CONSOLE_KEY_LEFT;
+				}
+
+				i += 2;
+			}
+		}
+	}
+
+	return keys;
+}
+
+void Console::print_above(int num_lines, const char* text) {
+	if (!this->is_interactive) {
+		return;
+	}
+
+	// Saves the cursor, rewrites the line the given number of lines above it and restores the cursor
+	printf("\0337\033[%dA\r%s\033[K\0338", num_lines, text);
+	fflush(stdout);
+}
+
+#endif
+
+bool Console::is_terminal() {
+	return this->is_interactive;
+}
+
+void Console::clean_line(int num_chars) {
+	char blank_str[16];
+
+	sprintf(blank_str, "\r%%%is\r", num_chars);
+	printf(blank_str, "");
+}
@@ -0,0 +1,45 @@
+#ifndef WASABI_CONSOLE_HPP
+#define WASABI_CONSOLE_HPP
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <termios.h>
+#endif
+
+// Keys used to control the playback (as a bit mask of the keys pressed since the last check)
+#define CONSOLE_KEY_SPACE 0x01
+#define CONSOLE_KEY_UP 0x02
+#define CONSOLE_KEY_DOWN 0x04
+#define CONSOLE_KEY_LEFT 0x08
+#define CONSOLE_KEY_RIGHT 0x10
+#define CONSOLE_KEY_QUIT 0x20
+
+class Console {
+private:
+	bool is_interactive{};
+#ifndef _WIN32
+	bool is_input_blocked{};
+	bool is_cursor_hidden{};
+	struct termios original_input_mode{};
+#endif
+
+public:
+	Console();
+
+	~Console();
+
+	bool is_terminal();
+
+	void block_std_input();
+
+	void hide_cursor();
+
+	int get_pressed_keys();
+
+	void clean_line(int num_chars);
+
+	void print_above(int num_lines, const char* text);
+};
+
+#endif //WASABI_CONSOLE_HPP
@@ -0,0 +1,289 @@
+#include "decoded_audio_cache.hpp"
+#include <algorithm>
+#include <atomic>
+#include <sys/stat.h>
+#include <thread>
+#include "playlist.hpp"
+
+DecodedAudioSource::DecodedAudioSource(std::shared_ptr<const DECODED_AUDIO> decoded_audio) {
+	this->decoded_audio = std::move(decoded_audio);
+}
+
+uint64_t DecodedAudioSource::get_num_frames() {
+	return this->decoded_audio->data.size() / this->decoded_audio->format.block_align;
+}
+
+AUDIO_FORMAT DecodedAudioSource::get_format() {
+	return this->decoded_audio->format;
+}
+
+bool DecodedAudioSource::get_chunk(AUDIO_CHUNK &chunk, uint32_t max_size) {
+	size_t remaining_size = this->decoded_audio->data.size() - this->position;
+	uint32_t block_align = this->decoded_audio->format.block_align;
+
+	// Lends whole frames straight from the decoded audio
+	if (max_size >= block_align) {
+		max_size -= max_size % block_align;
+	}
+
+	chunk.data = this->decoded_audio->data.data() + this->position;
+	chunk.size = (uint32_t)std::min<size_t>(remaining_size, max_size);
+	chunk.is_eof = chunk.size == remaining_size;
+
+	return chunk.is_eof;
+}
+
+void DecodedAudioSource::release_chunk(AUDIO_CHUNK &chunk) {
+	this->position += chunk.size;
+
+	chunk.data = nullptr;
+	chunk.size = 0;
+}
+
+bool DecodedAudioSource::seek(uint64_t frame) {
+	this->position = (size_t)std::min<uint64_t>(frame, this->get_num_frames()) * this->decoded_audio->format.block_align;
+
+	return true;
+}
+
+DecodedAudioCache::DecodedAudioCache(uint64_t memory_budget) {
+	this->statistics.memory_budget = memory_budget;
+}
+
+bool DecodedAudioCache::get_file_key(const std::string &file_path, std::string &file_key) {
+	struct stat file_status{};
+
+	if (stat(file_path.c_str(), &file_status) != 0) {
+		return false;
+	}
+
+	file_key = file_path + '\n' + std::to_string((long long)file_status.st_mtime) + '\n' +
+		std::to_string((long long)file_status.st_size);
+
+	return true;
+}
+
+std::string DecodedAudioCache::get_key(const std::string &file_key, const AUDIO_FORMAT &format, DITHER_TYPE dither_type,
+	RESAMPLER_QUALITY resampler_quality) {
+	return file_key + '\n' + std::to_string(format.sample_rate) + ' ' + std::to_string(format.num_channels) + ' ' +
+		std::to_string(format.bit_depth) + ' ' + std::to_string(format.is_float) + ' ' +
+		std::to_string(format.channel_mask) + ' ' + std::to_string(dither_type) + ' ' + std::to_string(resampler_quality);
+}
+
+std::shared_ptr<const DECODED_AUDIO> DecodedAudioCache::decode(const std::string &file_path,
+	const AUDIO_FORMAT &format, DITHER_TYPE dither_type, RESAMPLER_QUALITY resampler_quality) {
+	// Decodes the file through the same chain as a playlist track, so the cached audio is the one that would be played
+	Playlist playlist(std::vector<std::string>{file_path}, false, dither_type, resampler_quality);
+
+	playlist.is_verbose = false;
+
+	if (!playlist.open() || !playlist.set_format(format)) {
+		return nullptr;
+	}
+
+	// Files that can't fit in the budget (or whose size is unknown) aren't decoded at all
+	uint64_t size = playlist.get_track_num_frames() * format.block_align;
+
+	{
+		std::lock_guard<std::mutex> lck(this->mtx);
+
+		if (size > this->statistics.memory_budget) {
+			return nullptr;
+		}
+	}
+
+	std::shared_ptr<DECODED_AUDIO> decoded_audio(new DECODED_AUDIO());
+	AUDIO_CHUNK chunk;
+	bool is_eof = false;
+
+	decoded_audio->file_format = playlist.get_track_format();
+	decoded_audio->format = format;
+	decoded_audio->duration = playlist.get_track_duration();
+	decoded_audio->data.reserve(size);
+
+	while (!is_eof) {
+		is_eof = playlist.get_chunk(chunk, UINT32_MAX);
+
+		decoded_audio->data.insert(decoded_audio->data.end(), chunk.data, chunk.data + chunk.size);
+
+		playlist.release_chunk(chunk);
+
+		// Waits for the readers when they have nothing ready (decoding isn't bound to a deadline)
+		if (chunk.size == 0 && !is_eof) {
+			playlist.wait_for_chunk(SOURCE_WAIT_INTERVAL);
+		}
+	}
+
+	return decoded_audio;
+}
+
+std::shared_ptr<const DECODED_AUDIO> DecodedAudioCache::touch(const std::string &key) {
+	auto entry = this->index.find(key);
+
+	if (entry == this->index.end()) {
+		return nullptr;
+	}
+
+	this->entries.splice(this->entries.begin(), this->entries, entry->second);
+
+	return entry->second->decoded_audio;
+}
+
+void DecodedAudioCache::make_room(uint64_t size) {
+	while (!this->entries.empty() && this->statistics.memory_usage + size > this->statistics.memory_budget) {
+		CACHE_ENTRY &entry = this->entries.back();
+
+		// Tracks still playing the audio keep it alive, it only leaves the cache
+		this->statistics.memory_usage -= entry.decoded_audio->data.size();
+		this->statistics.num_evictions += 1;
+		this->index.erase(entry.key);
+		this->entries.pop_back();
+	}
+
+	this->statistics.num_entries = this->entries.size();
+}
+
+bool DecodedAudioCache::insert(const std::string &key, const std::string &file_key,
+	std::shared_ptr<const DECODED_AUDIO> decoded_audio) {
+	uint64_t size = decoded_audio->data.size();
+
+	if (this->index.count(key) != 0 || size > this->statistics.memory_budget) {
+		return false;
+	}
+
+	this->make_room(size);
+
+	this->entries.push_front(CACHE_ENTRY{key, file_key, std::move(decoded_audio)});
+	this->index[key] = this->entries.begin();
+
+	this->statistics.memory_usage += size;
+	this->statistics.num_entries = this->entries.size();
+
+	return true;
+}
+
+void DecodedAudioCache::set_memory_budget(uint64_t memory_budget) {
+	std::lock_guard<std::mutex> lck(this->mtx);
+
+	this->statistics.memory_budget = memory_budget;
+
+	this->make_room(0);
+}
+
+bool DecodedAudioCache::is_enabled() {
+	std::lock_guard<std::mutex> lck(this->mtx);
+
+	return this->statistics.memory_budget > 0;
+}
+
+std::shared_ptr<const DECODED_AUDIO> DecodedAudioCache::find(const std::string &file_path, const AUDIO_FORMAT &format,
+	DITHER_TYPE dither_type, RESAMPLER_QUALITY resampler_quality) {
+	std::string file_key;
+
+	if (!get_file_key(file_path, file_key)) {
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lck(this->mtx);
+	std::shared_ptr<const DECODED_AUDIO> decoded_audio = this->touch(
+		get_key(file_key, format, dither_type, resampler_quality));
+
+	if (decoded_audio != nullptr) {
+		this->statistics.num_hits += 1;
+	}
+	else {
+		this->statistics.num_misses += 1;
+	}
+
+	return decoded_audio;
+}
+
+std::shared_ptr<const DECODED_AUDIO> DecodedAudioCache::find_file(const std::string &file_path) {
+	std::string file_key;
+
+	if (!get_file_key(file_path, file_key)) {
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lck(this->mtx);
+
+	for (const CACHE_ENTRY &entry : this->entries) {
+		if (entry.file_key == file_key) {
+			return entry.decoded_audio;
+		}
+	}
+
+	return nullptr;
+}
+
+size_t DecodedAudioCache::warm_up(const std::vector<std::string> &file_paths, const AUDIO_FORMAT &format,
+	DITHER_TYPE dither_type, RESAMPLER_QUALITY resampler_quality, unsigned num_workers) {
+	std::atomic<size_t> next_file_index{0};
+	std::atomic<size_t> num_decoded_files{0};
+	std::vector<std::thread> workers;
+
+	if (num_workers == 0) {
+		num_workers = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	num_workers = (unsigned)std::min<size_t>(num_workers, file_paths.size());
+
+	// Each worker takes the next file of the list until there is none left
+	auto decode_files = [&]() {
+		for (size_t index = next_file_index++; index < file_paths.size(); index = next_file_index++) {
+			std::string file_key;
+
+			if (!get_file_key(file_paths[index], file_key)) {
+				std::lock_guard<std::mutex> lck(this->mtx);
+
+				this->statistics.num_rejections += 1;
+
+				continue;
+			}
+
+			std::string key = get_key(file_key, format, dither_type, resampler_quality);
+
+			{
+				std::lock_guard<std::mutex> lck(this->mtx);
+
+				if (this->index.count(key) != 0) {
+					continue;
+				}
+			}
+
+			// Decodes outside of the lock, the other workers keep going
+			std::shared_ptr<const DECODED_AUDIO> decoded_audio = this->decode(file_paths[index], format, dither_type,
+				resampler_quality);
+			std::lock_guard<std::mutex> lck(this->mtx);
+
+			if (decoded_audio == nullptr) {
+				this->statistics.num_rejections += 1;
+
+				continue;
+			}
+
+			// The same file may have been decoded by another worker in the meantime
+			if (this->insert(key, file_key, std::move(decoded_audio))) {
+				this->statistics.num_warmed_files += 1;
+
+				num_decoded_files += 1;
+			}
+		}
+	};
+
+	for (unsigned i = 0; i < num_workers; i++) {
+		workers.emplace_back(decode_files);
+	}
+
+	for (std::thread &worker : workers) {
+		worker.join();
+	}
+
+	return num_decoded_files;
+}
+
+DECODED_AUDIO_CACHE_STATISTICS DecodedAudioCache::get_statistics() {
+	std::lock_guard<std::mutex> lck(this->mtx);
+
+	return this->statistics;
+}
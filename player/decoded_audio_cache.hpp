@@ -0,0 +1,121 @@
+#ifndef WASABI_DECODED_AUDIO_CACHE_HPP
+#define WASABI_DECODED_AUDIO_CACHE_HPP
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "audio_format.hpp"
+#include "audio_source.hpp"
+#include "format_converter.hpp"
+#include "resampler.hpp"
+
+// Audio of a file fully converted to the format of a sink
+typedef struct DECODED_AUDIO {
+	AUDIO_FORMAT file_format; // Format of the file it was decoded from
+	AUDIO_FORMAT format;
+	std::vector<uint8_t> data;
+	int duration{}; // Duration of the file (in seconds, 0 when unknown)
+} DECODED_AUDIO;
+
+typedef struct DECODED_AUDIO_CACHE_STATISTICS {
+	uint64_t num_hits{};
+	uint64_t num_misses{};
+	uint64_t num_warmed_files{}; // Files decoded by the warm-up
+	uint64_t num_evictions{};
+	uint64_t num_rejections{}; // Files that couldn't be decoded or didn't fit in the memory budget
+	uint64_t num_entries{};
+	uint64_t memory_usage{}; // In bytes
+	uint64_t memory_budget{}; // In bytes
+} DECODED_AUDIO_CACHE_STATISTICS;
+
+// Source lending the chunks of a decoded audio straight from the cache (it keeps the audio alive when it's evicted)
+class DecodedAudioSource : public AudioSource {
+private:
+	std::shared_ptr<const DECODED_AUDIO> decoded_audio;
+	size_t position{};
+
+public:
+	explicit DecodedAudioSource(std::shared_ptr<const DECODED_AUDIO> decoded_audio);
+
+	uint64_t get_num_frames();
+
+	AUDIO_FORMAT get_format() override;
+
+	bool get_chunk(AUDIO_CHUNK &chunk, uint32_t max_size) override;
+
+	void release_chunk(AUDIO_CHUNK &chunk) override;
+
+	bool seek(uint64_t frame) override;
+};
+
+// In-process cache of decoded audio, so short files played again and again are neither read nor converted twice. The
+// entries are keyed by the path of the file, its modification time and size (a modified file is decoded again) and
+// the format it was converted to (along with the dither and the resampler quality), and they are evicted in least
+// recently used order to stay within a memory budget. It can be warmed from a list of files by a pool of workers
+// decoding them in parallel.
+class DecodedAudioCache {
+private:
+	typedef struct CACHE_ENTRY {
+		std::string key;
+		std::string file_key;
+		std::shared_ptr<const DECODED_AUDIO> decoded_audio;
+	} CACHE_ENTRY;
+
+	std::mutex mtx;
+	// Most recently used first
+	std::list<CACHE_ENTRY> entries;
+	std::unordered_map<std::string, std::list<CACHE_ENTRY>::iterator> index;
+	DECODED_AUDIO_CACHE_STATISTICS statistics;
+
+	// Identifies the current version of a file (path, modification time and size), returns false if it doesn't exist
+	static bool get_file_key(const std::string &file_path, std::string &file_key);
+
+	static std::string get_key(const std::string &file_key, const AUDIO_FORMAT &format, DITHER_TYPE dither_type,
+		RESAMPLER_QUALITY resampler_quality);
+
+	std::shared_ptr<const DECODED_AUDIO> decode(const std::string &file_path, const AUDIO_FORMAT &format,
+		DITHER_TYPE dither_type, RESAMPLER_QUALITY resampler_quality);
+
+	// Moves an entry to the front of the list (the lock must be held)
+	std::shared_ptr<const DECODED_AUDIO> touch(const std::string &key);
+
+	// Evicts the least recently used entries until the given size fits in the budget (the lock must be held)
+	void make_room(uint64_t size);
+
+	// Adds an entry unless it's already cached or can't fit in the budget, returns whether it was added (the lock must
+	// be held)
+	bool insert(const std::string &key, const std::string &file_key, std::shared_ptr<const DECODED_AUDIO> decoded_audio);
+
+public:
+	explicit DecodedAudioCache(uint64_t memory_budget = 0);
+
+	DecodedAudioCache(DecodedAudioCache const &decoded_audio_cache) = delete;
+
+	DecodedAudioCache &operator=(DecodedAudioCache const &decoded_audio_cache) = delete;
+
+	// Sets the memory budget (in bytes, 0 disables the cache), evicting entries if it's reduced
+	void set_memory_budget(uint64_t memory_budget);
+
+	bool is_enabled();
+
+	// Gets the audio of the current version of the file converted to the given format, or nullptr if it isn't cached
+	std::shared_ptr<const DECODED_AUDIO> find(const std::string &file_path, const AUDIO_FORMAT &format,
+		DITHER_TYPE dither_type, RESAMPLER_QUALITY resampler_quality);
+
+	// Gets the most recently used audio of the current version of the file in any format, or nullptr (it only
+	// describes the file, so it's neither counted as a hit nor as a miss)
+	std::shared_ptr<const DECODED_AUDIO> find_file(const std::string &file_path);
+
+	// Decodes the files that aren't cached yet in the given format, spreading them over a pool of workers (one per
+	// core when 0), returns the number of files decoded
+	size_t warm_up(const std::vector<std::string> &file_paths, const AUDIO_FORMAT &format, DITHER_TYPE dither_type,
+		RESAMPLER_QUALITY resampler_quality, unsigned num_workers = 0);
+
+	DECODED_AUDIO_CACHE_STATISTICS get_statistics();
+};
+
+#endif //WASABI_DECODED_AUDIO_CACHE_HPP
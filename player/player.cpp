@@ -1,173 +1,664 @@
 #include "player.hpp"
-
-Player::Player() = default;
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include "instrumentation.hpp"
+Player::Player() {
+	this->console.block_std_input();
+	this->console.hide_cursor();
+}
 
 Player::~Player() = default;
 
-void Player::clean_line(int num_chars) {
-	char blank_str[16];
+static void format_volume(char* volume_status, size_t size, double volume) {
+	if (volume <= GAIN_SILENCE_DB) {
+		snprintf(volume_status, size, "Volume: muted");
+	}
+	else {
+		snprintf(volume_status, size, "Volume: %.1f dB", volume);
+	}
+}
+
+// Writes a level as a JSON number (silence, at -infinity, is written as null)
+static void write_json_level(FILE* file, float level) {
+	if (std::isfinite(level)) {
+		fprintf(file, "%.2f", level);
+	}
+	else {
+		fprintf(file, "null");
+	}
+}
+
+static void write_json_levels(FILE* file, const float* levels, uint16_t num_levels) {
+	fprintf(file, "[");
+
+	for (uint16_t i = 0; i < num_levels; i++) {
+		fprintf(file, i > 0 ? ", " : "");
+		write_json_level(file, levels[i]);
+	}
+
+	fprintf(file, "]");
+}
 
-	sprintf(blank_str, "\r%%%is\r", num_chars);
-	printf(blank_str, "");
+// Writes a reading of the meter as a line of JSON (levels in dBFS, loudness in LUFS)
+static void write_meter_reading(FILE* file, const METER_READING& reading, uint32_t sample_rate) {
+	fprintf(file, "{\"type\": \"reading\", \"time\": %.3f, \"position\": %llu, \"peak\": ",
+		(double)reading.position / sample_rate, (unsigned long long)reading.position);
+	write_json_levels(file, reading.peaks, reading.num_channels);
+	fprintf(file, ", \"rms\": ");
+	write_json_levels(file, reading.rms_levels, reading.num_channels);
+	fprintf(file, ", \"momentary\": ");
+	write_json_level(file, reading.momentary_loudness);
+	fprintf(file, ", \"short_term\": ");
+	write_json_level(file, reading.short_term_loudness);
+	fprintf(file, ", \"integrated\": ");
+	write_json_level(file, reading.integrated_loudness);
+	fprintf(file, "}\n");
 }
 
-void Player::play_audio_stream(std::string file_path, int rendering_endpoint_buffer_duration) {
+static void write_meter_summary(FILE* file, const METER_SUMMARY& summary) {
+	fprintf(file, "{\"type\": \"summary\", \"max_peak\": ");
+	write_json_levels(file, summary.max_peaks, summary.num_channels);
+	fprintf(file, ", \"max_momentary\": ");
+	write_json_level(file, summary.max_momentary_loudness);
+	fprintf(file, ", \"max_short_term\": ");
+	write_json_level(file, summary.max_short_term_loudness);
+	fprintf(file, ", \"integrated\": ");
+	write_json_level(file, summary.integrated_loudness);
+	fprintf(file, ", \"blocks\": %llu, \"dropped_readings\": %llu}\n", (unsigned long long)summary.num_blocks,
+		(unsigned long long)summary.num_dropped_readings);
+}
+
+static float get_max_level(const float* levels, uint16_t num_levels) {
+	float max_level = -INFINITY;
+
+	for (uint16_t i = 0; i < num_levels; i++) {
+		max_level = std::max(max_level, levels[i]);
+	}
+
+	return max_level;
+}
+
+// Reports the latencies of the pipeline stages and its incidents, and writes the events as a Chrome trace if asked
+static void report_instrumentation(const PLAYBACK_OPTIONS& options) {
+	static const char* stage_names[TRACE_NUM_STAGES] = {"I/O", "Hand-off", "Refill", "Write"};
+	INSTRUMENTATION_SUMMARY summary = get_instrumentation_summary();
+
+	printf("[Latencies (us):     count       p50       p90       p99     p99.9       max]\n");
+
+	for (int stage = 0; stage < TRACE_NUM_STAGES; stage++) {
+		const LATENCY_HISTOGRAM& histogram = summary.histograms[stage];
+
+		printf("[  %-9s %14llu %9.1f %9.1f %9.1f %9.1f %9.1f]\n", stage_names[stage],
+			(unsigned long long)histogram.num_values, get_latency_percentile(histogram, 50.0) / 1000.0,
+			get_latency_percentile(histogram, 90.0) / 1000.0, get_latency_percentile(histogram, 99.0) / 1000.0,
+			get_latency_percentile(histogram, 99.9) / 1000.0, histogram.max_value / 1000.0);
+	}
+
+	printf("[Underruns: %llu, late refills: %llu, reader stalls: %llu]\n",
+		(unsigned long long)summary.counts[TRACE_UNDERRUN], (unsigned long long)summary.counts[TRACE_LATE_REFILL],
+		(unsigned long long)summary.counts[TRACE_READER_STALL]);
+
+	if (options.trace_output_path.empty()) {
+		return;
+	}
+
+	int64_t num_written_events = write_chrome_trace(options.trace_output_path);
+
+	if (num_written_events < 0) {
+		std::cerr << "WARNING: Unable to open \"" << options.trace_output_path << "\", the trace won't be written."
+			<< std::endl;
+	}
+	else {
+		printf("[Trace: %lld events written to \"%s\" (%llu dropped)]\n", (long long)num_written_events,
+			options.trace_output_path.c_str(), (unsigned long long)summary.num_dropped_events);
+	}
+}
+
+static const char* get_render_priority_name(RENDER_PRIORITY priority) {
+	switch (priority) {
+	case RENDER_PRIORITY_MMCSS:
+		return "MMCSS Pro Audio";
+	case RENDER_PRIORITY_FIFO:
+		return "SCHED_FIFO";
+	case RENDER_PRIORITY_RR:
+		return "SCHED_RR";
+	default:
+		return "normal (real-time scheduling not permitted)";
+	}
+}
+
+void Player::play_audio_stream(const PLAYBACK_OPTIONS& options) {
 	// Declares variables to control the playback
-	bool stop = FALSE;
-	bool playing = FALSE;
+	bool playing = false;
+	double rendering_endpoint_buffer_duration = options.rendering_endpoint_buffer_duration;
+
+	// Enabled before the readers start loading, so their first reads are measured
+	if (options.is_instrumented) {
+		start_instrumentation(!options.trace_output_path.empty());
+	}
+
+	// Instantiates the playlist and opens its first track
+	Playlist playlist(options.file_paths, options.use_memory_map, options.dither_type, options.resampler_quality);
+
+	playlist.is_mixed = options.is_mixed;
+
+	// The decoded audio cache outlives the plays, so the files played again are taken from memory (the mixed files
+	// are read from their sources)
+	this->decoded_audio_cache.set_memory_budget(options.is_mixed ? 0 : options.cache_size);
+
+	if (this->decoded_audio_cache.is_enabled()) {
+		playlist.set_decoded_audio_cache(&this->decoded_audio_cache);
+	}
+
+	if (!playlist.open()) {
+		return;
+	}
+
+	// Instantiates the audio sink the stream will be rendered to (in the requested sample format and rate, if any,
+	// otherwise in the one of the first track)
+	AUDIO_FORMAT file_format = playlist.get_track_format();
+	OUTPUT_SESSION_CONFIG output_config;
+
+	output_config.sink_type = options.sink_type;
+	output_config.output_file_path = options.output_file_path;
+	output_config.rendering_endpoint_buffer_duration = rendering_endpoint_buffer_duration;
+	output_config.is_exclusive = options.is_exclusive;
+	output_config.stream_format = make_audio_format(
+		options.output_sample_rate != 0 ? options.output_sample_rate : file_format.sample_rate,
+		options.output_num_channels != 0 ? options.output_num_channels : file_format.num_channels,
+		options.output_bit_depth != 0 ? options.output_bit_depth : file_format.bit_depth,
+		options.output_bit_depth != 0 ? options.is_output_float : file_format.is_float,
+		options.output_num_channels != 0 ? 0 : file_format.channel_mask);
+
+	// Reuses the sink of the previous play when possible (only renegotiating its format if the stream format changed)
+	auto sink_open_start_time = std::chrono::steady_clock::now();
+	uint64_t num_reused_sinks = this->output_session.get_num_reused_sinks();
+	AudioSink* sink = this->output_session.open(output_config);
+
+	if (sink == nullptr) {
+		return;
+	}
+
+	printf("[%s the audio sink in %.3f ms]\n",
+		this->output_session.get_num_reused_sinks() != num_reused_sinks ? "Reused" : "Opened",
+		std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sink_open_start_time).count());
+
+	// Converts every track to the format of the sink (devices may only accept their mix format)
+	AUDIO_FORMAT format = sink->get_format();
+
+	// Decodes the files that aren't cached yet in the format of the sink, in parallel, before the playback starts
+	if (this->decoded_audio_cache.is_enabled()) {
+		auto warm_up_start_time = std::chrono::steady_clock::now();
+		size_t num_warmed_files = this->decoded_audio_cache.warm_up(options.file_paths, format, options.dither_type,
+			options.resampler_quality);
+
+		printf("[Warmed the decoded audio cache with %zu files in %.3f ms]\n", num_warmed_files,
+			std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - warm_up_start_time).count());
+	}
+
+	if (!playlist.set_format(format)) {
+		return;
+	}
+
+	// Scales the stream in the pipeline (sample accurate and the same on every sink) rather than through the volume of
+	// the audio session
+	GainStage gain_stage(&playlist, options.dither_type);
+	double volume = sink->is_realtime() ? INITIAL_VOLUME : 0.0;
 
-	// Instantiates a wasapi object
-	WASAPI wasapi = WASAPI(rendering_endpoint_buffer_duration);
+	if (!gain_stage.is_supported()) {
+		std::cerr << "ERROR: The volume can't be applied to the sample format of the sink." << std::endl;
 
-	// Set audio session volume to the half of the current system volume
-	double volume = 0.5;
-	wasapi.set_volume(volume);
+		return;
+	}
 
-	std::cout << "Rendering endpoint buffer duration: " << rendering_endpoint_buffer_duration * 1000 << " ms"
-		<< std::endl;
-	std::cout << "Internal buffer duration: " << rendering_endpoint_buffer_duration * 5000 << " ms" << std::endl;
+	gain_stage.set_gain_db((float)volume, 0);
 
-	// Instantiates a wav format reader object
-	WAVReader wav_reader = WAVReader();
-	wav_reader.load_file(&file_path);
+	// The endpoint may round the requested duration (to whole device periods in exclusive mode)
+	printf("Rendering endpoint buffer duration: %.3f ms (%.3f ms requested)\n",
+		1000.0 * sink->get_buffer_size() / format.sample_rate, rendering_endpoint_buffer_duration);
+	std::cout << "Internal buffer duration: " << MAX_AUDIO_BUFFER_CHUNKS * 1000 << " ms" << std::endl;
 
 	// Declares and initializes the variables that will keep track of the playing time
 	int current_minutes = 0;
 	int current_seconds = 0;
-	int current_milliseconds = 0;
+	int displayed_seconds = -1;
 
-	// Declares and initializes the playback cycle in milliseconds
-	int cycle_duration = 100;
+	// Declares and initializes the time (in milliseconds) the console waits between two updates
+	int cycle_duration = 50;
 
-	// Declares the variables that will hold the chunk of audio data that will be written to the rendering endpoint buffer
-	BYTE* chunk = nullptr;
-	uint32_t chunk_size;
+	// Declares the variable that will store the status of the keys that are used to control the playback
+	int pressed_keys = 0;
 
-	// Declares the variables that will store the status of some specific keys that are used to control the playback
-	SHORT space_key = 0x0;
-	SHORT up_key = 0x0;
-	SHORT down_key = 0x0;
-
-	// Declares the variables that will control the playback
-	bool is_paused = FALSE;
-	bool is_window_focused = FALSE;
+	// Declares the variable that will control the playback
+	bool is_paused = false;
 
 	// Declares and initializes a variable that will hold the number of characters written to the console when updating the playback information
 	int num_chars_written = 0;
 
-	// Declares the variable that will store the playback information
-	char* playback_status = (char*)malloc(42 * sizeof(char));
+	// Declares the variables that will store the playback information (the status line stays empty until the playing
+	// time is first displayed, pausing may come before it)
+	char playback_status[128] = "";
+	char volume_status[32];
 
-	CONSOLE_SCREEN_BUFFER_INFO info;
-	COORD volume_cursor_position, current_time_cursor_position;
+	// Declares the variables that will store the track whose playing time is displayed, and the next track written to
+	// the sink, announced once it's heard
+	size_t displayed_track_index = SIZE_MAX;
+	uint64_t displayed_track_start_position = 0;
+	RENDER_EVENT pending_event;
+	bool has_pending_event = false;
 
-	while (stop == FALSE) {
-		if (!is_paused) {
-			if ((current_milliseconds + 1000) % (rendering_endpoint_buffer_duration * 1000) == 0) {
-				// Load the audio data chunk in the rendering endpoint buffer
-				stop = wav_reader.get_chunk(&chunk, chunk_size);
+	// Declares and initializes the position (in frames of the sink) the stream starts from
+	uint64_t start_position = 0;
 
-				// Write the audio data chunk in the rendering endpoint buffer
-				wasapi.write_chunk(chunk, chunk_size, stop);
+	if (options.start_time > 0.0) {
+		uint64_t start_frame = (uint64_t)(options.start_time * format.sample_rate);
 
-				if (playing == FALSE) {
-					std::cout << std::endl << "[Starting to play the file]" << std::endl;
-					printf("Volume: %.1f\n", volume);
+		if (playlist.seek(start_frame)) {
+			start_position = start_frame;
+		}
+	}
 
-					GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info);
-					volume_cursor_position.X = 0;
-					volume_cursor_position.Y = info.dwCursorPosition.Y - 1;
+	// Measures what's written to the sink (the readings are taken once their frames are being played)
+	std::unique_ptr<Meter> meter;
+	FILE* meter_output_file = nullptr;
+	METER_READING pending_reading;
+	METER_READING displayed_reading;
+	bool has_pending_reading = false;
+	bool has_displayed_reading = false;
 
-					current_time_cursor_position.X = 0;
-					current_time_cursor_position.Y = volume_cursor_position.Y + 2;
+	if (options.is_metered) {
+		meter.reset(new Meter(&gain_stage, start_position));
 
-					printf("Audio duration: %dm %.2ds\n", wav_reader.audio_duration.minutes, wav_reader.audio_duration.seconds);
+		if (!meter->is_supported()) {
+			std::cerr << "ERROR: The sample format of the sink can't be measured." << std::endl;
 
-					wasapi.start();
+			return;
+		}
+
+		if (!options.meter_output_path.empty()) {
+			meter_output_file = fopen(options.meter_output_path.c_str(), "w");
 
-					playing = TRUE;
+			if (meter_output_file == nullptr) {
+				std::cerr << "WARNING: Unable to open \"" << options.meter_output_path
+					<< "\", the readings of the meter won't be written." << std::endl;
+			}
+		}
+	}
+
+	// Renders the stream on its own thread, this one only handles the console from now on
+	RenderThread render_thread(sink, &playlist, &gain_stage, meter.get(), start_position);
+
+	render_thread.start();
+
+	while (true) {
+		// Checked first, so the events and the position read afterwards are the last ones once it has finished
+		bool is_finished = render_thread.is_finished();
+
+		if (!playing && render_thread.is_started()) {
+			std::cout << std::endl << "[Starting to play the file]" << std::endl;
+
+			if (sink->is_realtime()) {
+				std::cout << "[Render thread priority: " << get_render_priority_name(render_thread.get_priority()) << "]"
+					<< std::endl;
+			}
+
+			format_volume(volume_status, sizeof(volume_status), volume);
+			printf("%s\n", volume_status);
+
+			playing = true;
+		}
+
+		if (playing) {
+			uint64_t played_position = render_thread.get_played_position();
+
+			// Announces each track once its first frame is being played (the previous one may still be buffered)
+			while (has_pending_event || render_thread.receive_event(pending_event)) {
+				has_pending_event = true;
+
+				if (played_position < pending_event.track_start_position) {
+					break;
 				}
+
+				if (displayed_track_index != SIZE_MAX) {
+					if (sink->is_realtime()) {
+						this->console.clean_line(sizeof(playback_status));
+					}
+
+					printf("\n[Playing \"%s\"]\n", options.file_paths[pending_event.track_index].c_str());
+				}
+
+				printf("Audio duration: %dm %.2ds\n", pending_event.track_duration / 60,
+					pending_event.track_duration % 60);
+
+				displayed_track_index = pending_event.track_index;
+				displayed_track_start_position = pending_event.track_start_position;
+				displayed_seconds = -1;
+				has_pending_event = false;
 			}
 
-			// Print the playback information
-			sprintf(playback_status, "\rCurrent time: %dm %.2ds", current_minutes, current_seconds);
-			printf(playback_status, 33);
-			fflush(stdout);
+			// Takes the readings of the frames being played (the ones written ahead are kept for the next updates)
+			bool is_meter_updated = false;
+
+			while (meter != nullptr && (has_pending_reading || meter->receive_reading(pending_reading))) {
+				has_pending_reading = true;
 
-			if (current_milliseconds == 1000) {
-				current_seconds += 1;
-				current_milliseconds = 0;
+				if (!is_finished && played_position < pending_reading.position) {
+					break;
+				}
 
-				if (current_seconds == 60) {
-					current_minutes += 1;
-					current_seconds = 0;
+				if (meter_output_file != nullptr) {
+					write_meter_reading(meter_output_file, pending_reading, format.sample_rate);
 				}
+
+				displayed_reading = pending_reading;
+				has_displayed_reading = true;
+				has_pending_reading = false;
+				is_meter_updated = true;
 			}
 
-			current_milliseconds += cycle_duration;
+			// Print the playback information (the playing time is only meaningful for sinks that consume in real time)
+			if (sink->is_realtime() && !is_paused && displayed_track_index != SIZE_MAX) {
+				current_seconds = (int)((played_position - std::min(displayed_track_start_position, played_position)) /
+					format.sample_rate);
+				current_minutes = current_seconds / 60;
+				current_seconds = current_seconds % 60;
+
+				if (current_seconds != displayed_seconds || is_meter_updated) {
+					int status_size = sprintf(playback_status, "\rCurrent time: %dm %.2ds", current_minutes,
+						current_seconds);
+
+					// The fields have a fixed width, so a shorter reading doesn't leave characters of the previous one
+					if (has_displayed_reading) {
+						sprintf(playback_status + status_size, "  M %6.1f  S %6.1f  I %6.1f LUFS  Peak %6.1f dBFS",
+							displayed_reading.momentary_loudness, displayed_reading.short_term_loudness,
+							displayed_reading.integrated_loudness,
+							get_max_level(displayed_reading.peaks, displayed_reading.num_channels));
+					}
+
+					printf("%s", playback_status);
+					fflush(stdout);
+
+					displayed_seconds = current_seconds;
+				}
+			}
+		}
+
+		if (is_finished) {
+			break;
 		}
 
 		// Check if a key was pressed
-		is_window_focused = (GetConsoleWindow() == GetForegroundWindow());
+		pressed_keys = this->console.get_pressed_keys();
 
-		if (is_window_focused) {
-			space_key = GetAsyncKeyState(VK_SPACE);
-			up_key = GetAsyncKeyState(VK_UP);
-			down_key = GetAsyncKeyState(VK_DOWN);
-		}
+		if (pressed_keys & CONSOLE_KEY_SPACE) {
+			RENDER_COMMAND command;
+
+			if (is_paused == false) {
+				command.type = RENDER_COMMAND_PAUSE;
 
-		if (space_key & 0x01) {
-			if (is_paused == FALSE) {
-				wasapi.stop();
+				size_t status_size = strlen(playback_status);
 
-				sprintf(playback_status + strlen(playback_status), " [PAUSED]", current_minutes, current_seconds);
-				num_chars_written = printf(playback_status);
+				snprintf(playback_status + status_size, sizeof(playback_status) - status_size, " [PAUSED]");
+				num_chars_written = printf("%s", playback_status);
 				fflush(stdout);
 
-				is_paused = TRUE;
+				is_paused = true;
 			}
 			else {
-				wasapi.start();
+				command.type = RENDER_COMMAND_RESUME;
 
-				clean_line(num_chars_written);
+				this->console.clean_line(num_chars_written);
 				sprintf(playback_status, "\rCurrent time: %dm %.2ds", current_minutes, current_seconds);
-				printf(playback_status, 33);
+				printf("%s", playback_status);
 				fflush(stdout);
 
-				is_paused = FALSE;
+				is_paused = false;
 			}
+
+			render_thread.send_command(command);
 		}
 
-		if (up_key & 0x01 && volume < 1.0) {
-			volume += 0.1;
+		if (pressed_keys & (CONSOLE_KEY_UP | CONSOLE_KEY_DOWN)) {
+			double previous_volume = volume;
+
+			if (pressed_keys & CONSOLE_KEY_UP) {
+				volume = std::min(volume + VOLUME_STEP, 0.0);
+			}
+
+			if (pressed_keys & CONSOLE_KEY_DOWN) {
+				volume = std::max(volume - VOLUME_STEP, (double)GAIN_SILENCE_DB);
+			}
+
+			if (volume != previous_volume) {
+				RENDER_COMMAND command;
 
-			if (volume > 1.0) {
-				volume = 1.0;
+				command.type = RENDER_COMMAND_SET_VOLUME;
+				command.volume = (float)volume;
+
+				render_thread.send_command(command);
+
+				format_volume(volume_status, sizeof(volume_status), volume);
+				this->console.print_above(2, volume_status);
 			}
+		}
 
-			wasapi.set_volume(volume);
+		if (pressed_keys & (CONSOLE_KEY_LEFT | CONSOLE_KEY_RIGHT) && playing) {
+			RENDER_COMMAND command;
+			int64_t seek_step = (int64_t)SEEK_STEP_DURATION * format.sample_rate;
 
-			SetConsoleCursorPosition(GetStdHandle(STD_OUTPUT_HANDLE), volume_cursor_position);
-			printf("Volume: %.1f\n", volume);
-			SetConsoleCursorPosition(GetStdHandle(STD_OUTPUT_HANDLE), current_time_cursor_position);
+			command.type = RENDER_COMMAND_SEEK;
+			command.seek_offset = pressed_keys & CONSOLE_KEY_LEFT ? -seek_step : seek_step;
+
+			render_thread.send_command(command);
+
+			displayed_seconds = -1;
 		}
 
-		if (down_key & 0x01 && volume > 0.0) {
-			volume -= 0.1;
+		// Stops the playback (fading it out on the sinks that are heard)
+		if (pressed_keys & CONSOLE_KEY_QUIT) {
+			RENDER_COMMAND command;
+
+			command.type = RENDER_COMMAND_STOP;
+
+			render_thread.send_command(command);
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(cycle_duration));
+	}
+
+	render_thread.join();
+
+	// Reports how fast the stream was rendered (mostly useful with the sinks that don't consume in real time)
+	RENDER_STATISTICS render_statistics = render_thread.get_statistics();
+	double rendered_seconds = (double)render_statistics.num_rendered_frames / format.sample_rate;
+
+	AUDIO_SINK_STATISTICS statistics = sink->get_statistics();
+
+	printf("\n\n[Rendered %.2f s of audio in %.3f s (%.1fx real time)]\n", rendered_seconds,
+		render_statistics.elapsed_seconds, render_statistics.elapsed_seconds > 0 ?
+		rendered_seconds / render_statistics.elapsed_seconds : 0.0);
+	printf("[Refills: %llu, underruns: %llu, overruns: %llu, reader stalls: %llu]\n",
+		(unsigned long long)statistics.num_refills, (unsigned long long)statistics.num_underruns,
+		(unsigned long long)statistics.num_overruns, (unsigned long long)playlist.get_num_reader_stalls());
+
+	uint64_t num_decode_errors = playlist.get_num_decode_errors();
+
+	if (num_decode_errors > 0) {
+		printf("[Decode errors: %llu blocks played as silence]\n", (unsigned long long)num_decode_errors);
+	}
+
+	if (render_statistics.num_latency_samples > 0) {
+		printf("[Output latency: min %.3f ms, avg %.3f ms, max %.3f ms]\n",
+			render_statistics.min_output_latency * 1000.0,
+			render_statistics.total_output_latency / render_statistics.num_latency_samples * 1000.0,
+			render_statistics.max_output_latency * 1000.0);
+	}
+
+	if (meter != nullptr) {
+		METER_SUMMARY summary = meter->get_summary();
+
+		printf("[Loudness: %.1f LUFS integrated, %.1f LUFS max short-term, %.1f LUFS max momentary, %.1f dBFS sample "
+			"peak]\n", summary.integrated_loudness, summary.max_short_term_loudness, summary.max_momentary_loudness,
+			get_max_level(summary.max_peaks, summary.num_channels));
+
+		if (meter_output_file != nullptr) {
+			write_meter_summary(meter_output_file, summary);
+			fclose(meter_output_file);
+		}
+	}
+
+	if (this->decoded_audio_cache.is_enabled()) {
+		DECODED_AUDIO_CACHE_STATISTICS cache_statistics = this->decoded_audio_cache.get_statistics();
+
+		printf("[Decoded audio cache: %llu hits, %llu misses, %llu entries, %.1f of %.1f MB used, %llu evictions, "
+			"%llu rejections]\n", (unsigned long long)cache_statistics.num_hits,
+			(unsigned long long)cache_statistics.num_misses, (unsigned long long)cache_statistics.num_entries,
+			cache_statistics.memory_usage / 1048576.0, cache_statistics.memory_budget / 1048576.0,
+			(unsigned long long)cache_statistics.num_evictions, (unsigned long long)cache_statistics.num_rejections);
+	}
+
+	if (options.is_instrumented) {
+		report_instrumentation(options);
+	}
+}
+
+void Player::render_audio_stream(const PLAYBACK_OPTIONS& options) {
+	// The stream is written to the sink by this thread, which refills it as the render thread does for the playback
+	if (options.is_instrumented) {
+		start_instrumentation(!options.trace_output_path.empty());
+		register_trace_thread("Writer", TRACE_THREAD_EVENTS);
+	}
 
-			if (volume < 0.0) {
-				volume = 0.0;
+	// Opens the first track, whose format the output is chosen from (as for the playback)
+	SegmentRenderer renderer(options.file_paths, options.use_memory_map, options.dither_type, options.resampler_quality,
+		options.is_mixed, options.num_render_threads);
+
+	if (!renderer.open()) {
+		return;
+	}
+
+	// Writes a WAV file unless raw samples were asked for
+	AUDIO_FORMAT file_format = renderer.get_track_format();
+	OUTPUT_SESSION_CONFIG output_config;
+
+	output_config.sink_type = options.sink_type == SINK_RAW_FILE ? SINK_RAW_FILE : SINK_WAV_FILE;
+	output_config.output_file_path = options.render_output_path;
+	output_config.stream_format = make_audio_format(
+		options.output_sample_rate != 0 ? options.output_sample_rate : file_format.sample_rate,
+		options.output_num_channels != 0 ? options.output_num_channels : file_format.num_channels,
+		options.output_bit_depth != 0 ? options.output_bit_depth : file_format.bit_depth,
+		options.output_bit_depth != 0 ? options.is_output_float : file_format.is_float,
+		options.output_num_channels != 0 ? 0 : file_format.channel_mask);
+
+	AudioSink* sink = this->output_session.open(output_config);
+
+	if (sink == nullptr) {
+		return;
+	}
+
+	AUDIO_FORMAT format = sink->get_format();
+	auto render_start_time = std::chrono::steady_clock::now();
+
+	if (!renderer.set_format(format, (uint64_t)(std::max(options.start_time, 0.0) * format.sample_rate))) {
+		return;
+	}
+
+	printf("\n[Rendering to \"%s\": %zu tracks, %zu segments, %u workers]\n", options.render_output_path.c_str(),
+		renderer.get_num_tracks(), renderer.get_num_segments(), renderer.get_num_threads());
+
+	// Measures the stream in order, as it's written
+	std::unique_ptr<Meter> meter;
+	FILE* meter_output_file = nullptr;
+	METER_READING reading;
+
+	if (options.is_metered) {
+		meter.reset(new Meter(&renderer));
+
+		if (!meter->is_supported()) {
+			std::cerr << "ERROR: The sample format of the output can't be measured." << std::endl;
+
+			return;
+		}
+
+		if (!options.meter_output_path.empty()) {
+			meter_output_file = fopen(options.meter_output_path.c_str(), "w");
+
+			if (meter_output_file == nullptr) {
+				std::cerr << "WARNING: Unable to open \"" << options.meter_output_path
+					<< "\", the readings of the meter won't be written." << std::endl;
+			}
+		}
+	}
+
+	// Writes the stream as fast as the segments are rendered (the file sink takes whatever it's given)
+	AudioSource* output = meter != nullptr ? (AudioSource*)meter.get() : &renderer;
+	bool is_eof = false;
+
+	sink->start();
+
+	while (!is_eof) {
+		uint64_t refill_start_time = begin_trace_span();
+		uint32_t num_written_frames = sink->refill(*output, is_eof);
+
+		end_trace_span(TRACE_REFILL, refill_start_time, num_written_frames);
+
+		// Waits for the segment being rendered rather than polling it
+		if (num_written_frames == 0 && !is_eof) {
+			output->wait_for_chunk(SOURCE_WAIT_INTERVAL);
+		}
+
+		while (meter != nullptr && meter->receive_reading(reading)) {
+			if (meter_output_file != nullptr) {
+				write_meter_reading(meter_output_file, reading, format.sample_rate);
 			}
+		}
+	}
+
+	sink->stop();
+	renderer.join();
+
+	double elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - render_start_time).count();
+	double rendered_seconds = (double)sink->get_statistics().num_written_frames / format.sample_rate;
 
-			wasapi.set_volume(volume);
+	printf("\n[Rendered %.2f s of audio in %.3f s (%.1fx real time)]\n", rendered_seconds, elapsed_seconds,
+		elapsed_seconds > 0 ? rendered_seconds / elapsed_seconds : 0.0);
+	printf("[Reader stalls: %llu]\n", (unsigned long long)renderer.get_num_reader_stalls());
 
-			SetConsoleCursorPosition(GetStdHandle(STD_OUTPUT_HANDLE), volume_cursor_position);
-			printf("Volume: %.1f\n", volume);
-			SetConsoleCursorPosition(GetStdHandle(STD_OUTPUT_HANDLE), current_time_cursor_position);
+	uint64_t num_decode_errors = renderer.get_num_decode_errors();
+
+	if (num_decode_errors > 0) {
+		printf("[Decode errors: %llu blocks rendered as silence]\n", (unsigned long long)num_decode_errors);
+	}
+
+	uint64_t num_failed_segments = renderer.get_num_failed_segments();
+
+	if (num_failed_segments > 0) {
+		printf("[Failed segments: %llu left out of the output]\n", (unsigned long long)num_failed_segments);
+	}
+
+	if (meter != nullptr) {
+		METER_SUMMARY summary = meter->get_summary();
+
+		printf("[Loudness: %.1f LUFS integrated, %.1f LUFS max short-term, %.1f LUFS max momentary, %.1f dBFS sample "
+			"peak]\n", summary.integrated_loudness, summary.max_short_term_loudness, summary.max_momentary_loudness,
+			get_max_level(summary.max_peaks, summary.num_channels));
+
+		if (meter_output_file != nullptr) {
+			write_meter_summary(meter_output_file, summary);
+			fclose(meter_output_file);
 		}
+	}
 
-		Sleep(cycle_duration);
+	if (options.is_instrumented) {
+		report_instrumentation(options);
 	}
 
-	wasapi.stop();
-}
\ No newline at end of file
+	// The file is completed (its header written) when the sink is closed
+	this->output_session.close();
+}
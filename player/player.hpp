@@ -1,16 +1,67 @@
 #ifndef PLAYER_HPP
 #define PLAYER_HPP
 
-#include "wasapi.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+#include "audio_sink.hpp"
+#include "console.hpp"
+#include "decoded_audio_cache.hpp"
+#include "format_converter.hpp"
+#include "gain_stage.hpp"
+#include "meter.hpp"
+#include "output_session.hpp"
+#include "playlist.hpp"
+#include "render_thread.hpp"
+#include "resampler.hpp"
+#include "segment_renderer.hpp"
 #include "wav_reader.hpp"
 
+// Time (in seconds) skipped forward or backward with the arrow keys
+#define SEEK_STEP_DURATION 5
+
+// Volume (in dB) the playback starts at on the sinks that are heard (about half the amplitude, the other sinks render
+// at full scale), and change (in dB) of the up and down arrow keys, down to GAIN_SILENCE_DB (muted)
+#define INITIAL_VOLUME -6.0
+#define VOLUME_STEP 2.0
+
+typedef struct PLAYBACK_OPTIONS {
+	std::vector<std::string> file_paths{}; // Played one after the other without gaps
+	double rendering_endpoint_buffer_duration{1000.0}; // In milliseconds
+	bool is_exclusive{}; // Whether the endpoint is opened in exclusive mode (bypassing the shared mode mixer)
+	bool use_memory_map{};
+	SINK_TYPE sink_type{DEFAULT_SINK_TYPE};
+	std::string output_file_path{};
+	uint16_t output_bit_depth{}; // Keeps the sample format of the file when 0
+	bool is_output_float{};
+	DITHER_TYPE dither_type{DITHER_TPDF};
+	uint32_t output_sample_rate{}; // Keeps the sample rate of the file when 0 (devices impose their own)
+	RESAMPLER_QUALITY resampler_quality{RESAMPLER_QUALITY_HIGH};
+	uint16_t output_num_channels{}; // Keeps the channels of the file when 0 (devices impose their own)
+	double start_time{}; // Position (in seconds) the playback of the first track starts from
+	bool is_mixed{}; // Whether the files are played at once through the mixer rather than one after the other
+	uint64_t cache_size{}; // Memory budget (in bytes) of the decoded audio cache, which is warmed with the files before they are played (disabled when 0)
+	bool is_metered{}; // Whether the levels and the loudness of what's written to the sink are measured
+	std::string meter_output_path{}; // File the readings of the meter are written to, as JSON lines (none when empty)
+	std::string render_output_path{}; // Renders the stream to this file, unthrottled, instead of playing it (none when empty)
+	unsigned num_render_threads{}; // Workers rendering the segments of the tracks in parallel (one per core when 0)
+	bool is_instrumented{}; // Whether the latencies of the pipeline stages and its incidents are measured
+	std::string trace_output_path{}; // File the measured events are written to, as a Chrome trace (none when empty)
+} PLAYBACK_OPTIONS;
+
 class Player {
 private:
-	void clean_line(int num_chars);
+	Console console;
+	OutputSession output_session;
+	DecodedAudioCache decoded_audio_cache;
 public:
 	Player();
 	~Player();
-	void play_audio_stream(std::string file_path, int rendering_endpoint_buffer_duration);
+	void play_audio_stream(const PLAYBACK_OPTIONS& options);
+
+	// Renders the stream to a file through the same pipeline as the playback, without waiting for a device: the tracks
+	// are split into segments rendered in parallel and written in order
+	void render_audio_stream(const PLAYBACK_OPTIONS& options);
 };
 
-#endif //PLAYER_HPP
\ No newline at end of file
+#endif //PLAYER_HPP
@@ -0,0 +1,608 @@
+#include "playlist.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+Playlist::Playlist(const std::vector<std::string> &file_paths, bool use_memory_map, DITHER_TYPE dither_type,
+	RESAMPLER_QUALITY resampler_quality) {
+	this->file_paths = file_paths;
+	this->use_memory_map = use_memory_map;
+	this->dither_type = dither_type;
+	this->resampler_quality = resampler_quality;
+}
+
+Playlist::~Playlist() {
+	// Stops the track loader once it's done with the message it's working on
+	if (this->track_loader.joinable()) {
+		{
+			std::lock_guard<std::mutex> lck(this->track_loader_mtx);
+
+			this->is_track_loader_stopping = true;
+		}
+
+		this->track_loader_cv.notify_all();
+		this->track_loader.join();
+	}
+
+	// Releases the tracks still held by the messages (the seeked ones are the current track)
+	TRACK_LOADER_MESSAGE message;
+
+	while (this->track_loader_requests.pop(message) || this->track_loader_replies.pop(message)) {
+		if (message.type == TRACK_LOADER_LOAD_NEXT) {
+			std::unique_ptr<PLAYLIST_TRACK> track(message.track);
+		}
+	}
+}
+
+void Playlist::set_decoded_audio_cache(DecodedAudioCache *decoded_audio_cache) {
+	this->decoded_audio_cache = decoded_audio_cache;
+}
+
+bool Playlist::open_reader(PLAYLIST_TRACK &track, bool is_verbose) {
+	const std::string &file_path = this->file_paths[track.index];
+
+	// Picks the decoder from the first bytes of the file, which parses the header and starts pre-buffering the audio data
+	track.reader = this->decoder_registry.open_file(file_path, this->use_memory_map, is_verbose);
+
+	if (track.reader == nullptr) {
+		return false;
+	}
+
+	track.file_format = track.reader->get_format();
+	track.duration = (int)track.reader->get_duration();
+
+	return true;
+}
+
+std::unique_ptr<PLAYLIST_TRACK> Playlist::open_track(size_t index, bool is_verbose) {
+	std::unique_ptr<PLAYLIST_TRACK> track(new PLAYLIST_TRACK());
+
+	track->index = index;
+
+	// A cached file is described by its decoded audio, it's only opened if it isn't cached in the format of the
+	// playlist once it's known
+	std::shared_ptr<const DECODED_AUDIO> decoded_audio = this->decoded_audio_cache != nullptr ?
+		this->decoded_audio_cache->find_file(this->file_paths[index]) : nullptr;
+
+	if (decoded_audio != nullptr) {
+		track->file_format = decoded_audio->file_format;
+		track->duration = decoded_audio->duration;
+
+		return track;
+	}
+
+	if (!this->open_reader(*track, is_verbose)) {
+		return nullptr;
+	}
+
+	return track;
+}
+
+std::unique_ptr<PLAYLIST_TRACK> Playlist::open_mixed_track() {
+	std::unique_ptr<PLAYLIST_TRACK> track(new PLAYLIST_TRACK());
+
+	// Every file that can be opened is a voice, the track lasts as long as the longest one
+	for (const std::string &file_path : this->file_paths) {
+		std::unique_ptr<AudioDecoder> reader = this->decoder_registry.open_file(file_path, this->use_memory_map,
+			this->is_verbose && track->voice_readers.empty());
+
+		if (reader == nullptr) {
+			std::cerr << "\nWARNING: Skipping \"" << file_path << "\"." << std::endl;
+
+			continue;
+		}
+
+		if (track->voice_readers.empty()) {
+			track->file_format = reader->get_format();
+		}
+
+		track->duration = std::max(track->duration, (int)reader->get_duration());
+		track->voice_readers.push_back(std::move(reader));
+	}
+
+	if (track->voice_readers.empty()) {
+		return nullptr;
+	}
+
+	return track;
+}
+
+bool Playlist::build_mixed_track_chain(PLAYLIST_TRACK &track, bool is_verbose) {
+	track.mixer.reset(new Mixer(this->format, this->dither_type, this->resampler_quality));
+	track.num_frames = 0;
+
+	for (std::unique_ptr<AudioDecoder> &reader : track.voice_readers) {
+		AUDIO_FORMAT file_format = reader->get_format();
+
+		if (!track.mixer->add_voice(reader.get())) {
+			std::cerr << "ERROR: Unable to mix " << file_format.num_channels << " channels of " << file_format.bit_depth
+				<< " bits samples at " << file_format.sample_rate << " Hz." << std::endl;
+
+			return false;
+		}
+
+		uint64_t num_file_frames = reader->get_num_frames();
+
+		track.num_frames = std::max(track.num_frames, num_file_frames / file_format.sample_rate *
+			this->format.sample_rate + num_file_frames % file_format.sample_rate * this->format.sample_rate /
+			file_format.sample_rate);
+	}
+
+	// The mix is made of floats, it's converted to the format of the playlist as a whole
+	track.encoder.reset(new FormatConverter(track.mixer.get(), this->format, this->dither_type));
+	track.output = track.encoder.get();
+
+	if (!track.encoder->is_supported()) {
+		return false;
+	}
+
+	if (is_verbose) {
+		std::cout << "Mixing: " << track.voice_readers.size() << " files" << std::endl;
+	}
+
+	return true;
+}
+
+bool Playlist::build_track_chain(PLAYLIST_TRACK &track, bool is_verbose) {
+	if (!track.voice_readers.empty()) {
+		return this->build_mixed_track_chain(track, is_verbose);
+	}
+
+	// Plays the decoded audio straight from the cache when it holds the file in the format of the playlist (releasing
+	// the reader if the file was opened)
+	std::shared_ptr<const DECODED_AUDIO> decoded_audio = this->decoded_audio_cache != nullptr ?
+		this->decoded_audio_cache->find(this->file_paths[track.index], this->format, this->dither_type,
+			this->resampler_quality) : nullptr;
+
+	if (decoded_audio != nullptr) {
+		track.reader.reset();
+		track.decoded_source.reset(new DecodedAudioSource(decoded_audio));
+		track.output = track.decoded_source.get();
+		track.num_frames = track.decoded_source->get_num_frames();
+
+		if (is_verbose) {
+			std::cout << "Playing from the decoded audio cache" << std::endl;
+		}
+
+		return true;
+	}
+
+	if (track.reader == nullptr && !this->open_reader(track, is_verbose)) {
+		return false;
+	}
+
+	// Resampling works on floats, so the samples are only converted straight to the format of the playlist when the
+	// rates match. Otherwise, the channels are remixed on the side with the fewest of them, so fewer channels are
+	// resampled
+	AUDIO_FORMAT file_format = track.reader->get_format();
+	bool is_resampled = file_format.sample_rate != this->format.sample_rate;
+	AUDIO_FORMAT decoded_format = this->format;
+
+	if (is_resampled) {
+		decoded_format = this->format.num_channels < file_format.num_channels ?
+			make_audio_format(file_format.sample_rate, this->format.num_channels, 32, true, this->format.channel_mask) :
+			make_audio_format(file_format.sample_rate, file_format.num_channels, 32, true, file_format.channel_mask);
+	}
+
+	track.decoder.reset(new FormatConverter(track.reader.get(), decoded_format, this->dither_type));
+	track.resampler.reset(new Resampler(track.decoder.get(), this->format.sample_rate, this->resampler_quality));
+	track.encoder.reset(new FormatConverter(track.resampler.get(), this->format, this->dither_type));
+	track.output = track.encoder.get();
+
+	if (!track.decoder->is_supported() || !track.resampler->is_supported() || !track.encoder->is_supported()) {
+		std::cerr << "ERROR: Unable to convert " << file_format.num_channels << " channels of " << file_format.bit_depth
+			<< " bits samples at " << file_format.sample_rate << " Hz to the format of the sink." << std::endl;
+
+		return false;
+	}
+
+	// Counts the frames of the track in the sample rate of the playlist (without overflowing for long tracks)
+	uint64_t num_file_frames = track.reader->get_num_frames();
+
+	track.num_frames = num_file_frames / file_format.sample_rate * this->format.sample_rate +
+		num_file_frames % file_format.sample_rate * this->format.sample_rate / file_format.sample_rate;
+
+	if (is_verbose) {
+		if (file_format.num_channels != this->format.num_channels ||
+			file_format.channel_mask != this->format.channel_mask) {
+			std::cout << "Remixing: " << file_format.num_channels << " channels -> " << this->format.num_channels
+				<< " channels" << std::endl;
+		}
+
+		if (is_resampled) {
+			std::cout << "Resampling: " << file_format.sample_rate << " Hz -> " << this->format.sample_rate << " Hz ("
+				<< track.resampler->get_num_taps() << " taps)" << std::endl;
+		}
+	}
+
+	return true;
+}
+
+std::unique_ptr<PLAYLIST_TRACK> Playlist::load_next_track(size_t index) {
+	// Opens the next track that can be played (quietly, the current one is playing)
+	for (; index < this->file_paths.size(); index++) {
+		std::unique_ptr<PLAYLIST_TRACK> track = this->open_track(index, false);
+
+		if (track == nullptr || !this->build_track_chain(*track, false)) {
+			std::cerr << "\nWARNING: Skipping \"" << this->file_paths[index] << "\"." << std::endl;
+
+			continue;
+		}
+
+		return track;
+	}
+
+	return nullptr;
+}
+
+void Playlist::run_track_loader() {
+#ifndef _WIN32
+	// Runs at the normal priority whatever the thread the playlist was set up from, the threads of the readers it
+	// opens or seeks inherit it
+	sched_param param{};
+
+	pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+#endif
+
+	TRACK_LOADER_MESSAGE request;
+
+	while (this->receive_track_loader_request(request)) {
+		TRACK_LOADER_MESSAGE reply;
+
+		reply.type = request.type;
+
+		if (request.type == TRACK_LOADER_LOAD_NEXT) {
+			// Releases the track that has just ended here, so its readers aren't joined nor freed on the rendering
+			// path
+			std::unique_ptr<PLAYLIST_TRACK> previous_track(request.track);
+
+			previous_track.reset();
+
+			reply.track = this->load_next_track(request.index).release();
+		}
+		else {
+			reply.track = request.track;
+			reply.frame = request.frame;
+			reply.is_seeked = request.track->output->seek(request.frame);
+		}
+
+		this->send_track_loader_message(this->track_loader_replies, reply);
+	}
+}
+
+bool Playlist::receive_track_loader_request(TRACK_LOADER_MESSAGE &request) {
+	std::unique_lock<std::mutex> lck(this->track_loader_mtx);
+
+	this->track_loader_cv.wait(lck, [&] {
+		return this->is_track_loader_stopping || this->track_loader_requests.pop(request);
+	});
+
+	return !this->is_track_loader_stopping;
+}
+
+void Playlist::send_track_loader_message(CommandQueue<TRACK_LOADER_MESSAGE, TRACK_LOADER_QUEUE_SIZE> &queue,
+	const TRACK_LOADER_MESSAGE &message) {
+	// Never full, each side has at most a track to load and a seek in flight
+	queue.push(message);
+
+	// Wakes up the other side, which only holds the lock while checking its queue
+	std::lock_guard<std::mutex> lck(this->track_loader_mtx);
+	this->track_loader_cv.notify_all();
+}
+
+void Playlist::receive_track_loader_replies(uint32_t timeout) {
+	TRACK_LOADER_MESSAGE reply;
+	bool is_received = this->track_loader_replies.pop(reply);
+
+	if (!is_received && timeout > 0) {
+		std::unique_lock<std::mutex> lck(this->track_loader_mtx);
+
+		is_received = this->track_loader_cv.wait_for(lck, std::chrono::milliseconds(timeout), [&] {
+			return this->track_loader_replies.pop(reply);
+		});
+	}
+
+	while (is_received) {
+		if (reply.type == TRACK_LOADER_LOAD_NEXT) {
+			this->next_track.reset(reply.track);
+			this->is_next_track_pending = false;
+		}
+		else {
+			this->is_seeked = reply.is_seeked;
+			this->is_seek_pending = false;
+		}
+
+		is_received = this->track_loader_replies.pop(reply);
+	}
+}
+
+bool Playlist::switch_to_next_track() {
+	if (this->next_track == nullptr) {
+		return false;
+	}
+
+	std::unique_ptr<PLAYLIST_TRACK> previous_track = std::move(this->current_track);
+
+	if (previous_track->reader != nullptr) {
+		this->num_past_reader_stalls += previous_track->reader->get_num_stalls();
+		this->num_past_decode_errors += previous_track->reader->get_num_decode_errors();
+	}
+
+	this->current_track = std::move(this->next_track);
+	this->track_start_position = this->stream_position;
+	this->is_track_ended = false;
+
+	// Hands the track that has just ended to the track loader, which releases it and starts loading the following one
+	// right away
+	TRACK_LOADER_MESSAGE request;
+
+	request.type = TRACK_LOADER_LOAD_NEXT;
+	request.track = previous_track.release();
+	request.index = this->current_track->index + 1;
+
+	this->is_next_track_pending = true;
+	this->send_track_loader_message(this->track_loader_requests, request);
+
+	return true;
+}
+
+bool Playlist::open() {
+	if (this->is_mixed) {
+		this->current_track = this->open_mixed_track();
+
+		return this->current_track != nullptr;
+	}
+
+	for (size_t index = 0; index < this->file_paths.size(); index++) {
+		this->current_track = this->open_track(index, this->is_verbose);
+
+		if (this->current_track != nullptr) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+AUDIO_FORMAT Playlist::get_track_format() {
+	return this->current_track->file_format;
+}
+
+bool Playlist::set_format(const AUDIO_FORMAT &format) {
+	this->format = format;
+
+	if (!this->build_track_chain(*this->current_track, this->is_verbose)) {
+		return false;
+	}
+
+	// Starts the track loader from here rather than from the thread consuming the playlist, which may be a real-time
+	// one, and has it load the next track while the first one is playing (a mixed playlist has a single track)
+	if (!this->track_loader.joinable()) {
+		this->track_loader = std::thread(&Playlist::run_track_loader, this);
+	}
+
+	if (this->is_mixed) {
+		return true;
+	}
+
+	TRACK_LOADER_MESSAGE request;
+
+	request.type = TRACK_LOADER_LOAD_NEXT;
+	request.index = this->current_track->index + 1;
+
+	this->is_next_track_pending = true;
+	this->send_track_loader_message(this->track_loader_requests, request);
+
+	return true;
+}
+
+size_t Playlist::get_num_tracks() {
+	return this->file_paths.size();
+}
+
+size_t Playlist::get_track_index() {
+	return this->current_track->index;
+}
+
+const std::string &Playlist::get_track_path() {
+	return this->file_paths[this->current_track->index];
+}
+
+int Playlist::get_track_duration() {
+	return this->current_track->duration;
+}
+
+uint64_t Playlist::get_track_start_position() {
+	return this->track_start_position;
+}
+
+uint64_t Playlist::get_track_num_frames() {
+	return this->current_track->num_frames;
+}
+
+uint64_t Playlist::get_track_num_preroll_frames() {
+	// The history of a resampler holds its taps (in frames of the file), the ones of the voices of a mixed track are
+	// bounded by the longest filter
+	uint64_t num_preroll_frames = 0;
+
+	if (this->current_track->resampler != nullptr &&
+		this->current_track->file_format.sample_rate != this->format.sample_rate) {
+		uint32_t file_sample_rate = this->current_track->file_format.sample_rate;
+
+		num_preroll_frames = (uint64_t)this->current_track->resampler->get_num_taps() *
+			((this->format.sample_rate + file_sample_rate - 1) / file_sample_rate);
+	}
+
+	for (std::unique_ptr<AudioDecoder> &reader : this->current_track->voice_readers) {
+		uint32_t file_sample_rate = reader->get_format().sample_rate;
+
+		if (file_sample_rate != this->format.sample_rate) {
+			num_preroll_frames = std::max<uint64_t>(num_preroll_frames, (uint64_t)RESAMPLER_MAX_TAPS *
+				((this->format.sample_rate + file_sample_rate - 1) / file_sample_rate));
+		}
+	}
+
+	return num_preroll_frames;
+}
+
+void Playlist::reseed_dither(uint32_t seed) {
+	// The decoder only dithers when the file holds more bits than the playlist (the encoder of a mixed track too)
+	if (this->current_track->decoder != nullptr) {
+		this->current_track->decoder->reseed_dither(seed);
+	}
+
+	if (this->current_track->encoder != nullptr) {
+		this->current_track->encoder->reseed_dither(seed);
+	}
+}
+
+uint64_t Playlist::get_num_reader_stalls() {
+	uint64_t num_reader_stalls = this->num_past_reader_stalls;
+
+	if (this->current_track != nullptr && this->current_track->reader != nullptr) {
+		num_reader_stalls += this->current_track->reader->get_num_stalls();
+	}
+
+	if (this->current_track != nullptr) {
+		for (std::unique_ptr<AudioDecoder> &reader : this->current_track->voice_readers) {
+			num_reader_stalls += reader->get_num_stalls();
+		}
+	}
+
+	return num_reader_stalls;
+}
+
+uint64_t Playlist::get_num_decode_errors() {
+	uint64_t num_decode_errors = this->num_past_decode_errors;
+
+	if (this->current_track != nullptr && this->current_track->reader != nullptr) {
+		num_decode_errors += this->current_track->reader->get_num_decode_errors();
+	}
+
+	if (this->current_track != nullptr) {
+		for (std::unique_ptr<AudioDecoder> &reader : this->current_track->voice_readers) {
+			num_decode_errors += reader->get_num_decode_errors();
+		}
+	}
+
+	return num_decode_errors;
+}
+
+AUDIO_FORMAT Playlist::get_format() {
+	return this->format;
+}
+
+bool Playlist::get_chunk(AUDIO_CHUNK &chunk, uint32_t max_size) {
+	while (true) {
+		this->is_track_ended = this->current_track->output->get_chunk(chunk, max_size);
+
+		if (!this->is_track_ended) {
+			return false;
+		}
+
+		// Lends the last chunk of a track as any other one when another track follows, the switch happens once it
+		// is released. The next track has been loading since the current one started, until it's there the stream
+		// goes on with empty chunks, which are counted as reader stalls
+		if (this->is_next_track_pending) {
+			this->receive_track_loader_replies(0);
+		}
+
+		if (this->is_next_track_pending) {
+			if (chunk.size == 0) {
+				this->num_past_reader_stalls += 1;
+			}
+
+			chunk.is_eof = false;
+
+			return false;
+		}
+
+		if (this->next_track == nullptr) {
+			return true;
+		}
+
+		if (chunk.size > 0) {
+			chunk.is_eof = false;
+
+			return false;
+		}
+
+		// Moves on to the next track straight away when the last chunk is empty
+		this->current_track->output->release_chunk(chunk);
+		this->switch_to_next_track();
+	}
+}
+
+void Playlist::release_chunk(AUDIO_CHUNK &chunk) {
+	this->stream_position += chunk.size / this->format.block_align;
+	this->current_track->output->release_chunk(chunk);
+
+	if (this->is_track_ended && this->next_track != nullptr) {
+		this->switch_to_next_track();
+	}
+}
+
+void Playlist::wait_for_chunk(uint32_t timeout) {
+	if (this->is_track_ended && this->is_next_track_pending) {
+		this->receive_track_loader_replies(timeout);
+	}
+	else {
+		this->current_track->output->wait_for_chunk(timeout);
+	}
+}
+
+bool Playlist::seek(uint64_t frame) {
+	uint64_t track_frame = frame > this->track_start_position ? frame - this->track_start_position : 0;
+
+	track_frame = std::min(track_frame, this->current_track->num_frames);
+
+	if (!this->current_track->output->seek(track_frame)) {
+		return false;
+	}
+
+	this->stream_position = this->track_start_position + track_frame;
+	this->is_track_ended = false;
+
+	return true;
+}
+
+bool Playlist::request_seek(uint64_t frame) {
+	if (!this->track_loader.joinable()) {
+		return false;
+	}
+
+	uint64_t track_frame = frame > this->track_start_position ? frame - this->track_start_position : 0;
+	TRACK_LOADER_MESSAGE request;
+
+	request.type = TRACK_LOADER_SEEK;
+	request.track = this->current_track.get();
+	request.frame = std::min(track_frame, this->current_track->num_frames);
+
+	this->seek_frame = request.frame;
+	this->is_seek_pending = true;
+	this->send_track_loader_message(this->track_loader_requests, request);
+
+	return true;
+}
+
+bool Playlist::receive_seek(bool &is_seeked, uint32_t timeout) {
+	this->receive_track_loader_replies(this->is_seek_pending ? timeout : 0);
+
+	if (this->is_seek_pending) {
+		return false;
+	}
+
+	if (this->is_seeked) {
+		this->stream_position = this->track_start_position + this->seek_frame;
+		this->is_track_ended = false;
+	}
+
+	is_seeked = this->is_seeked;
+
+	return true;
+}
@@ -0,0 +1,188 @@
+#ifndef WASABI_PLAYLIST_HPP
+#define WASABI_PLAYLIST_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "audio_source.hpp"
+#include "command_queue.hpp"
+#include "decoded_audio_cache.hpp"
+#include "decoder_registry.hpp"
+#include "format_converter.hpp"
+#include "mixer.hpp"
+#include "resampler.hpp"
+
+// Maximum number of messages waiting for or from the track loader (a track to load and a seek at most)
+#define TRACK_LOADER_QUEUE_SIZE 4
+
+// Decoding chain of a track of the playlist, from its file (or its decoded audio when it's cached) to the format of
+// the playlist
+typedef struct PLAYLIST_TRACK {
+	size_t index{};
+	AUDIO_FORMAT file_format;
+	int duration{}; // In seconds (0 when unknown)
+	std::unique_ptr<AudioDecoder> reader;
+	std::unique_ptr<FormatConverter> decoder;
+	std::unique_ptr<Resampler> resampler;
+	std::unique_ptr<FormatConverter> encoder;
+	std::unique_ptr<DecodedAudioSource> decoded_source;
+	std::vector<std::unique_ptr<AudioDecoder>> voice_readers; // Of the files played at once when the playlist is mixed
+	std::unique_ptr<Mixer> mixer;
+	AudioSource *output{}; // Last stage of the chain
+	uint64_t num_frames{}; // In the sample rate of the playlist
+} PLAYLIST_TRACK;
+
+enum TRACK_LOADER_MESSAGE_TYPE {
+	TRACK_LOADER_LOAD_NEXT,
+	TRACK_LOADER_SEEK
+};
+
+// Work handed to the track loader and its result (the tracks are owned by the message while it's queued)
+typedef struct TRACK_LOADER_MESSAGE {
+	TRACK_LOADER_MESSAGE_TYPE type{};
+	PLAYLIST_TRACK *track{}; // Ended track to release or loaded track (null when none can be played), or track to seek
+	size_t index{}; // For TRACK_LOADER_LOAD_NEXT, first track tried
+	uint64_t frame{}; // For TRACK_LOADER_SEEK, in frames of the track
+	bool is_seeked{}; // For TRACK_LOADER_SEEK, whether the track has moved to the frame
+} TRACK_LOADER_MESSAGE;
+
+// Source playing a list of files one after the other without any gap. Every track is converted to the same format, and
+// the next one is opened, parsed and pre-buffered by a track loader thread while the current one is playing, so its
+// first chunk is lent right after the last one of the previous track (the sink sees a single stream and is never
+// reinitialised). Files that can't be opened or converted are reported and skipped. With a decoded audio cache, the
+// tracks it holds in the format of the playlist are played from memory without touching their files.
+//
+// The track loader runs at the normal priority and does everything that starts or joins threads (opening the next
+// track, releasing the ended one, restarting the readers on a seek requested with request_seek), so the render thread
+// only exchanges messages with it through lock-free queues.
+class Playlist : public AudioSource {
+private:
+	std::vector<std::string> file_paths;
+	DecoderRegistry decoder_registry;
+	bool use_memory_map{};
+	DITHER_TYPE dither_type{};
+	RESAMPLER_QUALITY resampler_quality{};
+	DecodedAudioCache *decoded_audio_cache{};
+	AUDIO_FORMAT format;
+	std::unique_ptr<PLAYLIST_TRACK> current_track;
+	std::unique_ptr<PLAYLIST_TRACK> next_track;
+	std::thread track_loader;
+	CommandQueue<TRACK_LOADER_MESSAGE, TRACK_LOADER_QUEUE_SIZE> track_loader_requests;
+	CommandQueue<TRACK_LOADER_MESSAGE, TRACK_LOADER_QUEUE_SIZE> track_loader_replies;
+	std::mutex track_loader_mtx;
+	std::condition_variable track_loader_cv;
+	bool is_track_loader_stopping{};
+	bool is_next_track_pending{}; // Whether the track loader is loading the next track
+	bool is_seek_pending{}; // Whether the track loader is seeking within the current track
+	uint64_t seek_frame{}; // Frame of the current track the pending seek moves to
+	bool is_seeked{}; // Whether the last seek done by the track loader succeeded
+	bool is_track_ended{};
+	uint64_t stream_position{};
+	uint64_t track_start_position{};
+	uint64_t num_past_reader_stalls{}; // Of the tracks already played
+	uint64_t num_past_decode_errors{};
+
+	bool open_reader(PLAYLIST_TRACK &track, bool is_verbose);
+
+	std::unique_ptr<PLAYLIST_TRACK> open_mixed_track();
+
+	bool build_mixed_track_chain(PLAYLIST_TRACK &track, bool is_verbose);
+
+	std::unique_ptr<PLAYLIST_TRACK> open_track(size_t index, bool is_verbose);
+
+	bool build_track_chain(PLAYLIST_TRACK &track, bool is_verbose);
+
+	std::unique_ptr<PLAYLIST_TRACK> load_next_track(size_t index);
+
+	void run_track_loader();
+
+	bool receive_track_loader_request(TRACK_LOADER_MESSAGE &request);
+
+	void send_track_loader_message(CommandQueue<TRACK_LOADER_MESSAGE, TRACK_LOADER_QUEUE_SIZE> &queue,
+		const TRACK_LOADER_MESSAGE &message);
+
+	// Picks up the replies of the track loader, waiting up to the given time (in milliseconds) for one if none is there
+	void receive_track_loader_replies(uint32_t timeout);
+
+	bool switch_to_next_track();
+
+public:
+	Playlist(const std::vector<std::string> &file_paths, bool use_memory_map, DITHER_TYPE dither_type,
+		RESAMPLER_QUALITY resampler_quality);
+
+	Playlist(Playlist const &playlist) = delete;
+
+	Playlist &operator=(Playlist const &playlist) = delete;
+
+	~Playlist() override;
+
+	bool is_verbose{true}; // Whether the first track is described (errors and skipped tracks are always reported)
+	bool is_mixed{}; // Whether the files are played at once, as a single track mixing them, rather than one after the other
+
+	// Looks the tracks up in the given cache (which must outlive the playlist) before opening them, it must be set
+	// before the playlist is opened
+	void set_decoded_audio_cache(DecodedAudioCache *decoded_audio_cache);
+
+	// Opens the first track that can be played, returns false if there is none
+	bool open();
+
+	// Gets the format of the file of the current track (the sink format is usually chosen from the first one)
+	AUDIO_FORMAT get_track_format();
+
+	// Sets the format every track is converted to, returns false if the current track can't be converted to it. The
+	// next track starts loading once it is set
+	bool set_format(const AUDIO_FORMAT &format);
+
+	size_t get_num_tracks();
+
+	size_t get_track_index();
+
+	const std::string &get_track_path();
+
+	// Gets the duration (in seconds) of the file of the current track (0 when unknown)
+	int get_track_duration();
+
+	// Gets the position (in frames of the playlist) of the first frame of the current track
+	uint64_t get_track_start_position();
+
+	uint64_t get_track_num_frames();
+
+	// Gets how many frames the current track must be rendered from ahead of a seek point for its frames to be the same
+	// as if it had been played from its start (its resamplers restart with an empty history)
+	uint64_t get_track_num_preroll_frames();
+
+	// Restarts the dither noise of the converters of the current track from the given seed
+	void reseed_dither(uint32_t seed);
+
+	// Gets how many times the readers of the tracks played so far had no data ready for the stream
+	uint64_t get_num_reader_stalls();
+
+	// Gets how many blocks the readers of the tracks played so far couldn't decode (they were played as silence)
+	uint64_t get_num_decode_errors();
+
+	AUDIO_FORMAT get_format() override;
+
+	bool get_chunk(AUDIO_CHUNK &chunk, uint32_t max_size) override;
+
+	void release_chunk(AUDIO_CHUNK &chunk) override;
+
+	void wait_for_chunk(uint32_t timeout) override;
+
+	// Seeks within the current track (frames are counted from the start of the playlist, positions outside of the
+	// current track are clamped to it)
+	bool seek(uint64_t frame) override;
+
+	// Starts seeking as seek does, but on the track loader, so the caller doesn't wait for the readers to restart. No
+	// chunk must be requested until the seek has been received. Returns false if the track loader isn't running
+	bool request_seek(uint64_t frame);
+
+	// Returns whether the requested seek is done (telling in is_seeked whether it succeeded), waiting up to the given
+	// time (in milliseconds) for it
+	bool receive_seek(bool &is_seeked, uint32_t timeout);
+};
+
+#endif //WASABI_PLAYLIST_HPP
@@ -0,0 +1,442 @@
+#include "render_thread.hpp"
+#include <algorithm>
+#include <chrono>
+#include "instrumentation.hpp"
+
+#ifdef _WIN32
+#include <avrt.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+RenderThread::RenderThread(AudioSink *sink, Playlist *playlist, GainStage *gain_stage, Meter *meter,
+	uint64_t start_position) {
+	uint32_t sample_rate = sink->get_format().sample_rate;
+
+	this->sink = sink;
+	this->playlist = playlist;
+	this->gain_stage = gain_stage;
+	this->meter = meter;
+	this->output = meter != nullptr ? (AudioSource *)meter : gain_stage;
+	this->stream_position = start_position;
+	this->played_position.store(start_position);
+	this->fade_frames = (uint32_t)((uint64_t)sample_rate * RENDER_FADE_DURATION / 1000);
+	this->volume_ramp_frames = (uint32_t)((uint64_t)sample_rate * RENDER_VOLUME_RAMP_DURATION / 1000);
+	this->late_refill_duration = (uint64_t)(sink->get_buffer_size() / 2) * 1000000000 / sample_rate;
+
+	// Only what's heard is faded, the sinks that don't consume in real time get the stream untouched
+	this->is_faded = sink->is_realtime();
+
+	if (this->is_faded) {
+		this->gain_stage->fade_in(this->fade_frames, 0.0f);
+	}
+}
+
+RenderThread::~RenderThread() {
+	this->join();
+}
+
+RENDER_PRIORITY RenderThread::promote_priority() {
+#ifdef _WIN32
+	// Registers the thread with the Multimedia Class Scheduler Service, which raises its priority while it renders
+	DWORD task_index = 0;
+
+	this->mmcss_task = AvSetMmThreadCharacteristicsW(L"Pro Audio", &task_index);
+
+	if (this->mmcss_task == nullptr) {
+		return RENDER_PRIORITY_NORMAL;
+	}
+
+	AvSetMmThreadPriority(this->mmcss_task, AVRT_PRIORITY_HIGH);
+
+	return RENDER_PRIORITY_MMCSS;
+#else
+	// Real-time policies usually need a privilege (or an RLIMIT_RTPRIO), the thread keeps its priority otherwise
+	int policies[] = {SCHED_FIFO, SCHED_RR};
+
+	for (int policy : policies) {
+		sched_param param{};
+
+		param.sched_priority = std::min(std::max(RENDER_THREAD_PRIORITY, sched_get_priority_min(policy)),
+			sched_get_priority_max(policy));
+
+		if (pthread_setschedparam(pthread_self(), policy, &param) == 0) {
+			return policy == SCHED_FIFO ? RENDER_PRIORITY_FIFO : RENDER_PRIORITY_RR;
+		}
+	}
+
+	return RENDER_PRIORITY_NORMAL;
+#endif
+}
+
+void RenderThread::revert_priority() {
+#ifdef _WIN32
+	if (this->mmcss_task != nullptr) {
+		AvRevertMmThreadCharacteristics(this->mmcss_task);
+
+		this->mmcss_task = nullptr;
+	}
+#endif
+	// The scheduling policy of a POSIX thread goes away with it
+}
+
+void RenderThread::publish_track() {
+	if (this->playlist->get_track_index() == this->sent_track_index) {
+		return;
+	}
+
+	RENDER_EVENT event;
+
+	event.track_index = this->playlist->get_track_index();
+	event.track_start_position = this->playlist->get_track_start_position();
+	event.track_duration = this->playlist->get_track_duration();
+
+	if (!this->events.push(event)) {
+		this->statistics.num_dropped_events += 1;
+	}
+
+	this->sent_track_index = event.track_index;
+}
+
+void RenderThread::publish_position() {
+	// The track is published before the position, so the UI gets a track before the position reaches it
+	this->publish_track();
+	this->played_position.store(this->get_sink_position(), std::memory_order_release);
+}
+
+uint64_t RenderThread::get_sink_position() {
+	return this->stream_position - std::min<uint64_t>(this->sink->get_padding(), this->stream_position);
+}
+
+uint32_t RenderThread::refill(bool &stop) {
+	bool is_eof = false;
+	uint64_t refill_start_time = begin_trace_span();
+	uint32_t num_written_frames = this->sink->refill(*this->output, is_eof);
+	uint64_t refill_duration = end_trace_span(TRACE_REFILL, refill_start_time, num_written_frames);
+
+	// The render loop refills the sink once it holds half its buffer, a refill taking longer than playing it leaves the
+	// endpoint running dry
+	if (refill_duration > this->late_refill_duration && this->sink->is_realtime()) {
+		record_trace_event(TRACE_LATE_REFILL, num_written_frames);
+	}
+
+	// The gain stage ends its chunks once it's held after the fade out of a pause, which isn't the end of the stream
+	if (is_eof && (!this->gain_stage->is_held() || this->is_stopping)) {
+		stop = true;
+	}
+
+	this->statistics.num_rendered_frames += num_written_frames;
+	this->stream_position += num_written_frames;
+
+	return num_written_frames;
+}
+
+void RenderThread::move_to(uint64_t target_position, bool is_started, bool &stop) {
+	// Drops what the sink still holds, so the frames written next are played within one period of the endpoint
+	this->sink->stop();
+	this->sink->flush();
+
+	// The playlist seeks within the current track on its track loader (clamping the position to it), the sink is
+	// refilled from the new position, and started if asked, once it's done
+	this->seek_position = target_position;
+	this->is_start_pending = is_started;
+	this->is_seeking = this->playlist->request_seek(target_position);
+
+	if (!this->is_seeking) {
+		this->complete_move(false, stop);
+	}
+}
+
+void RenderThread::complete_move(bool is_seeked, bool &stop) {
+	if (is_seeked) {
+		this->stream_position = std::min(std::max(this->seek_position, this->playlist->get_track_start_position()),
+			this->playlist->get_track_start_position() + this->playlist->get_track_num_frames());
+	}
+
+	// The frames written again are measured again
+	if (this->meter != nullptr) {
+		this->meter->restart(this->stream_position);
+	}
+
+	uint32_t num_written_frames = this->refill(stop);
+
+	// Starts the sink once it has something to play, a playlist that has nothing ready yet is refilled again by the
+	// render loop
+	if (this->is_start_pending && (num_written_frames > 0 || stop)) {
+		this->sink->start();
+
+		this->is_start_pending = false;
+	}
+}
+
+void RenderThread::fade_out(bool &stop) {
+	// Rewrites what the sink holds from the frame being played, so the fade out is heard right away
+	this->move_to(this->get_sink_position(), true, stop);
+	this->gain_stage->fade_out(this->fade_frames);
+}
+
+void RenderThread::seek(int64_t seek_offset, bool &stop) {
+	// Seeks from the frame being played, by frames so the position stays sample accurate
+	uint64_t played_position = this->get_sink_position();
+	uint64_t target_position = played_position;
+
+	if (seek_offset < 0) {
+		target_position = played_position > (uint64_t)-seek_offset ? played_position - (uint64_t)-seek_offset : 0;
+	}
+	else {
+		target_position = played_position + (uint64_t)seek_offset;
+	}
+
+	// Refills the sink as soon as the playlist has moved, so the first frame after the seek is played within one
+	// period of the endpoint (while paused, the sink is only started on resume)
+	this->move_to(target_position, !this->is_paused, stop);
+
+	// The fade out of a pause being played is dropped with the rest of what the sink held, the stage holds silence
+	// until the resume
+	if (this->is_pausing) {
+		this->gain_stage->fade_out(0);
+		this->is_pausing = false;
+	}
+
+	// The new position starts from silence (while paused, the fade in comes with the resume)
+	if (this->is_faded && !this->is_paused) {
+		this->gain_stage->fade_in(this->fade_frames, 0.0f);
+	}
+}
+
+void RenderThread::process_commands(bool &stop) {
+	RENDER_COMMAND command;
+
+	// The commands following a seek (those rewriting the sink seek too) wait for it in the queue
+	while (!this->is_seeking && this->commands.pop(command)) {
+		// Nothing but the end of the stream follows a stop
+		if (this->is_stopping) {
+			continue;
+		}
+
+		switch (command.type) {
+		case RENDER_COMMAND_PAUSE:
+			if (!this->is_paused) {
+				// Fades out from the next refill, the sink is stopped once the fade out has been played
+				if (this->is_playing && this->is_faded) {
+					this->gain_stage->fade_out(this->fade_frames);
+					this->is_pausing = true;
+				}
+				else {
+					this->sink->stop();
+
+					this->is_start_pending = false;
+				}
+
+				this->is_paused = true;
+			}
+			break;
+		case RENDER_COMMAND_RESUME:
+			if (this->is_paused) {
+				if (this->is_playing && this->is_faded) {
+					// Fades in from the next refill, from the gain the fade out of the pause has been lent down to.
+					// The sink is still running while that fade out is being played, otherwise it's started once
+					// refilled
+					this->gain_stage->fade_in(this->fade_frames, this->gain_stage->get_gain());
+					this->is_start_pending = !this->is_pausing;
+					this->is_pausing = false;
+				}
+				else if (this->is_playing) {
+					this->sink->start();
+				}
+
+				this->is_paused = false;
+			}
+			break;
+		case RENDER_COMMAND_SET_VOLUME:
+			// Ramps from the next refill, what the sink holds is played at the previous volume
+			this->gain_stage->set_gain_db(command.volume, this->volume_ramp_frames);
+			break;
+		case RENDER_COMMAND_SEEK:
+			if (this->is_playing && !stop) {
+				this->seek(command.seek_offset, stop);
+			}
+			break;
+		case RENDER_COMMAND_STOP:
+			// The stream ends once the fade out has been lent
+			if (this->is_playing && this->is_faded && !this->is_paused && !stop) {
+				this->is_stopping = true;
+				this->fade_out(stop);
+			}
+			else {
+				// Drops what the sink holds (a paused sink would never play it)
+				this->sink->stop();
+				this->sink->flush();
+
+				stop = true;
+			}
+			break;
+		}
+	}
+}
+
+void RenderThread::run() {
+	bool stop = false;
+
+	// Allocates the trace buffer of the thread before rendering (nothing is allocated while rendering)
+	register_trace_thread("Render", TRACE_THREAD_EVENTS);
+
+	// Only the sinks consuming in real time have deadlines, the other ones are rendered as fast as possible
+	if (this->sink->is_realtime()) {
+		this->priority.store(this->promote_priority());
+	}
+
+#ifdef _WIN32
+	// Joins the multithreaded apartment the sink was created in
+	bool is_com_initialized = SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+#endif
+
+	// Declares and initializes the variables that will decide when the rendering endpoint buffer is refilled
+	uint32_t refill_watermark = this->sink->get_buffer_size() / 2;
+	auto rendering_start_time = std::chrono::steady_clock::now();
+
+	while (stop == false) {
+		// Waits for the seek in progress (rather than for the sink, which is stopped), then refills the sink from the
+		// new position
+		if (this->is_seeking) {
+			bool is_seeked = false;
+
+			if (!this->playlist->receive_seek(is_seeked, RENDER_COMMAND_POLL_INTERVAL)) {
+				continue;
+			}
+
+			this->is_seeking = false;
+			this->complete_move(is_seeked, stop);
+		}
+
+		this->process_commands(stop);
+
+		// Refills the rendering endpoint buffer only once the frames it holds drop below the watermark (the fade out of
+		// a pause is refilled until it has been lent entirely). A refill may write nothing when the readers are
+		// behind, the sink is started once there is something to play
+		uint32_t num_written_frames = 0;
+		bool is_refilled = false;
+
+		if ((!this->is_paused || this->gain_stage->is_fading_out()) && !this->is_seeking && !stop &&
+			this->sink->get_padding() <= refill_watermark) {
+			num_written_frames = this->refill(stop);
+			is_refilled = true;
+
+			// Samples the latency once the endpoint is running, right after it has been refilled
+			if (this->is_playing && this->sink->is_realtime()) {
+				double output_latency = this->sink->get_output_latency();
+
+				this->statistics.min_output_latency = this->statistics.num_latency_samples == 0 ? output_latency :
+					std::min(this->statistics.min_output_latency, output_latency);
+				this->statistics.max_output_latency = std::max(this->statistics.max_output_latency, output_latency);
+				this->statistics.total_output_latency += output_latency;
+				this->statistics.num_latency_samples += 1;
+			}
+
+			if (this->is_playing == false && (num_written_frames > 0 || stop)) {
+				this->sink->start();
+
+				this->is_playing = true;
+				this->is_started_flag.store(true, std::memory_order_release);
+			}
+			else if (this->is_start_pending && (num_written_frames > 0 || stop)) {
+				this->sink->start();
+
+				this->is_start_pending = false;
+			}
+		}
+
+		// Stops the sink once the fade out of a pause has been played (flushing it, empty as it is, so the refill on
+		// resume isn't counted as an underrun)
+		if (this->is_pausing && !this->is_seeking && this->gain_stage->is_held() && this->sink->get_padding() == 0) {
+			this->sink->stop();
+			this->sink->flush();
+
+			this->is_pausing = false;
+		}
+
+		this->publish_position();
+
+		// Sleeps until the sink asks for more frames, waking up regularly to pick up the commands. The sinks without
+		// deadlines ask for more right away, they wait for the readers instead when those had nothing ready
+		if (stop == false && !this->is_seeking) {
+			if (is_refilled && num_written_frames == 0 && !this->sink->is_realtime()) {
+				this->output->wait_for_chunk(RENDER_COMMAND_POLL_INTERVAL);
+			}
+			else {
+				this->sink->wait_for_refill(RENDER_COMMAND_POLL_INTERVAL);
+			}
+		}
+	}
+
+	// Lets the sink play the frames that are still buffered before stopping it (pausing still holds the playback, and
+	// stops the sink straight away as there is nothing to rewrite anymore)
+	this->is_faded = false;
+
+	while (this->sink->get_padding() > 0) {
+		this->process_commands(stop);
+		this->publish_position();
+		this->sink->wait_for_refill(RENDER_COMMAND_POLL_INTERVAL);
+	}
+
+	this->sink->stop();
+	this->publish_position();
+
+	this->statistics.elapsed_seconds =
+		std::chrono::duration<double>(std::chrono::steady_clock::now() - rendering_start_time).count();
+
+#ifdef _WIN32
+	if (is_com_initialized) {
+		CoUninitialize();
+	}
+#endif
+
+	this->revert_priority();
+
+	this->is_finished_flag.store(true, std::memory_order_release);
+}
+
+void RenderThread::start() {
+	this->thread = std::thread(&RenderThread::run, this);
+}
+
+void RenderThread::join() {
+	if (this->thread.joinable()) {
+		this->thread.join();
+	}
+}
+
+bool RenderThread::send_command(const RENDER_COMMAND &command) {
+	if (!this->commands.push(command)) {
+		this->statistics.num_dropped_commands += 1;
+
+		return false;
+	}
+
+	return true;
+}
+
+uint64_t RenderThread::get_played_position() {
+	return this->played_position.load(std::memory_order_acquire);
+}
+
+bool RenderThread::receive_event(RENDER_EVENT &event) {
+	return this->events.pop(event);
+}
+
+bool RenderThread::is_started() {
+	return this->is_started_flag.load(std::memory_order_acquire);
+}
+
+bool RenderThread::is_finished() {
+	return this->is_finished_flag.load(std::memory_order_acquire);
+}
+
+RENDER_PRIORITY RenderThread::get_priority() {
+	return this->priority.load();
+}
+
+RENDER_STATISTICS RenderThread::get_statistics() {
+	return this->statistics;
+}
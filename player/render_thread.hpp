@@ -0,0 +1,184 @@
+#ifndef WASABI_RENDER_THREAD_HPP
+#define WASABI_RENDER_THREAD_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include "audio_sink.hpp"
+#include "command_queue.hpp"
+#include "gain_stage.hpp"
+#include "meter.hpp"
+#include "playlist.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Maximum number of commands waiting for the render thread (the UI sends a few per second at most)
+#define RENDER_COMMAND_QUEUE_SIZE 64
+
+// Maximum number of events waiting for the UI (a fast sink may go through a whole playlist between two updates)
+#define RENDER_EVENT_QUEUE_SIZE 256
+
+// Maximum time (in milliseconds) the render thread waits for the sink before checking the commands again
+#define RENDER_COMMAND_POLL_INTERVAL 10
+
+// Duration (in milliseconds) of the fades on start, pause, resume, seek and stop (only on the sinks consuming in real
+// time, the other ones render the stream untouched)
+#define RENDER_FADE_DURATION 10
+
+// Duration (in milliseconds) of the gain ramp following a volume change
+#define RENDER_VOLUME_RAMP_DURATION 20
+
+// Real-time priority requested for the render thread (SCHED_FIFO/SCHED_RR range, clamped to the one of the system)
+#define RENDER_THREAD_PRIORITY 70
+
+enum RENDER_COMMAND_TYPE {
+	RENDER_COMMAND_PAUSE,
+	RENDER_COMMAND_RESUME,
+	RENDER_COMMAND_SET_VOLUME,
+	RENDER_COMMAND_SEEK,
+	RENDER_COMMAND_STOP
+};
+
+typedef struct RENDER_COMMAND {
+	RENDER_COMMAND_TYPE type{};
+	float volume{}; // For RENDER_COMMAND_SET_VOLUME, in dB
+	int64_t seek_offset{}; // For RENDER_COMMAND_SEEK, in frames from the frame being played
+} RENDER_COMMAND;
+
+// Sent by the render thread when a track has been written to the sink (it's heard once the played position reaches
+// the start of the track)
+typedef struct RENDER_EVENT {
+	size_t track_index{};
+	uint64_t track_start_position{}; // In frames of the sink, counted from the start of the playlist
+	int track_duration{}; // In seconds (0 when unknown)
+} RENDER_EVENT;
+
+enum RENDER_PRIORITY {
+	RENDER_PRIORITY_NORMAL,
+	RENDER_PRIORITY_MMCSS,
+	RENDER_PRIORITY_FIFO,
+	RENDER_PRIORITY_RR
+};
+
+// Measurements of the render thread, complete once it has finished
+typedef struct RENDER_STATISTICS {
+	uint64_t num_rendered_frames{};
+	double elapsed_seconds{};
+	double min_output_latency{};
+	double max_output_latency{};
+	double total_output_latency{};
+	uint64_t num_latency_samples{};
+	uint64_t num_dropped_commands{}; // Commands sent while the queue was full
+	uint64_t num_dropped_events{}; // Events sent while the queue was full
+} RENDER_STATISTICS;
+
+// Thread feeding the sink from the playlist. It's the only one touching them once started, so the console (printing,
+// key polling) can't delay a refill: the UI sends its commands through a lock-free queue, and gets the tracks written
+// to the sink through another one and the position being played through an atomic. The thread asks for real-time
+// scheduling (MMCSS "Pro Audio" on Windows, SCHED_FIFO or SCHED_RR on Linux where permitted) when the sink consumes in
+// real time, and never prints nor allocates while rendering. It doesn't start nor join threads either: the track
+// changes and the seeks (which restart the readers) are done by the track loader of the playlist, the sink being
+// refilled once a seek is done while the commands wait in their queue. Nor does it wait for the readers: a refill
+// writes what the playlist has ready, the rest is pulled on the next sink event, and the sink is only started once it
+// has something to play. On those sinks the playback starts with a fade in, and pausing, resuming, seeking and stopping
+// are faded too, so none of them clicks. Pausing, resuming and volume changes are ramped from the next refill, after
+// what the sink holds, which is played without a gap. Seeking and stopping rewrite what the sink holds from the frame
+// being played, so they are heard right away.
+class RenderThread {
+private:
+	AudioSink *sink;
+	Playlist *playlist;
+	GainStage *gain_stage;
+	Meter *meter;
+	AudioSource *output; // Last stage before the sink
+	uint64_t stream_position;
+	CommandQueue<RENDER_COMMAND, RENDER_COMMAND_QUEUE_SIZE> commands;
+	CommandQueue<RENDER_EVENT, RENDER_EVENT_QUEUE_SIZE> events;
+	size_t sent_track_index{SIZE_MAX};
+	std::thread thread;
+	RENDER_STATISTICS statistics;
+	bool is_paused{};
+	bool is_playing{};
+	bool is_faded{}; // Whether the sink consumes in real time, so what it plays is faded and rewritten on commands
+	bool is_pausing{}; // Whether the fade out of a pause is being played (the sink runs until it has been)
+	bool is_stopping{}; // Whether the fade out of a stop is being lent
+	uint32_t fade_frames{};
+	uint32_t volume_ramp_frames{};
+	uint64_t late_refill_duration{}; // Time (in nanoseconds) the sink takes to play the frames it's refilled at
+	bool is_seeking{}; // Whether the playlist is seeking, nothing is refilled until it's done
+	uint64_t seek_position{}; // Position the playlist is seeking to
+	bool is_start_pending{}; // Whether the sink is started once it has been refilled with frames (after a seek or a pause)
+
+	// State published to the UI
+	std::atomic<uint64_t> played_position{};
+	std::atomic<bool> is_started_flag{};
+	std::atomic<bool> is_finished_flag{};
+	std::atomic<RENDER_PRIORITY> priority{RENDER_PRIORITY_NORMAL};
+
+#ifdef _WIN32
+	HANDLE mmcss_task{};
+#endif
+
+	void run();
+
+	RENDER_PRIORITY promote_priority();
+
+	void revert_priority();
+
+	void process_commands(bool &stop);
+
+	uint64_t get_sink_position();
+
+	void move_to(uint64_t target_position, bool is_started, bool &stop);
+
+	void complete_move(bool is_seeked, bool &stop);
+
+	void fade_out(bool &stop);
+
+	void seek(int64_t seek_offset, bool &stop);
+
+	uint32_t refill(bool &stop);
+
+	void publish_track();
+
+	void publish_position();
+
+public:
+	// The playlist must already be positioned at the given frame (counted from its start), the gain stage must scale it
+	// (the render thread owns its volume and fades once started) and the meter, if any, must measure the gain stage
+	RenderThread(AudioSink *sink, Playlist *playlist, GainStage *gain_stage, Meter *meter, uint64_t start_position);
+
+	RenderThread(RenderThread const &render_thread) = delete;
+
+	RenderThread &operator=(RenderThread const &render_thread) = delete;
+
+	~RenderThread();
+
+	void start();
+
+	// Waits for the stream to be played to the end
+	void join();
+
+	// Queues a command for the render thread, returns false (and counts it) if the queue is full
+	bool send_command(const RENDER_COMMAND &command);
+
+	// Gets the position (in frames of the sink, counted from the start of the playlist) of the frame being played
+	uint64_t get_played_position();
+
+	// Gets the next track written to the sink, returns false if there is none
+	bool receive_event(RENDER_EVENT &event);
+
+	// Returns whether the sink has been started (the first refill has been written)
+	bool is_started();
+
+	bool is_finished();
+
+	RENDER_PRIORITY get_priority();
+
+	// Gets the measurements of the render thread (only meaningful once it has been joined)
+	RENDER_STATISTICS get_statistics();
+};
+
+#endif //WASABI_RENDER_THREAD_HPP
@@ -0,0 +1,468 @@
+#include "segment_renderer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sys/stat.h>
+#include "instrumentation.hpp"
+
+// Only regular files can be opened again by the workers and sought (not pipes nor devices)
+static bool are_regular_files(const std::vector<std::string> &file_paths) {
+	for (const std::string &file_path : file_paths) {
+		struct stat file_status{};
+
+		if (stat(file_path.c_str(), &file_status) != 0 || (file_status.st_mode & S_IFMT) != S_IFREG) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+SegmentRenderer::SegmentRenderer(const std::vector<std::string> &file_paths, bool use_memory_map,
+	DITHER_TYPE dither_type, RESAMPLER_QUALITY resampler_quality, bool is_mixed, unsigned num_threads) {
+	this->use_memory_map = use_memory_map;
+	this->dither_type = dither_type;
+	this->resampler_quality = resampler_quality;
+	this->is_mixed = is_mixed;
+	this->num_threads = num_threads != 0 ? num_threads : std::max(1u, std::thread::hardware_concurrency());
+	this->num_threads = std::min(this->num_threads, (unsigned)RENDER_MAX_THREADS);
+
+	// A mixed playlist is a single track made of every file
+	if (is_mixed) {
+		this->tracks.emplace_back();
+		this->tracks.back().file_paths = file_paths;
+	}
+	else {
+		for (const std::string &file_path : file_paths) {
+			this->tracks.emplace_back();
+			this->tracks.back().file_paths.push_back(file_path);
+		}
+	}
+}
+
+SegmentRenderer::~SegmentRenderer() {
+	{
+		std::lock_guard<std::mutex> lck(this->mtx);
+
+		this->is_stopping = true;
+	}
+
+	this->slot_released.notify_all();
+	this->join();
+}
+
+std::unique_ptr<Playlist> SegmentRenderer::open_playlist(const std::vector<std::string> &track_file_paths,
+	bool is_verbose) {
+	std::unique_ptr<Playlist> playlist(new Playlist(track_file_paths, this->use_memory_map, this->dither_type,
+		this->resampler_quality));
+
+	playlist->is_verbose = is_verbose;
+	playlist->is_mixed = this->is_mixed;
+
+	if (!playlist->open()) {
+		return nullptr;
+	}
+
+	return playlist;
+}
+
+void SegmentRenderer::collect_statistics(Playlist &playlist) {
+	this->num_reader_stalls += playlist.get_num_reader_stalls();
+	this->num_decode_errors += playlist.get_num_decode_errors();
+}
+
+bool SegmentRenderer::open() {
+	// The tracks preceding the first one that can be opened are skipped (the playlist reports them)
+	while (!this->tracks.empty()) {
+		this->first_playlist = this->open_playlist(this->tracks.front().file_paths, this->is_verbose);
+
+		if (this->first_playlist != nullptr) {
+			return true;
+		}
+
+		this->tracks.erase(this->tracks.begin());
+	}
+
+	return false;
+}
+
+AUDIO_FORMAT SegmentRenderer::get_track_format() {
+	return this->first_playlist->get_track_format();
+}
+
+bool SegmentRenderer::set_format(const AUDIO_FORMAT &format, uint64_t start_frame) {
+	uint64_t segment_frames = (uint64_t)RENDER_SEGMENT_DURATION * format.sample_rate;
+	size_t num_split_segments = 0;
+
+	this->format = format;
+
+	for (size_t track_index = 0; track_index < this->tracks.size(); track_index++) {
+		RENDER_TRACK &track = this->tracks[track_index];
+		std::unique_ptr<Playlist> playlist = track_index == 0 ? std::move(this->first_playlist) :
+			this->open_playlist(track.file_paths, false);
+
+		if (playlist == nullptr || !playlist->set_format(format)) {
+			if (playlist != nullptr) {
+				std::cerr << "\nWARNING: Skipping \"" << track.file_paths.front() << "\"." << std::endl;
+			}
+
+			continue;
+		}
+
+		// Only the first track rendered starts from the given frame
+		uint64_t track_start_frame = this->num_rendered_tracks == 0 ? start_frame : 0;
+
+		track.num_frames = playlist->get_track_num_frames();
+		track.num_preroll_frames = playlist->get_track_num_preroll_frames();
+
+		this->num_rendered_tracks += 1;
+
+		// Streams (whose length isn't known, or which can't be read again) are pulled from this playlist as they are lent
+		if (playlist->get_track_duration() == 0 || !are_regular_files(track.file_paths)) {
+			if (track_start_frame > 0) {
+				playlist->seek(track_start_frame);
+			}
+
+			track.playlist = std::move(playlist);
+
+			this->segments.push_back({track_index, 0, UINT64_MAX, true});
+
+			continue;
+		}
+
+		// The playlist was only opened to know the length of the track, the workers open their own ones
+		track_start_frame = std::min(track_start_frame, track.num_frames);
+
+		this->collect_statistics(*playlist);
+
+		while (true) {
+			if (track.num_frames - track_start_frame <= segment_frames + segment_frames / 2) {
+				this->segments.push_back({track_index, track_start_frame, UINT64_MAX, false});
+
+				break;
+			}
+
+			this->segments.push_back({track_index, track_start_frame, segment_frames, false});
+
+			track_start_frame += segment_frames;
+		}
+	}
+
+	if (this->segments.empty()) {
+		return false;
+	}
+
+	// Segments are only rendered ahead of the one being lent within the memory budget (one at least)
+	uint64_t max_segment_size = (segment_frames + segment_frames / 2) * format.block_align;
+	size_t num_slots = (size_t)std::max<uint64_t>(1, RENDER_MAX_BUFFERED_SIZE / max_segment_size);
+
+	for (const RENDER_SEGMENT &segment : this->segments) {
+		num_split_segments += segment.is_streamed ? 0 : 1;
+	}
+
+	this->num_threads = (unsigned)std::min<size_t>(this->num_threads, num_split_segments);
+	this->slots.resize(std::min<size_t>(num_slots, std::max(1u, this->num_threads) * 2));
+
+	for (unsigned i = 0; i < this->num_threads; i++) {
+		this->workers.emplace_back(&SegmentRenderer::render_segments, this);
+	}
+
+	return true;
+}
+
+size_t SegmentRenderer::get_num_tracks() {
+	return this->num_rendered_tracks;
+}
+
+size_t SegmentRenderer::get_num_segments() {
+	return this->segments.size();
+}
+
+unsigned SegmentRenderer::get_num_threads() {
+	return this->num_threads;
+}
+
+void SegmentRenderer::join() {
+	for (std::thread &worker : this->workers) {
+		if (worker.joinable()) {
+			worker.join();
+		}
+	}
+}
+
+uint64_t SegmentRenderer::get_num_reader_stalls() {
+	std::lock_guard<std::mutex> lck(this->mtx);
+
+	return this->num_reader_stalls;
+}
+
+uint64_t SegmentRenderer::get_num_decode_errors() {
+	std::lock_guard<std::mutex> lck(this->mtx);
+
+	return this->num_decode_errors;
+}
+
+uint64_t SegmentRenderer::get_num_failed_segments() {
+	std::lock_guard<std::mutex> lck(this->mtx);
+
+	return this->num_failed_segments;
+}
+
+// Derives the dither seed of a segment from its position, so its noise is the same whichever worker renders it and
+// whatever that worker rendered before (the bits are mixed as splitmix64 does, nearby segments get unrelated seeds)
+static uint32_t get_segment_dither_seed(const RENDER_SEGMENT &segment) {
+	uint64_t key = ((uint64_t)segment.track_index << 48) ^ segment.start_frame;
+
+	key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ull;
+	key = (key ^ (key >> 27)) * 0x94D049BB133111EBull;
+
+	return (uint32_t)(key ^ (key >> 31));
+}
+
+bool SegmentRenderer::render_segment(Playlist &playlist, const RENDER_SEGMENT &segment, std::vector<uint8_t> &data) {
+	const RENDER_TRACK &track = this->tracks[segment.track_index];
+	uint32_t block_align = this->format.block_align;
+	uint64_t num_preroll_frames = std::min(segment.start_frame, track.num_preroll_frames);
+
+	if (!playlist.seek(segment.start_frame - num_preroll_frames)) {
+		return false;
+	}
+
+	playlist.reseed_dither(get_segment_dither_seed(segment));
+
+	// Renders the preroll, then the segment (up to the end of the track for the last one)
+	uint64_t num_skipped_bytes = num_preroll_frames * block_align;
+	uint64_t segment_size = segment.num_frames != UINT64_MAX ? segment.num_frames * block_align : UINT64_MAX;
+	uint32_t max_chunk_size = UINT32_MAX - UINT32_MAX % block_align;
+	AUDIO_CHUNK chunk;
+	bool is_eof = false;
+
+	if (segment.num_frames != UINT64_MAX) {
+		data.reserve(segment_size);
+	}
+
+	while (!is_eof && data.size() < segment_size) {
+		uint64_t requested_size = num_skipped_bytes > 0 ? num_skipped_bytes : segment_size - data.size();
+
+		is_eof = playlist.get_chunk(chunk, (uint32_t)std::min<uint64_t>(requested_size, max_chunk_size));
+
+		// The readers have nothing ready, the worker waits for them (it has no deadline)
+		if (chunk.size == 0 && !is_eof) {
+			playlist.release_chunk(chunk);
+			playlist.wait_for_chunk(SOURCE_WAIT_INTERVAL);
+
+			continue;
+		}
+
+		if (num_skipped_bytes > 0) {
+			num_skipped_bytes -= std::min<uint64_t>(chunk.size, num_skipped_bytes);
+		}
+		else {
+			data.insert(data.end(), chunk.data, chunk.data + chunk.size);
+		}
+
+		playlist.release_chunk(chunk);
+	}
+
+	return true;
+}
+
+void SegmentRenderer::render_segments() {
+	std::unique_ptr<Playlist> playlist;
+	size_t playlist_track_index = SIZE_MAX;
+
+	register_trace_thread("Segment worker", TRACE_READER_EVENTS);
+
+	while (true) {
+		size_t segment_index;
+
+		{
+			std::unique_lock<std::mutex> lck(this->mtx);
+
+			// Waits for the slot of the next segment to be released by the one lent before it
+			this->slot_released.wait(lck, [this]() {
+				return this->is_stopping || this->next_segment_index >= this->segments.size() ||
+					this->next_segment_index < this->read_segment_index + this->slots.size();
+			});
+
+			if (this->is_stopping || this->next_segment_index >= this->segments.size()) {
+				break;
+			}
+
+			segment_index = this->next_segment_index++;
+		}
+
+		const RENDER_SEGMENT &segment = this->segments[segment_index];
+		RENDER_SLOT &slot = this->slots[segment_index % this->slots.size()];
+
+		if (segment.is_streamed) {
+			continue;
+		}
+
+		// Keeps the playlist of the previous segment when it's of the same track, it only has to seek
+		if (segment.track_index != playlist_track_index) {
+			if (playlist != nullptr) {
+				std::lock_guard<std::mutex> lck(this->mtx);
+
+				this->collect_statistics(*playlist);
+			}
+
+			playlist = this->open_playlist(this->tracks[segment.track_index].file_paths, false);
+			playlist_track_index = segment.track_index;
+
+			if (playlist != nullptr && !playlist->set_format(this->format)) {
+				playlist.reset();
+			}
+		}
+
+		// The slot isn't touched by the stream until it's ready
+		slot.data.clear();
+
+		bool is_rendered = playlist != nullptr && this->render_segment(*playlist, segment, slot.data);
+
+		{
+			std::lock_guard<std::mutex> lck(this->mtx);
+
+			slot.is_ready = true;
+			this->num_failed_segments += is_rendered ? 0 : 1;
+		}
+
+		this->segment_rendered.notify_all();
+	}
+
+	if (playlist != nullptr) {
+		std::lock_guard<std::mutex> lck(this->mtx);
+
+		this->collect_statistics(*playlist);
+	}
+}
+
+void SegmentRenderer::finish_segment() {
+	const RENDER_SEGMENT &segment = this->segments[this->read_segment_index];
+
+	{
+		std::lock_guard<std::mutex> lck(this->mtx);
+
+		if (segment.is_streamed) {
+			RENDER_TRACK &track = this->tracks[segment.track_index];
+
+			this->collect_statistics(*track.playlist);
+			track.playlist.reset();
+		}
+		else {
+			this->slots[this->read_segment_index % this->slots.size()].is_ready = false;
+		}
+
+		this->read_segment_index += 1;
+		this->read_position = 0;
+	}
+
+	this->slot_released.notify_all();
+}
+
+AUDIO_FORMAT SegmentRenderer::get_format() {
+	return this->format;
+}
+
+bool SegmentRenderer::get_chunk(AUDIO_CHUNK &chunk, uint32_t max_size) {
+	// Chunks are made of whole frames
+	max_size -= max_size % this->format.block_align;
+
+	while (this->read_segment_index < this->segments.size()) {
+		const RENDER_SEGMENT &segment = this->segments[this->read_segment_index];
+		bool is_last_segment = this->read_segment_index + 1 == this->segments.size();
+
+		if (segment.is_streamed) {
+			bool is_track_ended = this->tracks[segment.track_index].playlist->get_chunk(chunk, max_size);
+
+			// The segment ends once the last chunk of the track is released
+			if (!is_track_ended || chunk.size > 0) {
+				this->is_lending_stream = true;
+				this->is_stream_ended = is_track_ended;
+				chunk.is_eof = is_track_ended && is_last_segment;
+
+				return chunk.is_eof;
+			}
+
+			this->tracks[segment.track_index].playlist->release_chunk(chunk);
+			this->finish_segment();
+
+			continue;
+		}
+
+		RENDER_SLOT &slot = this->slots[this->read_segment_index % this->slots.size()];
+		bool is_ready = false;
+
+		{
+			std::lock_guard<std::mutex> lck(this->mtx);
+
+			is_ready = slot.is_ready;
+		}
+
+		// Lends an empty chunk while the segment is being rendered, the consumer waits with wait_for_chunk
+		if (!is_ready) {
+			chunk.data = nullptr;
+			chunk.size = 0;
+			chunk.is_eof = false;
+
+			return false;
+		}
+
+		// Lends the segment straight from its slot, which is released once the segment has been lent entirely
+		size_t remaining_size = slot.data.size() - this->read_position;
+
+		if (remaining_size > 0) {
+			chunk.data = slot.data.data() + this->read_position;
+			chunk.size = (uint32_t)std::min<size_t>(remaining_size, max_size);
+			chunk.is_eof = is_last_segment && chunk.size == remaining_size;
+
+			return chunk.is_eof;
+		}
+
+		this->finish_segment();
+	}
+
+	chunk.data = nullptr;
+	chunk.size = 0;
+	chunk.is_eof = true;
+
+	return true;
+}
+
+void SegmentRenderer::wait_for_chunk(uint32_t timeout) {
+	if (this->read_segment_index >= this->segments.size()) {
+		return;
+	}
+
+	const RENDER_SEGMENT &segment = this->segments[this->read_segment_index];
+
+	if (segment.is_streamed) {
+		this->tracks[segment.track_index].playlist->wait_for_chunk(timeout);
+
+		return;
+	}
+
+	RENDER_SLOT &slot = this->slots[this->read_segment_index % this->slots.size()];
+	std::unique_lock<std::mutex> lck(this->mtx);
+
+	this->segment_rendered.wait_for(lck, std::chrono::milliseconds(timeout), [&slot]() {
+		return slot.is_ready;
+	});
+}
+
+void SegmentRenderer::release_chunk(AUDIO_CHUNK &chunk) {
+	if (this->is_lending_stream) {
+		this->tracks[this->segments[this->read_segment_index].track_index].playlist->release_chunk(chunk);
+		this->is_lending_stream = false;
+
+		if (this->is_stream_ended) {
+			this->finish_segment();
+		}
+	}
+	else {
+		this->read_position += chunk.size;
+	}
+
+	chunk.data = nullptr;
+	chunk.size = 0;
+}
@@ -0,0 +1,144 @@
+#ifndef WASABI_SEGMENT_RENDERER_HPP
+#define WASABI_SEGMENT_RENDERER_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "audio_source.hpp"
+#include "format_converter.hpp"
+#include "playlist.hpp"
+#include "resampler.hpp"
+
+// Duration (in seconds of the output) of the segments the tracks are split into, the last one of a track may be up to
+// half as long again so no short segment is left
+#define RENDER_SEGMENT_DURATION 10
+
+// Maximum number of workers rendering the segments
+#define RENDER_MAX_THREADS 16
+
+// Maximum size (in bytes) of the rendered segments waiting to be written (each worker has two of them at most)
+#define RENDER_MAX_BUFFERED_SIZE (256 * 1024 * 1024)
+
+// Track of the render, played by a playlist of its own (made of all the files when they are mixed)
+typedef struct RENDER_TRACK {
+	std::vector<std::string> file_paths;
+	uint64_t num_frames{}; // In frames of the output
+	uint64_t num_preroll_frames{}; // Rendered and dropped before a segment starting within the track
+	std::unique_ptr<Playlist> playlist; // Kept open for the tracks that are streamed rather than split
+} RENDER_TRACK;
+
+typedef struct RENDER_SEGMENT {
+	size_t track_index{};
+	uint64_t start_frame{}; // In frames of the output, counted from the start of the track
+	uint64_t num_frames{}; // UINT64_MAX for the last segment of a track (rendered until the track ends)
+	bool is_streamed{}; // Whether the segment is the whole track, pulled from its playlist as it's written
+} RENDER_SEGMENT;
+
+// Rendered audio of a segment, waiting to be written
+typedef struct RENDER_SLOT {
+	std::vector<uint8_t> data;
+	bool is_ready{};
+} RENDER_SLOT;
+
+// Source rendering the tracks of a playlist as fast as possible, rather than at the pace of a sink. The tracks are
+// split into segments that a pool of workers renders in parallel, each through a playlist of its own (so with the same
+// decoders, converters and resamplers as the player) seeking to the segment, and the segments are lent in order as they
+// complete (an empty chunk is lent while the next one is being rendered), so the stream is the same as the one of a
+// single playlist. The workers stay at most two segments each ahead of the one being lent. A segment starting within a
+// track is preceded by enough frames for the resampler to fill its history, which are dropped. Tracks whose length
+// isn't known (streams) can't be split, they are pulled from their playlist as they are lent.
+class SegmentRenderer : public AudioSource {
+private:
+	bool use_memory_map{};
+	DITHER_TYPE dither_type{};
+	RESAMPLER_QUALITY resampler_quality{};
+	bool is_mixed{};
+	unsigned num_threads{};
+	AUDIO_FORMAT format;
+	std::unique_ptr<Playlist> first_playlist; // Describes the first track until the format is set
+	std::vector<RENDER_TRACK> tracks;
+	std::vector<RENDER_SEGMENT> segments;
+	std::vector<RENDER_SLOT> slots;
+	size_t num_rendered_tracks{};
+	std::vector<std::thread> workers;
+	std::mutex mtx;
+	std::condition_variable segment_rendered;
+	std::condition_variable slot_released;
+	size_t next_segment_index{}; // Next segment a worker takes
+	size_t read_segment_index{}; // Segment being lent
+	size_t read_position{}; // In the data of the segment being lent
+	bool is_lending_stream{}; // Whether the chunk lent comes from the playlist of a streamed track
+	bool is_stream_ended{};
+	bool is_stopping{};
+	uint64_t num_reader_stalls{};
+	uint64_t num_decode_errors{};
+	uint64_t num_failed_segments{};
+
+	std::unique_ptr<Playlist> open_playlist(const std::vector<std::string> &track_file_paths, bool is_verbose);
+
+	// Adds the counters of a playlist that is about to be closed to the ones of the render (the lock must be held)
+	void collect_statistics(Playlist &playlist);
+
+	bool render_segment(Playlist &playlist, const RENDER_SEGMENT &segment, std::vector<uint8_t> &data);
+
+	void render_segments();
+
+	void finish_segment();
+
+public:
+	// The tracks are rendered with the given number of workers (one per core when 0)
+	SegmentRenderer(const std::vector<std::string> &file_paths, bool use_memory_map, DITHER_TYPE dither_type,
+		RESAMPLER_QUALITY resampler_quality, bool is_mixed, unsigned num_threads = 0);
+
+	SegmentRenderer(SegmentRenderer const &segment_renderer) = delete;
+
+	SegmentRenderer &operator=(SegmentRenderer const &segment_renderer) = delete;
+
+	~SegmentRenderer() override;
+
+	bool is_verbose{true}; // Whether the first track is described (errors and skipped tracks are always reported)
+
+	// Opens the first track that can be rendered, returns false if there is none
+	bool open();
+
+	// Gets the format of the file of the first track (the output format is usually chosen from it)
+	AUDIO_FORMAT get_track_format();
+
+	// Sets the format every track is rendered in and splits the tracks into segments (opening each of them once to know
+	// its length, the ones that can't be opened are reported and skipped), then starts the workers from the given frame
+	// of the first track. Returns false if no track can be rendered in this format
+	bool set_format(const AUDIO_FORMAT &format, uint64_t start_frame = 0);
+
+	// Gets the number of tracks that are rendered (the ones that could be opened)
+	size_t get_num_tracks();
+
+	size_t get_num_segments();
+
+	unsigned get_num_threads();
+
+	// Waits for the workers to exit, the counters are complete afterwards
+	void join();
+
+	// Gets how many times the readers made the workers (or the stream, for streamed tracks) wait for their data
+	uint64_t get_num_reader_stalls();
+
+	// Gets how many blocks the readers couldn't decode (they were rendered as silence)
+	uint64_t get_num_decode_errors();
+
+	// Gets how many segments couldn't be rendered (their tracks couldn't be opened again or sought)
+	uint64_t get_num_failed_segments();
+
+	AUDIO_FORMAT get_format() override;
+
+	bool get_chunk(AUDIO_CHUNK &chunk, uint32_t max_size) override;
+
+	void release_chunk(AUDIO_CHUNK &chunk) override;
+
+	void wait_for_chunk(uint32_t timeout) override;
+};
+
+#endif //WASABI_SEGMENT_RENDERER_HPP
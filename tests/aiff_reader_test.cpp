@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "aiff_reader.hpp"
+#include "conversion_kernels.hpp"
+#include "test.hpp"
+
+// Number of frames of the test files (not a multiple of any vector width)
+#define TEST_NUM_FRAMES 1001
+
+// Size of the sample buffers of the kernel tests, the longest length tested included
+#define TEST_KERNEL_BUFFER_SIZE 1100
+
+// Sample rate of the NTSC video pull-down (48000 * 1000 / 1001 Hz), stored as it is and rounded by the reader
+#define TEST_FRACTIONAL_SAMPLE_RATE (48000.0 * 1000.0 / 1001.0)
+
+// Storage of the samples of an AIFF or AIFC test file
+typedef struct TEST_AIFF_FORMAT {
+	const char *compression_type; // nullptr for an AIFF file
+	uint16_t bit_depth;
+	bool is_float;
+	bool is_big_endian;
+} TEST_AIFF_FORMAT;
+
+static void append_uint16_be(std::vector<uint8_t> &data, uint16_t value) {
+	data.push_back((uint8_t)(value >> 8));
+	data.push_back((uint8_t)value);
+}
+
+static void append_uint32_be(std::vector<uint8_t> &data, uint32_t value) {
+	append_uint16_be(data, (uint16_t)(value >> 16));
+	append_uint16_be(data, (uint16_t)value);
+}
+
+// Appends an 80 bits IEEE 754 extended precision number: sign, 15 bits exponent biased by 16383, then a 64 bits
+// mantissa whose integer bit is explicit
+static void append_extended(std::vector<uint8_t> &data, double value) {
+	int exponent;
+	double fraction = std::frexp(value, &exponent);
+	uint64_t mantissa = (uint64_t)std::ldexp(fraction, 64);
+
+	append_uint16_be(data, (uint16_t)(exponent - 1 + 16383));
+	append_uint32_be(data, (uint32_t)(mantissa >> 32));
+	append_uint32_be(data, (uint32_t)mantissa);
+}
+
+static void append_chunk_header(std::vector<uint8_t> &data, const char *id, uint32_t size) {
+	data.insert(data.end(), id, id + 4);
+	append_uint32_be(data, size);
+}
+
+// Gets the value of the test sample, a sine over most of the range of the format (the integer ones are whole steps)
+static float get_test_sample(uint64_t index, const TEST_AIFF_FORMAT &format) {
+	float value = 0.9f * std::sin((float)index * 0.05f);
+
+	if (format.is_float) {
+		return value;
+	}
+
+	return std::ldexp(std::round(std::ldexp(value, format.bit_depth - 1)), 1 - format.bit_depth);
+}
+
+// Appends a sample in the byte order of the format
+static void append_sample(std::vector<uint8_t> &data, float value, const TEST_AIFF_FORMAT &format) {
+	uint32_t sample;
+
+	if (format.is_float) {
+		memcpy(&sample, &value, sizeof(sample));
+	}
+	else {
+		sample = (uint32_t)(int32_t)std::ldexp(value, format.bit_depth - 1);
+	}
+
+	for (uint16_t i = 0; i < format.bit_depth / 8; i++) {
+		uint16_t shift = format.is_big_endian ? (uint16_t)(format.bit_depth - 8 - i * 8) : (uint16_t)(i * 8);
+
+		data.push_back((uint8_t)(sample >> shift));
+	}
+}
+
+// Builds a stereo AIFF (or AIFC) file of the test samples, the samples of its SSND chunk preceded by 4 bytes of the
+// offset field
+static std::vector<uint8_t> make_test_aiff_file(double sample_rate, const TEST_AIFF_FORMAT &format) {
+	bool is_aifc = format.compression_type != nullptr;
+	std::vector<uint8_t> data;
+
+	append_chunk_header(data, "FORM", 0);
+	data.insert(data.end(), {'A', 'I', 'F', is_aifc ? (uint8_t)'C' : (uint8_t)'F'});
+
+	// Version of the AIFC specification
+	if (is_aifc) {
+		append_chunk_header(data, "FVER", 4);
+		append_uint32_be(data, 0xA2805140);
+	}
+
+	// The AIFC compression name (an empty Pascal string) pads the chunk to an even size
+	append_chunk_header(data, "COMM", is_aifc ? AIFC_COMM_SIZE + 2 : AIFF_COMM_SIZE);
+	append_uint16_be(data, 2);
+	append_uint32_be(data, TEST_NUM_FRAMES);
+	append_uint16_be(data, format.bit_depth);
+	append_extended(data, sample_rate);
+
+	if (is_aifc) {
+		data.insert(data.end(), format.compression_type, format.compression_type + 4);
+		data.insert(data.end(), 2, 0);
+	}
+
+	append_chunk_header(data, "SSND", AIFF_SSND_HEADER_SIZE + 4 + TEST_NUM_FRAMES * 2 * format.bit_depth / 8);
+	append_uint32_be(data, 4);
+	append_uint32_be(data, 0);
+	data.insert(data.end(), 4, 0);
+
+	for (uint64_t i = 0; i < TEST_NUM_FRAMES * 2; i++) {
+		append_sample(data, get_test_sample(i, format), format);
+	}
+
+	for (int i = 0; i < 4; i++) {
+		data[4 + i] = (uint8_t)((data.size() - 8) >> (24 - i * 8));
+	}
+
+	return data;
+}
+
+// Loads the file and converts its samples to floats with the kernel its format calls for, checking the format fields
+// and that the samples are the test ones
+static void check_file(std::string &file_path, double sample_rate, const TEST_AIFF_FORMAT &format) {
+	AIFFReader reader;
+
+	reader.is_verbose = false;
+
+	if (!TEST_CHECK(write_test_file(file_path, make_test_aiff_file(sample_rate, format))) ||
+		!TEST_CHECK(reader.load_file(&file_path))) {
+		return;
+	}
+
+	AUDIO_FORMAT audio_format = reader.get_format();
+
+	TEST_CHECK(audio_format.sample_rate == (uint32_t)std::lround(sample_rate));
+	TEST_CHECK(audio_format.num_channels == 2 && audio_format.bit_depth == format.bit_depth);
+	TEST_CHECK(audio_format.is_float == format.is_float && audio_format.is_big_endian == format.is_big_endian);
+	TEST_CHECK(reader.get_num_frames() == TEST_NUM_FRAMES);
+
+	std::vector<uint8_t> stream;
+	AUDIO_CHUNK chunk;
+	bool is_eof = false;
+
+	while (!is_eof) {
+		is_eof = reader.get_chunk(chunk, UINT32_MAX);
+
+		stream.insert(stream.end(), chunk.data, chunk.data + chunk.size);
+
+		reader.release_chunk(chunk);
+
+		if (chunk.size == 0 && !is_eof) {
+			reader.wait_for_chunk(SOURCE_WAIT_INTERVAL);
+		}
+	}
+
+	if (!TEST_CHECK(stream.size() == (size_t)TEST_NUM_FRAMES * audio_format.block_align)) {
+		return;
+	}
+
+	TO_FLOAT_KERNEL convert = audio_format.is_big_endian ?
+		get_big_endian_to_float_kernel(audio_format.bit_depth, audio_format.is_float, get_simd_level()) :
+		get_to_float_kernel(audio_format.bit_depth, audio_format.is_float, get_simd_level());
+	std::vector<float> samples(TEST_NUM_FRAMES * 2);
+	bool is_intact = true;
+
+	convert(stream.data(), samples.data(), samples.size());
+
+	for (size_t i = 0; i < samples.size() && is_intact; i++) {
+		is_intact = samples[i] == get_test_sample(i, format);
+	}
+
+	TEST_CHECK(is_intact);
+}
+
+// Checks that the 80 bits sample rates are read, the fractional ones being rounded
+static void test_sample_rates(const std::string &work_directory) {
+	std::string file_path = work_directory + "/wasabi_aiff_sample_rate_test.aiff";
+
+	check_file(file_path, 44100, {nullptr, 16, false, true});
+	check_file(file_path, 48000, {nullptr, 24, false, true});
+	check_file(file_path, 96000, {nullptr, 32, false, true});
+	check_file(file_path, TEST_FRACTIONAL_SAMPLE_RATE, {nullptr, 16, false, true});
+
+	remove(file_path.c_str());
+}
+
+// Checks the uncompressed AIFC files: big-endian ('NONE'), little-endian ('sowt') and big-endian floats ('fl32')
+static void test_compression_types(const std::string &work_directory) {
+	std::string file_path = work_directory + "/wasabi_aifc_test.aifc";
+
+	check_file(file_path, 44100, {"NONE", 16, false, true});
+	check_file(file_path, 44100, {"NONE", 24, false, true});
+	check_file(file_path, 44100, {"sowt", 16, false, false});
+	check_file(file_path, 48000, {"sowt", 24, false, false});
+	check_file(file_path, 48000, {"fl32", 32, true, true});
+
+	remove(file_path.c_str());
+}
+
+// Converts a big-endian sample as the specification reads it, one byte at a time
+static float convert_reference_sample(const uint8_t *sample, uint16_t bit_depth, bool is_float) {
+	uint32_t value = 0;
+
+	for (uint16_t i = 0; i < bit_depth / 8; i++) {
+		value = value << 8 | sample[i];
+	}
+
+	if (is_float) {
+		float float_value;
+
+		memcpy(&float_value, &value, sizeof(float_value));
+
+		return float_value;
+	}
+
+	// Sign extended from the bit depth
+	int64_t signed_value = (int64_t)value - ((value >> (bit_depth - 1)) != 0 ? (int64_t)1 << bit_depth : 0);
+
+	return std::ldexp((float)signed_value, 1 - bit_depth);
+}
+
+// Checks the big-endian kernels of every instruction set the CPU supports against the reference conversion (bit for
+// bit, float NaNs included), for lengths that leave tails after the vectors and from unaligned input
+static void test_big_endian_kernels() {
+	static const size_t LENGTHS[] = {0, 1, 3, 7, 8, 9, 15, 16, 17, 31, 33, 63, 65, 1001, TEST_KERNEL_BUFFER_SIZE - 1};
+	static const TEST_AIFF_FORMAT FORMATS[] = {
+		{nullptr, 16, false, true}, {nullptr, 24, false, true}, {nullptr, 32, false, true}, {"fl32", 32, true, true}
+	};
+
+	// Random bytes, so every sign and exponent (NaNs and infinities of the floats included) is converted
+	std::vector<uint8_t> input(TEST_KERNEL_BUFFER_SIZE * 4 + 1);
+	uint32_t seed = 1;
+
+	for (uint8_t &byte : input) {
+		seed = seed * 1664525 + 1013904223;
+		byte = (uint8_t)(seed >> 24);
+	}
+
+	for (const TEST_AIFF_FORMAT &format : FORMATS) {
+		size_t sample_size = format.bit_depth / 8;
+		std::vector<float> expected(TEST_KERNEL_BUFFER_SIZE);
+
+		for (size_t i = 0; i < TEST_KERNEL_BUFFER_SIZE; i++) {
+			expected[i] = convert_reference_sample(input.data() + 1 + i * sample_size, format.bit_depth,
+				format.is_float);
+		}
+
+		for (int level = SIMD_LEVEL_SCALAR; level <= get_simd_level(); level++) {
+			TO_FLOAT_KERNEL convert = get_big_endian_to_float_kernel(format.bit_depth, format.is_float,
+				(SIMD_LEVEL)level);
+
+			if (!TEST_CHECK(convert != nullptr)) {
+				continue;
+			}
+
+			for (size_t length : LENGTHS) {
+				// The sample following the converted ones must be left as it was
+				std::vector<float> output(TEST_KERNEL_BUFFER_SIZE + 1, 2.0f);
+
+				convert(input.data() + 1, output.data(), length);
+
+				TEST_CHECK(memcmp(output.data(), expected.data(), length * sizeof(float)) == 0);
+				TEST_CHECK(output[length] == 2.0f);
+			}
+		}
+	}
+}
+
+void run_aiff_reader_tests(const TEST_OPTIONS &options) {
+	test_sample_rates(options.work_directory);
+	test_compression_types(options.work_directory);
+	test_big_endian_kernels();
+}
@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "channel_mixer_kernels.hpp"
+#include "test.hpp"
+
+// Largest error allowed for an output sample, relative to the sum of the magnitudes of the products it adds: the
+// kernels add the same products in the same order, but the AVX2 one fuses the multiplications with the additions
+#define TEST_REMIX_TOLERANCE 1e-6
+
+// Samples following the frames of the buffer, which the kernels must leave as they are
+#define TEST_GUARD_SAMPLES 8
+#define TEST_GUARD_VALUE 3.0f
+
+// Channel counts of the tests: the layouts with specialised kernels, downmixes and upmixes (which are processed in
+// place from the last frame) through the vectorised kernels, and counts beyond their 8 output channels
+static const uint16_t CHANNEL_COUNTS[][2] = {
+	{1, 2}, {6, 2}, {8, 6}, {2, 1}, {4, 4}, {3, 5}, {2, 6}, {1, 8}, {6, 8}, {8, 2}, {12, 2}, {2, 10}, {32, 32}
+};
+
+// Checks the remix of every instruction set against one computed in double precision from a copy of the input, for
+// every number of frames (so the in-place upmixes are checked to read each frame before overwriting it)
+static void test_remix(uint16_t num_input_channels, uint16_t num_output_channels) {
+	uint16_t max_num_channels = std::max(num_input_channels, num_output_channels);
+	std::vector<float> matrix((size_t)num_input_channels * num_output_channels);
+	std::vector<float> input((size_t)TEST_KERNEL_MAX_LENGTH * num_input_channels);
+
+	fill_random_samples(matrix.data(), matrix.size(), -1.0f, 1.0f, num_input_channels * 100 + num_output_channels);
+	fill_random_samples(input.data(), input.size(), -1.0f, 1.0f, 11);
+
+	for (SIMD_LEVEL level : get_test_simd_levels()) {
+		REMIX_KERNEL remix = get_remix_kernel(num_input_channels, num_output_channels, level);
+
+		if (!TEST_CHECK(remix != nullptr)) {
+			continue;
+		}
+
+		for (size_t num_frames : get_test_kernel_lengths()) {
+			std::vector<float> samples(num_frames * max_num_channels + TEST_GUARD_SAMPLES, TEST_GUARD_VALUE);
+			bool is_accurate = true;
+
+			std::copy(input.begin(), input.begin() + (std::ptrdiff_t)(num_frames * num_input_channels),
+				samples.begin());
+
+			remix(samples.data(), num_frames, matrix.data(), num_input_channels, num_output_channels);
+
+			for (size_t frame = 0; frame < num_frames; frame++) {
+				for (uint16_t output_channel = 0; output_channel < num_output_channels; output_channel++) {
+					double expected = 0.0;
+					double magnitude = 0.0;
+
+					for (uint16_t input_channel = 0; input_channel < num_input_channels; input_channel++) {
+						double product = (double)matrix[(size_t)output_channel * num_input_channels + input_channel] *
+							input[frame * num_input_channels + input_channel];
+
+						expected += product;
+						magnitude += std::fabs(product);
+					}
+
+					float sample = samples[frame * num_output_channels + output_channel];
+
+					is_accurate = is_accurate && std::fabs(sample - expected) <= TEST_REMIX_TOLERANCE * magnitude;
+				}
+			}
+
+			TEST_CHECK(is_accurate);
+			TEST_CHECK(std::all_of(samples.end() - TEST_GUARD_SAMPLES, samples.end(), [](float sample) {
+				return sample == TEST_GUARD_VALUE;
+			}));
+		}
+	}
+}
+
+void run_channel_mixer_kernels_tests(const TEST_OPTIONS &options) {
+	for (const uint16_t (&channel_counts)[2] : CHANNEL_COUNTS) {
+		test_remix(channel_counts[0], channel_counts[1]);
+	}
+
+	// Channel counts without a kernel
+	TEST_CHECK(get_remix_kernel(0, 2, SIMD_LEVEL_SCALAR) == nullptr);
+	TEST_CHECK(get_remix_kernel(2, CHANNEL_MIXER_MAX_CHANNELS + 1, get_simd_level()) == nullptr);
+}
@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "conversion_kernels.hpp"
+#include "test.hpp"
+
+// Seed of the dither of the tests (any one would do)
+#define TEST_DITHER_SEED 0x5EED
+
+// Sample formats the kernels convert from and to 32 bits floats
+typedef struct TEST_SAMPLE_FORMAT {
+	uint16_t bit_depth;
+	bool is_float;
+} TEST_SAMPLE_FORMAT;
+
+static const TEST_SAMPLE_FORMAT SAMPLE_FORMATS[] = {{8, false}, {16, false}, {24, false}, {32, false}, {32, true}};
+
+// Bytes preceding the input of the kernels, so their loads are unaligned
+#define TEST_INPUT_OFFSET 1
+
+// Checks the conversions to floats of every instruction set against the scalar ones, bit for bit: every lane does
+// the same exact operations (a conversion and a multiplication by a power of 2). The input is random bytes (NaNs and
+// infinities of the floats included)
+static void test_to_float() {
+	std::vector<uint8_t> input(TEST_INPUT_OFFSET + TEST_KERNEL_MAX_LENGTH * 4);
+	uint32_t seed = 1;
+
+	for (uint8_t &byte : input) {
+		seed = seed * 1664525u + 1013904223u;
+		byte = (uint8_t)(seed >> 24);
+	}
+
+	for (const TEST_SAMPLE_FORMAT &format : SAMPLE_FORMATS) {
+		TO_FLOAT_KERNEL convert_scalar = get_to_float_kernel(format.bit_depth, format.is_float, SIMD_LEVEL_SCALAR);
+		std::vector<float> expected(TEST_KERNEL_MAX_LENGTH);
+
+		convert_scalar(input.data() + TEST_INPUT_OFFSET, expected.data(), TEST_KERNEL_MAX_LENGTH);
+
+		for (SIMD_LEVEL level : get_test_simd_levels()) {
+			TO_FLOAT_KERNEL convert = get_to_float_kernel(format.bit_depth, format.is_float, level);
+
+			for (size_t length : get_test_kernel_lengths()) {
+				// The sample following the converted ones must be left as it was
+				std::vector<float> output(length + 1, 2.0f);
+
+				convert(input.data() + TEST_INPUT_OFFSET, output.data(), length);
+
+				TEST_CHECK(memcmp(output.data(), expected.data(), length * sizeof(float)) == 0);
+				TEST_CHECK(output[length] == 2.0f);
+			}
+		}
+	}
+
+	// Full scale (the most negative sample) maps to -1
+	const uint8_t minimum_samples[] = {0x00, 0x00, 0x80, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0x80};
+	float minimum;
+
+	get_to_float_kernel(8, false, SIMD_LEVEL_SCALAR)(minimum_samples, &minimum, 1);
+	TEST_CHECK(minimum == -1.0f);
+	get_to_float_kernel(16, false, SIMD_LEVEL_SCALAR)(minimum_samples + 1, &minimum, 1);
+	TEST_CHECK(minimum == -1.0f);
+	get_to_float_kernel(24, false, SIMD_LEVEL_SCALAR)(minimum_samples + 3, &minimum, 1);
+	TEST_CHECK(minimum == -1.0f);
+	get_to_float_kernel(32, false, SIMD_LEVEL_SCALAR)(minimum_samples + 6, &minimum, 1);
+	TEST_CHECK(minimum == -1.0f);
+}
+
+// Gets samples beyond full scale (which are clipped), full scale itself and the halves of a step (which are rounded to
+// even), followed by random ones
+static std::vector<float> make_from_float_input() {
+	std::vector<float> input(TEST_KERNEL_MAX_LENGTH);
+
+	fill_random_samples(input.data(), input.size(), -1.25f, 1.25f, 7);
+
+	const float special_samples[] = {
+		1.0f, -1.0f, 0.0f, -0.0f, 2.0f, -2.0f, 0.99999994f, -0.99999994f, 0.5f / 32768.0f, 1.5f / 32768.0f,
+		-0.5f / 32768.0f, 0.5f / 8388608.0f, 1.5f / 8388608.0f, 1e-30f, 1e30f, -1e30f
+	};
+
+	memcpy(input.data() + 3, special_samples, sizeof(special_samples));
+
+	return input;
+}
+
+// Checks the conversions from floats of every instruction set against the scalar ones, bit for bit: they round and
+// clip the same way, and the dither noise of each sample only depends on its position in the stream
+static void test_from_float(bool is_dithered) {
+	std::vector<float> input = make_from_float_input();
+
+	for (const TEST_SAMPLE_FORMAT &format : SAMPLE_FORMATS) {
+		size_t sample_size = format.bit_depth / 8;
+		FROM_FLOAT_KERNEL convert_scalar = get_from_float_kernel(format.bit_depth, format.is_float, SIMD_LEVEL_SCALAR);
+		DITHER_STATE dither_state;
+		std::vector<uint8_t> expected(TEST_KERNEL_MAX_LENGTH * sample_size);
+
+		initialize_dither_state(&dither_state, TEST_DITHER_SEED);
+		convert_scalar(input.data(), expected.data(), TEST_KERNEL_MAX_LENGTH, is_dithered ? &dither_state : nullptr);
+
+		for (SIMD_LEVEL level : get_test_simd_levels()) {
+			FROM_FLOAT_KERNEL convert = get_from_float_kernel(format.bit_depth, format.is_float, level);
+
+			for (size_t length : get_test_kernel_lengths()) {
+				std::vector<uint8_t> output((length + 1) * sample_size, 0xA5);
+
+				initialize_dither_state(&dither_state, TEST_DITHER_SEED);
+				convert(input.data(), output.data(), length, is_dithered ? &dither_state : nullptr);
+
+				TEST_CHECK(memcmp(output.data(), expected.data(), length * sample_size) == 0);
+				TEST_CHECK(output[length * sample_size] == 0xA5);
+			}
+
+			// The same stream converted in blocks of every length (the groups of the dither are cut everywhere)
+			std::vector<uint8_t> output(TEST_KERNEL_MAX_LENGTH * sample_size);
+			size_t position = 0;
+
+			initialize_dither_state(&dither_state, TEST_DITHER_SEED);
+
+			for (size_t block_size = 1; position < TEST_KERNEL_MAX_LENGTH; block_size++) {
+				size_t length = std::min<size_t>(block_size, TEST_KERNEL_MAX_LENGTH - position);
+
+				convert(input.data() + position, output.data() + position * sample_size, length,
+					is_dithered ? &dither_state : nullptr);
+
+				position += length;
+			}
+
+			TEST_CHECK(output == expected);
+		}
+	}
+
+	// Full scale is clipped to the largest sample, the halves of a step are rounded to even
+	uint8_t samples[2];
+
+	get_from_float_kernel(16, false, SIMD_LEVEL_SCALAR)(input.data() + 3, samples, 1, nullptr);
+	TEST_CHECK(samples[0] == 0xFF && samples[1] == 0x7F);
+	get_from_float_kernel(16, false, SIMD_LEVEL_SCALAR)(input.data() + 11, samples, 1, nullptr);
+	TEST_CHECK(samples[0] == 0x00 && samples[1] == 0x00);
+	get_from_float_kernel(16, false, SIMD_LEVEL_SCALAR)(input.data() + 12, samples, 1, nullptr);
+	TEST_CHECK(samples[0] == 0x02 && samples[1] == 0x00);
+}
+
+void run_conversion_kernels_tests(const TEST_OPTIONS &options) {
+	test_to_float();
+	test_from_float(false);
+	test_from_float(true);
+}
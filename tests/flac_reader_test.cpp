@@ -0,0 +1,461 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "flac_reader.hpp"
+#include "test.hpp"
+
+// Number of samples per channel of the frames of the test streams, the last one holds what remains
+#define TEST_BLOCK_SIZE 4096
+#define TEST_NUM_FULL_BLOCKS 10
+#define TEST_LAST_BLOCK_SIZE 1000
+
+#define TEST_SAMPLE_RATE 44100
+
+// Codes of the frame headers: 4096 samples blocks (256 << 4), the other sizes stored after the frame number (16 bits,
+// minus 1), 44100 Hz and the bit depths
+#define TEST_BLOCK_SIZE_CODE 12
+#define TEST_UNCOMMON_BLOCK_SIZE_CODE 7
+#define TEST_SAMPLE_RATE_CODE 9
+#define TEST_BIT_DEPTH_CODE_16 4
+#define TEST_BIT_DEPTH_CODE_24 6
+
+// Subframe types (the order is added to them, minus 1 for LPC) and stereo channel assignments
+#define TEST_SUBFRAME_FIXED 8
+#define TEST_SUBFRAME_LPC 32
+#define TEST_CHANNELS_INDEPENDENT 1
+#define TEST_CHANNELS_LEFT_SIDE 8
+#define TEST_CHANNELS_RIGHT_SIDE 9
+#define TEST_CHANNELS_MID_SIDE 10
+
+// Big-endian bit writer the test streams are encoded with
+typedef struct TEST_BIT_WRITER {
+	std::vector<uint8_t> data;
+	uint32_t num_used_bits{}; // Bits of the last byte already written (0 when it's full)
+} TEST_BIT_WRITER;
+
+// Linear predictor of a subframe, the fixed ones have no shift and coefficients given by their order
+typedef struct TEST_PREDICTOR {
+	bool is_fixed{};
+	uint32_t order{};
+	uint32_t precision{}; // Bits of the coefficients
+	int shift{};
+	std::vector<int32_t> coefficients; // The first one applies to the previous sample
+} TEST_PREDICTOR;
+
+static const int32_t FIXED_COEFFICIENTS[5][4] = {{}, {1}, {2, -1}, {3, -3, 1}, {4, -6, 4, -1}};
+
+// Second order predictors spread over more coefficients, the 16 bits ones are restored by the 32 bits kernels and the
+// 24 bits ones (with 15 bits coefficients) by the 64 bits ones
+static const int32_t LPC_COEFFICIENTS_16[] = {2043, -1021, 2, -1, 1, -1, 1, -1};
+static const int32_t LPC_COEFFICIENTS_24[] = {16375, -8185, 3, -2, 1, -1, 1, -1, 1, -1, 1, -1};
+
+static void write_bits(TEST_BIT_WRITER &writer, uint64_t value, uint32_t num_bits) {
+	for (uint32_t i = num_bits; i-- > 0;) {
+		if (writer.num_used_bits == 0) {
+			writer.data.push_back(0);
+		}
+
+		writer.data.back() |= (uint8_t)(((value >> i) & 1) << (7 - writer.num_used_bits));
+		writer.num_used_bits = (writer.num_used_bits + 1) & 7;
+	}
+}
+
+static void write_signed_bits(TEST_BIT_WRITER &writer, int64_t value, uint32_t num_bits) {
+	write_bits(writer, (uint64_t)value & ((1ull << num_bits) - 1), num_bits);
+}
+
+static uint8_t compute_crc8(const std::vector<uint8_t> &data) {
+	uint8_t crc = 0;
+
+	for (uint8_t byte : data) {
+		crc ^= byte;
+
+		for (int i = 0; i < 8; i++) {
+			crc = (uint8_t)((crc & 0x80) != 0 ? (crc << 1) ^ 0x07 : crc << 1);
+		}
+	}
+
+	return crc;
+}
+
+static uint16_t compute_crc16(const std::vector<uint8_t> &data) {
+	uint16_t crc = 0;
+
+	for (uint8_t byte : data) {
+		crc ^= (uint16_t)(byte << 8);
+
+		for (int i = 0; i < 8; i++) {
+			crc = (uint16_t)((crc & 0x8000) != 0 ? (crc << 1) ^ 0x8005 : crc << 1);
+		}
+	}
+
+	return crc;
+}
+
+static TEST_PREDICTOR make_fixed_predictor(uint32_t order) {
+	TEST_PREDICTOR predictor;
+
+	predictor.is_fixed = true;
+	predictor.order = order;
+	predictor.coefficients.assign(FIXED_COEFFICIENTS[order], FIXED_COEFFICIENTS[order] + order);
+
+	return predictor;
+}
+
+static TEST_PREDICTOR make_lpc_predictor(uint16_t bit_depth) {
+	TEST_PREDICTOR predictor;
+
+	if (bit_depth == 16) {
+		predictor.precision = 12;
+		predictor.shift = 10;
+		predictor.coefficients.assign(std::begin(LPC_COEFFICIENTS_16), std::end(LPC_COEFFICIENTS_16));
+	}
+	else {
+		predictor.precision = 15;
+		predictor.shift = 13;
+		predictor.coefficients.assign(std::begin(LPC_COEFFICIENTS_24), std::end(LPC_COEFFICIENTS_24));
+	}
+
+	predictor.order = (uint32_t)predictor.coefficients.size();
+
+	return predictor;
+}
+
+// Writes the residuals of a partition with the Rice parameter coding them in the fewest bits (the escape code is left
+// out)
+static void write_rice_partition(TEST_BIT_WRITER &writer, const std::vector<uint64_t> &folded_residuals,
+	size_t first_residual, size_t num_residuals, uint32_t parameter_size) {
+	uint32_t best_parameter = 0;
+	uint64_t best_size = UINT64_MAX;
+
+	for (uint32_t parameter = 0; parameter + 1 < (1u << parameter_size); parameter++) {
+		uint64_t size = (uint64_t)num_residuals * (parameter + 1);
+
+		for (size_t i = first_residual; i < first_residual + num_residuals; i++) {
+			size += folded_residuals[i] >> parameter;
+		}
+
+		if (size < best_size) {
+			best_parameter = parameter;
+			best_size = size;
+		}
+	}
+
+	write_bits(writer, best_parameter, parameter_size);
+
+	for (size_t i = first_residual; i < first_residual + num_residuals; i++) {
+		for (uint64_t quotient = folded_residuals[i] >> best_parameter; quotient > 0; quotient--) {
+			write_bits(writer, 0, 1);
+		}
+
+		write_bits(writer, 1, 1);
+		write_bits(writer, folded_residuals[i], best_parameter);
+	}
+}
+
+// Writes a fixed or LPC subframe: the warm-up samples, the predictor and the residuals, Rice coded in 2^partition_order
+// partitions (with 5 bits parameters past 17 bits, so for the side channel of 24 bits streams)
+static void write_subframe(TEST_BIT_WRITER &writer, const std::vector<int64_t> &samples, uint32_t bit_depth,
+	const TEST_PREDICTOR &predictor, uint32_t partition_order) {
+	uint32_t type = predictor.is_fixed ? TEST_SUBFRAME_FIXED + predictor.order :
+		TEST_SUBFRAME_LPC + predictor.order - 1;
+
+	// Zero bit, type, no wasted bits
+	write_bits(writer, 0, 1);
+	write_bits(writer, type, 6);
+	write_bits(writer, 0, 1);
+
+	for (uint32_t i = 0; i < predictor.order; i++) {
+		write_signed_bits(writer, samples[i], bit_depth);
+	}
+
+	if (!predictor.is_fixed) {
+		write_bits(writer, predictor.precision - 1, 4);
+		write_signed_bits(writer, predictor.shift, 5);
+
+		for (int32_t coefficient : predictor.coefficients) {
+			write_signed_bits(writer, coefficient, predictor.precision);
+		}
+	}
+
+	// Zigzag folded residuals: the sign goes to the lowest bit
+	std::vector<uint64_t> folded_residuals;
+
+	for (size_t i = predictor.order; i < samples.size(); i++) {
+		int64_t prediction = 0;
+
+		for (uint32_t j = 0; j < predictor.order; j++) {
+			prediction += (int64_t)predictor.coefficients[j] * samples[i - 1 - j];
+		}
+
+		int64_t residual = samples[i] - (prediction >> predictor.shift);
+
+		folded_residuals.push_back((uint64_t)(residual * 2) ^ (uint64_t)(residual >> 63));
+	}
+
+	uint32_t parameter_size = bit_depth > 17 ? 5 : 4;
+	size_t partition_size = samples.size() >> partition_order;
+
+	write_bits(writer, parameter_size == 4 ? 0 : 1, 2);
+	write_bits(writer, partition_order, 4);
+
+	for (size_t partition = 0; partition < ((size_t)1 << partition_order); partition++) {
+		size_t first_residual = partition == 0 ? 0 : partition * partition_size - predictor.order;
+
+		write_rice_partition(writer, folded_residuals, first_residual,
+			partition == 0 ? partition_size - predictor.order : partition_size, parameter_size);
+	}
+}
+
+// Writes a frame of a stereo stream, its subframes coded as the channel assignment and the frame number require: both
+// fixed and LPC predictors, with every fixed order, in every channel assignment
+static void write_frame(std::vector<uint8_t> &stream, const std::vector<int32_t> &samples, uint64_t first_sample,
+	uint32_t block_size, uint32_t frame_number, uint16_t bit_depth) {
+	static const uint32_t CHANNEL_ASSIGNMENTS[] = {
+		TEST_CHANNELS_INDEPENDENT, TEST_CHANNELS_LEFT_SIDE, TEST_CHANNELS_RIGHT_SIDE, TEST_CHANNELS_MID_SIDE
+	};
+	uint32_t channel_assignment = CHANNEL_ASSIGNMENTS[frame_number % 4];
+	TEST_BIT_WRITER writer;
+
+	write_bits(writer, 0xFFF8, 16);
+	write_bits(writer, block_size == TEST_BLOCK_SIZE ? TEST_BLOCK_SIZE_CODE : TEST_UNCOMMON_BLOCK_SIZE_CODE, 4);
+	write_bits(writer, TEST_SAMPLE_RATE_CODE, 4);
+	write_bits(writer, channel_assignment, 4);
+	write_bits(writer, bit_depth == 16 ? TEST_BIT_DEPTH_CODE_16 : TEST_BIT_DEPTH_CODE_24, 3);
+	write_bits(writer, 0, 1);
+
+	// The frame number, coded like UTF-8 (the test streams are short enough for 2 bytes)
+	if (frame_number < 0x80) {
+		write_bits(writer, frame_number, 8);
+	}
+	else {
+		write_bits(writer, 0xC0 | frame_number >> 6, 8);
+		write_bits(writer, 0x80 | (frame_number & 0x3F), 8);
+	}
+
+	if (block_size != TEST_BLOCK_SIZE) {
+		write_bits(writer, block_size - 1, 16);
+	}
+
+	write_bits(writer, compute_crc8(writer.data), 8);
+
+	// The side channel (left minus right) has an extra bit, the mid channel loses the lowest bit of the sum
+	std::vector<int64_t> left(block_size);
+	std::vector<int64_t> right(block_size);
+
+	for (uint32_t i = 0; i < block_size; i++) {
+		left[i] = samples[(first_sample + i) * 2];
+		right[i] = samples[(first_sample + i) * 2 + 1];
+	}
+
+	std::vector<int64_t> side(block_size);
+	std::vector<int64_t> mid(block_size);
+
+	for (uint32_t i = 0; i < block_size; i++) {
+		side[i] = left[i] - right[i];
+		mid[i] = (left[i] + right[i]) >> 1;
+	}
+
+	const std::vector<int64_t> *subframes[2] = {&left, &right};
+	uint32_t subframe_bit_depths[2] = {bit_depth, bit_depth};
+
+	if (channel_assignment == TEST_CHANNELS_LEFT_SIDE) {
+		subframes[1] = &side;
+		subframe_bit_depths[1] += 1;
+	}
+	else if (channel_assignment == TEST_CHANNELS_RIGHT_SIDE) {
+		subframes[0] = &side;
+		subframe_bit_depths[0] += 1;
+	}
+	else if (channel_assignment == TEST_CHANNELS_MID_SIDE) {
+		subframes[0] = &mid;
+		subframes[1] = &side;
+		subframe_bit_depths[1] += 1;
+	}
+
+	for (uint32_t channel = 0; channel < 2; channel++) {
+		uint32_t index = frame_number * 2 + channel;
+		TEST_PREDICTOR predictor = (frame_number + channel) % 2 == 0 ? make_lpc_predictor(bit_depth) :
+			make_fixed_predictor(index % 5);
+
+		write_subframe(writer, *subframes[channel], subframe_bit_depths[channel], predictor, index % 3 == 0 ? 0 : 3);
+	}
+
+	// Padded to a whole byte
+	writer.num_used_bits = 0;
+
+	uint16_t crc = compute_crc16(writer.data);
+
+	writer.data.push_back((uint8_t)(crc >> 8));
+	writer.data.push_back((uint8_t)crc);
+
+	stream.insert(stream.end(), writer.data.begin(), writer.data.end());
+}
+
+// Builds a stereo FLAC stream of the given samples (interleaved), with a STREAMINFO block and no seek table
+static std::vector<uint8_t> make_test_flac_file(const std::vector<int32_t> &samples, uint16_t bit_depth) {
+	uint64_t num_frames = samples.size() / 2;
+	TEST_BIT_WRITER writer;
+
+	writer.data = {'f', 'L', 'a', 'C'};
+
+	// Last metadata block, STREAMINFO, 34 bytes long (the frame sizes and the MD5 signature are unknown)
+	write_bits(writer, 1, 1);
+	write_bits(writer, 0, 7);
+	write_bits(writer, 34, 24);
+	write_bits(writer, TEST_BLOCK_SIZE, 16);
+	write_bits(writer, TEST_BLOCK_SIZE, 16);
+	write_bits(writer, 0, 24);
+	write_bits(writer, 0, 24);
+	write_bits(writer, TEST_SAMPLE_RATE, 20);
+	write_bits(writer, 2 - 1, 3);
+	write_bits(writer, bit_depth - 1u, 5);
+	write_bits(writer, num_frames, 36);
+	write_bits(writer, 0, 64);
+	write_bits(writer, 0, 64);
+
+	for (uint64_t first_sample = 0; first_sample < num_frames; first_sample += TEST_BLOCK_SIZE) {
+		write_frame(writer.data, samples, first_sample, (uint32_t)std::min<uint64_t>(num_frames - first_sample,
+			TEST_BLOCK_SIZE), (uint32_t)(first_sample / TEST_BLOCK_SIZE), bit_depth);
+	}
+
+	return writer.data;
+}
+
+// Builds the interleaved samples of the stream: two sines of different frequencies with some noise, filling most of
+// the range of the bit depth
+static std::vector<int32_t> make_test_samples(uint16_t bit_depth, uint64_t num_frames) {
+	std::vector<int32_t> samples(num_frames * 2);
+	double amplitude = (double)(1 << (bit_depth - 1)) * 0.6;
+	uint32_t noise = 12345;
+
+	for (uint64_t frame = 0; frame < num_frames; frame++) {
+		for (uint16_t channel = 0; channel < 2; channel++) {
+			double phase = (double)frame * (channel == 0 ? 0.031 : 0.0173);
+
+			noise = noise * 1664525 + 1013904223;
+
+			double signal = 0.8 * std::sin(phase) + 0.2 * std::sin(phase * 7.3);
+
+			samples[frame * 2 + channel] = (int32_t)(amplitude * signal) + ((int32_t)(noise >> 24) - 128) *
+				(1 << (bit_depth - 16));
+		}
+	}
+
+	return samples;
+}
+
+// Gets the samples as the reader outputs them: little-endian, in whole bytes
+static std::vector<uint8_t> get_pcm_data(const std::vector<int32_t> &samples, uint16_t bit_depth) {
+	std::vector<uint8_t> data;
+
+	for (int32_t sample : samples) {
+		for (uint16_t shift = 0; shift < bit_depth; shift += 8) {
+			data.push_back((uint8_t)(sample >> shift));
+		}
+	}
+
+	return data;
+}
+
+// Reads from the current position until the end of the stream
+static std::vector<uint8_t> read_stream(FLACReader &reader) {
+	std::vector<uint8_t> stream;
+	AUDIO_CHUNK chunk;
+	bool is_eof = false;
+
+	while (!is_eof) {
+		is_eof = reader.get_chunk(chunk, UINT32_MAX);
+
+		stream.insert(stream.end(), chunk.data, chunk.data + chunk.size);
+
+		reader.release_chunk(chunk);
+
+		if (chunk.size == 0 && !is_eof) {
+			reader.wait_for_chunk(SOURCE_WAIT_INTERVAL);
+		}
+	}
+
+	return stream;
+}
+
+// Decodes the whole stream with the given number of workers, and checks it's the known PCM
+static std::vector<uint8_t> decode(std::string &file_path, bool use_memory_map, unsigned num_threads,
+	const std::vector<uint8_t> &pcm_data, uint16_t bit_depth) {
+	FLACReader reader;
+	std::vector<uint8_t> stream;
+
+	reader.is_verbose = false;
+	reader.num_decode_threads = num_threads;
+
+	if (TEST_CHECK(reader.load_file(&file_path, use_memory_map))) {
+		AUDIO_FORMAT format = reader.get_format();
+
+		TEST_CHECK(format.sample_rate == TEST_SAMPLE_RATE && format.num_channels == 2 && format.bit_depth == bit_depth);
+		TEST_CHECK(reader.get_num_frames() == pcm_data.size() / format.block_align);
+
+		stream = read_stream(reader);
+
+		TEST_CHECK(stream == pcm_data);
+		TEST_CHECK(reader.get_num_decode_errors() == 0);
+	}
+
+	return stream;
+}
+
+// Checks that seeking to a frame within a block, past the frames indexed so far and then back to an indexed one, plays
+// the stream from that frame
+static void test_seek(std::string &file_path, bool use_memory_map, const std::vector<uint8_t> &pcm_data) {
+	FLACReader reader;
+
+	reader.is_verbose = false;
+
+	if (!TEST_CHECK(reader.load_file(&file_path, use_memory_map))) {
+		return;
+	}
+
+	uint32_t block_align = reader.get_format().block_align;
+	uint64_t seek_frames[] = {TEST_BLOCK_SIZE * 7 + 1234, TEST_BLOCK_SIZE * 2 - 1, 0, TEST_BLOCK_SIZE * 10 + 999};
+
+	for (uint64_t frame : seek_frames) {
+		TEST_CHECK(reader.seek(frame));
+		TEST_CHECK(read_stream(reader) == std::vector<uint8_t>(pcm_data.begin() + (ptrdiff_t)(frame * block_align),
+			pcm_data.end()));
+	}
+
+	TEST_CHECK(reader.get_num_decode_errors() == 0);
+}
+
+// Decodes a generated stream holding every kind of frame the encoders write (each stereo mode, fixed and LPC
+// subframes) and checks the PCM, streamed and memory mapped, with one worker and with several ones
+static void test_bit_depth(const std::string &work_directory, uint16_t bit_depth) {
+	std::string file_path = work_directory + "/wasabi_flac_reader_test.flac";
+	std::vector<int32_t> samples = make_test_samples(bit_depth, TEST_BLOCK_SIZE * TEST_NUM_FULL_BLOCKS +
+		TEST_LAST_BLOCK_SIZE);
+	std::vector<uint8_t> pcm_data = get_pcm_data(samples, bit_depth);
+
+	if (!TEST_CHECK(write_test_file(file_path, make_test_flac_file(samples, bit_depth)))) {
+		return;
+	}
+
+	for (bool use_memory_map : {false, true}) {
+		std::vector<uint8_t> single_stream = decode(file_path, use_memory_map, 1, pcm_data, bit_depth);
+		std::vector<uint8_t> parallel_stream = decode(file_path, use_memory_map, FLAC_MAX_DECODE_THREADS, pcm_data,
+			bit_depth);
+
+		TEST_CHECK(single_stream == parallel_stream);
+
+		test_seek(file_path, use_memory_map, pcm_data);
+	}
+
+	remove(file_path.c_str());
+}
+
+void run_flac_reader_tests(const TEST_OPTIONS &options) {
+	test_bit_depth(options.work_directory, 16);
+	test_bit_depth(options.work_directory, 24);
+}
@@ -0,0 +1,84 @@
+#include <cstdio>
+#include <memory>
+#include <string>
+#include "format_converter.hpp"
+#include "null_sink.hpp"
+#include "test.hpp"
+#include "wav_reader.hpp"
+
+// Plays a file through the reader (and a format converter, if an output format is given) into a sink consuming it as
+// fast as it's written, and checks that once playback has started no chunk hand-off allocates, whether the data is
+// streamed by the loader thread or memory mapped
+static void test_steady_state(std::string file_path, bool use_memory_map, const AUDIO_FORMAT *output_format) {
+	WAVReader reader;
+
+	reader.is_verbose = false;
+
+	if (!TEST_CHECK(reader.load_file(&file_path, use_memory_map))) {
+		return;
+	}
+
+	std::unique_ptr<FormatConverter> format_converter;
+	AudioSource *source = &reader;
+
+	if (output_format != nullptr) {
+		format_converter = std::make_unique<FormatConverter>(&reader, *output_format, DITHER_TPDF);
+		source = format_converter.get();
+	}
+
+	NullSink sink(source->get_format(), false, 20.0);
+	bool is_eof = false;
+
+	sink.start();
+
+	// The first refills let each stage set up its buffers and the loader start
+	for (int i = 0; i < 2 && !is_eof; i++) {
+		if (sink.refill(*source, is_eof) == 0 && !is_eof) {
+			source->wait_for_chunk(SOURCE_WAIT_INTERVAL);
+		}
+	}
+
+	start_counting_allocations();
+
+	while (!is_eof) {
+		if (sink.refill(*source, is_eof) == 0 && !is_eof) {
+			source->wait_for_chunk(SOURCE_WAIT_INTERVAL);
+		}
+	}
+
+	uint64_t num_allocations = stop_counting_allocations();
+
+	sink.stop();
+
+	TEST_CHECK(num_allocations == 0);
+	TEST_CHECK(sink.get_statistics().num_written_frames == reader.get_num_frames());
+	TEST_CHECK(sink.get_statistics().num_refills > 100);
+}
+
+void run_hand_off_tests(const TEST_OPTIONS &options) {
+	std::string file_path = options.work_directory + "/wasabi_hand_off_test.wav";
+
+	// The hook must see the allocations of this binary, otherwise every other check passes for nothing (the function is
+	// called directly, as the compiler may elide the allocations of new expressions)
+	start_counting_allocations();
+
+	void *data = ::operator new(64);
+
+	TEST_CHECK(stop_counting_allocations() == 1);
+
+	::operator delete(data);
+
+	// 10 seconds, so the ring buffer of the streamed reader (5 seconds) wraps around
+	if (!TEST_CHECK(write_test_file(file_path, make_test_wav_file(44100, 2, 16, 441000)))) {
+		return;
+	}
+
+	AUDIO_FORMAT float_format{44100, 2, 32, 8, 44100 * 8, true, false, CHANNEL_LAYOUT_STEREO};
+
+	test_steady_state(file_path, false, nullptr);
+	test_steady_state(file_path, true, nullptr);
+	test_steady_state(file_path, false, &float_format);
+	test_steady_state(file_path, true, &float_format);
+
+	remove(file_path.c_str());
+}
@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "mixer_kernels.hpp"
+#include "test.hpp"
+
+// Largest error allowed for a mixed sample, relative to the sum of the magnitudes of the mix and of the product it
+// adds: the AVX2 kernel fuses the multiplication with the addition, so it rounds once where the others round twice
+#define TEST_MIX_TOLERANCE 1e-6
+
+// Largest error allowed for a soft clipped sample (full scale being 1): the vectorised kernels multiply by the inverse
+// of the range where the scalar one divides by it, and the AVX2 one fuses the last multiplication with the addition
+#define TEST_SOFT_CLIP_TOLERANCE 1e-6
+
+// Samples following the processed ones, which the kernels must leave as they are
+#define TEST_GUARD_VALUE 3.0f
+
+// Channel counts of the gain patterns: their sizes are 8 to 64 samples, so the vectors start at every position of them
+static const uint16_t CHANNEL_COUNTS[] = {1, 2, 3, 6, 8};
+
+// Thresholds of the soft clip, the mixer keeps them between 0.01 and 0.99
+static const float THRESHOLDS[] = {0.01f, 0.5f, 0.9f, 0.99f};
+
+// Checks the mixes of every instruction set against ones computed in double precision, with gain patterns of every
+// channel count and a mix starting one sample after an aligned address (the voices start at any frame of the mix)
+static void test_mix() {
+	std::vector<float> samples(TEST_KERNEL_MAX_LENGTH);
+	std::vector<float> initial_mix(TEST_KERNEL_MAX_LENGTH);
+
+	fill_random_samples(samples.data(), samples.size(), -1.0f, 1.0f, 13);
+	fill_random_samples(initial_mix.data(), initial_mix.size(), -1.0f, 1.0f, 17);
+
+	for (uint16_t num_channels : CHANNEL_COUNTS) {
+		size_t pattern_size = (size_t)num_channels * MIX_GAIN_PATTERN_FRAMES;
+		std::vector<float> channel_gains(num_channels);
+		std::vector<float> gain_pattern(pattern_size);
+
+		fill_random_samples(channel_gains.data(), num_channels, 0.0f, 2.0f, num_channels);
+
+		for (size_t i = 0; i < pattern_size; i++) {
+			gain_pattern[i] = channel_gains[i % num_channels];
+		}
+
+		for (SIMD_LEVEL level : get_test_simd_levels()) {
+			MIX_KERNEL mix_samples = get_mix_kernel(level);
+
+			for (size_t num_samples : get_test_kernel_lengths()) {
+				std::vector<float> mix(num_samples + 2, TEST_GUARD_VALUE);
+				bool is_accurate = true;
+
+				std::copy(initial_mix.begin(), initial_mix.begin() + (std::ptrdiff_t)num_samples, mix.begin() + 1);
+
+				mix_samples(mix.data() + 1, samples.data(), num_samples, gain_pattern.data(), pattern_size);
+
+				for (size_t i = 0; i < num_samples; i++) {
+					double product = (double)samples[i] * channel_gains[i % num_channels];
+					double expected = initial_mix[i] + product;
+					double magnitude = std::fabs((double)initial_mix[i]) + std::fabs(product);
+
+					is_accurate = is_accurate && std::fabs(mix[i + 1] - expected) <= TEST_MIX_TOLERANCE * magnitude;
+				}
+
+				TEST_CHECK(is_accurate);
+				TEST_CHECK(mix.front() == TEST_GUARD_VALUE && mix.back() == TEST_GUARD_VALUE);
+			}
+		}
+	}
+}
+
+// Soft clips a sample in double precision
+static double soft_clip_reference_sample(float sample, float threshold) {
+	double magnitude = std::fabs((double)sample);
+
+	if (magnitude <= threshold) {
+		return sample;
+	}
+
+	double range = 1.0 - threshold;
+	double excess = (magnitude - threshold) / range;
+	double clipped_magnitude = threshold + range * excess / (1.0 + excess);
+
+	return sample < 0.0f ? -clipped_magnitude : clipped_magnitude;
+}
+
+// Checks the soft clips of every instruction set against one computed in double precision: the samples up to the
+// threshold must be left as they are (bit for bit), the others bent below full scale, and exactly those counted
+static void test_soft_clip() {
+	std::vector<float> input(TEST_KERNEL_MAX_LENGTH);
+
+	// Mostly quiet samples with peaks up to 8 times full scale, so some vectors are left untouched and others are
+	// partially clipped
+	fill_random_samples(input.data(), input.size(), -1.0f, 1.0f, 19);
+
+	for (size_t i = 0; i < input.size(); i += 7) {
+		input[i] *= 8.0f;
+	}
+
+	for (float threshold : THRESHOLDS) {
+		// The threshold itself (not clipped) and the float following it (clipped), with both signs
+		input[1] = threshold;
+		input[2] = -threshold;
+		input[3] = std::nextafter(threshold, 2.0f);
+		input[4] = -std::nextafter(threshold, 2.0f);
+
+		for (SIMD_LEVEL level : get_test_simd_levels()) {
+			SOFT_CLIP_KERNEL soft_clip = get_soft_clip_kernel(level);
+
+			for (size_t num_samples : get_test_kernel_lengths()) {
+				std::vector<float> samples(input.begin(), input.begin() + (std::ptrdiff_t)num_samples);
+				size_t expected_num_clipped_samples = 0;
+				bool is_accurate = true;
+
+				samples.push_back(TEST_GUARD_VALUE);
+
+				size_t num_clipped_samples = soft_clip(samples.data(), num_samples, threshold);
+
+				for (size_t i = 0; i < num_samples; i++) {
+					if (std::fabs(input[i]) <= threshold) {
+						is_accurate = is_accurate && samples[i] == input[i];
+						continue;
+					}
+
+					double expected = soft_clip_reference_sample(input[i], threshold);
+
+					is_accurate = is_accurate && std::fabs(samples[i] - expected) <= TEST_SOFT_CLIP_TOLERANCE &&
+						std::fabs(samples[i]) < 1.0f && (samples[i] < 0.0f) == (input[i] < 0.0f);
+					expected_num_clipped_samples++;
+				}
+
+				TEST_CHECK(is_accurate);
+				TEST_CHECK(num_clipped_samples == expected_num_clipped_samples);
+				TEST_CHECK(samples.back() == TEST_GUARD_VALUE);
+			}
+		}
+	}
+}
+
+void run_mixer_kernels_tests(const TEST_OPTIONS &options) {
+	test_mix();
+	test_soft_clip();
+}
@@ -0,0 +1,75 @@
+#include <cmath>
+#include "resampler_kernels.hpp"
+#include "test.hpp"
+
+// Largest error allowed for a dot product, relative to the sum of the magnitudes of its products: the kernels add the
+// products in different orders (and the AVX2 one fuses the multiplications with the additions), so their roundings
+// differ. The error of a float sum of n terms is bounded by about n * 2^-24 of that sum, the accumulators of the
+// kernels keep it much lower
+#define TEST_DOT_PRODUCT_TOLERANCE 1e-5
+
+// Checks the dot products of every instruction set against one computed in double precision, with the samples starting
+// at every offset (the history is read from any frame) and filters of every multiple of the taps alignment (the AVX2
+// kernel has a tail of 8 taps after its 16 taps loop)
+static void test_dot_product() {
+	size_t max_num_taps = (TEST_KERNEL_MAX_LENGTH + RESAMPLER_KERNEL_TAPS_ALIGNMENT - 1) /
+		RESAMPLER_KERNEL_TAPS_ALIGNMENT * RESAMPLER_KERNEL_TAPS_ALIGNMENT;
+	float *samples = (float *)allocate_aligned((max_num_taps + RESAMPLER_KERNEL_TAPS_ALIGNMENT) * sizeof(float));
+	float *coefficients = (float *)allocate_aligned(max_num_taps * sizeof(float));
+
+	fill_random_samples(samples, max_num_taps + RESAMPLER_KERNEL_TAPS_ALIGNMENT, -1.0f, 1.0f, 3);
+	fill_random_samples(coefficients, max_num_taps, -0.5f, 0.5f, 5);
+
+	for (SIMD_LEVEL level : get_test_simd_levels()) {
+		DOT_PRODUCT_KERNEL get_dot_product = get_dot_product_kernel(level);
+
+		for (size_t length : get_test_kernel_lengths()) {
+			size_t num_taps = (length + RESAMPLER_KERNEL_TAPS_ALIGNMENT - 1) / RESAMPLER_KERNEL_TAPS_ALIGNMENT *
+				RESAMPLER_KERNEL_TAPS_ALIGNMENT;
+
+			for (size_t offset = 0; offset < RESAMPLER_KERNEL_TAPS_ALIGNMENT; offset++) {
+				double expected = 0.0;
+				double magnitude = 0.0;
+
+				for (size_t i = 0; i < num_taps; i++) {
+					expected += (double)samples[offset + i] * coefficients[i];
+					magnitude += std::fabs((double)samples[offset + i] * coefficients[i]);
+				}
+
+				double dot_product = get_dot_product(samples + offset, coefficients, num_taps);
+
+				TEST_CHECK(std::fabs(dot_product - expected) <= TEST_DOT_PRODUCT_TOLERANCE * magnitude);
+			}
+		}
+	}
+
+	free_aligned(samples);
+	free_aligned(coefficients);
+}
+
+// Checks that the products are exact when they can be: samples and coefficients of few significant bits, whose sums
+// are all representable, give the same dot product whatever the instruction set
+static void test_exact_dot_product() {
+	size_t num_taps = 1024;
+	float *samples = (float *)allocate_aligned(num_taps * sizeof(float));
+	float *coefficients = (float *)allocate_aligned(num_taps * sizeof(float));
+	double expected = 0.0;
+
+	for (size_t i = 0; i < num_taps; i++) {
+		samples[i] = (float)((int)(i * 37 % 201) - 100) / 128.0f;
+		coefficients[i] = (float)((int)(i * 11 % 61) - 30) / 64.0f;
+		expected += (double)samples[i] * coefficients[i];
+	}
+
+	for (SIMD_LEVEL level : get_test_simd_levels()) {
+		TEST_CHECK(get_dot_product_kernel(level)(samples, coefficients, num_taps) == expected);
+	}
+
+	free_aligned(samples);
+	free_aligned(coefficients);
+}
+
+void run_resampler_kernels_tests(const TEST_OPTIONS &options) {
+	test_dot_product();
+	test_exact_dot_product();
+}
@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+#include "ring_buffer.hpp"
+#include "test.hpp"
+
+// Bytes streamed by the stress tests: their value depends on their position (an offset of any multiple of 256 bytes
+// changes it too) and on the stream, so a byte lost, repeated or left over from a previous stream is noticed
+static uint8_t get_stream_byte(uint64_t position, uint32_t stream) {
+	return (uint8_t)(position ^ (position >> 8) ^ (position >> 16) ^ (stream * 0x9Du));
+}
+
+// Writes the stream in spans of random sizes, through the zero-copy API or the copying one, until it has been written
+// or the buffer is closed. Returns the number of bytes written
+static uint64_t produce(RingBuffer &ring_buffer, uint64_t size, uint32_t stream, bool is_copying, uint32_t seed) {
+	std::mt19937 random(seed);
+	std::vector<uint8_t> data;
+	uint64_t position = 0;
+
+	while (position < size) {
+		size_t span_size = std::min<uint64_t>(size - position, random() % ring_buffer.get_capacity() + 1);
+
+		if (!ring_buffer.wait_for_writable(1)) {
+			break;
+		}
+
+		if (is_copying) {
+			data.resize(span_size);
+
+			for (size_t i = 0; i < span_size; i++) {
+				data[i] = get_stream_byte(position + i, stream);
+			}
+
+			position += ring_buffer.write(data.data(), span_size);
+		}
+		else {
+			uint8_t *span;
+
+			span_size = std::min(span_size, ring_buffer.acquire_write(&span));
+
+			for (size_t i = 0; i < span_size; i++) {
+				span[i] = get_stream_byte(position + i, stream);
+			}
+
+			ring_buffer.commit_write(span_size);
+			position += span_size;
+		}
+	}
+
+	return position;
+}
+
+// Reads the stream in spans of random sizes until the given size has been read or the buffer is drained, checking
+// every byte. Returns the number of bytes read
+static uint64_t consume(RingBuffer &ring_buffer, uint64_t size, uint32_t stream, bool is_copying, uint32_t seed) {
+	std::mt19937 random(seed);
+	std::vector<uint8_t> data(ring_buffer.get_capacity());
+	uint64_t position = 0;
+	bool is_intact = true;
+
+	while (position < size && is_intact) {
+		size_t span_size = std::min<uint64_t>(size - position, random() % ring_buffer.get_capacity() + 1);
+
+		// Waits for a random amount of data, the buffer may hold more or less than what's read next
+		if (!ring_buffer.wait_for_readable(span_size)) {
+			break;
+		}
+
+		const uint8_t *span = data.data();
+
+		if (is_copying) {
+			span_size = ring_buffer.read(data.data(), span_size);
+		}
+		else {
+			span_size = std::min(span_size, ring_buffer.acquire_read(&span));
+		}
+
+		for (size_t i = 0; i < span_size && is_intact; i++) {
+			is_intact = span[i] == get_stream_byte(position + i, stream);
+		}
+
+		if (!is_copying) {
+			ring_buffer.commit_read(span_size);
+		}
+
+		position += span_size;
+	}
+
+	TEST_CHECK(is_intact);
+
+	return position;
+}
+
+static void test_wraparound() {
+	RingBuffer ring_buffer;
+	uint8_t *write_span;
+	const uint8_t *read_span;
+	uint8_t data[10];
+
+	ring_buffer.allocate(10);
+
+	// Fills most of the buffer and frees part of it, so the next write wraps around the end of the storage
+	for (uint8_t i = 0; i < 8; i++) {
+		data[i] = i;
+	}
+
+	TEST_CHECK(ring_buffer.write(data, 8) == 8);
+	TEST_CHECK(ring_buffer.read(data, 5) == 5);
+	TEST_CHECK(data[0] == 0 && data[4] == 4);
+	TEST_CHECK(ring_buffer.get_readable_size() == 3);
+	TEST_CHECK(ring_buffer.get_writable_size() == 7);
+
+	// The zero-copy API only lends the contiguous space before the end of the storage
+	TEST_CHECK(ring_buffer.acquire_write(&write_span) == 2);
+
+	for (uint8_t i = 0; i < 7; i++) {
+		data[i] = (uint8_t)(8 + i);
+	}
+
+	TEST_CHECK(ring_buffer.write(data, 10) == 7);
+	TEST_CHECK(ring_buffer.get_writable_size() == 0);
+	TEST_CHECK(ring_buffer.acquire_write(&write_span) == 0);
+
+	// The consumer only reloads the write position once it has read what it had seen of it
+	TEST_CHECK(ring_buffer.acquire_read(&read_span) == 3);
+	TEST_CHECK(read_span[0] == 5 && read_span[2] == 7);
+
+	ring_buffer.commit_read(3);
+
+	TEST_CHECK(ring_buffer.acquire_read(&read_span) == 2);
+	TEST_CHECK(read_span[0] == 8 && read_span[1] == 9);
+
+	ring_buffer.commit_read(2);
+
+	TEST_CHECK(ring_buffer.acquire_read(&read_span) == 5);
+	TEST_CHECK(read_span[0] == 10 && read_span[4] == 14);
+
+	ring_buffer.commit_read(5);
+
+	TEST_CHECK(ring_buffer.get_readable_size() == 0);
+	TEST_CHECK(ring_buffer.get_writable_size() == 10);
+}
+
+static void test_stress(size_t capacity, bool is_copying) {
+	// An odd capacity (not a power of two) makes the spans wrap around at every possible offset
+	const uint64_t stream_size = 64ull * 1024 * 1024;
+	RingBuffer ring_buffer;
+	uint64_t num_written_bytes = 0;
+
+	ring_buffer.allocate(capacity);
+
+	std::thread producer([&]() {
+		num_written_bytes = produce(ring_buffer, stream_size, 1, is_copying, 1);
+
+		ring_buffer.close();
+	});
+
+	uint64_t num_read_bytes = consume(ring_buffer, UINT64_MAX, 1, is_copying, 2);
+
+	producer.join();
+
+	TEST_CHECK(num_written_bytes == stream_size);
+	TEST_CHECK(num_read_bytes == stream_size);
+	TEST_CHECK(ring_buffer.is_drained());
+}
+
+static void test_close() {
+	RingBuffer ring_buffer;
+	uint8_t data[64] = {};
+
+	ring_buffer.allocate(64);
+
+	// Closing wakes up a consumer waiting for more data than will ever come, the data written before stays readable
+	std::thread producer([&]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+		ring_buffer.write(data, 16);
+		ring_buffer.close();
+	});
+
+	TEST_CHECK(ring_buffer.wait_for_readable(64));
+	TEST_CHECK(ring_buffer.is_closed());
+	TEST_CHECK(!ring_buffer.is_drained());
+	TEST_CHECK(ring_buffer.read(data, 64) == 16);
+	TEST_CHECK(ring_buffer.is_drained());
+	TEST_CHECK(!ring_buffer.wait_for_readable(1));
+
+	producer.join();
+
+	// Closing wakes up a producer waiting for space the consumer will never free
+	ring_buffer.reset();
+	ring_buffer.write(data, 64);
+
+	bool is_writable = true;
+	std::thread blocked_producer([&]() {
+		is_writable = ring_buffer.wait_for_writable(1);
+	});
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	ring_buffer.close();
+	blocked_producer.join();
+
+	TEST_CHECK(!is_writable);
+
+	// A wait with a timeout gives up when nothing comes
+	ring_buffer.reset();
+
+	auto start_time = std::chrono::steady_clock::now();
+
+	TEST_CHECK(!ring_buffer.wait_for_readable(1, std::chrono::milliseconds(20)));
+	TEST_CHECK(std::chrono::steady_clock::now() - start_time >= std::chrono::milliseconds(20));
+}
+
+static void test_reset() {
+	// Plays the role of a reader seeking over and over: a part of each stream is read, the producer is stopped by
+	// closing the buffer, and the buffer is reset before the next stream starts
+	const uint64_t stream_size = 1024 * 1024;
+	RingBuffer ring_buffer;
+	std::mt19937 random(3);
+
+	ring_buffer.allocate(4099);
+
+	for (uint32_t stream = 0; stream < 200; stream++) {
+		uint64_t read_size = random() % stream_size;
+
+		std::thread producer([&]() {
+			produce(ring_buffer, stream_size, stream, stream % 2 == 0, stream);
+		});
+
+		TEST_CHECK(consume(ring_buffer, read_size, stream, stream % 3 == 0, stream + 1) == read_size);
+
+		ring_buffer.close();
+		producer.join();
+		ring_buffer.reset();
+
+		// Nothing of the previous stream is left, and the buffer accepts writes again
+		TEST_CHECK(ring_buffer.get_readable_size() == 0);
+		TEST_CHECK(ring_buffer.get_writable_size() == ring_buffer.get_capacity());
+		TEST_CHECK(!ring_buffer.is_closed());
+	}
+}
+
+// Checks that a storage that can't be allocated is reported, and leaves a closed buffer no side waits on
+static void test_allocation_failure() {
+	RingBuffer ring_buffer;
+	uint8_t data[16] = {};
+
+	TEST_CHECK(!ring_buffer.allocate(SIZE_MAX));
+	TEST_CHECK(ring_buffer.get_capacity() == 0);
+
+	// The waits would block on an open buffer
+	if (!TEST_CHECK(ring_buffer.is_closed() && ring_buffer.is_drained())) {
+		return;
+	}
+
+	TEST_CHECK(!ring_buffer.wait_for_writable(1));
+	TEST_CHECK(!ring_buffer.wait_for_readable(1));
+	TEST_CHECK(ring_buffer.read(data, sizeof(data)) == 0);
+
+	ring_buffer.reset();
+
+	TEST_CHECK(ring_buffer.is_closed());
+	TEST_CHECK(!ring_buffer.allocate(0));
+
+	// A later allocation that succeeds reopens the buffer
+	TEST_CHECK(ring_buffer.allocate(sizeof(data)));
+	TEST_CHECK(!ring_buffer.is_closed());
+	TEST_CHECK(ring_buffer.write(data, sizeof(data)) == sizeof(data));
+	TEST_CHECK(ring_buffer.get_readable_size() == sizeof(data));
+}
+
+void run_ring_buffer_tests(const TEST_OPTIONS &options) {
+	test_wraparound();
+	test_stress(1021, false);
+	test_stress(1021, true);
+	test_stress(64 * 1024, false);
+	test_close();
+	test_reset();
+	test_allocation_failure();
+}
@@ -0,0 +1,87 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "segment_renderer.hpp"
+#include "test.hpp"
+
+// Builds a float WAV file of two sines (the test data bytes would be read as arbitrary floats, NaNs included)
+static std::vector<uint8_t> make_float_wav_file(uint32_t sample_rate, uint64_t num_frames) {
+	std::vector<uint8_t> data = make_test_wav_file(sample_rate, 2, 32, num_frames);
+
+	// WAVE_FORMAT_IEEE_FLOAT
+	data[20] = 3;
+
+	for (uint64_t frame = 0; frame < num_frames; frame++) {
+		float samples[2];
+
+		samples[0] = 0.5f * std::sin((float)frame * 0.0123f) + 0.3f * std::sin((float)frame * 0.00071f);
+		samples[1] = -0.7f * samples[0];
+
+		memcpy(data.data() + 44 + frame * 8, samples, sizeof(samples));
+	}
+
+	return data;
+}
+
+// Renders the file with the given number of workers, returns the stream as it's lent
+static std::vector<uint8_t> render(const std::string &file_path, const AUDIO_FORMAT &format, unsigned num_threads) {
+	SegmentRenderer renderer(std::vector<std::string>{file_path}, false, DITHER_TPDF, RESAMPLER_QUALITY_MEDIUM, false,
+		num_threads);
+	std::vector<uint8_t> stream;
+
+	renderer.is_verbose = false;
+
+	if (!TEST_CHECK(renderer.open()) || !TEST_CHECK(renderer.set_format(format))) {
+		return stream;
+	}
+
+	AUDIO_CHUNK chunk;
+	bool is_eof = false;
+
+	while (!is_eof) {
+		is_eof = renderer.get_chunk(chunk, UINT32_MAX);
+
+		stream.insert(stream.end(), chunk.data, chunk.data + chunk.size);
+
+		renderer.release_chunk(chunk);
+
+		if (chunk.size == 0 && !is_eof) {
+			renderer.wait_for_chunk(SOURCE_WAIT_INTERVAL);
+		}
+	}
+
+	renderer.join();
+
+	TEST_CHECK(renderer.get_num_failed_segments() == 0);
+
+	return stream;
+}
+
+// Checks that the stream is the same whatever the number of workers, the dither of each segment (float samples
+// reduced to 16 bits) being seeded from its position rather than from what its worker rendered before
+static void test_worker_count(const std::string &file_path, const AUDIO_FORMAT &format, uint64_t num_frames) {
+	std::vector<uint8_t> single_stream = render(file_path, format, 1);
+	std::vector<uint8_t> parallel_stream = render(file_path, format, 4);
+
+	TEST_CHECK(single_stream.size() == num_frames * format.block_align);
+	TEST_CHECK(single_stream == parallel_stream);
+}
+
+void run_segment_renderer_tests(const TEST_OPTIONS &options) {
+	std::string file_path = options.work_directory + "/wasabi_segment_renderer_test.wav";
+	uint64_t num_frames = 44100 * 37;
+
+	// 37 seconds, split into segments of 10, 10 and 17 seconds
+	if (!TEST_CHECK(write_test_file(file_path, make_float_wav_file(44100, num_frames)))) {
+		return;
+	}
+
+	test_worker_count(file_path, make_audio_format(44100, 2, 16), num_frames);
+
+	// The segments starting within the track are preceded by a preroll for the resampler
+	test_worker_count(file_path, make_audio_format(48000, 2, 16), (num_frames * 48000 + 44099) / 44100);
+
+	remove(file_path.c_str());
+}
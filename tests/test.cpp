@@ -0,0 +1,208 @@
+#include "test.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// Counted from every thread (the stress tests check from their producers and consumers)
+static std::atomic<uint64_t> num_checks{};
+static std::atomic<uint64_t> num_failed_checks{};
+
+static std::atomic<bool> is_counting_allocations{};
+static std::atomic<uint64_t> num_allocations{};
+
+static void *allocate(size_t size, size_t alignment) {
+	if (is_counting_allocations.load(std::memory_order_relaxed)) {
+		num_allocations.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	size = size != 0 ? size : 1;
+
+#ifdef _WIN32
+	void *data = alignment > alignof(std::max_align_t) ? _aligned_malloc(size, alignment) : malloc(size);
+#else
+	void *data = nullptr;
+
+	if (alignment > alignof(std::max_align_t)) {
+		data = posix_memalign(&data, alignment, size) == 0 ? data : nullptr;
+	}
+	else {
+		data = malloc(size);
+	}
+#endif
+
+	if (data == nullptr) {
+		throw std::bad_alloc();
+	}
+
+	return data;
+}
+
+static void deallocate(void *data, size_t alignment) {
+#ifdef _WIN32
+	if (alignment > alignof(std::max_align_t)) {
+		_aligned_free(data);
+
+		return;
+	}
+#endif
+
+	free(data);
+}
+
+// Replaces the global allocation functions, so the allocations of any code run by the tests are counted
+void *operator new(size_t size) {
+	return allocate(size, alignof(std::max_align_t));
+}
+
+void *operator new[](size_t size) {
+	return allocate(size, alignof(std::max_align_t));
+}
+
+void *operator new(size_t size, std::align_val_t alignment) {
+	return allocate(size, (size_t)alignment);
+}
+
+void *operator new[](size_t size, std::align_val_t alignment) {
+	return allocate(size, (size_t)alignment);
+}
+
+void operator delete(void *data) noexcept {
+	deallocate(data, alignof(std::max_align_t));
+}
+
+void operator delete[](void *data) noexcept {
+	deallocate(data, alignof(std::max_align_t));
+}
+
+void operator delete(void *data, size_t size) noexcept {
+	deallocate(data, alignof(std::max_align_t));
+}
+
+void operator delete[](void *data, size_t size) noexcept {
+	deallocate(data, alignof(std::max_align_t));
+}
+
+void operator delete(void *data, std::align_val_t alignment) noexcept {
+	deallocate(data, (size_t)alignment);
+}
+
+void operator delete[](void *data, std::align_val_t alignment) noexcept {
+	deallocate(data, (size_t)alignment);
+}
+
+void operator delete(void *data, size_t size, std::align_val_t alignment) noexcept {
+	deallocate(data, (size_t)alignment);
+}
+
+void operator delete[](void *data, size_t size, std::align_val_t alignment) noexcept {
+	deallocate(data, (size_t)alignment);
+}
+
+bool check_test_condition(bool condition, const char *expression, const char *file, int line) {
+	num_checks.fetch_add(1, std::memory_order_relaxed);
+
+	if (!condition) {
+		num_failed_checks.fetch_add(1, std::memory_order_relaxed);
+
+		fprintf(stderr, "FAILED: %s (%s:%d)\n", expression, file, line);
+	}
+
+	return condition;
+}
+
+uint64_t get_num_checks() {
+	return num_checks.load();
+}
+
+uint64_t get_num_failed_checks() {
+	return num_failed_checks.load();
+}
+
+void start_counting_allocations() {
+	num_allocations.store(0);
+	is_counting_allocations.store(true);
+}
+
+uint64_t stop_counting_allocations() {
+	is_counting_allocations.store(false);
+
+	return num_allocations.load();
+}
+
+static void write_uint16(std::vector<uint8_t> &data, size_t offset, uint16_t value) {
+	data[offset] = (uint8_t)value;
+	data[offset + 1] = (uint8_t)(value >> 8);
+}
+
+static void write_uint32(std::vector<uint8_t> &data, size_t offset, uint32_t value) {
+	write_uint16(data, offset, (uint16_t)value);
+	write_uint16(data, offset + 2, (uint16_t)(value >> 16));
+}
+
+std::vector<uint8_t> make_test_wav_file(uint32_t sample_rate, uint16_t num_channels, uint16_t bit_depth,
+	uint64_t num_frames) {
+	uint16_t block_align = (uint16_t)(num_channels * bit_depth / 8);
+	uint32_t data_size = (uint32_t)(num_frames * block_align);
+	std::vector<uint8_t> data(44 + data_size);
+
+	// RIFF header, 16 bytes 'fmt ' chunk and 'data' chunk
+	memcpy(data.data(), "RIFF", 4);
+	write_uint32(data, 4, 36 + data_size);
+	memcpy(data.data() + 8, "WAVEfmt ", 8);
+	write_uint32(data, 16, 16);
+	write_uint16(data, 20, 1);
+	write_uint16(data, 22, num_channels);
+	write_uint32(data, 24, sample_rate);
+	write_uint32(data, 28, sample_rate * block_align);
+	write_uint16(data, 32, block_align);
+	write_uint16(data, 34, bit_depth);
+	memcpy(data.data() + 36, "data", 4);
+	write_uint32(data, 40, data_size);
+
+	for (uint32_t i = 0; i < data_size; i++) {
+		data[44 + i] = get_test_data_byte(i);
+	}
+
+	return data;
+}
+
+bool write_test_file(const std::string &file_path, const std::vector<uint8_t> &data) {
+	FILE *file = fopen(file_path.c_str(), "wb");
+
+	if (file == nullptr) {
+		return false;
+	}
+
+	bool is_written = fwrite(data.data(), 1, data.size(), file) == data.size();
+
+	return fclose(file) == 0 && is_written;
+}
+
+std::vector<SIMD_LEVEL> get_test_simd_levels() {
+	std::vector<SIMD_LEVEL> levels;
+
+	for (int level = SIMD_LEVEL_SCALAR; level <= get_simd_level(); level++) {
+		levels.push_back((SIMD_LEVEL)level);
+	}
+
+	return levels;
+}
+
+const std::vector<size_t> &get_test_kernel_lengths() {
+	static const std::vector<size_t> lengths = {
+		0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 1000, TEST_KERNEL_MAX_LENGTH
+	};
+
+	return lengths;
+}
+
+void fill_random_samples(float *samples, size_t num_samples, float min_value, float max_value, uint32_t seed) {
+	for (size_t i = 0; i < num_samples; i++) {
+		seed = seed * 1664525u + 1013904223u;
+
+		samples[i] = min_value + (max_value - min_value) * (float)(seed >> 8) * (1.0f / 16777216.0f);
+	}
+}
@@ -0,0 +1,75 @@
+#ifndef WASABI_TEST_HPP
+#define WASABI_TEST_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "simd.hpp"
+
+// Checks a condition, the failed ones are reported with their location and counted (the test goes on, so a run lists
+// every failure)
+#define TEST_CHECK(condition) check_test_condition((condition), #condition, __FILE__, __LINE__)
+
+// Settings of the tests, from the command line
+typedef struct TEST_OPTIONS {
+	std::vector<std::string> test_names; // Empty to run them all
+	std::string work_directory; // Where the test files are generated
+} TEST_OPTIONS;
+
+bool check_test_condition(bool condition, const char *expression, const char *file, int line);
+
+uint64_t get_num_checks();
+
+uint64_t get_num_failed_checks();
+
+// Counts the allocations made through operator new (replaced by the tests) by every thread until the count is stopped
+void start_counting_allocations();
+
+uint64_t stop_counting_allocations();
+
+// Gets the value of the byte at the given offset of the audio data of the test files (251 is prime, so a shift by a
+// whole number of frames changes it)
+inline uint8_t get_test_data_byte(uint64_t offset) {
+	return (uint8_t)(offset % 251);
+}
+
+// Builds a canonical PCM WAV file holding the given number of frames of test data
+std::vector<uint8_t> make_test_wav_file(uint32_t sample_rate, uint16_t num_channels, uint16_t bit_depth,
+	uint64_t num_frames);
+
+bool write_test_file(const std::string &file_path, const std::vector<uint8_t> &data);
+
+// Gets the instruction sets the kernels are compared at, from the scalar one up to the best one the CPU supports
+std::vector<SIMD_LEVEL> get_test_simd_levels();
+
+// Gets the lengths the kernels are tested with: around the multiples of the widths of the vectors (4 and 8 floats, 16
+// and 32 bytes), so every tail is covered, and a long odd one. None is longer than TEST_KERNEL_MAX_LENGTH
+#define TEST_KERNEL_MAX_LENGTH 1021
+
+const std::vector<size_t> &get_test_kernel_lengths();
+
+// Fills the samples with pseudo-random floats between min_value and max_value, the same ones for a given seed
+void fill_random_samples(float *samples, size_t num_samples, float min_value, float max_value, uint32_t seed);
+
+// Tests of each component
+void run_ring_buffer_tests(const TEST_OPTIONS &options);
+
+void run_hand_off_tests(const TEST_OPTIONS &options);
+
+void run_wav_reader_tests(const TEST_OPTIONS &options);
+
+void run_flac_reader_tests(const TEST_OPTIONS &options);
+
+void run_aiff_reader_tests(const TEST_OPTIONS &options);
+
+void run_conversion_kernels_tests(const TEST_OPTIONS &options);
+
+void run_resampler_kernels_tests(const TEST_OPTIONS &options);
+
+void run_channel_mixer_kernels_tests(const TEST_OPTIONS &options);
+
+void run_mixer_kernels_tests(const TEST_OPTIONS &options);
+
+void run_segment_renderer_tests(const TEST_OPTIONS &options);
+
+#endif //WASABI_TEST_HPP
@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include "test.hpp"
+
+typedef struct TEST_SUITE {
+	const char *name;
+	void (*run)(const TEST_OPTIONS &options);
+} TEST_SUITE;
+
+static const TEST_SUITE test_suites[] = {
+	{"ring_buffer", run_ring_buffer_tests},
+	{"hand_off", run_hand_off_tests},
+	{"wav_reader", run_wav_reader_tests},
+	{"flac_reader", run_flac_reader_tests},
+	{"aiff_reader", run_aiff_reader_tests},
+	{"conversion_kernels", run_conversion_kernels_tests},
+	{"resampler_kernels", run_resampler_kernels_tests},
+	{"channel_mixer_kernels", run_channel_mixer_kernels_tests},
+	{"mixer_kernels", run_mixer_kernels_tests},
+	{"segment_renderer", run_segment_renderer_tests}
+};
+
+// Splits a comma separated list of the command line
+static std::vector<std::string> split_list(const char *list) {
+	std::vector<std::string> items;
+	std::stringstream stream(list);
+	std::string item;
+
+	while (std::getline(stream, item, ',')) {
+		if (!item.empty()) {
+			items.push_back(item);
+		}
+	}
+
+	return items;
+}
+
+int main(int argc, char* argv[]) {
+	TEST_OPTIONS options;
+	const char *temp_directory = getenv("TMPDIR");
+
+	options.work_directory = temp_directory != nullptr && temp_directory[0] != '\0' ? temp_directory : "/tmp";
+
+	for (int i = 0; i < argc; i++) {
+		if (strcmp(argv[i], "--tests") == 0 && (i + 1) < argc) {
+			options.test_names = split_list(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "--work_dir") == 0 && (i + 1) < argc) {
+			options.work_directory = argv[i + 1];
+		}
+	}
+
+	// A misspelt name would otherwise pass by running nothing
+	for (const std::string &test_name : options.test_names) {
+		if (std::none_of(std::begin(test_suites), std::end(test_suites), [&](const TEST_SUITE &test_suite) {
+			return test_name == test_suite.name;
+		})) {
+			std::cerr << "ERROR: Unknown test suite: " << test_name << std::endl;
+
+			return 1;
+		}
+	}
+
+	// Runs the selected suites, each one reporting how many of its checks failed
+	for (const TEST_SUITE &test_suite : test_suites) {
+		if (!options.test_names.empty() && std::find(options.test_names.begin(), options.test_names.end(),
+			test_suite.name) == options.test_names.end()) {
+			continue;
+		}
+
+		uint64_t num_checks = get_num_checks();
+		uint64_t num_failed_checks = get_num_failed_checks();
+		auto start_time = std::chrono::steady_clock::now();
+
+		test_suite.run(options);
+
+		printf("[%s: %llu checks, %llu failed, %.3f s]\n", test_suite.name,
+			(unsigned long long)(get_num_checks() - num_checks),
+			(unsigned long long)(get_num_failed_checks() - num_failed_checks),
+			std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count());
+	}
+
+	return get_num_failed_checks() == 0 ? 0 : 1;
+}
@@ -0,0 +1,527 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "test.hpp"
+#include "wav_reader.hpp"
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+// Size of the regions of test data written into the sparse files (the rest of their audio data reads as zeros)
+#define TEST_REGION_SIZE 4096
+
+static void append_uint16(std::vector<uint8_t> &data, uint16_t value) {
+	data.push_back((uint8_t)value);
+	data.push_back((uint8_t)(value >> 8));
+}
+
+static void append_uint32(std::vector<uint8_t> &data, uint32_t value) {
+	append_uint16(data, (uint16_t)value);
+	append_uint16(data, (uint16_t)(value >> 16));
+}
+
+static void append_uint64(std::vector<uint8_t> &data, uint64_t value) {
+	append_uint32(data, (uint32_t)value);
+	append_uint32(data, (uint32_t)(value >> 32));
+}
+
+static void append_chunk_header(std::vector<uint8_t> &data, const char *id, uint32_t size) {
+	data.insert(data.end(), id, id + 4);
+	append_uint32(data, size);
+}
+
+// Builds the header of an RF64 file of 16 bits stereo frames, all its 32 bits size fields left to the 'ds64' chunk: the
+// RIFF and data sizes, and the size of a 'JUNK' chunk through the table of the 'ds64' chunk
+static std::vector<uint8_t> make_rf64_header(uint64_t data_size) {
+	std::vector<uint8_t> header;
+
+	append_chunk_header(header, "RF64", UINT32_MAX);
+	header.insert(header.end(), {'W', 'A', 'V', 'E'});
+
+	append_chunk_header(header, "ds64", 28 + 12);
+	append_uint64(header, 0);
+	append_uint64(header, data_size);
+	append_uint64(header, data_size / 4);
+	append_uint32(header, 1);
+	header.insert(header.end(), {'J', 'U', 'N', 'K'});
+	append_uint64(header, 6);
+
+	append_chunk_header(header, "JUNK", UINT32_MAX);
+	header.insert(header.end(), 6, 0);
+
+	append_chunk_header(header, "fmt ", 16);
+	append_uint16(header, WAV_FORMAT_PCM);
+	append_uint16(header, 2);
+	append_uint32(header, 44100);
+	append_uint32(header, 44100 * 4);
+	append_uint16(header, 4);
+	append_uint16(header, 16);
+
+	append_chunk_header(header, "data", UINT32_MAX);
+
+	// RIFF size (the whole file but the RIFF ID and size fields)
+	uint64_t riff_size = header.size() - 8 + data_size;
+
+	for (int i = 0; i < 8; i++) {
+		header[20 + i] = (uint8_t)(riff_size >> (i * 8));
+	}
+
+	return header;
+}
+
+// Writes a region of test data at the given offset of the audio data, leaving the file sparse before it
+static bool write_test_region(std::ofstream &file, uint64_t data_offset, uint64_t position, uint64_t size) {
+	std::vector<uint8_t> region(size);
+
+	for (uint64_t i = 0; i < size; i++) {
+		region[i] = get_test_data_byte(position + i);
+	}
+
+	file.seekp((std::streamoff)(data_offset + position));
+	file.write(reinterpret_cast<const char *>(region.data()), (std::streamsize)size);
+
+	return file.good();
+}
+
+// Gets the next chunk of the reader, waiting for its loader when it has nothing ready yet
+static bool get_next_chunk(WAVReader &reader, AUDIO_CHUNK &chunk, uint32_t max_size) {
+	bool is_eof = reader.get_chunk(chunk, max_size);
+
+	while (chunk.size == 0 && !is_eof) {
+		reader.release_chunk(chunk);
+		reader.wait_for_chunk(SOURCE_WAIT_INTERVAL);
+
+		is_eof = reader.get_chunk(chunk, max_size);
+	}
+
+	return is_eof;
+}
+
+// Reads from the current position until the end of the stream or until the given size has been read, checking that
+// the data is the test data starting at the given position. Returns the number of bytes read
+static uint64_t read_test_data(WAVReader &reader, uint64_t position, uint64_t size) {
+	AUDIO_CHUNK chunk;
+	uint64_t num_read_bytes = 0;
+	bool is_eof = false;
+	bool is_intact = true;
+
+	while (!is_eof && num_read_bytes < size) {
+		is_eof = get_next_chunk(reader, chunk, (uint32_t)std::min<uint64_t>(size - num_read_bytes, UINT32_MAX));
+
+		for (uint32_t i = 0; i < chunk.size && is_intact; i++) {
+			is_intact = chunk.data[i] == get_test_data_byte(position + num_read_bytes + i);
+		}
+
+		num_read_bytes += chunk.size;
+		reader.release_chunk(chunk);
+	}
+
+	TEST_CHECK(is_intact);
+
+	return num_read_bytes;
+}
+
+// Checks that the 64 bits sizes of the 'ds64' chunk replace the 32 bits ones, and that seeking past 4 GB reaches the
+// right bytes, in a sparse file of 4.5 GB whose audio data is only written around the seek targets
+static void test_rf64(const std::string &work_directory, bool use_memory_map) {
+	const uint64_t data_size = 4608ull * 1024 * 1024;
+	const uint64_t seek_frame = (4096ull + 256) * 1024 * 1024 / 4 + 3;
+	std::string file_path = work_directory + "/wasabi_rf64_test.wav";
+	std::vector<uint8_t> header = make_rf64_header(data_size);
+
+	{
+		std::ofstream file(file_path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+		file.write(reinterpret_cast<const char *>(header.data()), (std::streamsize)header.size());
+
+		if (!TEST_CHECK(write_test_region(file, header.size(), seek_frame * 4, TEST_REGION_SIZE) &&
+			write_test_region(file, header.size(), data_size - TEST_REGION_SIZE, TEST_REGION_SIZE))) {
+			remove(file_path.c_str());
+
+			return;
+		}
+	}
+
+	WAVReader reader;
+
+	reader.is_verbose = false;
+
+	if (TEST_CHECK(reader.load_file(&file_path, use_memory_map))) {
+		TEST_CHECK(reader.is_rf64);
+		TEST_CHECK(reader.chunk_size == header.size() - 8 + data_size);
+		TEST_CHECK(reader.find_chunk("JUNK") != nullptr && reader.find_chunk("JUNK")->size == 6);
+		TEST_CHECK(reader.find_chunk("data") != nullptr && reader.find_chunk("data")->size == data_size);
+		TEST_CHECK(reader.data_subchunk_size == data_size);
+		TEST_CHECK(reader.get_num_frames() == data_size / 4);
+		TEST_CHECK(reader.audio_duration.minutes == 456 && reader.audio_duration.seconds == 31);
+
+		// Past 4 GB, and to the last frames (whose end has to be found from the 64 bits size)
+		TEST_CHECK(reader.seek(seek_frame));
+		TEST_CHECK(read_test_data(reader, seek_frame * 4, TEST_REGION_SIZE) == TEST_REGION_SIZE);
+
+		TEST_CHECK(reader.seek(data_size / 4 - TEST_REGION_SIZE / 4));
+		TEST_CHECK(read_test_data(reader, data_size - TEST_REGION_SIZE, UINT64_MAX) == TEST_REGION_SIZE);
+	}
+
+	remove(file_path.c_str());
+}
+
+// Checks that an empty 'data' chunk (size 0) is played as an empty stream, not read until the end of the file like a
+// chunk whose size was left unset (0xFFFFFFFF), which would play the chunks following it as audio
+static void test_data_size(const std::string &work_directory, bool use_memory_map) {
+	std::string file_path = work_directory + "/wasabi_data_size_test.wav";
+	std::vector<uint8_t> data = make_test_wav_file(44100, 2, 16, 0);
+
+	append_chunk_header(data, "LIST", 4 + 8 + 8);
+	data.insert(data.end(), {'I', 'N', 'F', 'O', 'I', 'S', 'F', 'T', 8, 0, 0, 0, 'w', 'a', 's', 'a', 'b', 'i', 0, 0});
+
+	TEST_CHECK(write_test_file(file_path, data));
+
+	AUDIO_CHUNK chunk;
+	WAVReader empty_reader;
+
+	empty_reader.is_verbose = false;
+
+	if (TEST_CHECK(empty_reader.load_file(&file_path, use_memory_map))) {
+		TEST_CHECK(empty_reader.data_subchunk_size == 0);
+		TEST_CHECK(empty_reader.get_num_frames() == 0);
+		TEST_CHECK(get_next_chunk(empty_reader, chunk, UINT32_MAX));
+		TEST_CHECK(chunk.size == 0);
+
+		empty_reader.release_chunk(chunk);
+	}
+
+	// The same file with the size unset, whose audio data goes on until the end of the file (the 'LIST' chunk)
+	std::fill(data.begin() + 40, data.begin() + 44, 0xFF);
+
+	TEST_CHECK(write_test_file(file_path, data));
+
+	WAVReader unset_reader;
+
+	unset_reader.is_verbose = false;
+
+	if (TEST_CHECK(unset_reader.load_file(&file_path, use_memory_map))) {
+		TEST_CHECK(unset_reader.data_subchunk_size == data.size() - 44);
+		TEST_CHECK(unset_reader.get_num_frames() == (data.size() - 44) / 4);
+	}
+
+	remove(file_path.c_str());
+}
+
+// Appends a 'fmt ' chunk of 16 bits stereo PCM at 44100 Hz: the base format (16 bytes), with an empty extension (18
+// bytes) or as WAVE_FORMAT_EXTENSIBLE (40 bytes) with the given channel mask
+static void append_fmt_chunk(std::vector<uint8_t> &data, uint32_t size, uint32_t channel_mask = 0) {
+	append_chunk_header(data, "fmt ", size);
+	append_uint16(data, size == WAV_FMT_MAX_SIZE ? WAV_FORMAT_EXTENSIBLE : WAV_FORMAT_PCM);
+	append_uint16(data, 2);
+	append_uint32(data, 44100);
+	append_uint32(data, 44100 * 4);
+	append_uint16(data, 4);
+	append_uint16(data, 16);
+
+	if (size == 18) {
+		append_uint16(data, 0);
+	} else if (size == WAV_FMT_MAX_SIZE) {
+		// Valid bits, channel mask and the subformat GUID (KSDATAFORMAT_SUBTYPE_PCM)
+		append_uint16(data, 22);
+		append_uint16(data, 16);
+		append_uint32(data, channel_mask);
+		data.insert(data.end(), {1, 0, 0, 0, 0, 0, 0x10, 0, 0x80, 0, 0, 0xAA, 0, 0x38, 0x9B, 0x71});
+	}
+}
+
+// Appends a chunk of the given size, padded to an even size, its data filled with its size
+static void append_filler_chunk(std::vector<uint8_t> &data, const char *id, uint32_t size) {
+	append_chunk_header(data, id, size);
+	data.insert(data.end(), size + (size & 1), (uint8_t)size);
+}
+
+static void append_data_chunk(std::vector<uint8_t> &data, uint32_t size) {
+	append_chunk_header(data, "data", size);
+
+	for (uint32_t i = 0; i < size; i++) {
+		data.push_back(get_test_data_byte(i));
+	}
+}
+
+static std::vector<uint8_t> make_riff_header() {
+	std::vector<uint8_t> data;
+
+	append_chunk_header(data, "RIFF", 0);
+	data.insert(data.end(), {'W', 'A', 'V', 'E'});
+
+	return data;
+}
+
+// Sets the RIFF size once the chunks have been appended
+static void set_riff_size(std::vector<uint8_t> &data) {
+	for (int i = 0; i < 4; i++) {
+		data[4 + i] = (uint8_t)((data.size() - 8) >> (i * 8));
+	}
+}
+
+// Checks that a chunk was indexed at the given offset of the file (that of its data) with the given size
+static bool is_chunk_indexed(WAVReader &reader, const char *id, uint64_t offset, uint64_t size) {
+	const RIFF_CHUNK *chunk = reader.find_chunk(id);
+
+	return chunk != nullptr && chunk->offset == offset && chunk->size == size;
+}
+
+// Loads the file, and checks that its whole audio data is the test data of the given size
+static void check_file(std::string &file_path, const std::vector<uint8_t> &data, bool use_memory_map,
+	uint64_t data_size, const std::function<void(WAVReader &reader)> &check_header) {
+	WAVReader reader;
+
+	reader.is_verbose = false;
+
+	if (TEST_CHECK(write_test_file(file_path, data)) && TEST_CHECK(reader.load_file(&file_path, use_memory_map))) {
+		check_header(reader);
+
+		TEST_CHECK(reader.data_subchunk_size == data_size);
+		TEST_CHECK(read_test_data(reader, 0, UINT64_MAX) == data_size);
+	}
+}
+
+// Checks that the chunks preceding the 'fmt ' chunk (padding, tags, broadcast extension) are skipped and indexed, the
+// odd sized one being followed by a padding byte
+static void test_leading_chunks(const std::string &work_directory, bool use_memory_map) {
+	std::string file_path = work_directory + "/wasabi_leading_chunks_test.wav";
+	std::vector<uint8_t> data = make_riff_header();
+
+	append_filler_chunk(data, "JUNK", 28);
+	append_filler_chunk(data, "LIST", 13);
+	append_filler_chunk(data, "bext", 603);
+	append_fmt_chunk(data, 16);
+	append_data_chunk(data, 4000);
+	set_riff_size(data);
+
+	check_file(file_path, data, use_memory_map, 4000, [](WAVReader &reader) {
+		TEST_CHECK(is_chunk_indexed(reader, "JUNK", 20, 28));
+		TEST_CHECK(is_chunk_indexed(reader, "LIST", 56, 13));
+		TEST_CHECK(is_chunk_indexed(reader, "bext", 78, 603));
+		TEST_CHECK(is_chunk_indexed(reader, "fmt ", 690, 16));
+		TEST_CHECK(is_chunk_indexed(reader, "data", 714, 4000));
+		TEST_CHECK(reader.num_channels == 2 && reader.sample_rate == 44100 && reader.bit_depth == 16);
+	});
+
+	remove(file_path.c_str());
+}
+
+// Checks the 'fmt ' chunks with an empty extension (18 bytes) and of the WAVE_FORMAT_EXTENSIBLE format (40 bytes, whose
+// channel mask replaces the default one)
+static void test_fmt_sizes(const std::string &work_directory, bool use_memory_map) {
+	std::string file_path = work_directory + "/wasabi_fmt_sizes_test.wav";
+	std::vector<uint8_t> data = make_riff_header();
+
+	append_fmt_chunk(data, 18);
+	append_data_chunk(data, 4000);
+	set_riff_size(data);
+
+	check_file(file_path, data, use_memory_map, 4000, [](WAVReader &reader) {
+		TEST_CHECK(reader.fmt_subchunk_size == 18);
+		TEST_CHECK(reader.audio_format == WAV_FORMAT_PCM);
+		TEST_CHECK(reader.get_format().channel_mask == get_default_channel_mask(2));
+	});
+
+	// Back left and right speakers
+	data = make_riff_header();
+
+	append_fmt_chunk(data, WAV_FMT_MAX_SIZE, 0x30);
+	append_data_chunk(data, 4000);
+	set_riff_size(data);
+
+	check_file(file_path, data, use_memory_map, 4000, [](WAVReader &reader) {
+		TEST_CHECK(reader.fmt_subchunk_size == WAV_FMT_MAX_SIZE);
+		TEST_CHECK(reader.audio_format == WAV_FORMAT_PCM);
+		TEST_CHECK(reader.get_format().channel_mask == 0x30);
+	});
+
+	remove(file_path.c_str());
+}
+
+// Checks a 'data' chunk found past the first region read (WAV_HEADER_READ_SIZE bytes), after a large chunk, and one
+// whose header straddles the end of that region
+static void test_data_offset(const std::string &work_directory, bool use_memory_map) {
+	std::string file_path = work_directory + "/wasabi_data_offset_test.wav";
+
+	// Offsets of the audio data: the 'JUNK' chunk starts after the 'fmt ' chunk (at 36), its data 8 bytes later
+	for (uint32_t data_offset : {100000u, WAV_HEADER_READ_SIZE - 4u, WAV_HEADER_READ_SIZE + 4u,
+		WAV_HEADER_READ_SIZE + 8u}) {
+		std::vector<uint8_t> data = make_riff_header();
+
+		append_fmt_chunk(data, 16);
+		append_filler_chunk(data, "JUNK", data_offset - 8 - 36 - 8);
+		append_data_chunk(data, 20000);
+		set_riff_size(data);
+
+		check_file(file_path, data, use_memory_map, 20000, [](WAVReader &reader) {
+			TEST_CHECK(reader.find_chunk("JUNK") != nullptr);
+			TEST_CHECK(reader.find_chunk("data") != nullptr &&
+				reader.find_chunk("data")->offset == reader.find_chunk("JUNK")->offset +
+				reader.find_chunk("JUNK")->size + 8);
+		});
+	}
+
+	remove(file_path.c_str());
+}
+
+// Checks that the chunks following the audio data are indexed, close to it or past a region of the file, and that
+// they aren't played. The bytes following the last chunk (too short to be one) are left out
+static void test_trailing_chunks(const std::string &work_directory, bool use_memory_map) {
+	std::string file_path = work_directory + "/wasabi_trailing_chunks_test.wav";
+
+	for (uint32_t data_size : {4000u, 200000u}) {
+		std::vector<uint8_t> data = make_riff_header();
+
+		append_fmt_chunk(data, 16);
+		append_data_chunk(data, data_size);
+		append_filler_chunk(data, "LIST", 13);
+		append_filler_chunk(data, "bext", 602);
+		append_filler_chunk(data, "id3 ", WAV_TRAILER_READ_SIZE + 10);
+		append_filler_chunk(data, "JUNK", 0);
+		set_riff_size(data);
+		data.insert(data.end(), 3, 0);
+
+		uint64_t trailer_offset = 44 + data_size;
+
+		check_file(file_path, data, use_memory_map, data_size, [trailer_offset](WAVReader &reader) {
+			TEST_CHECK(is_chunk_indexed(reader, "LIST", trailer_offset + 8, 13));
+			TEST_CHECK(is_chunk_indexed(reader, "bext", trailer_offset + 30, 602));
+			TEST_CHECK(is_chunk_indexed(reader, "id3 ", trailer_offset + 640, WAV_TRAILER_READ_SIZE + 10));
+			TEST_CHECK(is_chunk_indexed(reader, "JUNK", trailer_offset + 640 + WAV_TRAILER_READ_SIZE + 18, 0));
+			TEST_CHECK(reader.chunks.size() == 6);
+		});
+	}
+
+	remove(file_path.c_str());
+}
+
+// Checks that malformed or truncated headers are rejected
+static void test_malformed_headers(const std::string &work_directory) {
+	std::string file_path = work_directory + "/wasabi_malformed_header_test.wav";
+	std::vector<std::vector<uint8_t>> files;
+	std::vector<uint8_t> data;
+
+	// Too short, not a RIFF file, not a WAVE file
+	files.push_back({'R', 'I', 'F', 'F', 0, 0, 0, 0});
+	files.push_back(make_test_wav_file(44100, 2, 16, 100));
+	memcpy(files.back().data(), "RIFX", 4);
+	files.push_back(make_test_wav_file(44100, 2, 16, 100));
+	memcpy(files.back().data() + 8, "AVI ", 4);
+
+	// No 'data' chunk, no 'fmt ' chunk, the 'fmt ' chunk after the 'data' chunk
+	data = make_riff_header();
+	append_fmt_chunk(data, 16);
+	files.push_back(data);
+
+	data = make_riff_header();
+	append_data_chunk(data, 400);
+	files.push_back(data);
+
+	data = make_riff_header();
+	append_data_chunk(data, 400);
+	append_fmt_chunk(data, 16);
+	files.push_back(data);
+
+	// A 'fmt ' chunk too short, one cut by the end of the file, an extensible one without its extension
+	data = make_riff_header();
+	append_filler_chunk(data, "fmt ", 14);
+	append_data_chunk(data, 400);
+	files.push_back(data);
+
+	data = make_riff_header();
+	append_fmt_chunk(data, 16);
+	data.resize(data.size() - 6);
+	files.push_back(data);
+
+	data = make_riff_header();
+	append_fmt_chunk(data, WAV_FMT_MAX_SIZE, 0x3);
+	data[16] = 18;
+	data.resize(data.size() - (WAV_FMT_MAX_SIZE - 18));
+	append_data_chunk(data, 400);
+	files.push_back(data);
+
+	// A bad block alignment
+	files.push_back(make_test_wav_file(44100, 2, 16, 100));
+	files.back()[32] = 6;
+
+	// A chunk whose size goes past the end of the file before the 'data' chunk
+	data = make_riff_header();
+	append_fmt_chunk(data, 16);
+	append_chunk_header(data, "JUNK", 100000);
+	data.insert(data.end(), 1000, 0);
+	files.push_back(data);
+
+	// The errors are expected, they aren't printed
+	std::streambuf *error_buffer = std::cerr.rdbuf(nullptr);
+
+	for (const std::vector<uint8_t> &file : files) {
+		WAVReader reader;
+
+		reader.is_verbose = false;
+
+		TEST_CHECK(write_test_file(file_path, file) && !reader.load_file(&file_path));
+	}
+
+	std::cerr.rdbuf(error_buffer);
+
+	remove(file_path.c_str());
+}
+
+#ifndef _WIN32
+// Checks that a seek on a pipe fails without disturbing the stream, which goes on from where it was
+static void test_pipe_seek(const std::string &work_directory) {
+	std::string pipe_path = work_directory + "/wasabi_pipe_test.wav";
+	std::vector<uint8_t> data = make_test_wav_file(44100, 2, 16, 88200);
+
+	remove(pipe_path.c_str());
+
+	if (!TEST_CHECK(mkfifo(pipe_path.c_str(), 0600) == 0)) {
+		return;
+	}
+
+	// Writes the file into the pipe as the reader consumes it (the reader's open waits for this one)
+	std::thread writer([&]() {
+		write_test_file(pipe_path, data);
+	});
+
+	WAVReader reader;
+
+	reader.is_verbose = false;
+
+	if (TEST_CHECK(reader.load_file(&pipe_path))) {
+		TEST_CHECK(!reader.seek(44100));
+		TEST_CHECK(read_test_data(reader, 0, UINT64_MAX) == data.size() - 44);
+	}
+
+	writer.join();
+	remove(pipe_path.c_str());
+}
+#endif
+
+void run_wav_reader_tests(const TEST_OPTIONS &options) {
+	test_rf64(options.work_directory, false);
+	test_rf64(options.work_directory, true);
+	test_data_size(options.work_directory, false);
+	test_data_size(options.work_directory, true);
+
+	for (bool use_memory_map : {false, true}) {
+		test_leading_chunks(options.work_directory, use_memory_map);
+		test_fmt_sizes(options.work_directory, use_memory_map);
+		test_data_offset(options.work_directory, use_memory_map);
+		test_trailing_chunks(options.work_directory, use_memory_map);
+	}
+
+	test_malformed_headers(options.work_directory);
+
+#ifndef _WIN32
+	test_pipe_seek(options.work_directory);
+#endif
+}
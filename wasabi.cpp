@@ -1,78 +1,323 @@
 #include "player.hpp"
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <string>
 
-void parse_args(int argc, char* argv[], std::string* file_path, int* rendering_endpoint_buffer_duration) {
+void load_playlist(const char* playlist_path, PLAYBACK_OPTIONS* options) {
+	// Reads an M3U playlist: one path per line (relative ones start from the playlist directory), '#' starts a comment
+	std::ifstream playlist_file(playlist_path);
+	std::string playlist_directory = playlist_path;
+	std::string line;
+
+	if (!playlist_file.is_open()) {
+		std::cerr << "WARNING: Unable to open the playlist \"" << playlist_path << "\"." << std::endl;
+
+		return;
+	}
+
+	size_t separator_pos = playlist_directory.find_last_of("/\\");
+
+	playlist_directory = separator_pos != std::string::npos ? playlist_directory.substr(0, separator_pos + 1) : "";
+
+	while (std::getline(playlist_file, line)) {
+		line.erase(line.find_last_not_of(" \t\r\n") + 1);
+
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+
+		bool is_absolute = line[0] == '/' || line[0] == '\\' || (line.size() > 1 && line[1] == ':');
+
+		options->file_paths.push_back(is_absolute ? line : playlist_directory + line);
+	}
+}
+
+void parse_args(int argc, char* argv[], PLAYBACK_OPTIONS* options) {
 	// Checks if all parameters are provided, if not, initializes all required but non defined parameters with their default values
-	int file_pos = -1;
+	int playlist_pos = -1;
 	int rendering_endpoint_buffer_duration_pos = -1;
+	int buffer_duration_pos = -1;
+	int sink_pos = -1;
+	int output_pos = -1;
+	int sample_format_pos = -1;
+	int dither_pos = -1;
+	int sample_rate_pos = -1;
+	int resampler_quality_pos = -1;
+	int channels_pos = -1;
+	int start_pos = -1;
+	int cache_size_pos = -1;
+	int meter_output_pos = -1;
+	int render_to_pos = -1;
+	int render_threads_pos = -1;
+	int trace_pos = -1;
 
 	for (int i = 0; i < argc; i++) {
-		if (strcmp(argv[i], "--file") == TRUE) {
-			if ((i + 1) < (argc - 1)) {
-				file_pos = i + 1;
+		if (strcmp(argv[i], "--file") == 0) {
+			// Every file given is appended to the playlist
+			if ((i + 1) < argc) {
+				options->file_paths.push_back(argv[i + 1]);
 			}
 		}
-		else if (strcmp(argv[i], "--rendering_endpoint_buffer_duration") == TRUE) {
-			if ((i + 1) < (argc - 1)) {
+		else if (strcmp(argv[i], "--playlist") == 0) {
+			if ((i + 1) < argc) {
+				playlist_pos = i + 1;
+			}
+		}
+		else if (strcmp(argv[i], "--rendering_endpoint_buffer_duration") == 0) {
+			if ((i + 1) < argc) {
 				rendering_endpoint_buffer_duration_pos = i + 1;
 			}
 		}
+		else if (strcmp(argv[i], "--buffer_duration") == 0) {
+			if ((i + 1) < argc) {
+				buffer_duration_pos = i + 1;
+			}
+		}
+		else if (strcmp(argv[i], "--exclusive") == 0) {
+			options->is_exclusive = true;
+		}
+		else if (strcmp(argv[i], "--memory_map") == 0) {
+			options->use_memory_map = true;
+		}
+		else if (strcmp(argv[i], "--sink") == 0) {
+			if ((i + 1) < argc) {
+				sink_pos = i + 1;
+			}
+		}
+		else if (strcmp(argv[i], "--output") == 0) {
+			if ((i + 1) < argc) {
+				output_pos = i + 1;
+			}
+		}
+		else if (strcmp(argv[i], "--sample_format") == 0) {
+			if ((i + 1) < argc) {
+				sample_format_pos = i + 1;
+			}
+		}
+		else if (strcmp(argv[i], "--dither") == 0) {
+			if ((i + 1) < argc) {
+				dither_pos = i + 1;
+			}
+		}
+		else if (strcmp(argv[i], "--sample_rate") == 0) {
+			if ((i + 1) < argc) {
+				sample_rate_pos = i + 1;
+			}
+		}
+		else if (strcmp(argv[i], "--resampler_quality") == 0) {
+			if ((i + 1) < argc) {
+				resampler_quality_pos = i + 1;
+			}
+		}
+		else if (strcmp(argv[i], "--channels") == 0) {
+			if ((i + 1) < argc) {
+				channels_pos = i + 1;
+			}
+		}
+		else if (strcmp(argv[i], "--start") == 0) {
+			if ((i + 1) < argc) {
+				start_pos = i + 1;
+			}
+		}
+		else if (strcmp(argv[i], "--mix") == 0) {
+			options->is_mixed = true;
+		}
+		else if (strcmp(argv[i], "--cache_size") == 0) {
+			if ((i + 1) < argc) {
+				cache_size_pos = i + 1;
+			}
+		}
+		else if (strcmp(argv[i], "--meter") == 0) {
+			options->is_metered = true;
+		}
+		else if (strcmp(argv[i], "--meter_output") == 0) {
+			if ((i + 1) < argc) {
+				meter_output_pos = i + 1;
+			}
+		}
+		else if (strcmp(argv[i], "--render_to") == 0 || strcmp(argv[i], "--render-to") == 0) {
+			if ((i + 1) < argc) {
+				render_to_pos = i + 1;
+			}
+		}
+		else if (strcmp(argv[i], "--render_threads") == 0) {
+			if ((i + 1) < argc) {
+				render_threads_pos = i + 1;
+			}
+		}
+		else if (strcmp(argv[i], "--instrument") == 0) {
+			options->is_instrumented = true;
+		}
+		else if (strcmp(argv[i], "--trace") == 0) {
+			if ((i + 1) < argc) {
+				trace_pos = i + 1;
+			}
+		}
 	}
 
-	if (file_pos != -1) {
-		*file_path = argv[file_pos];
+	if (playlist_pos != -1) {
+		load_playlist(argv[playlist_pos], options);
 	}
-	else {
+
+	if (options->file_paths.empty()) {
 		std::string input_file_path;
 
 		std::cout << "Input file: ";
 		std::getline(std::cin, input_file_path);
 
-		*file_path = input_file_path;
+		options->file_paths.push_back(input_file_path);
 	}
 
+	// The buffer duration is given in seconds by the original option, and in (fractional) milliseconds by the new one
 	if (rendering_endpoint_buffer_duration_pos != -1) {
-		*rendering_endpoint_buffer_duration = strtol(argv[rendering_endpoint_buffer_duration_pos], nullptr, 10);
+		options->rendering_endpoint_buffer_duration = strtod(argv[rendering_endpoint_buffer_duration_pos], nullptr) * 1000.0;
 	}
-	else {
-		*rendering_endpoint_buffer_duration = 1;
+
+	if (buffer_duration_pos != -1) {
+		options->rendering_endpoint_buffer_duration = strtod(argv[buffer_duration_pos], nullptr);
 	}
-}
 
-void block_std_input() {
-	// Block standard input to be shown in the console
-	HANDLE h = GetStdHandle(STD_INPUT_HANDLE);
-	DWORD mode;
+	if (sink_pos != -1) {
+		if (strcmp(argv[sink_pos], "wasapi") == 0) {
+			options->sink_type = SINK_WASAPI;
+		}
+		else if (strcmp(argv[sink_pos], "null") == 0) {
+			options->sink_type = SINK_NULL;
+		}
+		else if (strcmp(argv[sink_pos], "null_unthrottled") == 0) {
+			options->sink_type = SINK_NULL_UNTHROTTLED;
+		}
+		else if (strcmp(argv[sink_pos], "wav") == 0) {
+			options->sink_type = SINK_WAV_FILE;
+		}
+		else if (strcmp(argv[sink_pos], "raw") == 0) {
+			options->sink_type = SINK_RAW_FILE;
+		}
+		else {
+			std::cerr << "WARNING: Unknown sink \"" << argv[sink_pos] << "\", the default one will be used." << std::endl;
+		}
+	}
 
-	if (GetConsoleMode(h, &mode)) {
-		mode &= ~ENABLE_ECHO_INPUT;
+	// Exclusive mode runs at the minimum device period by default
+	if (options->is_exclusive && options->sink_type == SINK_WASAPI && buffer_duration_pos == -1 &&
+		rendering_endpoint_buffer_duration_pos == -1) {
+		options->rendering_endpoint_buffer_duration = 0.0;
+	}
 
-		SetConsoleMode(h, mode);
+	if (output_pos != -1) {
+		options->output_file_path = argv[output_pos];
+	}
+	else if (options->sink_type == SINK_WAV_FILE || options->sink_type == SINK_RAW_FILE) {
+		options->output_file_path = options->sink_type == SINK_WAV_FILE ? "output.wav" : "output.raw";
 	}
-}
 
-void hide_console_cursor() {
-	HANDLE consoleHandle = GetStdHandle(STD_OUTPUT_HANDLE);
-	CONSOLE_CURSOR_INFO info;
+	if (sample_format_pos != -1) {
+		if (strcmp(argv[sample_format_pos], "u8") == 0) {
+			options->output_bit_depth = 8;
+		}
+		else if (strcmp(argv[sample_format_pos], "s16") == 0) {
+			options->output_bit_depth = 16;
+		}
+		else if (strcmp(argv[sample_format_pos], "s24") == 0) {
+			options->output_bit_depth = 24;
+		}
+		else if (strcmp(argv[sample_format_pos], "s32") == 0) {
+			options->output_bit_depth = 32;
+		}
+		else if (strcmp(argv[sample_format_pos], "f32") == 0) {
+			options->output_bit_depth = 32;
+			options->is_output_float = true;
+		}
+		else {
+			std::cerr << "WARNING: Unknown sample format \"" << argv[sample_format_pos]
+				<< "\", the one of the file will be used." << std::endl;
+		}
+	}
 
-	info.dwSize = 100;
-	info.bVisible = FALSE;
+	if (dither_pos != -1) {
+		if (strcmp(argv[dither_pos], "none") == 0) {
+			options->dither_type = DITHER_NONE;
+		}
+		else if (strcmp(argv[dither_pos], "tpdf") == 0) {
+			options->dither_type = DITHER_TPDF;
+		}
+		else {
+			std::cerr << "WARNING: Unknown dither \"" << argv[dither_pos] << "\", TPDF dither will be used." << std::endl;
+		}
+	}
 
-	SetConsoleCursorInfo(consoleHandle, &info);
-}
+	if (sample_rate_pos != -1) {
+		options->output_sample_rate = strtoul(argv[sample_rate_pos], nullptr, 10);
+	}
 
+	if (channels_pos != -1) {
+		options->output_num_channels = (uint16_t)strtoul(argv[channels_pos], nullptr, 10);
+	}
+
+	if (start_pos != -1) {
+		options->start_time = strtod(argv[start_pos], nullptr);
+	}
 
+	if (cache_size_pos != -1) {
+		// Given in megabytes
+		options->cache_size = (uint64_t)(strtod(argv[cache_size_pos], nullptr) * 1048576.0);
+	}
+
+	// Writing the readings implies measuring them
+	if (meter_output_pos != -1) {
+		options->meter_output_path = argv[meter_output_pos];
+		options->is_metered = true;
+	}
+
+	// Rendering to a file replaces the playback (the sink only tells whether raw samples are written)
+	if (render_to_pos != -1) {
+		options->render_output_path = argv[render_to_pos];
+	}
+
+	if (render_threads_pos != -1) {
+		options->num_render_threads = (unsigned)strtoul(argv[render_threads_pos], nullptr, 10);
+	}
+
+	// Writing the trace implies instrumenting the pipeline
+	if (trace_pos != -1) {
+		options->trace_output_path = argv[trace_pos];
+		options->is_instrumented = true;
+	}
+
+	if (resampler_quality_pos != -1) {
+		if (strcmp(argv[resampler_quality_pos], "low") == 0) {
+			options->resampler_quality = RESAMPLER_QUALITY_LOW;
+		}
+		else if (strcmp(argv[resampler_quality_pos], "medium") == 0) {
+			options->resampler_quality = RESAMPLER_QUALITY_MEDIUM;
+		}
+		else if (strcmp(argv[resampler_quality_pos], "high") == 0) {
+			options->resampler_quality = RESAMPLER_QUALITY_HIGH;
+		}
+		else if (strcmp(argv[resampler_quality_pos], "best") == 0) {
+			options->resampler_quality = RESAMPLER_QUALITY_BEST;
+		}
+		else {
+			std::cerr << "WARNING: Unknown resampler quality \"" << argv[resampler_quality_pos]
+				<< "\", the high quality preset will be used." << std::endl;
+		}
+	}
+}
 
 int main(int argc, char* argv[]) {
-	std::string file;
-	int rendering_endpoint_buffer_duration;
+	PLAYBACK_OPTIONS options;
+
+	parse_args(argc, argv, &options);
 
-	parse_args(argc, argv, &file, &rendering_endpoint_buffer_duration);
-	block_std_input();
-	hide_console_cursor();
+	Player player;
 
-	Player player = Player();
-	player.play_audio_stream(file, rendering_endpoint_buffer_duration);
+	if (!options.render_output_path.empty()) {
+		player.render_audio_stream(options);
+	}
+	else {
+		player.play_audio_stream(options);
+	}
 
 	return 0;
-}
\ No newline at end of file
+}